@@ -74,6 +74,40 @@ typedef struct {
 
 static int next_id (riff_context *ctxt);
 
+/* sectors read and written per I/O call when converting */
+#define CDXA_BLOCK_SECTORS 64
+
+static void
+_write_data (riff_context *ctxt, const uint8_t *buf, unsigned sectors)
+{
+  if (!sectors)
+    return;
+
+  if (fwrite (buf, M2F2_SECTOR_SIZE, sectors, ctxt->fd_out) != sectors)
+    {
+      vcd_error ("fwrite (): %s", strerror (errno));
+      fclose (ctxt->fd);
+      fclose (ctxt->fd_out);
+      exit (EXIT_FAILURE);
+    }
+}
+
+/* sets the output length to the given number of sectors; empty
+   sectors that were skipped at the end become holes */
+static void
+_truncate_data (riff_context *ctxt, long sectors)
+{
+  fflush (ctxt->fd_out);
+
+  if (ftruncate (fileno (ctxt->fd_out), sectors * M2F2_SECTOR_SIZE))
+    {
+      vcd_error ("ftruncate (): %s", strerror (errno));
+      fclose (ctxt->fd);
+      fclose (ctxt->fd_out);
+      exit (EXIT_FAILURE);
+    }
+}
+
 static uint32_t
 read_le_u32 (riff_context *ctxt)
 {
@@ -134,31 +168,67 @@ handler_data (riff_context *ctxt)
 
   if (ctxt->fd_out)
     {
-      long first_nzero = -1, last_nzero = -1, s;
-      struct {
+      long first_nzero = -1, last_nzero = -1, s = 0;
+      long holes = 0; /* empty sectors not yet accounted for in output */
+      unsigned out_count = 0;
+      uint8_t *outbuf;
+      struct sbuf {
 	uint8_t sync[CDIO_CD_SYNC_SIZE];
 	uint8_t header[CDIO_CD_HEADER_SIZE];
 	uint8_t subheader[CDIO_CD_SUBHEADER_SIZE];
 	uint8_t data[M2F2_SECTOR_SIZE];
 	uint8_t edc[CDIO_CD_EDC_SIZE];
-      } GNUC_PACKED sbuf;
+      } GNUC_PACKED *sbuf;
 
-      vcd_assert (sizeof (sbuf) == CDIO_CD_FRAMESIZE_RAW);
+      vcd_assert (sizeof (struct sbuf) == CDIO_CD_FRAMESIZE_RAW);
 
       vcd_info ("...converting...");
 
-      for (s = 0; s < sectors; s++)
+      sbuf = calloc(CDXA_BLOCK_SECTORS, sizeof (struct sbuf));
+      outbuf = calloc(CDXA_BLOCK_SECTORS, M2F2_SECTOR_SIZE);
+
+      while (s < sectors)
 	{
-	  int r = fread (&sbuf, CDIO_CD_FRAMESIZE_RAW, 1, ctxt->fd);
-	  bool empty = true;
+	  const unsigned want = MIN (CDXA_BLOCK_SECTORS, sectors - s);
+	  const unsigned r = fread (sbuf, CDIO_CD_FRAMESIZE_RAW, want,
+				    ctxt->fd);
+	  unsigned i;
+
+	  for (i = 0; i < r; i++, s++)
+	    {
+	      if (_vcd_mem_is_zero (sbuf[i].data, M2F2_SECTOR_SIZE))
+		{
+		  /* leading empty sectors are dropped, inner ones
+		     become holes in the output file */
+		  if (first_nzero != -1)
+		    holes++;
+		  continue;
+		}
+
+	      last_nzero = s;
+
+	      if (first_nzero == -1)
+		first_nzero = s;
 
-	  {
-	    int i;
-	    for (i = 0; (i < M2F2_SECTOR_SIZE) && !sbuf.data[i]; i++);
-	    empty = i == M2F2_SECTOR_SIZE;
-	  }
+	      if (holes)
+		{
+		  _write_data (ctxt, outbuf, out_count);
+		  out_count = 0;
 
-	  if (!r)
+		  if (fseek (ctxt->fd_out, holes * M2F2_SECTOR_SIZE, SEEK_CUR))
+		    vcd_error ("fseek (): %s", strerror (errno));
+		  holes = 0;
+		}
+
+	      memcpy (outbuf + out_count * M2F2_SECTOR_SIZE, sbuf[i].data,
+		      M2F2_SECTOR_SIZE);
+	      out_count++;
+	    }
+
+	  _write_data (ctxt, outbuf, out_count);
+	  out_count = 0;
+
+	  if (r < want)
 	    {
 	      if (ferror (ctxt->fd))
 		vcd_error ("fread (): %s", strerror (errno));
@@ -166,32 +236,25 @@ handler_data (riff_context *ctxt)
 	      if (feof (ctxt->fd))
 		vcd_warn ("premature end of file encountered after %ld sectors", s);
 
+	      /* keep everything read since the first data sector,
+		 including empty sectors not written yet */
+	      if (first_nzero != -1)
+		_truncate_data (ctxt, s - first_nzero);
+
 	      fclose (ctxt->fd);
 	      fclose (ctxt->fd_out);
 	      exit (EXIT_FAILURE);
 	    }
-
-	  if (empty)
-	    {
-	      if (first_nzero == -1)
-		continue;
-	    }
-	  else
-	    {
-	      last_nzero = s;
-
-	      if (first_nzero == -1)
-		first_nzero = s;
-	    }
-
-	  fwrite (&sbuf.data, M2F2_SECTOR_SIZE, 1, ctxt->fd_out);
 	}
 
-      fflush (ctxt->fd_out);
+      free (outbuf);
+      free (sbuf);
 
+      /* trailing empty sectors were never written; the truncation
+	 below only matters if no data was found at all */
       {
 	const long allsecs = (last_nzero - first_nzero + 1);
-	ftruncate (fileno (ctxt->fd_out), allsecs * M2F2_SECTOR_SIZE);
+	_truncate_data (ctxt, allsecs);
 
 	vcd_info ("...stripped %ld leading and %ld trailing empty sectors...",
 		first_nzero, (sectors - last_nzero - 1));
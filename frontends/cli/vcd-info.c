@@ -30,6 +30,11 @@
 #include <string.h>
 #endif
 #include <stddef.h>
+#include <stdarg.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include <popt.h>
 /* Accomodate to older popt that doesn't support the "optional" flag */
@@ -75,6 +80,10 @@ static struct gl_t
   int      quiet_flag;
   int      suppress_warnings;
 
+  int      batch_flag;  /* One line of JSON per image instead of dumps */
+  char     *files_from; /* File with more image names, - for stdin     */
+  int      jobs;        /* Images analyzed in parallel in batch mode   */
+
   struct show_t
   {
     int all;     /* True makes all of the below "show" variables true. */
@@ -1273,12 +1282,378 @@ dump (char *image_fname[])
   exit (EXIT_FAILURE);
 }
 
+/* --batch: analyze many images, possibly in parallel, and print one
+   JSON object per image and line */
+
+typedef struct
+{
+  char *buf;
+  size_t len;
+  size_t size;
+  bool failed;  /* out of memory, buf is incomplete */
+} json_buf_t;
+
+static void
+_json_append (json_buf_t *p_json, const char format[], ...)
+{
+  va_list args;
+  int len;
+
+  if (p_json->failed)
+    return;
+
+  for (;;)
+    {
+      const size_t avail = p_json->size - p_json->len;
+      size_t size;
+      char *p_buf;
+
+      va_start (args, format);
+      len = vsnprintf (p_json->buf + p_json->len, avail, format, args);
+      va_end (args);
+
+      if (len >= 0 && (size_t) len < avail)
+        break;
+
+      size = p_json->size * 2 + (len > 0 ? len : 0) + 64;
+      if (!(p_buf = realloc (p_json->buf, size)))
+        {
+          p_json->failed = true;
+          return;
+        }
+
+      p_json->buf = p_buf;
+      p_json->size = size;
+    }
+
+  p_json->len += len;
+}
+
+/* append str as a quoted JSON string, or null if str is NULL */
+static void
+_json_append_string (json_buf_t *p_json, const char str[])
+{
+  const unsigned char *p;
+
+  if (NULL == str)
+    {
+      _json_append (p_json, "null");
+      return;
+    }
+
+  _json_append (p_json, "\"");
+
+  for (p = (const unsigned char *) str; *p; p++)
+    switch (*p)
+      {
+      case '"':  _json_append (p_json, "\\\""); break;
+      case '\\': _json_append (p_json, "\\\\"); break;
+      case '\n': _json_append (p_json, "\\n"); break;
+      case '\r': _json_append (p_json, "\\r"); break;
+      case '\t': _json_append (p_json, "\\t"); break;
+      default:
+        if (*p < 0x20)
+          _json_append (p_json, "\\u%4.4x", *p);
+        else
+          _json_append (p_json, "%c", *p);
+      }
+
+  _json_append (p_json, "\"");
+}
+
+typedef struct
+{
+  json_buf_t warnings;  /* comma separated JSON strings */
+  json_buf_t errors;
+} batch_log_t;
+
+/* messages logged by the image the current thread is working on; the
+   log handler is shared by all batch workers */
+#ifdef HAVE_PTHREAD_H
+static pthread_key_t gl_batch_log_key;
+static bool gl_batch_log_key_created = false;
+#else
+static batch_log_t *gl_batch_log = NULL;
+#endif
+
+static batch_log_t *
+_batch_log (void)
+{
+#ifdef HAVE_PTHREAD_H
+  return gl_batch_log_key_created
+    ? pthread_getspecific (gl_batch_log_key) : NULL;
+#else
+  return gl_batch_log;
+#endif
+}
+
+static void
+_batch_log_set (batch_log_t *p_log)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_setspecific (gl_batch_log_key, p_log);
+#else
+  gl_batch_log = p_log;
+#endif
+}
+
+static void
+_batch_log_message (vcd_log_level_t level, const char message[])
+{
+  batch_log_t *p_log = _batch_log ();
+  json_buf_t *p_json = NULL;
+
+  switch (level)
+    {
+    case VCD_LOG_WARN:
+      p_json = &p_log->warnings;
+      break;
+    case VCD_LOG_ERROR:
+      p_json = &p_log->errors;
+      break;
+    default:
+      return;
+    }
+
+  if (p_json->len)
+    _json_append (p_json, ", ");
+  _json_append_string (p_json, message);
+}
+
+/* analyze one image and return its JSON line in p_out */
+static bool
+_batch_analyze (const char psz_source[], json_buf_t *p_out)
+{
+  vcdinfo_obj_t *p_obj = NULL;
+  char *psz_name = strdup (psz_source);
+  vcdinfo_open_return_t open_rc;
+  batch_log_t log;
+
+  memset (&log, 0, sizeof (log));
+  _batch_log_set (&log);
+
+  open_rc = vcdinfo_open_lazy (&p_obj, &psz_name, gl.source_type,
+                               gl.access_mode);
+
+  _json_append (p_out, "{\"source\": ");
+  _json_append_string (p_out, psz_source);
+
+  switch (open_rc)
+    {
+    case VCDINFO_OPEN_VCD:
+      _json_append (p_out, ", \"status\": \"vcd\", \"format\": ");
+      _json_append_string (p_out, vcdinfo_get_format_version_str (p_obj));
+      _json_append (p_out, ", \"album_id\": ");
+      _json_append_string (p_out, vcdinfo_get_album_id (p_obj));
+      _json_append (p_out, ", \"volume_id\": ");
+      _json_append_string (p_out, vcdinfo_get_volume_id (p_obj));
+      _json_append (p_out,
+                    ", \"volume\": %u, \"volume_count\": %u"
+                    ", \"sectors\": %lu, \"tracks\": %u, \"entries\": %u"
+                    ", \"segments\": %u, \"lids\": %u, \"psd_size\": %lu"
+                    ", \"pbc\": %s",
+                    vcdinfo_get_volume_num (p_obj),
+                    vcdinfo_get_volume_count (p_obj),
+                    (unsigned long int)
+                    cdio_get_disc_last_lsn (vcdinfo_get_cd_image (p_obj)),
+                    (unsigned int) vcdinfo_get_num_tracks (p_obj),
+                    (unsigned int) vcdinfo_get_num_entries (p_obj),
+                    (unsigned int) vcdinfo_get_num_segments (p_obj),
+                    (unsigned int) vcdinfo_get_num_LIDs (p_obj),
+                    (unsigned long int) vcdinfo_get_psd_size (p_obj),
+                    vcdinfo_has_pbc (p_obj) ? "true" : "false");
+      vcdinfo_close (p_obj);
+      break;
+    case VCDINFO_OPEN_OTHER:
+      /* vcdinfo_open has already disposed of p_obj */
+      _json_append (p_out, ", \"status\": \"other\"");
+      break;
+    case VCDINFO_OPEN_ERROR:
+    default:
+      _json_append (p_out, ", \"status\": \"error\"");
+      break;
+    }
+
+  _batch_log_set (NULL);
+
+  _json_append (p_out, ", \"warnings\": [%s], \"errors\": [%s]}\n",
+                log.warnings.len ? log.warnings.buf : "",
+                log.errors.len ? log.errors.buf : "");
+
+  if (log.warnings.failed || log.errors.failed)
+    p_out->failed = true;
+
+  free (log.warnings.buf);
+  free (log.errors.buf);
+  free (psz_name);
+
+  return VCDINFO_OPEN_ERROR != open_rc;
+}
+
+typedef struct
+{
+  char **names;
+  unsigned count;
+  unsigned next;
+  unsigned failed;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;
+#endif
+} batch_queue_t;
+
+static void *
+_batch_worker (void *user_data)
+{
+  batch_queue_t *p_queue = user_data;
+  json_buf_t out;
+
+  memset (&out, 0, sizeof (out));
+
+  for (;;)
+    {
+      unsigned idx;
+      bool ok;
+
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock (&p_queue->lock);
+#endif
+      idx = p_queue->next++;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock (&p_queue->lock);
+#endif
+
+      if (idx >= p_queue->count)
+        break;
+
+      out.len = 0;
+      out.failed = false;
+      ok = _batch_analyze (p_queue->names[idx], &out) && !out.failed;
+
+      /* write whole lines only, so that output of workers does not
+         interleave */
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock (&p_queue->lock);
+#endif
+      if (out.failed)
+        fprintf (stderr, "out of memory for the results of `%s'\n",
+                 p_queue->names[idx]);
+      else
+        fwrite (out.buf, 1, out.len, stdout);
+      fflush (stdout);
+      if (!ok)
+        p_queue->failed++;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock (&p_queue->lock);
+#endif
+    }
+
+  free (out.buf);
+
+  return NULL;
+}
+
+/* add the names listed in psz_fname (- for stdin), one per line */
+static void
+_batch_read_list (const char psz_fname[], char ***p_names, unsigned *p_count)
+{
+  FILE *fd = strcmp (psz_fname, "-") ? fopen (psz_fname, "r") : stdin;
+  char line[4096];
+
+  if (NULL == fd)
+    {
+      fprintf (stderr, "can't open `%s' - try --help\n", psz_fname);
+      exit (EXIT_FAILURE);
+    }
+
+  while (fgets (line, sizeof (line), fd))
+    {
+      size_t len = strlen (line);
+
+      while (len && (line[len-1] == '\n' || line[len-1] == '\r'))
+        line[--len] = '\0';
+
+      if (!len)
+        continue;
+
+      *p_names = realloc (*p_names, (*p_count + 1) * sizeof (char *));
+      (*p_names)[(*p_count)++] = strdup (line);
+    }
+
+  if (fd != stdin)
+    fclose (fd);
+}
+
+static int
+batch (char *names[], unsigned count)
+{
+  batch_queue_t queue;
+  unsigned nthreads = gl.jobs > 0 ? gl.jobs : 1;
+
+  memset (&queue, 0, sizeof (queue));
+  queue.names = names;
+  queue.count = count;
+
+  if (nthreads > count)
+    nthreads = count;
+
+  /* driver setup is not thread safe; do it before starting workers */
+  cdio_init ();
+
+#ifdef HAVE_PTHREAD_H
+  if (pthread_key_create (&gl_batch_log_key, NULL))
+    {
+      fprintf (stderr, "can't create thread key\n");
+      return EXIT_FAILURE;
+    }
+
+  gl_batch_log_key_created = true;
+  pthread_mutex_init (&queue.lock, NULL);
+
+  if (nthreads > 1)
+    {
+      pthread_t *threads = calloc (nthreads - 1, sizeof (pthread_t));
+      unsigned n, started = 0;
+
+      /* the main thread is one of the workers */
+      for (n = 0; threads && n < nthreads - 1; n++)
+        if (!pthread_create (&threads[n], NULL, _batch_worker, &queue))
+          started++;
+        else
+          break;
+
+      /* whatever is left is done by the main thread */
+      _batch_worker (&queue);
+
+      for (n = 0; n < started; n++)
+        pthread_join (threads[n], NULL);
+
+      free (threads);
+    }
+  else
+#endif
+    _batch_worker (&queue);
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy (&queue.lock);
+#endif
+
+  return queue.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
 static vcd_log_handler_t  gl_default_vcd_log_handler  = NULL;
 static cdio_log_handler_t gl_default_cdio_log_handler = NULL;
 
 static void
 _vcd_log_handler (vcd_log_level_t level, const char message[])
 {
+  /* in batch mode problems go into the JSON line of the image; the
+     default handler would exit on the first error */
+  if (_batch_log () && level != VCD_LOG_ASSERT)
+    {
+      _batch_log_message (level, message);
+      return;
+    }
+
   if (level == VCD_LOG_DEBUG && !(gl.debug_level >= 1))
     return;
 
@@ -1316,6 +1691,9 @@ init()
   gl.quiet_flag       = false;
   gl.source_type      = DRIVER_UNKNOWN;
   gl.access_mode      = NULL;
+  gl.batch_flag       = false;
+  gl.files_from       = NULL;
+  gl.jobs             = 1;
 
   /* Set all of show-flag entries false in one go. */
   memset(&gl.show, false, sizeof(gl.show));
@@ -1428,6 +1806,15 @@ main (int argc, const char *argv[])
      OP_SOURCE_DEVICE,
      "set CD-ROM device as source", "DEVICE"},
 
+    {"batch", '\0', POPT_ARG_NONE, &gl.batch_flag, 0,
+     "print one line of JSON per image; allows several images"},
+
+    {"files-from", '\0', POPT_ARG_STRING, &gl.files_from, 0,
+     "in batch mode also read image names from FILE (- for stdin)", "FILE"},
+
+    {"jobs", 'j', POPT_ARG_INT, &gl.jobs, 0,
+     "in batch mode analyze up to N images in parallel", "N"},
+
     {"debug", 'd', POPT_ARG_INT, &gl.debug_level, 0,
      "Set debugging output to LEVEL"},
 
@@ -1637,7 +2024,78 @@ main (int argc, const char *argv[])
         exit (EXIT_FAILURE);
       }
 
-  if ((args = poptGetArgs (optCon)) != NULL)
+  if (gl.debug_level == 3) {
+    vcd_loglevel_default = VCD_LOG_INFO;
+    cdio_loglevel_default = CDIO_LOG_INFO;
+  } else if (gl.debug_level >= 4) {
+    vcd_loglevel_default = VCD_LOG_DEBUG;
+    cdio_loglevel_default = CDIO_LOG_INFO;
+  }
+
+  args = poptGetArgs (optCon);
+
+  if (gl.files_from && !gl.batch_flag)
+    {
+      fprintf (stderr, "--files-from requires --batch - try --help\n");
+      poptFreeContext(optCon);
+      exit (EXIT_FAILURE);
+    }
+
+  if (gl.batch_flag)
+    {
+      char **names = NULL;
+      unsigned count = 0, n;
+      int rc;
+
+      if (source_name)
+        {
+          names = realloc (names, (count + 1) * sizeof (char *));
+          names[count++] = strdup (source_name);
+        }
+
+      for (n = 0; args && args[n]; n++)
+        {
+          names = realloc (names, (count + 1) * sizeof (char *));
+          names[count++] = strdup (args[n]);
+        }
+
+      if (gl.files_from)
+        _batch_read_list (gl.files_from, &names, &count);
+
+      if (!count)
+        {
+          fprintf (stderr, "no images given - try --help\n");
+          poptFreeContext(optCon);
+          exit (EXIT_FAILURE);
+        }
+
+      if (gl.source_type == OP_SOURCE_DEVICE && count > 1)
+        {
+          fprintf (stderr, "only one device allowed! - try --help\n");
+          poptFreeContext(optCon);
+          exit (EXIT_FAILURE);
+        }
+
+      /* libcdio's log recursion guard isn't thread-local, so keep its
+         messages out of the way unless they were asked for */
+      if (gl.debug_level < 3)
+        cdio_loglevel_default = CDIO_LOG_ASSERT;
+
+      gl_default_vcd_log_handler  = vcd_log_set_handler (_vcd_log_handler);
+      gl_default_cdio_log_handler =
+        cdio_log_set_handler ( (cdio_log_handler_t) _vcd_log_handler);
+
+      rc = batch (names, count);
+
+      for (n = 0; n < count; n++)
+        free (names[n]);
+      free (names);
+      free (source_name);
+      poptFreeContext(optCon);
+      return rc;
+    }
+
+  if (args != NULL)
     {
       if (args[1]) {
         fprintf ( stderr, "too many arguments - try --help");
@@ -1657,14 +2115,6 @@ main (int argc, const char *argv[])
       gl.source_type = OP_SOURCE_UNDEF;
     }
 
-  if (gl.debug_level == 3) {
-    vcd_loglevel_default = VCD_LOG_INFO;
-    cdio_loglevel_default = CDIO_LOG_INFO;
-  } else if (gl.debug_level >= 4) {
-    vcd_loglevel_default = VCD_LOG_DEBUG;
-    cdio_loglevel_default = CDIO_LOG_INFO;
-  }
-
   /* Handle massive show flag reversals below. */
   if (gl.show.all) {
     gl.show.entries.all  = gl.show.pvd.all  = gl.show.info.all
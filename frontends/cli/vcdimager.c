@@ -21,6 +21,7 @@
 #include "vcd.h"
 #include "vcd_assert.h"
 #include "image_sink.h"
+#include "mpeg_mux.h"
 #include "stream_stdio.h"
 #include "util.h"
 
@@ -36,6 +37,9 @@
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #ifdef HAVE_TIME_H
 #define __USE_XOPEN
@@ -167,6 +171,8 @@ main (int argc, const char *argv[])
   int n = 0;
   vcd_type_t type_id;
   CdioListNode_t *node;
+  VcdImageSink_t *p_image_sink;
+  int stdout_fd = -1;
   time_t create_time;
 
   /* g_set_prgname (argv[0]); */
@@ -325,6 +331,10 @@ main (int argc, const char *argv[])
     if (gl.verbose_flag && gl.quiet_flag)
       vcd_error ("I can't be both, quiet and verbose... either one or another ;-)");
 
+    /* don't even format what _vcd_log_handler () would throw away */
+    vcd_log_set_level (gl.quiet_flag ? VCD_LOG_WARN
+                       : gl.verbose_flag ? VCD_LOG_DEBUG : VCD_LOG_INFO);
+
     if ((args = poptGetArgs (optCon)) == NULL)
       vcd_error ("error: need at least one data track as argument "
                  "-- try --help");
@@ -374,10 +384,45 @@ main (int argc, const char *argv[])
 
   /* done with argument processing */
 
+  /* the image goes to stdout: from here on everything else printed to
+     stdout ends up on stderr, and the image sink gets the original */
+  if (!strcmp (gl.image_fname, "-"))
+    {
+      fflush (stdout);
+
+      if ((stdout_fd = dup (STDOUT_FILENO)) < 0
+          || dup2 (STDERR_FILENO, STDOUT_FILENO) < 0)
+        {
+          perror ("redirecting stdout");
+          exit (EXIT_FAILURE);
+        }
+    }
+
   if (!strcmp (gl.image_fname, gl.cue_fname))
     vcd_warn ("bin and cue file seem to be the same"
               " -- cue file may get overwritten by bin file!");
 
+  p_image_sink = vcd_image_sink_new_bincue ();
+
+  if (!p_image_sink)
+    {
+      vcd_error ("failed to create image object");
+      exit (EXIT_FAILURE);
+    }
+
+  vcd_image_sink_set_arg (p_image_sink, "bin", gl.image_fname);
+  vcd_image_sink_set_arg (p_image_sink, "cue", gl.cue_fname);
+  vcd_image_sink_set_arg (p_image_sink, "sector",
+                          gl.sector_2336_flag ? "2336" : "2352");
+
+  if (stdout_fd >= 0)
+    {
+      char buf[16];
+
+      snprintf (buf, sizeof (buf), "%d", stdout_fd);
+      vcd_image_sink_set_arg (p_image_sink, "stdout-fd", buf);
+    }
+
   gl_vcd_obj = vcd_obj_new (type_id);
 
   if (gl.check_flag)
@@ -459,10 +504,29 @@ main (int argc, const char *argv[])
   for (n = 0; gl.track_fnames[n] != NULL; n++)
     {
       VcdDataSource_t *data_source;
+      char *video_fname = NULL, *audio_fname = NULL;
 
-      data_source = vcd_data_source_new_stdio (gl.track_fnames[n]);
+      /* VIDEO,AUDIO names two elementary streams to multiplex */
+      if (access (gl.track_fnames[n], F_OK)
+          && !_parse_file_arg (gl.track_fnames[n], &video_fname,
+                               &audio_fname))
+        {
+          data_source =
+            vcd_mpeg_mux_new (type_id,
+                              vcd_data_source_new_stdio (video_fname),
+                              vcd_data_source_new_stdio (audio_fname));
+          free (video_fname);
+          free (audio_fname);
+        }
+      else
+        {
+          data_source = vcd_data_source_new_stdio (gl.track_fnames[n]);
 
-      vcd_assert (data_source != NULL);
+          vcd_assert (data_source != NULL);
+
+          if (vcd_mpeg_mux_video_es_p (data_source))
+            data_source = vcd_mpeg_mux_new (type_id, data_source, NULL);
+        }
 
       vcd_obj_append_sequence_play_item (gl_vcd_obj,
                                          vcd_mpeg_source_new (data_source),
@@ -472,20 +536,6 @@ main (int argc, const char *argv[])
 
   {
     unsigned sectors;
-    VcdImageSink_t *p_image_sink;
-
-    p_image_sink = vcd_image_sink_new_bincue ();
-
-    vcd_image_sink_set_arg (p_image_sink, "bin", gl.image_fname);
-    vcd_image_sink_set_arg (p_image_sink, "cue", gl.cue_fname);
-    vcd_image_sink_set_arg (p_image_sink, "sector",
-                            gl.sector_2336_flag ? "2336" : "2352");
-
-    if (!p_image_sink)
-      {
-        vcd_error ("failed to create image object");
-        exit (EXIT_FAILURE);
-      }
 
     sectors = vcd_obj_begin_output (gl_vcd_obj);
 
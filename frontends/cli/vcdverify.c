@@ -0,0 +1,482 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* checks sync, header, subheader, EDC and ECC of every sector of a
+   bin/cue or nrg image, without burning it */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/sector.h>
+#include <cdio/bytesex.h>
+
+#include <popt.h>
+
+#include <libvcd/logging.h>
+#include <libvcd/sector.h>
+
+/* Private includes */
+#include "vcd_assert.h"
+#include "salloc.h"
+#include "util.h"
+#include "vcd.h"
+#include "verify.h"
+
+#define DEFAULT_MAX_ERRORS 100
+
+static struct {
+  int quiet_flag;
+  int verbose_flag;
+  int sector_2336_flag;
+  int jobs;
+  int max_errors;
+
+  vcd_log_handler_t default_vcd_log_handler;
+} gl = { 0, }; /* global */
+
+/* first sector of each track, in image sectors */
+static struct {
+  uint32_t start[CDIO_CD_MAX_TRACKS];
+  int count;
+} tracks;
+
+static void
+_vcd_log_handler (vcd_log_level_t level, const char message[])
+{
+  if (level == VCD_LOG_DEBUG && !gl.verbose_flag)
+    return;
+
+  if (level == VCD_LOG_INFO && gl.quiet_flag)
+    return;
+
+  gl.default_vcd_log_handler (level, message);
+}
+
+static int
+_track_of (uint32_t sector)
+{
+  int n;
+
+  for (n = tracks.count; n > 0; n--)
+    if (tracks.start[n - 1] <= sector)
+      return n;
+
+  return 0;
+}
+
+static void
+_add_track (uint32_t start)
+{
+  if (tracks.count < CDIO_CD_MAX_TRACKS)
+    tracks.start[tracks.count++] = start;
+}
+
+/* the bin file named by a cue sheet, relative to the cue sheet's
+   directory; fills in the tracks and the sector size */
+static char *
+_read_cue (const char cue_fname[], unsigned *p_sector_size)
+{
+  FILE *fd = fopen (cue_fname, "r");
+  char line[1024];
+  char *bin_fname = NULL;
+  bool track_started = false;
+
+  if (!fd)
+    {
+      vcd_error ("can't open `%s': %s", cue_fname, strerror (errno));
+      return NULL;
+    }
+
+  while (fgets (line, sizeof (line), fd))
+    {
+      char name[1024];
+      unsigned num, mm, ss, ff, size;
+
+      if (sscanf (line, " FILE \"%1023[^\"]\"", name) == 1)
+        {
+          const char *_slash = strrchr (cue_fname, '/');
+
+          free (bin_fname);
+
+          if (name[0] != '/' && _slash)
+            {
+              const size_t len = _slash - cue_fname + 1;
+
+              bin_fname = calloc (1, len + strlen (name) + 1);
+              memcpy (bin_fname, cue_fname, len);
+              strcat (bin_fname, name);
+            }
+          else
+            bin_fname = strdup (name);
+        }
+      else if (sscanf (line, " TRACK %u MODE2/%u", &num, &size) == 2)
+        {
+          *p_sector_size = size;
+          track_started = false;
+        }
+      else if (sscanf (line, " INDEX %u %u:%u:%u", &num, &mm, &ss, &ff) == 4
+               && !track_started)
+        {
+          /* the pregap, if any, counts with its track */
+          _add_track ((mm * CDIO_CD_SECS_PER_MIN + ss)
+                      * CDIO_CD_FRAMES_PER_SEC + ff);
+          track_started = true;
+        }
+    }
+
+  fclose (fd);
+
+  if (!bin_fname)
+    vcd_error ("no FILE in cue sheet `%s'", cue_fname);
+
+  return bin_fname;
+}
+
+/* whether fname can be looked at before it's verified; stdin and
+   pipes can be read only once */
+static bool
+_regular_file_p (const char fname[])
+{
+  struct stat statbuf;
+
+  return strcmp (fname, "-") && !stat (fname, &statbuf)
+    && S_ISREG (statbuf.st_mode);
+}
+
+/* if fname is an nrg image, the size of its sector data, else 0;
+   fills in the tracks */
+static long
+_read_nrg (const char fname[])
+{
+  FILE *fd;
+  uint8_t footer[12];
+  uint64_t offset = 0;
+  long size;
+
+  if (!_regular_file_p (fname) || !(fd = fopen (fname, "rb")))
+    return 0;
+
+  if (fseek (fd, -12, SEEK_END) || fread (footer, 1, 12, fd) != 12)
+    {
+      fclose (fd);
+      return 0;
+    }
+
+  if (!memcmp (footer + 4, "NERO", 4))
+    offset = ((uint64_t) footer[8] << 24) | (footer[9] << 16)
+      | (footer[10] << 8) | footer[11];
+  else if (!memcmp (footer, "NER5", 4))
+    {
+      int n;
+
+      for (n = 4; n < 12; n++)
+        offset = (offset << 8) | footer[n];
+    }
+  else
+    {
+      fclose (fd);
+      return 0;
+    }
+
+  size = offset;
+
+  /* the chunks after the sector data; only the track tables matter */
+  fseek (fd, size, SEEK_SET);
+
+  for (;;)
+    {
+      uint8_t chunk[8];
+      uint32_t len;
+
+      if (fread (chunk, 1, 8, fd) != 8)
+        break;
+
+      len = uint32_from_be (*(uint32_t *) (chunk + 4));
+
+      if (!memcmp (chunk, "ETNF", 4) || !memcmp (chunk, "ETN2", 4))
+        {
+          const bool _etn2 = chunk[3] == '2';
+          const unsigned entry_len = _etn2 ? 32 : 20;
+          uint8_t entry[32];
+          unsigned n;
+
+          for (n = 0; n < len / entry_len; n++)
+            {
+              uint64_t start = 0;
+              int i;
+
+              if (fread (entry, 1, entry_len, fd) != entry_len)
+                break;
+
+              for (i = 0; i < (_etn2 ? 8 : 4); i++)
+                start = (start << 8) | entry[i];
+
+              _add_track (start / M2RAW_SECTOR_SIZE);
+            }
+          break;
+        }
+
+      if (!memcmp (chunk, "END!", 4))
+        break;
+
+      fseek (fd, len, SEEK_CUR);
+    }
+
+  fclose (fd);
+
+  return size;
+}
+
+/* 2352 if fname starts with a sync pattern and isn't cut short,
+   else 2336; 2352 for anything but a regular file */
+static unsigned
+_guess_sector_size (const char fname[])
+{
+  static const uint8_t sync[12] =
+    { 0x00, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00 };
+  FILE *fd;
+  uint8_t buf[12];
+  unsigned sector_size = CDIO_CD_FRAMESIZE_RAW;
+  long size;
+
+  if (!_regular_file_p (fname) || !(fd = fopen (fname, "rb")))
+    return sector_size;
+
+  fseek (fd, 0, SEEK_END);
+  size = ftell (fd);
+  rewind (fd);
+
+  if (fread (buf, 1, sizeof (buf), fd) != sizeof (buf)
+      || memcmp (buf, sync, sizeof (sync))
+      || (size % CDIO_CD_FRAMESIZE_RAW && !(size % M2RAW_SECTOR_SIZE)))
+    sector_size = M2RAW_SECTOR_SIZE;
+
+  fclose (fd);
+
+  return sector_size;
+}
+
+static void
+_print_problems (const char prefix[], int problems, unsigned long counts[])
+{
+  int n;
+  bool first = true;
+
+  fprintf (stdout, "%s", prefix);
+
+  for (n = 0; n < VCD_SECTOR_CHECKS; n++)
+    if (problems & (1 << n))
+      {
+        fprintf (stdout, "%s%s", first ? "" : ", ",
+                 _vcd_check_mode2_name (1 << n));
+        if (counts)
+          fprintf (stdout, " %lu", counts[n]);
+        first = false;
+      }
+
+  fprintf (stdout, "\n");
+}
+
+int
+main (int argc, const char *argv[])
+{
+  const char *image_fname;
+  char *bin_fname = NULL;
+  vcd_verify_opts_t opts;
+  vcd_verify_result_t result;
+  bool nrg = false;
+  uint32_t n;
+  int rc;
+
+  gl.default_vcd_log_handler = vcd_log_set_handler (_vcd_log_handler);
+  gl.max_errors = DEFAULT_MAX_ERRORS;
+
+  {
+    struct poptOption optionsTable[] =
+      {
+        {"sector-2336", '\0', POPT_ARG_NONE, &gl.sector_2336_flag, 0,
+         "bin file has 2336 byte sectors (default: guessed)"},
+        {"jobs", 'j', POPT_ARG_INT, &gl.jobs, 0,
+         "check sectors in N threads", "N"},
+        {"max-errors", '\0', POPT_ARG_INT, &gl.max_errors, 0,
+         "list at most N bad sectors, 0 for all (default: "
+         "100)", "N"},
+        {"verbose", 'v', POPT_ARG_NONE, &gl.verbose_flag, 0, "be verbose"},
+        {"quiet", 'q', POPT_ARG_NONE, &gl.quiet_flag, 0, "show only critical messages"},
+        {"version", 'V', POPT_ARG_NONE, NULL, 1, "display version and copyright information and exit"},
+
+        POPT_AUTOHELP
+        {NULL, 0, 0, NULL, 0}
+      };
+
+    int opt;
+
+    const char **args = NULL;
+
+    poptContext optCon = poptGetContext ("vcdimager", argc, argv, optionsTable, 0);
+    poptSetOtherOptionHelp (optCon, "[OPTION...] <cue-file|bin-file|nrg-file>");
+
+    if (poptReadDefaultConfig (optCon, 0))
+      fprintf (stderr, "warning, reading popt configuration failed\n");
+
+    while ((opt = poptGetNextOpt (optCon)) != -1)
+      switch (opt)
+        {
+        case 1:
+          fprintf (stdout, vcd_version_string (true), "vcdverify");
+          fflush (stdout);
+          poptFreeContext(optCon);
+          exit (EXIT_SUCCESS);
+          break;
+        default:
+          vcd_error ("error while parsing command line - try --help");
+          break;
+        }
+
+    if (gl.verbose_flag && gl.quiet_flag)
+      vcd_error ("I can't be both, quiet and verbose... either one or another ;-)");
+
+    if (gl.jobs < 0 || gl.max_errors < 0)
+      vcd_error ("invalid number given -- try --help");
+
+    if ((args = poptGetArgs (optCon)) == NULL)
+      vcd_error ("image file argument missing -- try --help");
+
+    if (args[1])
+      vcd_error ("only one image file argument allowed -- try --help");
+
+    image_fname = strdup (args[0]);
+
+    poptFreeContext(optCon);
+  }
+
+  memset (&opts, 0, sizeof (opts));
+  opts.jobs = gl.jobs;
+  opts.first_extent = 0;
+
+  {
+    const size_t len = strlen (image_fname);
+    long nrg_size;
+
+    if (len > 4 && !strcmp (image_fname + len - 4, ".cue"))
+      {
+        opts.sector_size = CDIO_CD_FRAMESIZE_RAW;
+        if (!(bin_fname = _read_cue (image_fname, &opts.sector_size)))
+          exit (EXIT_FAILURE);
+      }
+    else if ((nrg_size = _read_nrg (image_fname)))
+      {
+        /* nrg images hold the sectors without sync and header and
+           without the pregaps, so their addresses can't be checked */
+        nrg = true;
+        bin_fname = strdup (image_fname);
+        opts.sector_size = M2RAW_SECTOR_SIZE;
+        opts.sectors = nrg_size / M2RAW_SECTOR_SIZE;
+        opts.first_extent = SECTOR_NIL;
+      }
+    else
+      {
+        bin_fname = strdup (image_fname);
+        opts.sector_size = gl.sector_2336_flag
+          ? M2RAW_SECTOR_SIZE : _guess_sector_size (bin_fname);
+      }
+
+    if (gl.sector_2336_flag)
+      opts.sector_size = M2RAW_SECTOR_SIZE;
+
+    if (opts.sector_size != CDIO_CD_FRAMESIZE_RAW
+        && opts.sector_size != M2RAW_SECTOR_SIZE)
+      vcd_error ("unsupported sector size %u in `%s'", opts.sector_size,
+                 image_fname);
+  }
+
+  vcd_debug ("checking `%s', %u byte sectors, %d tracks", bin_fname,
+             opts.sector_size, tracks.count);
+
+  rc = _vcd_verify_image (bin_fname, &opts, &result);
+
+  for (n = 0; n < result.bad; n++)
+    {
+      const vcd_verify_error_t *p_error = &result.errors[n];
+      char prefix[80];
+
+      if (gl.max_errors && n == (uint32_t) gl.max_errors)
+        {
+          fprintf (stdout, "... and %u more bad sectors\n", result.bad - n);
+          break;
+        }
+
+      snprintf (prefix, sizeof (prefix), "%s %u (track %d): ",
+                nrg ? "sector" : "lsn", p_error->sector,
+                _track_of (p_error->sector));
+      _print_problems (prefix, p_error->problems, NULL);
+    }
+
+  if (!gl.quiet_flag)
+    {
+      const double mbytes =
+        (double) result.sectors * opts.sector_size / (1024 * 1024);
+
+      fprintf (stdout, "checked %u sectors (%.1f MB) in %.2f seconds,"
+               " %.1f MB/s: %u bad\n", result.sectors, mbytes,
+               result.seconds,
+               result.seconds > 0 ? mbytes / result.seconds : 0.0,
+               result.bad);
+
+      if (result.bad)
+        {
+          int problems = 0, i;
+
+          for (i = 0; i < VCD_SECTOR_CHECKS; i++)
+            if (result.problems[i])
+              problems |= 1 << i;
+
+          _print_problems ("bad sectors by check: ", problems,
+                           result.problems);
+        }
+    }
+
+  fflush (stdout);
+
+  if (!rc && result.bad)
+    rc = -1;
+
+  _vcd_verify_result_free (&result);
+  free (bin_fname);
+  free ((char *) image_fname);
+
+  return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,501 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Benchmark for reading XML control files; run with 'make bench'.
+
+   A control file with a large PBC is generated first: a menu and many
+   selection lists, play lists and end lists referring to it, to each
+   other and to sequence and segment items, as generated control files
+   for menu-heavy discs have. It is then parsed into a vcdxml_t, the
+   way vcdxbuild does it with vcd_xml_parse_reader () and the way it
+   used to with a whole document tree and vcd_xml_parse (). xml-dump
+   times writing it out again with vcd_xml_dump (), as vcdxrip and
+   vcdxgen do.
+
+   Each benchmark prints one line of space separated key=value pairs,
+   e.g.
+
+     bench=xml-stream items=100000 bytes=21270534 seconds=2.557246
+     mb_per_s=7.93 items_per_s=39104.6 max_rss_kb=187516
+
+   (on a single line). max_rss_kb is the peak memory use of the whole
+   process so far, so xml-stream and xml-dump run before xml-dom. When a benchmark
+   is repeated, the fastest run is reported. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <libxml/parser.h>
+#include <libxml/xmlreader.h>
+
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "vcdxml.h"
+#include "vcd_xml_parse.h"
+#include "vcd_xml_dtd.h"
+#include "vcd_xml_dump.h"
+
+#define BENCH_XML      "bench.xml"
+#define BENCH_DUMP_XML "bench-dump.xml"
+
+static struct
+{
+  unsigned items;        /* pbc items */
+  unsigned repeat;
+  const char *only;
+  bool keep;
+  bool verbose;
+} gl = {
+  100000, 1, NULL, false, false
+};
+
+typedef struct
+{
+  unsigned long long bytes;
+  unsigned long items;
+  double seconds;
+  long max_rss_kb;
+} bench_result_t;
+
+static double
+_now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static long
+_max_rss_kb (void)
+{
+  struct rusage usage;
+
+  if (getrusage (RUSAGE_SELF, &usage))
+    return -1;
+
+  return usage.ru_maxrss;
+}
+
+static void
+_log_handler (vcd_log_level_t level, const char message[])
+{
+  if (level < (gl.verbose ? VCD_LOG_WARN : VCD_LOG_ERROR))
+    return;
+
+  fprintf (stderr, "vcdxbench: %s\n", message);
+
+  if (level >= VCD_LOG_ERROR)
+    exit (EXIT_FAILURE);
+}
+
+/*
+ * synthetic control file
+ */
+
+/* sequence and segment items, each */
+static unsigned
+_media_items (void)
+{
+  return gl.items / 100 + 1;
+}
+
+static void
+_write_pbc_item (FILE *fd, unsigned n)
+{
+  const unsigned media = _media_items ();
+  const unsigned prev = n ? n - 1 : gl.items - 1;
+  const unsigned next = (n + 1) % gl.items;
+
+  /* lid-0 is the menu everything returns to */
+  if (!n || n % 4 == 1)
+    {
+      unsigned i;
+
+      fprintf (fd, "<selection id=\"lid-%u\"><bsn>1</bsn>", n);
+      fprintf (fd, "<prev ref=\"lid-%u\"/><next ref=\"lid-%u\"/>"
+               "<return ref=\"lid-0\" x1=\"0\" y1=\"0\" x2=\"32\" y2=\"16\"/>",
+               prev, next);
+      fprintf (fd, "<default ref=\"lid-%u\"/><timeout ref=\"lid-0\"/>"
+               "<wait>%u</wait><loop jump-timing=\"delayed\">1</loop>",
+               next, n % 60);
+      fprintf (fd, "<play-item ref=\"segment-%u\"/>", n % media);
+
+      for (i = 1; i <= 4; i++)
+        fprintf (fd, "<select ref=\"lid-%u\"/>", (n + i) % gl.items);
+
+      fprintf (fd, "</selection>\n");
+    }
+  else if (n % 4 != 0)
+    fprintf (fd, "<playlist id=\"lid-%u\"><prev ref=\"lid-%u\"/>"
+             "<next ref=\"lid-%u\"/><return ref=\"lid-0\"/><wait>5</wait>"
+             "<autowait>0</autowait><play-item ref=\"sequence-%u\"/>"
+             "<play-item ref=\"segment-%u\"/></playlist>\n",
+             n, prev, next, n % media, n % media);
+  else
+    fprintf (fd, "<endlist id=\"lid-%u\"><play-item ref=\"segment-%u\"/>"
+             "</endlist>\n", n, n % media);
+}
+
+static bool
+_generate_xml (FILE *fd)
+{
+  const unsigned media = _media_items ();
+  unsigned n;
+
+  fprintf (fd, "<?xml version=\"1.0\"?>\n"
+           "<!DOCTYPE videocd PUBLIC \"%s\" \"%s\">\n"
+           "<videocd xmlns=\"%s\" class=\"svcd\" version=\"1.0\">\n",
+           VIDEOCD_DTD_PUBID, VIDEOCD_DTD_SYSID, VIDEOCD_DTD_XMLNS);
+
+  fprintf (fd, "<option name=\"update scan offsets\" value=\"true\"/>\n"
+           "<info><album-id>BENCH</album-id><volume-count>1</volume-count>"
+           "<volume-number>1</volume-number><restriction>0</restriction>"
+           "</info>\n"
+           "<pvd><volume-id>BENCH</volume-id>"
+           "<system-id>CD-RTOS CD-BRIDGE</system-id></pvd>\n");
+
+  fprintf (fd, "<segment-items>\n");
+  for (n = 0; n < media; n++)
+    fprintf (fd, "<segment-item src=\"item%4.4u.mpg\" id=\"segment-%u\">"
+             "<auto-pause>2.5</auto-pause></segment-item>\n", n, n);
+  fprintf (fd, "</segment-items>\n");
+
+  fprintf (fd, "<sequence-items>\n");
+  for (n = 0; n < media; n++)
+    fprintf (fd, "<sequence-item src=\"avseq%4.4u.mpg\" id=\"sequence-%u\">"
+             "<default-entry id=\"entry-%u-0\"/>"
+             "<entry id=\"entry-%u-1\">%u.5</entry></sequence-item>\n",
+             n, n, n, n, n % 100);
+  fprintf (fd, "</sequence-items>\n");
+
+  fprintf (fd, "<pbc>\n");
+  for (n = 0; n < gl.items; n++)
+    _write_pbc_item (fd, n);
+  fprintf (fd, "</pbc>\n</videocd>\n");
+
+  return !ferror (fd);
+}
+
+/*
+ * benchmarks
+ */
+
+static bool
+_bench_generate (bench_result_t *p_res)
+{
+  FILE *fd = fopen (BENCH_XML, "w");
+
+  if (!fd || !_generate_xml (fd))
+    return false;
+
+  p_res->bytes = ftell (fd);
+  p_res->items = gl.items;
+  p_res->max_rss_kb = _max_rss_kb ();
+
+  return !fclose (fd);
+}
+
+/* what all parse benchmarks end with */
+static bool
+_parsed (bench_result_t *p_res, vcdxml_t *p_vcdxml, bool failed)
+{
+  FILE *fd = fopen (BENCH_XML, "r");
+
+  if (fd && !fseek (fd, 0, SEEK_END))
+    p_res->bytes = ftell (fd);
+
+  if (fd)
+    fclose (fd);
+
+  p_res->items = _cdio_list_length (p_vcdxml->pbc_list);
+  p_res->max_rss_kb = _max_rss_kb ();
+
+  vcd_xml_destroy (p_vcdxml);
+
+  return !failed && p_res->items == gl.items;
+}
+
+static bool
+_bench_stream (bench_result_t *p_res)
+{
+  xmlTextReaderPtr reader;
+  vcdxml_t vcdxml;
+  bool failed = true;
+
+  vcd_xml_init (&vcdxml);
+
+  if ((reader = xmlReaderForFile (BENCH_XML, NULL, XML_PARSE_DTDVALID
+                                  | XML_PARSE_NOBLANKS)))
+    {
+      failed = vcd_xml_parse_reader (&vcdxml, reader);
+      xmlFreeTextReader (reader);
+    }
+
+  return _parsed (p_res, &vcdxml, failed);
+}
+
+/* only the dump is timed */
+static bool
+_bench_dump (bench_result_t *p_res)
+{
+  xmlTextReaderPtr reader;
+  vcdxml_t vcdxml;
+  bool failed = true;
+  double t0;
+  FILE *fd;
+
+  vcd_xml_init (&vcdxml);
+
+  if ((reader = xmlReaderForFile (BENCH_XML, NULL, XML_PARSE_DTDVALID
+                                  | XML_PARSE_NOBLANKS)))
+    {
+      failed = vcd_xml_parse_reader (&vcdxml, reader);
+      xmlFreeTextReader (reader);
+    }
+
+  t0 = _now ();
+
+  if (!failed)
+    failed = vcd_xml_dump (&vcdxml, BENCH_DUMP_XML) != 0;
+
+  p_res->seconds = _now () - t0;
+
+  if ((fd = fopen (BENCH_DUMP_XML, "r")))
+    {
+      if (!fseek (fd, 0, SEEK_END))
+        p_res->bytes = ftell (fd);
+      fclose (fd);
+    }
+
+  if (!gl.keep)
+    remove (BENCH_DUMP_XML);
+
+  p_res->items = _cdio_list_length (vcdxml.pbc_list);
+  p_res->max_rss_kb = _max_rss_kb ();
+
+  vcd_xml_destroy (&vcdxml);
+
+  return !failed && p_res->items == gl.items;
+}
+
+static bool
+_bench_dom (bench_result_t *p_res)
+{
+  xmlDocPtr doc;
+  xmlNodePtr root;
+  vcdxml_t vcdxml;
+  bool failed = true;
+
+  vcd_xml_init (&vcdxml);
+
+  if ((doc = xmlReadFile (BENCH_XML, NULL, XML_PARSE_DTDVALID
+                          | XML_PARSE_NOBLANKS)))
+    {
+      root = xmlDocGetRootElement (doc);
+
+      failed = !root
+        || vcd_xml_parse (&vcdxml, doc, root,
+                          xmlSearchNsByHref (doc, root, (const xmlChar *)
+                                             VIDEOCD_DTD_XMLNS));
+
+      xmlFreeDoc (doc);
+    }
+
+  return _parsed (p_res, &vcdxml, failed);
+}
+
+/* in the order they are run */
+static const struct {
+  const char *name;
+  bool (*func) (bench_result_t *p_res);
+} _benchmarks[] = {
+  { "xml-generate", _bench_generate },
+  { "xml-stream",   _bench_stream },
+  { "xml-dump",     _bench_dump },
+  { "xml-dom",      _bench_dom },
+};
+
+#define BENCHMARKS (sizeof (_benchmarks) / sizeof (_benchmarks[0]))
+
+static bool
+_selected (const char name[])
+{
+  const char *p;
+  const size_t len = strlen (name);
+
+  if (!gl.only)
+    return true;
+
+  for (p = gl.only; (p = strstr (p, name)); p += len)
+    if ((p == gl.only || p[-1] == ',') && (p[len] == ',' || !p[len]))
+      return true;
+
+  return false;
+}
+
+static bool
+_run (unsigned idx)
+{
+  bench_result_t best = { 0, };
+  unsigned i;
+
+  for (i = 0; i < gl.repeat; i++)
+    {
+      bench_result_t res = { 0, };
+      double t0 = _now ();
+
+      if (!_benchmarks[idx].func (&res))
+        {
+          printf ("bench=%s items=%u failed\n", _benchmarks[idx].name,
+                  gl.items);
+          return false;
+        }
+
+      /* unless the benchmark timed itself */
+      if (!res.seconds)
+        res.seconds = _now () - t0;
+
+      if (!i || res.seconds < best.seconds)
+        best = res;
+    }
+
+  if (best.seconds <= 0)
+    best.seconds = 1e-6;
+
+  printf ("bench=%s items=%lu bytes=%llu seconds=%.6f mb_per_s=%.2f"
+          " items_per_s=%.1f max_rss_kb=%ld\n",
+          _benchmarks[idx].name, best.items, best.bytes, best.seconds,
+          best.bytes / best.seconds / (1024 * 1024),
+          best.items / best.seconds, best.max_rss_kb);
+  fflush (stdout);
+
+  return true;
+}
+
+static void
+_usage (void)
+{
+  unsigned i;
+
+  printf ("usage: vcdxbench [OPTION]...\n"
+          "\n"
+          "  --items=N           pbc items in the control file (default 100000)\n"
+          "  --repeat=N          run each benchmark N times, report fastest\n"
+          "  --only=NAME[,NAME]  run these benchmarks only\n"
+          "  --generate=FILE     only write the control file to FILE\n"
+          "  --keep              keep the generated files\n"
+          "  --verbose           show libvcd warnings\n"
+          "\n"
+          "benchmarks:");
+
+  for (i = 0; i < BENCHMARKS; i++)
+    printf (" %s", _benchmarks[i].name);
+
+  printf ("\n");
+}
+
+int
+main (int argc, const char *argv[])
+{
+  const char *psz_generate = NULL;
+  unsigned n;
+  int i, fail = 0;
+
+  for (i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      const char *val = strchr (arg, '=');
+
+      val = val ? val + 1 : "";
+
+      if (!strncmp (arg, "--items=", 8))
+        gl.items = atoi (val);
+      else if (!strncmp (arg, "--repeat=", 9))
+        gl.repeat = atoi (val);
+      else if (!strncmp (arg, "--only=", 7))
+        gl.only = val;
+      else if (!strncmp (arg, "--generate=", 11))
+        psz_generate = val;
+      else if (!strcmp (arg, "--keep"))
+        gl.keep = true;
+      else if (!strcmp (arg, "--verbose"))
+        gl.verbose = true;
+      else
+        {
+          _usage ();
+          return strcmp (arg, "--help") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+
+  if (!gl.items || !gl.repeat)
+    {
+      fprintf (stderr, "vcdxbench: parameter out of range\n");
+      return EXIT_FAILURE;
+    }
+
+  vcd_log_set_handler (_log_handler);
+
+  if (psz_generate)
+    {
+      FILE *fd = fopen (psz_generate, "w");
+
+      if (!fd || !_generate_xml (fd) || fclose (fd))
+        {
+          perror (psz_generate);
+          return EXIT_FAILURE;
+        }
+
+      return EXIT_SUCCESS;
+    }
+
+  xmlKeepBlanksDefaultValue = false;
+  vcd_xml_dtd_init ();
+
+  printf ("# vcdxbench version=%s items=%u repeat=%u\n", VERSION, gl.items,
+          gl.repeat);
+
+  for (n = 0; n < BENCHMARKS; n++)
+    /* the control file is always written */
+    if (!n || _selected (_benchmarks[n].name))
+      if (!_run (n))
+        fail++;
+
+  if (!gl.keep)
+    remove (BENCH_XML);
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
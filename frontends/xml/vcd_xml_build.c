@@ -24,6 +24,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_TIME_H
 #define __USE_XOPEN
@@ -32,6 +34,10 @@
 
 #include <popt.h>
 
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
 /* We don't want to pull in cdio's config */
 #define __CDIO_CONFIG_H__
 #include <libxml/parserInternals.h>
@@ -39,6 +45,7 @@
 #include <libxml/valid.h>
 #include <libxml/xmlmemory.h>
 #include <libxml/xmlerror.h>
+#include <libxml/xmlreader.h>
 
 #include <libvcd/logging.h>
 #include <libvcd/types.h>
@@ -76,52 +83,14 @@ _dummy_error (void *ctx, const char *msg, ...)
 }
 #endif
 
-static xmlDocPtr
-_xmlParseFile(const char *filename)
+/* the control file is validated and parsed as it is read, see
+   vcd_xml_parse_reader () */
+static xmlTextReaderPtr
+_xmlReaderForFile (const char *filename)
 {
-  xmlDocPtr ret = NULL;
-  xmlParserCtxtPtr ctxt = NULL;
-  char *directory = NULL;
-
-  /* assert (_init_done == true); */
-
-  ctxt = xmlCreateFileParserCtxt (filename);
-
-  if (!ctxt)
-    return NULL;
-
-  /* ctxt->keepBlanks = false; */
-  ctxt->pedantic = true;
-  ctxt->validate = true;
-
-  if (ctxt->sax)
-    {
-      ctxt->sax->error = ctxt->sax->fatalError = xmlParserError;
-      ctxt->sax->warning = xmlParserWarning;
-    }
-
-  ctxt->vctxt.error = xmlParserValidityError;
-  ctxt->vctxt.warning = xmlParserValidityWarning;
-
-  ctxt->vctxt.nodeMax = 0;
-
-  if (!ctxt->directory
-      && (directory = xmlParserGetDirectory(filename)))
-    ctxt->directory = (char *) xmlStrdup((xmlChar *) directory);
-
-  xmlParseDocument(ctxt);
-
-  if (ctxt->wellFormed && ctxt->valid)
-    ret = ctxt->myDoc;
-  else
-    {
-      xmlFreeDoc (ctxt->myDoc);
-      ctxt->myDoc = NULL;
-    }
-
-  xmlFreeParserCtxt(ctxt);
-
-  return(ret);
+  return xmlReaderForFile (filename, NULL,
+			   XML_PARSE_DTDVALID | XML_PARSE_PEDANTIC
+			   | XML_PARSE_NOBLANKS);
 }
 
 #define DEFAULT_CUE_FILE       "videocd.cue"
@@ -138,14 +107,22 @@ static struct {
   CdioList_t *img_options;
 
   char *xml_fname;
+  char **xml_fnames;  /* batch mode */
+  unsigned xml_count;
+  char *files_from;
+  int jobs;
   char *file_prefix;
   char *create_timestr;
+  char *manifest_fname;
+  char *reuse_image_fname;
 
   int verbose_flag;
   int check_flag;
   int quiet_flag;
   int progress_flag;
+  int stats_flag;
   int gui_flag;
+  int batch_flag;
 } gl;
 
 struct key_val_t {
@@ -168,6 +145,52 @@ _set_img_opt (const char key[], const char val[])
   _cdio_list_append (gl.img_options, _cons);
 }
 
+/* the value last given for image option key, or NULL */
+static const char *
+_get_img_opt (const char key[])
+{
+  const char *val = NULL;
+  CdioListNode_t *node;
+
+  _CDIO_LIST_FOREACH (node, gl.img_options)
+    {
+      struct key_val_t *_cons = _cdio_list_node_data (node);
+
+      if (!strcmp (_cons->key, key))
+	val = _cons->val;
+    }
+
+  return val;
+}
+
+/* adds the control files listed in fname (- for stdin), one per line */
+static void
+_read_file_list (const char fname[])
+{
+  FILE *fd = strcmp (fname, "-") ? fopen (fname, "r") : stdin;
+  char line[4096];
+
+  if (!fd)
+    vcd_error ("can't open `%s': %s", fname, strerror (errno));
+
+  while (fgets (line, sizeof (line), fd))
+    {
+      size_t len = strlen (line);
+
+      while (len && (line[len-1] == '\n' || line[len-1] == '\r'))
+	line[--len] = '\0';
+
+      if (!len)
+	continue;
+
+      gl.xml_fnames = realloc (gl.xml_fnames,
+			       (gl.xml_count + 1) * sizeof (char *));
+      gl.xml_fnames[gl.xml_count++] = strdup (line);
+    }
+
+  if (fd != stdin)
+    fclose (fd);
+}
 
 static int
 _do_cl (int argc, const char *argv[])
@@ -218,6 +241,26 @@ _do_cl (int argc, const char *argv[])
       {"progress", 'p', POPT_ARG_NONE, &gl.progress_flag, 0,
        "show progress"},
 
+      {"stats", '\0', POPT_ARG_NONE, &gl.stats_flag, 0,
+       "show where the time went when done"},
+
+      {"manifest", '\0', POPT_ARG_STRING, &gl.manifest_fname, 0,
+       "record the layout of the image in FILE", "FILE"},
+
+      {"reuse-image", '\0', POPT_ARG_STRING, &gl.reuse_image_fname, 0,
+       "copy unchanged tracks from FILE, a bin file built before with"
+       " the same --manifest", "FILE"},
+
+      {"batch", '\0', POPT_ARG_NONE, &gl.batch_flag, 0,
+       "build an image for each xml control file given, named after it"},
+
+      {"files-from", '\0', POPT_ARG_STRING, &gl.files_from, 0,
+       "in batch mode, read the xml control files to build from FILE,"
+       " one per line ('-' for stdin)", "FILE"},
+
+      {"jobs", 'j', POPT_ARG_INT, &gl.jobs, 0,
+       "in batch mode, build up to N images at the same time", "N"},
+
       {"dump-dtd", '\0', POPT_ARG_NONE, NULL, CL_DUMP_DTD,
        "dump internal DTD to stdout"},
 
@@ -247,7 +290,7 @@ _do_cl (int argc, const char *argv[])
     };
 
   optCon = poptGetContext ("vcdimager", argc, argv, optionsTable, 0);
-  poptSetOtherOptionHelp (optCon, "[OPTION...] <xml-control-file>");
+  poptSetOtherOptionHelp (optCon, "[OPTION...] <xml-control-file...>");
 
   if (poptReadDefaultConfig (optCon, 0))
     fprintf (stderr, "warning, reading popt configuration failed\n");
@@ -341,6 +384,37 @@ _do_cl (int argc, const char *argv[])
   if (gl.verbose_flag && gl.quiet_flag)
     vcd_error ("I can't be both, quiet and verbose... either one or another ;-)");
 
+  if (gl.files_from && !gl.batch_flag)
+    vcd_error ("--files-from is for batch mode only -- try --help");
+
+  if (gl.jobs < 0)
+    vcd_error ("invalid number of jobs -- try --help");
+
+  if (gl.batch_flag)
+    {
+      if (gl.manifest_fname || gl.reuse_image_fname)
+	vcd_error ("--manifest and --reuse-image can't be used"
+		   " in batch mode -- try --help");
+
+      if ((args = poptGetArgs (optCon)))
+	for (n = 0; args[n]; n++)
+	  {
+	    gl.xml_fnames = realloc (gl.xml_fnames,
+				     (gl.xml_count + 1) * sizeof (char *));
+	    gl.xml_fnames[gl.xml_count++] = strdup (args[n]);
+	  }
+
+      if (gl.files_from)
+	_read_file_list (gl.files_from);
+
+      if (!gl.xml_count)
+	vcd_error ("no xml input files given -- try --help");
+
+      poptFreeContext (optCon);
+
+      return 0;
+    }
+
   if ((args = poptGetArgs (optCon)) == NULL)
     vcd_error ("xml input file argument missing -- try --help");
 
@@ -356,8 +430,27 @@ _do_cl (int argc, const char *argv[])
   return 0;
 }
 
+/* xml_fname with its extension, if any, replaced by ext */
+static char *
+_image_name (const char xml_fname[], const char ext[])
+{
+  const char *_slash = strrchr (xml_fname, '/');
+  const char *_base = _slash ? _slash + 1 : xml_fname;
+  const char *_dot = strrchr (_base, '.');
+  size_t len = _dot && _dot != _base
+    ? (size_t) (_dot - xml_fname) : strlen (xml_fname);
+  char *fname = calloc (1, len + strlen (ext) + 1);
+
+  memcpy (fname, xml_fname, len);
+  strcat (fname, ext);
+
+  return fname;
+}
+
+/* in batch mode the image is named after xml_fname, else by the image
+   options given */
 static VcdImageSink_t *
-_create_sink (void)
+_create_sink (const char xml_fname[])
 {
   VcdImageSink_t *image_sink = NULL;
   CdioListNode_t *node;
@@ -389,121 +482,542 @@ _create_sink (void)
 		   _cons->key, _cons->val);
     }
 
+  if (xml_fname)
+    {
+      const struct {
+	int img_type;
+	const char *key;
+	const char *ext;
+      } _names[] = {
+	{ IMG_TYPE_BINCUE, "bin", ".bin" },
+	{ IMG_TYPE_BINCUE, "cue", ".cue" },
+	{ IMG_TYPE_CDRDAO, "img_base", "" },
+	{ IMG_TYPE_CDRDAO, "toc", ".toc" },
+	{ IMG_TYPE_NRG, "nrg", ".nrg" },
+	{ 0, NULL, NULL }
+      }, *_name;
+
+      for (_name = _names; _name->key; _name++)
+	if (_name->img_type == gl.img_type)
+	  {
+	    char *_fname = _image_name (xml_fname, _name->ext);
+
+	    if (vcd_image_sink_set_arg (image_sink, _name->key, _fname))
+	      vcd_error ("error while setting image option '%s' (key='%s')",
+			 _name->key, _fname);
+
+	    free (_fname);
+	  }
+    }
+
   return image_sink;
 }
 
-int
-main (int argc, const char *argv[])
+/* the image moved out of the way by _reuse_image (); put back if the
+   build doesn't get to replace it */
+static struct {
+  char *bin_fname;
+  char *old_fname;
+} _moved;
+
+static void
+_restore_image (void)
 {
-  time_t create_time;
-  xmlDocPtr vcd_doc;
+  if (!_moved.old_fname)
+    return;
 
-  memset(&gl, 0, sizeof(gl));
+  if (rename (_moved.old_fname, _moved.bin_fname))
+    fprintf (stderr, "could not rename `%s' back to `%s': %s\n",
+	     _moved.old_fname, _moved.bin_fname, strerror (errno));
 
-  vcd_xml_progname = "vcdxbuild";
+  free (_moved.bin_fname);
+  free (_moved.old_fname);
+  _moved.bin_fname = _moved.old_fname = NULL;
+}
 
-  _init_xml ();
+static void
+_drop_moved_image (void)
+{
+  if (!_moved.old_fname)
+    return;
 
-  vcd_xml_log_init ();
+  remove (_moved.old_fname);
 
-  gl.img_options = _cdio_list_new ();
-  gl.create_timestr = NULL;
+  free (_moved.bin_fname);
+  free (_moved.old_fname);
+  _moved.bin_fname = _moved.old_fname = NULL;
+}
 
-  if (_do_cl (argc, argv))
-    goto err_exit;
+/* the image to reuse may well be the one about to be overwritten
+   (under whatever name); it's moved out of the way then */
+static const char *
+_reuse_image (void)
+{
+  const char *bin_fname = _get_img_opt ("bin");
+  struct stat bin_st, reuse_st;
+  char *old_fname;
 
-  if (gl.quiet_flag)
-    vcd_xml_verbosity = VCD_LOG_WARN;
-  else if (gl.verbose_flag)
-    vcd_xml_verbosity = VCD_LOG_DEBUG;
-  else
-    vcd_xml_verbosity = VCD_LOG_INFO;
+  if (!gl.reuse_image_fname || gl.img_type != IMG_TYPE_BINCUE)
+    return gl.reuse_image_fname;
 
-  if (gl.gui_flag)
-    vcd_xml_gui_mode = true;
+  if (!bin_fname)
+    bin_fname = DEFAULT_BIN_FILE;
 
-  if (gl.progress_flag)
-    vcd_xml_show_progress = true;
+  if (stat (bin_fname, &bin_st) || stat (gl.reuse_image_fname, &reuse_st)
+      || bin_st.st_dev != reuse_st.st_dev
+      || bin_st.st_ino != reuse_st.st_ino)
+    return gl.reuse_image_fname;
 
-  if (gl.check_flag)
-    vcd_xml_check_mode = true;
+  old_fname = calloc (1, strlen (bin_fname) + strlen (".old") + 1);
+  if (!old_fname)
+    {
+      vcd_error ("out of memory");
+      return NULL;
+    }
+  strcpy (old_fname, bin_fname);
+  strcat (old_fname, ".old");
+
+  if (rename (bin_fname, old_fname))
+    {
+      vcd_warn ("could not rename `%s' to `%s': %s", bin_fname, old_fname,
+		strerror (errno));
+      free (old_fname);
+      return NULL;
+    }
+
+  _moved.bin_fname = strdup (bin_fname);
+  _moved.old_fname = old_fname;
+
+  /* vcd_error () exits */
+  {
+    static bool registered = false;
+
+    if (!registered)
+      registered = !atexit (_restore_image);
+  }
+
+  return old_fname;
+}
+
+static time_t
+_create_time (void)
+{
+  time_t create_time = time(NULL);
+
+  if (gl.create_timestr != NULL) {
+    if (!strcmp (gl.create_timestr, "TESTING"))
+      create_time = 269236800L;
+    else {
+#ifdef HAVE_STRPTIME
+      struct tm tm;
+
+      if (NULL == strptime(gl.create_timestr, "%Y-%m-%d %H:%M:%S", &tm)) {
+	vcd_warn("Trouble converting date string %s using strptime.",
+		 gl.create_timestr);
+	vcd_warn("String should match %%Y-%%m-%%d %%H:%%M:%%S");
+      } else {
+	create_time = mktime(&tm);
+      }
+#else
+      create_time = 269236800L;
+#endif
+    }
+  }
+
+  return create_time;
+}
+
+#ifdef HAVE_PTHREAD_H
+/* neither libxml's parser setup nor the dtd loader are thread safe */
+static pthread_mutex_t _parse_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/* what a build leaves to _build () to clean up, whether an error ended
+   it or not */
+typedef struct {
+  vcdxml_t vcdxml;
+  xmlTextReaderPtr reader;
+  bool parse_locked;
+  VcdImageSink_t *image_sink; /* NULL once the image is written */
+} build_state_t;
+
+static bool
+_build_image (build_state_t *p_state, const char xml_fname[],
+	      vcd_obj_stats_t *p_stats)
+{
+  time_t create_time;
+  int dtd_loaded;
+  bool opened = false;
+  bool failed = true;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&_parse_lock);
+  p_state->parse_locked = true;
+#endif
+
+  dtd_loaded = vcd_xml_dtd_loaded;
 
   errno = 0;
-  if (!(vcd_doc = _xmlParseFile (gl.xml_fname)))
+  if ((p_state->reader = _xmlReaderForFile (xml_fname)))
+    {
+      opened = true;
+      failed = vcd_xml_parse_reader (&p_state->vcdxml, p_state->reader);
+      xmlFreeTextReader (p_state->reader);
+      p_state->reader = NULL;
+    }
+
+  dtd_loaded = vcd_xml_dtd_loaded - dtd_loaded;
+
+#ifdef HAVE_PTHREAD_H
+  p_state->parse_locked = false;
+  pthread_mutex_unlock (&_parse_lock);
+#endif
+
+  if (!opened)
     {
       if (errno)
 	vcd_warn ("error while parsing file `%s': %s",
-		   gl.xml_fname, strerror (errno));
+		   xml_fname, strerror (errno));
       else
-	vcd_warn ("parsing file `%s' failed", gl.xml_fname);
-      goto err_exit;
+	vcd_warn ("parsing file `%s' failed", xml_fname);
+      return false;
     }
 
-  if (vcd_xml_dtd_loaded < 1)
+  if (dtd_loaded < 1)
     {
-      vcd_error ("doctype declaration missing in `%s'", gl.xml_fname);
-      goto err_exit;
+      vcd_error ("doctype declaration missing in `%s'", xml_fname);
+      return false;
     }
 
-  {
-    xmlNodePtr root;
-    xmlNsPtr ns;
-    vcdxml_t vcdxml;
-    VcdImageSink_t *image_sink;
+  if (failed)
+    {
+      vcd_warn ("parsing file `%s' failed", xml_fname);
+      return false;
+    }
 
-    vcd_xml_init (&vcdxml);
+  if (!(p_state->image_sink =
+	_create_sink (gl.batch_flag ? xml_fname : NULL)))
+    {
+      vcd_error ("failed to create image object");
+      return false;
+    }
 
-    if (!(root = xmlDocGetRootElement (vcd_doc)))
-      vcd_error ("XML document seems to be empty (no root node found)");
+  p_state->vcdxml.file_prefix = gl.file_prefix;
+  p_state->vcdxml.manifest_fname = gl.manifest_fname;
+  p_state->vcdxml.reuse_image_fname = _reuse_image ();
 
-    if (!(ns = xmlSearchNsByHref (vcd_doc, root, (const xmlChar *) VIDEOCD_DTD_XMLNS)))
-      vcd_error ("Namespace not found in document");
+  create_time = _create_time ();
 
-    if (vcd_xml_parse (&vcdxml, vcd_doc, root, ns))
-      vcd_error ("parsing tree failed");
+  if (vcd_xml_master (&p_state->vcdxml, p_state->image_sink, &create_time,
+		      p_stats)) {
+    vcd_warn ("building videocd failed");
+    return false;
+  }
 
-    if (!(image_sink = _create_sink (/* gl */)))
-      {
-        vcd_error ("failed to create image object");
-        goto err_exit;
-      }
+  /* destroyed along with the VcdObj */
+  p_state->image_sink = NULL;
 
-    vcdxml.file_prefix = gl.file_prefix;
+  return true;
+}
 
-    create_time = time(NULL);
-    if (gl.create_timestr != NULL) {
-      if (!strcmp (gl.create_timestr, "TESTING"))
-	create_time = 269236800L;
-      else {
-#ifdef HAVE_STRPTIME
-	struct tm tm;
-
-	if (NULL == strptime(gl.create_timestr, "%Y-%m-%d %H:%M:%S", &tm)) {
-	  vcd_warn("Trouble converting date string %s using strptime.",
-		   gl.create_timestr);
-	  vcd_warn("String should match %%Y-%%m-%%d %%H:%%M:%%S");
-	} else {
-	  create_time = mktime(&tm);
-	}
-#else
-	create_time = 269236800L;
+/* _build_image () with errors caught; the state it leaves is in the
+   caller's frame, which longjmp () doesn't clobber */
+static bool
+_build_catching (build_state_t *p_state, const char xml_fname[],
+		 vcd_obj_stats_t *p_stats)
+{
+  vcd_xml_catch_t _catch;
+  bool ok;
+
+  vcd_xml_catch_push (&_catch);
+  if (setjmp (_catch.env))
+    return false;
+
+  ok = _build_image (p_state, xml_fname, p_stats);
+
+  vcd_xml_catch_pop (&_catch);
+
+  return ok;
+}
+
+/* builds the image for xml_fname, named after it in batch mode; if it
+   fails, whatever was written of the image is removed again */
+static bool
+_build (const char xml_fname[], vcd_obj_stats_t *p_stats)
+{
+  build_state_t state;
+  bool ok;
+
+  memset (&state, 0, sizeof (state));
+  vcd_xml_init (&state.vcdxml);
+
+  ok = _build_catching (&state, xml_fname, p_stats);
+
+  if (state.reader)
+    xmlFreeTextReader (state.reader);
+
+#ifdef HAVE_PTHREAD_H
+  if (state.parse_locked)
+    pthread_mutex_unlock (&_parse_lock);
 #endif
-      }
+
+  if (state.image_sink)
+    vcd_image_sink_discard (state.image_sink);
+
+  if (ok)
+    _drop_moved_image ();
+  else
+    _restore_image ();
+
+  vcd_xml_destroy (&state.vcdxml);
+
+  return ok;
+}
+
+/* batch mode: the images are built by a pool of worker threads; an
+   error fails just the image it happens in (see vcd_xml_catch_push ()),
+   so one broken control file doesn't stop the batch */
+
+typedef struct {
+  const char *xml_fname;
+  bool ok;
+  double seconds;
+  vcd_obj_stats_t stats;
+} batch_job_t;
+
+static struct {
+  batch_job_t *jobs;
+  unsigned count;
+  unsigned next;
+  unsigned done;
+  unsigned failed;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;   /* the above and stdout */
+#endif
+} batch;
+
+/* with batch.lock held */
+static void
+_batch_report (const batch_job_t *p_job)
+{
+  batch.done++;
+
+  if (!p_job->ok)
+    {
+      batch.failed++;
+      vcd_warn ("[%u/%u] %s: building image failed",
+		batch.done, batch.count, p_job->xml_fname);
+      return;
     }
 
-    if (vcd_xml_master (&vcdxml, image_sink, &create_time)) {
-      vcd_warn ("building videocd failed");
-      goto err_exit;
+  vcd_info ("[%u/%u] %s: %lu sectors in %.1f seconds (%.1f MB/s)",
+	    batch.done, batch.count, p_job->xml_fname,
+	    p_job->stats.sectors, p_job->seconds,
+	    p_job->seconds > 0
+	    ? (double) p_job->stats.sectors * CDIO_CD_FRAMESIZE_RAW
+	    / p_job->seconds / (1024 * 1024) : 0.0);
+}
+
+static void *
+_batch_worker (void *user_data)
+{
+  for (;;)
+    {
+      batch_job_t *p_job;
+      double t_start;
+
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock (&batch.lock);
+#endif
+      p_job = batch.next < batch.count ? &batch.jobs[batch.next++] : NULL;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock (&batch.lock);
+#endif
+
+      if (!p_job)
+	break;
+
+      vcd_xml_log_set_label (p_job->xml_fname);
+
+      t_start = _vcd_clock ();
+      p_job->ok = _build (p_job->xml_fname, &p_job->stats);
+      p_job->seconds = _vcd_clock () - t_start;
+
+      vcd_xml_log_set_label (NULL);
+
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock (&batch.lock);
+#endif
+      _batch_report (p_job);
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock (&batch.lock);
+#endif
     }
 
+  return NULL;
+}
 
-    vcd_xml_destroy(&vcdxml);
-  }
+static int
+_batch (void)
+{
+  unsigned n, nworkers = gl.jobs > 0 ? gl.jobs : 1;
+  unsigned long sectors = 0;
+  unsigned hits, misses;
+#ifdef HAVE_PTHREAD_H
+  pthread_t *threads;
+  unsigned nthreads = 0;
+#endif
+  double t_start = _vcd_clock (), seconds;
+
+  memset (&batch, 0, sizeof (batch));
+
+  batch.count = gl.xml_count;
+  batch.jobs = calloc (batch.count, sizeof (batch_job_t));
+
+  for (n = 0; n < batch.count; n++)
+    batch.jobs[n].xml_fname = gl.xml_fnames[n];
+
+  if (nworkers > batch.count)
+    nworkers = batch.count;
+
+#ifndef HAVE_TLS
+  /* the log labels and the catch frames are per thread */
+  if (nworkers > 1)
+    {
+      vcd_warn ("--jobs not supported by this build -- building sequentially");
+      nworkers = 1;
+    }
+#endif
+
+  vcd_xml_scan_cache_enable ();
+
+#ifdef HAVE_PTHREAD_H
+  /* the progress lines of several images would overwrite each other */
+  if (nworkers > 1 && !vcd_xml_gui_mode)
+    vcd_xml_show_progress = false;
+
+  xmlInitParser ();
+
+  pthread_mutex_init (&batch.lock, NULL);
+
+  /* the calling thread is one of the workers */
+  threads = calloc (nworkers, sizeof (pthread_t));
+
+  for (n = 1; threads && n < nworkers; n++)
+    if (!pthread_create (&threads[nthreads], NULL, _batch_worker, NULL))
+      nthreads++;
+    else
+      vcd_warn ("can't start worker thread");
+#endif
+
+  _batch_worker (NULL);
+
+#ifdef HAVE_PTHREAD_H
+  for (n = 0; n < nthreads; n++)
+    pthread_join (threads[n], NULL);
+
+  free (threads);
+
+  pthread_mutex_destroy (&batch.lock);
+#endif
+
+  seconds = _vcd_clock () - t_start;
+
+  for (n = 0; n < batch.count; n++)
+    if (batch.jobs[n].ok)
+      sectors += batch.jobs[n].stats.sectors;
+
+  vcd_xml_scan_cache_stats (&hits, &misses);
+
+  vcd_info ("built %u of %u images, %lu sectors in %.1f seconds"
+	    " (%.1f MB/s); %u MPEG files scanned, %u scans saved",
+	    batch.count - batch.failed, batch.count, sectors, seconds,
+	    seconds > 0
+	    ? (double) sectors * CDIO_CD_FRAMESIZE_RAW
+	    / seconds / (1024 * 1024) : 0.0,
+	    misses, hits);
+
+  vcd_xml_scan_cache_free ();
+
+  free (batch.jobs);
+
+  return batch.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int
+main (int argc, const char *argv[])
+{
+  int rc = EXIT_SUCCESS;
+  unsigned n;
+
+  memset(&gl, 0, sizeof(gl));
+
+  vcd_xml_progname = "vcdxbuild";
+
+  _init_xml ();
+
+  vcd_xml_log_init ();
+
+  gl.img_options = _cdio_list_new ();
+  gl.create_timestr = NULL;
+
+  if (_do_cl (argc, argv))
+    goto err_exit;
+
+  /* the image goes to stdout: from here on everything else printed to
+     stdout ends up on stderr, and the image sink gets the original */
+  if (!gl.batch_flag && gl.img_type == IMG_TYPE_BINCUE
+      && _get_img_opt ("bin") && !strcmp (_get_img_opt ("bin"), "-"))
+    {
+      char buf[16];
+      int fd;
+
+      fflush (stdout);
+
+      if ((fd = dup (STDOUT_FILENO)) < 0
+	  || dup2 (STDERR_FILENO, STDOUT_FILENO) < 0)
+	{
+	  perror ("redirecting stdout");
+	  goto err_exit;
+	}
+
+      snprintf (buf, sizeof (buf), "%d", fd);
+      _set_img_opt ("stdout-fd", buf);
+    }
+
+  if (gl.quiet_flag)
+    vcd_xml_verbosity = VCD_LOG_WARN;
+  else if (gl.verbose_flag)
+    vcd_xml_verbosity = VCD_LOG_DEBUG;
+  else
+    vcd_xml_verbosity = VCD_LOG_INFO;
+
+  /* don't even format what the handler would throw away */
+  vcd_log_set_level (vcd_xml_verbosity);
+
+  if (gl.gui_flag)
+    vcd_xml_gui_mode = true;
+
+  if (gl.progress_flag)
+    vcd_xml_show_progress = true;
+
+  if (gl.stats_flag)
+    vcd_xml_show_stats = true;
+
+  if (gl.check_flag)
+    vcd_xml_check_mode = true;
+
+  if (gl.batch_flag)
+    rc = _batch ();
+  else if (!_build (gl.xml_fname, NULL))
+    goto err_exit;
 
-  xmlFreeDoc (vcd_doc);
+  for (n = 0; n < gl.xml_count; n++)
+    free (gl.xml_fnames[n]);
+  free (gl.xml_fnames);
   free(gl.xml_fname);
   _cdio_list_free (gl.img_options, true, NULL);
-  return EXIT_SUCCESS;
+  return rc;
  err_exit:
   free(gl.xml_fname);
   _cdio_list_free (gl.img_options, true, NULL);
@@ -22,12 +22,15 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 /* We don't want to pull in cdio's config */
 #define __CDIO_CONFIG_H__
 
 /* Private includes */
 #include "vcd_assert.h"
+#include "stream.h"
+#include "util.h"
 #include "vcd.h"
 #include <libxml/parser.h>
 
@@ -43,17 +46,80 @@ vcd_log_level_t vcd_xml_verbosity = VCD_LOG_INFO;
 
 bool vcd_xml_show_progress = false;
 
+bool vcd_xml_show_stats = false;
+
 bool vcd_xml_check_mode = false;
 
 static vcd_log_handler_t __default_vcd_log_handler = 0;
 
+/* see vcd_xml_catch_push () */
+static VCD_THREAD_LOCAL vcd_xml_catch_t *_catch = NULL;
+
+void
+vcd_xml_catch_push (vcd_xml_catch_t *p_catch)
+{
+  p_catch->prev = _catch;
+  _catch = p_catch;
+}
+
+void
+vcd_xml_catch_pop (vcd_xml_catch_t *p_catch)
+{
+  vcd_assert (_catch == p_catch);
+
+  _catch = p_catch->prev;
+}
+
+void
+vcd_xml_catch_rethrow (void)
+{
+  vcd_xml_catch_t *p_catch = _catch;
+
+  if (!p_catch)
+    exit (EXIT_FAILURE);
+
+  _catch = p_catch->prev;
+
+  /* the counter libvcd was given is on a stack being unwound */
+  _vcd_stream_count_seeks (NULL);
+
+  longjmp (p_catch->env, 1);
+}
+
+/* see vcd_xml_log_set_label () */
+static VCD_THREAD_LOCAL const char *_log_label = NULL;
+
+void
+vcd_xml_log_set_label (const char label[])
+{
+  _log_label = label;
+}
+
 static void
 _vcd_xml_log_handler (vcd_log_level_t level, const char message[])
 {
+  char *_labelled = NULL;
 
   if (level < vcd_xml_verbosity)
     return;
 
+  if (_log_label
+      && (_labelled = malloc (strlen (_log_label) + strlen (message) + 3)))
+    {
+      sprintf (_labelled, "%s: %s", _log_label, message);
+      message = _labelled;
+    }
+
+  if (_catch && level == VCD_LOG_ERROR && !vcd_xml_gui_mode)
+    {
+      /* the default handler would exit */
+      fflush (stdout);
+      fprintf (stderr, "**ERROR: %s\n", message);
+      fflush (stderr);
+      free (_labelled);
+      vcd_xml_catch_rethrow ();
+    }
+
   if (vcd_xml_gui_mode)
     {
       const char *_level_str = "unknown";
@@ -83,8 +149,12 @@ _vcd_xml_log_handler (vcd_log_level_t level, const char message[])
   else
     __default_vcd_log_handler (level, message);
 
-  if (level == VCD_LOG_ERROR
-      || level == VCD_LOG_ASSERT)
+  free (_labelled);
+
+  if (level == VCD_LOG_ERROR)
+    vcd_xml_catch_rethrow ();
+
+  if (level == VCD_LOG_ASSERT)
     exit (EXIT_FAILURE);
 }
 
@@ -95,22 +165,47 @@ vcd_xml_log_init (void)
   __default_vcd_log_handler = vcd_log_set_handler (_vcd_xml_log_handler);
 }
 
+/* whether the next progress update is due; the first and the last
+   one always are */
+static bool
+_progress_due (double *p_last_time, bool first, bool last)
+{
+  const double t_now = _vcd_clock ();
+
+  if (!first && !last
+      && (t_now - *p_last_time) * 1000 < VCD_XML_PROGRESS_INTERVAL)
+    return false;
+
+  *p_last_time = t_now;
+
+  return true;
+}
+
 int
 vcd_xml_scan_progress_cb (const vcd_mpeg_prog_info_t *info, void *user_data)
 {
-  const bool _last = info->current_pos == info->length;
+  static VCD_THREAD_LOCAL double last_time = 0;
+  /* length is 0 while scanning a pipe */
+  const bool _last = info->length && info->current_pos == info->length;
 
   if (!vcd_xml_show_progress)
     return 0;
 
+  if (!_progress_due (&last_time, !info->current_pos, _last))
+    return 0;
+
   if (vcd_xml_gui_mode)
     fprintf (stdout, "<progress operation=\"scan\" id=\"%s\" position=\"%ld\" size=\"%ld\" />\n",
 	     (char *) user_data, info->current_pos, info->length);
   else
     {
-      fprintf (stdout, "#scan[%s]: %ld/%ld (%2.0f%%)          \r",
-	       (char *) user_data, info->current_pos, info->length,
-	       (double) info->current_pos / info->length * 100);
+      if (info->length)
+	fprintf (stdout, "#scan[%s]: %ld/%ld (%2.0f%%)          \r",
+		 (char *) user_data, info->current_pos, info->length,
+		 (double) info->current_pos / info->length * 100);
+      else
+	fprintf (stdout, "#scan[%s]: %ld          \r",
+		 (char *) user_data, info->current_pos);
 
       if (_last)
 	{
@@ -128,11 +223,15 @@ vcd_xml_scan_progress_cb (const vcd_mpeg_prog_info_t *info, void *user_data)
 int
 vcd_xml_read_progress_cb (const _read_progress_t *info, void *user_data)
 {
+  static VCD_THREAD_LOCAL double last_time = 0;
   const bool _last = info->done == info->total;
 
   if (!vcd_xml_show_progress)
     return 0;
 
+  if (!_progress_due (&last_time, !info->done, _last))
+    return 0;
+
   if (vcd_xml_gui_mode)
     fprintf (stdout, "<progress operation=\"extract\" id=\"%s\" position=\"%ld\" size=\"%ld\" />\n",
 	     (char *) user_data, info->done, info->total);
@@ -21,12 +21,19 @@
 #ifndef __VCD_XML_COMMON_H__
 #define __VCD_XML_COMMON_H__
 
+#include <setjmp.h>
+
 #include <libvcd/logging.h>
 
 extern bool vcd_xml_gui_mode;
 
 extern bool vcd_xml_show_progress;
 
+/* milliseconds at least between two progress updates */
+#define VCD_XML_PROGRESS_INTERVAL 100
+
+extern bool vcd_xml_show_stats;
+
 extern bool vcd_xml_check_mode;
 
 extern vcd_log_level_t vcd_xml_verbosity;
@@ -36,6 +43,30 @@ extern const char *vcd_xml_progname;
 
 void vcd_xml_log_init (void);
 
+/* while the calling thread has a catch frame pushed, an error it
+   logs doesn't end the process but longjmp ()s back to the innermost
+   frame, which is popped by then */
+typedef struct vcd_xml_catch_tag {
+  jmp_buf env;
+  struct vcd_xml_catch_tag *prev;
+} vcd_xml_catch_t;
+
+/* to be followed by `if (setjmp (p_catch->env))' in the same function,
+   whose branch is where an error goes on; locals changed after the
+   setjmp () and read there have to be volatile */
+void vcd_xml_catch_push (vcd_xml_catch_t *p_catch);
+
+/* once the guarded code got through */
+void vcd_xml_catch_pop (vcd_xml_catch_t *p_catch);
+
+/* passes an error on to the next outer frame; ends the process if
+   there is none */
+void vcd_xml_catch_rethrow (void);
+
+/* messages logged by the calling thread are prefixed with label, until
+   it is set to NULL again */
+void vcd_xml_log_set_label (const char label[]);
+
 int vcd_xml_scan_progress_cb (const vcd_mpeg_prog_info_t *info, void *user_data);
 
 int vcd_xml_write_progress_cb (const progress_info_t *info, void *user_data);
@@ -29,6 +29,7 @@
 #include <libxml/parserInternals.h>
 #include <libxml/xmlmemory.h>
 #include <libxml/uri.h>
+#include <libxml/xmlsave.h>
 
 #define FOR_EACH(iter, parent) for(iter = parent->xmlChildrenNode; iter != NULL; iter = iter->next)
 
@@ -145,65 +146,227 @@ _ref_area_helper (xmlNodePtr cur, xmlNsPtr ns, const char tag_id[], const char p
     }
 }
 
-static void
-_make_xml (vcdxml_t *obj, const char xml_fname[])
+/*
+ * streaming output
+ *
+ * Every element is built as a small tree and written out as soon as it
+ * is complete, then freed again. Elements without element children are
+ * written by xmlsave itself and the rest is formatted the way
+ * xmlSaveFormatFile () formats a whole document, so the output is the
+ * same as if the whole tree had been built and saved at once.
+ */
+
+/* videocd and a section */
+#define MAX_OPEN 2
+
+/* what xmlsave.c limits the indentation to */
+#define MAX_INDENT 60
+
+struct _VcdXmlDump
 {
-  xmlDtdPtr dtd;
+  vcdxml_t *obj;
+
+  xmlOutputBufferPtr out;
+  xmlBufferPtr buf;
+  xmlSaveCtxtPtr save;             /* writes to buf */
+
   xmlDocPtr doc;
-  xmlNodePtr vcd_node, section;
-  xmlNsPtr ns = NULL;
-  char buf[1024];
-  CdioListNode_t *node;
+  xmlNsPtr ns;
+  xmlNodePtr vcd_node;
 
-  xmlKeepBlanksDefault(0);
+  /* elements whose end tag is still to be written; the start tag of
+     an element is written along with its first child */
+  xmlNodePtr open[MAX_OPEN];
+  unsigned open_count;
+  unsigned started_count;
 
-  doc = xmlNewDoc ((const xmlChar *) "1.0");
+  vcd_xml_dump_part_t next_part;   /* the first one not written yet */
+};
 
-  dtd = xmlNewDtd (doc, (const xmlChar *) "videocd",
-		   (const xmlChar *) VIDEOCD_DTD_PUBID,
-		   (const xmlChar *) VIDEOCD_DTD_SYSID);
-  xmlAddChild ((xmlNodePtr) doc, (xmlNodePtr) dtd);
+static void
+_write (VcdXmlDump_t *p_dump, const char str[])
+{
+  xmlOutputBufferWriteString (p_dump->out, str);
+}
 
-  if (obj->comment)
-    xmlAddChild ((xmlNodePtr) doc, xmlNewComment ((const xmlChar *) obj->comment));
+/* moves what xmlsave wrote to the output, except for the last skip
+   bytes */
+static void
+_write_saved (VcdXmlDump_t *p_dump, int skip)
+{
+  xmlSaveFlush (p_dump->save);
 
-  vcd_node = xmlNewDocNode (doc, ns, (const xmlChar *) "videocd", NULL);
-  xmlAddChild ((xmlNodePtr) doc, vcd_node);
+  vcd_assert (xmlBufferLength (p_dump->buf) >= skip);
 
-  ns = xmlNewNs (vcd_node, (const xmlChar *) VIDEOCD_DTD_XMLNS, NULL);
-  xmlSetNs (vcd_node, ns);
+  xmlOutputBufferWrite (p_dump->out, xmlBufferLength (p_dump->buf) - skip,
+			(const char *) xmlBufferContent (p_dump->buf));
+  xmlBufferEmpty (p_dump->buf);
+}
 
-  switch (obj->vcd_type)
+static void
+_write_indent (VcdXmlDump_t *p_dump, unsigned level)
+{
+  const unsigned max = MAX_INDENT / MAX (1, strlen (xmlTreeIndentString));
+
+  if (!xmlIndentTreeOutput)
+    return;
+
+  for (level = MIN (level, max); level; level--)
+    _write (p_dump, xmlTreeIndentString);
+}
+
+/* whether xmlsave puts the children of node on lines of their own */
+static bool
+_formatted (xmlNodePtr node)
+{
+  xmlNodePtr child;
+
+  if (!node->children)
+    return false;
+
+  FOR_EACH (child, node)
+    switch (child->type)
+      {
+      case XML_TEXT_NODE:
+      case XML_CDATA_SECTION_NODE:
+      case XML_ENTITY_REF_NODE:
+	return false;
+
+      default:
+	break;
+      }
+
+  return true;
+}
+
+static void
+_write_start_tag (VcdXmlDump_t *p_dump, xmlNodePtr node)
+{
+  xmlNodePtr children = node->children;
+  xmlNodePtr last = node->last;
+
+  /* without children it is saved as "<name .../>" */
+  node->children = node->last = NULL;
+  xmlSaveTree (p_dump->save, node);
+  node->children = children;
+  node->last = last;
+
+  _write_saved (p_dump, 2);
+  _write (p_dump, ">\n");
+}
+
+static void
+_write_end_tag (VcdXmlDump_t *p_dump, xmlNodePtr node)
+{
+  _write (p_dump, "</");
+
+  if (node->ns && node->ns->prefix)
     {
-    case VCD_TYPE_VCD:
-      xmlSetProp (vcd_node, (const xmlChar *) "class", (const xmlChar *) "vcd");
-      xmlSetProp (vcd_node, (const xmlChar *) "version", (const xmlChar *) "1.0");
-      break;
+      _write (p_dump, (const char *) node->ns->prefix);
+      _write (p_dump, ":");
+    }
 
-    case VCD_TYPE_VCD11:
-      xmlSetProp (vcd_node, (const xmlChar *) "class", (const xmlChar *) "vcd");
-      xmlSetProp (vcd_node, (const xmlChar *) "version", (const xmlChar *) "1.1");
-      break;
+  _write (p_dump, (const char *) node->name);
+  _write (p_dump, ">");
+}
 
-    case VCD_TYPE_VCD2:
-      xmlSetProp (vcd_node, (const xmlChar *) "class", (const xmlChar *) "vcd");
-      xmlSetProp (vcd_node, (const xmlChar *) "version", (const xmlChar *) "2.0");
-      break;
+static void
+_write_node (VcdXmlDump_t *p_dump, xmlNodePtr node, unsigned level)
+{
+  xmlNodePtr child;
 
-    case VCD_TYPE_SVCD:
-      xmlSetProp (vcd_node, (const xmlChar *) "class", (const xmlChar *) "svcd");
-      xmlSetProp (vcd_node, (const xmlChar *) "version", (const xmlChar *) "1.0");
-      break;
+  _write_indent (p_dump, level);
 
-    case VCD_TYPE_HQVCD:
-      xmlSetProp (vcd_node, (const xmlChar *) "class", (const xmlChar *) "hqvcd");
-      xmlSetProp (vcd_node, (const xmlChar *) "version", (const xmlChar *) "1.0");
-      break;
+  if (!_formatted (node))
+    {
+      xmlSaveTree (p_dump->save, node);
+      _write_saved (p_dump, 0);
+      return;
+    }
 
-    default:
-      vcd_assert_not_reached ();
-      break;
+  _write_start_tag (p_dump, node);
+
+  FOR_EACH (child, node)
+    {
+      _write_node (p_dump, child, level + 1);
+      _write (p_dump, "\n");
+    }
+
+  _write_indent (p_dump, level);
+  _write_end_tag (p_dump, node);
+}
+
+static void
+_write_start_tags (VcdXmlDump_t *p_dump)
+{
+  while (p_dump->started_count < p_dump->open_count)
+    {
+      _write_indent (p_dump, p_dump->started_count);
+      _write_start_tag (p_dump, p_dump->open[p_dump->started_count++]);
+    }
+}
+
+/* node is an element whose children will be written one by one */
+static void
+_open_element (VcdXmlDump_t *p_dump, xmlNodePtr node)
+{
+  vcd_assert (p_dump->open_count < MAX_OPEN);
+
+  p_dump->open[p_dump->open_count++] = node;
+}
+
+/* writes node, a complete child of the innermost open element, and
+   frees it */
+static void
+_write_element (VcdXmlDump_t *p_dump, xmlNodePtr node)
+{
+  _write_start_tags (p_dump);
+
+  _write_node (p_dump, node, p_dump->open_count);
+  _write (p_dump, "\n");
+
+  xmlUnlinkNode (node);
+  xmlFreeNode (node);
+}
+
+static void
+_close_element (VcdXmlDump_t *p_dump)
+{
+  xmlNodePtr node;
+
+  vcd_assert (p_dump->open_count > 0);
+
+  node = p_dump->open[--p_dump->open_count];
+
+  vcd_assert (node->children == NULL);
+
+  if (p_dump->started_count > p_dump->open_count)
+    {
+      p_dump->started_count--;
+      _write_indent (p_dump, p_dump->open_count);
+      _write_end_tag (p_dump, node);
+      _write (p_dump, "\n");
+
+      xmlUnlinkNode (node);
+      xmlFreeNode (node);
     }
+  else /* no children, "<name/>" */
+    _write_element (p_dump, node);
+}
+
+/*
+ * the parts of the description
+ */
+
+static void
+_dump_head (VcdXmlDump_t *p_dump)
+{
+  vcdxml_t *obj = p_dump->obj;
+  xmlDocPtr doc = p_dump->doc;
+  xmlNodePtr vcd_node = p_dump->vcd_node, section;
+  xmlNsPtr ns = p_dump->ns;
+  char buf[1024];
+  CdioListNode_t *node;
 
   /* options */
 
@@ -214,6 +377,8 @@ _make_xml (vcdxml_t *obj, const char xml_fname[])
       section = xmlNewChild (vcd_node, ns, (const xmlChar *) "option", NULL);
       xmlSetProp (section, (const xmlChar *) "name", (const xmlChar *) _option->name);
       xmlSetProp (section, (const xmlChar *) "value", (const xmlChar *) _option->value);
+
+      _write_element (p_dump, section);
     }
 
   /* INFO */
@@ -237,6 +402,8 @@ _make_xml (vcdxml_t *obj, const char xml_fname[])
   snprintf (buf, sizeof (buf), "%d", obj->info.restriction);
   xmlNewChild (section, ns, (const xmlChar *) "restriction", (const xmlChar *) buf);
 
+  _write_element (p_dump, section);
+
   /* PVD */
 
   section = xmlNewChild (vcd_node, ns, (const xmlChar *) "pvd", NULL);
@@ -247,7 +414,10 @@ _make_xml (vcdxml_t *obj, const char xml_fname[])
   xmlNewChild (section, ns, (const xmlChar *) "preparer-id", (const xmlChar *) obj->pvd.preparer_id);
   xmlNewChild (section, ns, (const xmlChar *) "publisher-id", (const xmlChar *) obj->pvd.publisher_id);
 
-  /* filesystem */
+  _write_element (p_dump, section);
+
+  /* filesystem; the folders are sorted while it is built, so it is
+     written as a whole */
 
   if (_cdio_list_length (obj->filesystem))
     {
@@ -271,38 +441,64 @@ _make_xml (vcdxml_t *obj, const char xml_fname[])
 	  else /* folder */
 	    _get_node_pathname (doc, section, ns, p->name, true);
 	}
+
+      _write_element (p_dump, section);
     }
+}
+
+static void
+_dump_segments (VcdXmlDump_t *p_dump)
+{
+  vcdxml_t *obj = p_dump->obj;
+  xmlNsPtr ns = p_dump->ns;
+  xmlNodePtr section;
+  CdioListNode_t *node;
+
+  if (!_cdio_list_length (obj->segment_list))
+    return;
 
-  /* segments */
+  section = xmlNewChild (p_dump->vcd_node, ns, (const xmlChar *) "segment-items", NULL);
+  _open_element (p_dump, section);
 
-  if (_cdio_list_length (obj->segment_list))
+  _CDIO_LIST_FOREACH (node, obj->segment_list)
     {
-      section = xmlNewChild (vcd_node, ns, (const xmlChar *) "segment-items", NULL);
+      struct segment_t *_segment =  _cdio_list_node_data (node);
+      xmlNodePtr seg_node;
+      CdioListNode_t *node2;
+      unsigned char *psz_xml_fname_utf8 =
+	vcd_xml_filename_to_utf8 (_segment->src);
 
-      _CDIO_LIST_FOREACH (node, obj->segment_list)
-	{
-	  struct segment_t *_segment =  _cdio_list_node_data (node);
-	  xmlNodePtr seg_node;
-	  CdioListNode_t *node2;
+      seg_node = xmlNewChild (section, ns, (const xmlChar *) "segment-item", NULL);
+      xmlSetProp (seg_node, (const xmlChar *) "src", psz_xml_fname_utf8);
+      free(psz_xml_fname_utf8);
 
-	  seg_node = xmlNewChild (section, ns, (const xmlChar *) "segment-item", NULL);
-	  xmlSetProp (seg_node, (const xmlChar *) "src", vcd_xml_filename_to_utf8 (_segment->src));
-	  xmlSetProp (seg_node, (const xmlChar *) "id", (const xmlChar *) _segment->id);
+      xmlSetProp (seg_node, (const xmlChar *) "id", (const xmlChar *) _segment->id);
 
-	  _CDIO_LIST_FOREACH (node2, _segment->autopause_list)
-	    {
-	      double *_ap_ts = _cdio_list_node_data (node2);
-	      char buf[80];
+      _CDIO_LIST_FOREACH (node2, _segment->autopause_list)
+	{
+	  double *_ap_ts = _cdio_list_node_data (node2);
+	  char buf[80];
 
-	      snprintf (buf, sizeof (buf), "%f", *_ap_ts);
-	      xmlNewChild (seg_node, ns, (const xmlChar *) "auto-pause", (const xmlChar *) buf);
-	    }
+	  snprintf (buf, sizeof (buf), "%f", *_ap_ts);
+	  xmlNewChild (seg_node, ns, (const xmlChar *) "auto-pause", (const xmlChar *) buf);
 	}
+
+      _write_element (p_dump, seg_node);
     }
 
-  /* sequences */
+  _close_element (p_dump);
+}
 
-  section = xmlNewChild (vcd_node, ns, (const xmlChar *) "sequence-items", NULL);
+static void
+_dump_sequences (VcdXmlDump_t *p_dump)
+{
+  vcdxml_t *obj = p_dump->obj;
+  xmlNsPtr ns = p_dump->ns;
+  xmlNodePtr section;
+  CdioListNode_t *node;
+
+  section = xmlNewChild (p_dump->vcd_node, ns, (const xmlChar *) "sequence-items", NULL);
+  _open_element (p_dump, section);
 
   _CDIO_LIST_FOREACH (node, obj->sequence_list)
     {
@@ -352,156 +548,303 @@ _make_xml (vcdxml_t *obj, const char xml_fname[])
 	  xmlNewChild (seq_node, ns, (const xmlChar *) "auto-pause",
 		       (const xmlChar *) buf);
 	}
+
+      _write_element (p_dump, seq_node);
     }
 
-  /* PBC */
+  _close_element (p_dump);
+}
+
+static void
+_dump_pbc (VcdXmlDump_t *p_dump)
+{
+  vcdxml_t *obj = p_dump->obj;
+  xmlNsPtr ns = p_dump->ns;
+  xmlNodePtr section;
+  CdioListNode_t *node;
+
+  if (!_cdio_list_length (obj->pbc_list))
+    return;
 
-  if (_cdio_list_length (obj->pbc_list))
+  section = xmlNewChild (p_dump->vcd_node, ns, (const xmlChar *) "pbc", NULL);
+  _open_element (p_dump, section);
+
+  _CDIO_LIST_FOREACH (node, obj->pbc_list)
     {
-      section = xmlNewChild (vcd_node, ns, (const xmlChar *) "pbc", NULL);
+      pbc_t *_pbc = _cdio_list_node_data (node);
+      xmlNodePtr pl = NULL;
 
-      _CDIO_LIST_FOREACH (node, obj->pbc_list)
+      switch (_pbc->type)
 	{
-	  pbc_t *_pbc = _cdio_list_node_data (node);
-	  xmlNodePtr pl = NULL;
+	  char buf[80];
+	  CdioListNode_t *node2;
+
+	case PBC_PLAYLIST:
+	  pl = xmlNewChild (section, ns, (const xmlChar *) "playlist", NULL);
 
-	  switch (_pbc->type)
+	  _ref_area_helper (pl, ns, "prev", _pbc->prev_id, _pbc->prev_area);
+	  _ref_area_helper (pl, ns, "next", _pbc->next_id, _pbc->next_area);
+	  _ref_area_helper (pl, ns, "return", _pbc->retn_id, _pbc->return_area);
+
+	  if (_pbc->playing_time)
 	    {
-	      char buf[80];
-	      CdioListNode_t *node2;
+	      snprintf (buf, sizeof (buf), "%f", _pbc->playing_time);
+	      xmlNewChild (pl, ns, (const xmlChar *) "playtime", (const xmlChar *) buf);
+	    }
+
+	  snprintf (buf, sizeof (buf), "%d", _pbc->wait_time);
+	  xmlNewChild (pl, ns, (const xmlChar *) "wait", (const xmlChar *) buf);
 
-	    case PBC_PLAYLIST:
-	      pl = xmlNewChild (section, ns, (const xmlChar *) "playlist", NULL);
+	  snprintf (buf, sizeof (buf), "%d", _pbc->auto_pause_time);
+	  xmlNewChild (pl, ns, (const xmlChar *) "autowait", (const xmlChar *) buf);
 
-	      _ref_area_helper (pl, ns, "prev", _pbc->prev_id, _pbc->prev_area);
-	      _ref_area_helper (pl, ns, "next", _pbc->next_id, _pbc->next_area);
-	      _ref_area_helper (pl, ns, "return", _pbc->retn_id, _pbc->return_area);
+	  _CDIO_LIST_FOREACH (node2, _pbc->item_id_list)
+	    {
+	      const char *_id = _cdio_list_node_data (node2);
 
-	      if (_pbc->playing_time)
-		{
-		  snprintf (buf, sizeof (buf), "%f", _pbc->playing_time);
-		  xmlNewChild (pl, ns, (const xmlChar *) "playtime", (const xmlChar *) buf);
-		}
+	      if (_id)
+		xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "play-item", NULL),
+			    (const xmlChar *) "ref", (const xmlChar *) _id);
+	      else
+		xmlNewChild (pl, ns, (const xmlChar *) "play-item", NULL);
+	    }
 
-	      snprintf (buf, sizeof (buf), "%d", _pbc->wait_time);
-	      xmlNewChild (pl, ns, (const xmlChar *) "wait", (const xmlChar *) buf);
+	  break;
 
-	      snprintf (buf, sizeof (buf), "%d", _pbc->auto_pause_time);
-	      xmlNewChild (pl, ns, (const xmlChar *) "autowait", (const xmlChar *) buf);
+	case PBC_SELECTION:
+	  pl = xmlNewChild (section, ns, (const xmlChar *) "selection", NULL);
 
-	      _CDIO_LIST_FOREACH (node2, _pbc->item_id_list)
-		{
-		  const char *_id = _cdio_list_node_data (node2);
+	  snprintf (buf, sizeof (buf), "%d", _pbc->bsn);
+	  xmlNewChild (pl, ns, (const xmlChar *) "bsn", (const xmlChar *) buf);
 
-		  if (_id)
-		    xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "play-item", NULL),
-				(const xmlChar *) "ref", (const xmlChar *) _id);
-		  else
-		    xmlNewChild (pl, ns, (const xmlChar *) "play-item", NULL);
-		}
+	  _ref_area_helper (pl, ns, "prev", _pbc->prev_id, _pbc->prev_area);
+	  _ref_area_helper (pl, ns, "next", _pbc->next_id, _pbc->next_area);
+	  _ref_area_helper (pl, ns, "return", _pbc->retn_id, _pbc->return_area);
+	  switch (_pbc->selection_type)
+	    {
+	    case _SEL_NORMAL:
+	      _ref_area_helper (pl, ns, "default",
+				_pbc->default_id, _pbc->default_area);
+	      break;
+
+	    case _SEL_MULTI_DEF:
+	      xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "multi-default", NULL),
+			  (const xmlChar *) "numeric", (const xmlChar *) "enabled");
+	      break;
 
+	    case _SEL_MULTI_DEF_NO_NUM:
+	      xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "multi-default", NULL),
+			  (const xmlChar *) "numeric", (const xmlChar *) "disabled");
 	      break;
+	    }
+
+	  if (_pbc->timeout_id)
+	    xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "timeout", NULL),
+			(const xmlChar *) "ref", (const xmlChar *) _pbc->timeout_id);
+
+	  snprintf (buf, sizeof (buf), "%d", _pbc->timeout_time);
+	  xmlNewChild (pl, ns, (const xmlChar *) "wait", (const xmlChar *) buf);
+
+	  snprintf (buf, sizeof (buf), "%d", _pbc->loop_count);
+	  xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "loop", (const xmlChar *) buf),
+		      (const xmlChar *) "jump-timing",
+		      (_pbc->jump_delayed ? (const xmlChar *) "delayed" : (const xmlChar *) "immediate"));
 
-	    case PBC_SELECTION:
-	      pl = xmlNewChild (section, ns, (const xmlChar *) "selection", NULL);
-
-	      snprintf (buf, sizeof (buf), "%d", _pbc->bsn);
-	      xmlNewChild (pl, ns, (const xmlChar *) "bsn", (const xmlChar *) buf);
-
-	      _ref_area_helper (pl, ns, "prev", _pbc->prev_id, _pbc->prev_area);
-	      _ref_area_helper (pl, ns, "next", _pbc->next_id, _pbc->next_area);
-	      _ref_area_helper (pl, ns, "return", _pbc->retn_id, _pbc->return_area);
-	      switch (_pbc->selection_type)
-		{
-		case _SEL_NORMAL:
-		  _ref_area_helper (pl, ns, "default",
-				    _pbc->default_id, _pbc->default_area);
-		  break;
-
-		case _SEL_MULTI_DEF:
-		  xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "multi-default", NULL),
-			      (const xmlChar *) "numeric", (const xmlChar *) "enabled");
-		  break;
-
-		case _SEL_MULTI_DEF_NO_NUM:
-		  xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "multi-default", NULL),
-			      (const xmlChar *) "numeric", (const xmlChar *) "disabled");
-		  break;
-		}
-
-	      if (_pbc->timeout_id)
-		xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "timeout", NULL),
-			    (const xmlChar *) "ref", (const xmlChar *) _pbc->timeout_id);
-
-	      snprintf (buf, sizeof (buf), "%d", _pbc->timeout_time);
-	      xmlNewChild (pl, ns, (const xmlChar *) "wait", (const xmlChar *) buf);
-
-	      snprintf (buf, sizeof (buf), "%d", _pbc->loop_count);
-	      xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "loop", (const xmlChar *) buf),
-			  (const xmlChar *) "jump-timing",
-			  (_pbc->jump_delayed ? (const xmlChar *) "delayed" : (const xmlChar *) "immediate"));
-
-	      if (_pbc->item_id)
-		xmlSetProp (xmlNewChild (pl, ns,
-					 (const xmlChar *) "play-item", NULL),
-			    (const xmlChar *) "ref",
-			    (const xmlChar *) _pbc->item_id);
+	  if (_pbc->item_id)
+	    xmlSetProp (xmlNewChild (pl, ns,
+				     (const xmlChar *) "play-item", NULL),
+			(const xmlChar *) "ref",
+			(const xmlChar *) _pbc->item_id);
 
+	  {
+	    CdioListNode_t *node3 =
+	      _cdio_list_begin (_pbc->select_area_list);
+
+	    _CDIO_LIST_FOREACH (node2, _pbc->select_id_list)
 	      {
-		CdioListNode_t *node3 =
-		  _cdio_list_begin (_pbc->select_area_list);
-
-		_CDIO_LIST_FOREACH (node2, _pbc->select_id_list)
-		  {
-		    char *_id = _cdio_list_node_data (node2);
-		    pbc_area_t *_area = node3 ? _cdio_list_node_data (node3) : NULL;
-
-		    if (_id)
-		      _ref_area_helper (pl, ns, "select", _id, _area);
-		    else
-		      xmlNewChild (pl, ns, (const xmlChar *) "select", NULL);
-
-		    if (_cdio_list_length (_pbc->select_area_list))
-		      node3 = _cdio_list_node_next (node3);
-		  }
-	      }
-	      break;
+		char *_id = _cdio_list_node_data (node2);
+		pbc_area_t *_area = node3 ? _cdio_list_node_data (node3) : NULL;
 
-	    case PBC_END:
-	      pl = xmlNewChild (section, ns, (const xmlChar *) "endlist", NULL);
+		if (_id)
+		  _ref_area_helper (pl, ns, "select", _id, _area);
+		else
+		  xmlNewChild (pl, ns, (const xmlChar *) "select", NULL);
 
-	      if (_pbc->next_disc)
-		{
-		  snprintf (buf, sizeof (buf), "%d", _pbc->next_disc);
-		  xmlNewChild (pl, ns, (const xmlChar *) "next-volume", (const xmlChar *) buf);
-		}
+		if (_cdio_list_length (_pbc->select_area_list))
+		  node3 = _cdio_list_node_next (node3);
+	      }
+	  }
+	  break;
 
-	      if (_pbc->image_id)
-		xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "play-item", NULL),
-			    (const xmlChar *) "ref", (const xmlChar *) _pbc->image_id);
-	      break;
+	case PBC_END:
+	  pl = xmlNewChild (section, ns, (const xmlChar *) "endlist", NULL);
 
-	    default:
-	      vcd_assert_not_reached ();
+	  if (_pbc->next_disc)
+	    {
+	      snprintf (buf, sizeof (buf), "%d", _pbc->next_disc);
+	      xmlNewChild (pl, ns, (const xmlChar *) "next-volume", (const xmlChar *) buf);
 	    }
 
-	  xmlSetProp (pl, (const xmlChar *) "id", (const xmlChar *) _pbc->id);
-	  if (_pbc->rejected)
-	    xmlSetProp (pl, (const xmlChar *) "rejected", (const xmlChar *) "true");
+	  if (_pbc->image_id)
+	    xmlSetProp (xmlNewChild (pl, ns, (const xmlChar *) "play-item", NULL),
+			(const xmlChar *) "ref", (const xmlChar *) _pbc->image_id);
+	  break;
+
+	default:
+	  vcd_assert_not_reached ();
 	}
+
+      xmlSetProp (pl, (const xmlChar *) "id", (const xmlChar *) _pbc->id);
+      if (_pbc->rejected)
+	xmlSetProp (pl, (const xmlChar *) "rejected", (const xmlChar *) "true");
+
+      _write_element (p_dump, pl);
+    }
+
+  _close_element (p_dump);
+}
+
+VcdXmlDump_t *
+vcd_xml_dump_new (vcdxml_t *obj, const char xml_fname[])
+{
+  VcdXmlDump_t *p_dump;
+  xmlOutputBufferPtr out;
+  xmlNodePtr node;
+
+  xmlKeepBlanksDefault(0);
+
+  /* the same output xmlSaveFormatFile () would use */
+  if (!(out = xmlOutputBufferCreateFilename (xml_fname, NULL, 0)))
+    return NULL;
+
+  p_dump = calloc (1, sizeof (VcdXmlDump_t));
+  p_dump->obj = obj;
+  p_dump->out = out;
+  p_dump->buf = xmlBufferCreate ();
+  p_dump->save = xmlSaveToBuffer (p_dump->buf, NULL, XML_SAVE_FORMAT);
+
+  p_dump->doc = xmlNewDoc ((const xmlChar *) "1.0");
+
+  _write (p_dump, "<?xml version=\"1.0\"?>\n");
+
+  node = (xmlNodePtr) xmlNewDtd (p_dump->doc, (const xmlChar *) "videocd",
+				 (const xmlChar *) VIDEOCD_DTD_PUBID,
+				 (const xmlChar *) VIDEOCD_DTD_SYSID);
+  xmlAddChild ((xmlNodePtr) p_dump->doc, node);
+  _write_node (p_dump, node, 0);
+  _write (p_dump, "\n");
+
+  if (obj->comment)
+    {
+      node = xmlNewComment ((const xmlChar *) obj->comment);
+      xmlAddChild ((xmlNodePtr) p_dump->doc, node);
+      _write_node (p_dump, node, 0);
+      _write (p_dump, "\n");
+    }
+
+  node = xmlNewDocNode (p_dump->doc, NULL, (const xmlChar *) "videocd", NULL);
+  xmlAddChild ((xmlNodePtr) p_dump->doc, node);
+  p_dump->vcd_node = node;
+
+  p_dump->ns = xmlNewNs (node, (const xmlChar *) VIDEOCD_DTD_XMLNS, NULL);
+  xmlSetNs (node, p_dump->ns);
+
+  switch (obj->vcd_type)
+    {
+    case VCD_TYPE_VCD:
+      xmlSetProp (node, (const xmlChar *) "class", (const xmlChar *) "vcd");
+      xmlSetProp (node, (const xmlChar *) "version", (const xmlChar *) "1.0");
+      break;
+
+    case VCD_TYPE_VCD11:
+      xmlSetProp (node, (const xmlChar *) "class", (const xmlChar *) "vcd");
+      xmlSetProp (node, (const xmlChar *) "version", (const xmlChar *) "1.1");
+      break;
+
+    case VCD_TYPE_VCD2:
+      xmlSetProp (node, (const xmlChar *) "class", (const xmlChar *) "vcd");
+      xmlSetProp (node, (const xmlChar *) "version", (const xmlChar *) "2.0");
+      break;
+
+    case VCD_TYPE_SVCD:
+      xmlSetProp (node, (const xmlChar *) "class", (const xmlChar *) "svcd");
+      xmlSetProp (node, (const xmlChar *) "version", (const xmlChar *) "1.0");
+      break;
+
+    case VCD_TYPE_HQVCD:
+      xmlSetProp (node, (const xmlChar *) "class", (const xmlChar *) "hqvcd");
+      xmlSetProp (node, (const xmlChar *) "version", (const xmlChar *) "1.0");
+      break;
+
+    default:
+      vcd_assert_not_reached ();
+      break;
     }
 
-  xmlSaveFormatFile (xml_fname, doc, true);
+  _open_element (p_dump, node);
+
+  p_dump->next_part = VCD_XML_DUMP_HEAD;
+
+  return p_dump;
+}
+
+void
+vcd_xml_dump_until (VcdXmlDump_t *p_dump, vcd_xml_dump_part_t part)
+{
+  vcd_assert (p_dump != NULL);
+
+  for (; p_dump->next_part <= part; p_dump->next_part++)
+    switch (p_dump->next_part)
+      {
+      case VCD_XML_DUMP_HEAD:
+	_dump_head (p_dump);
+	break;
+
+      case VCD_XML_DUMP_SEGMENTS:
+	_dump_segments (p_dump);
+	break;
+
+      case VCD_XML_DUMP_SEQUENCES:
+	_dump_sequences (p_dump);
+	break;
+
+      case VCD_XML_DUMP_PBC:
+	_dump_pbc (p_dump);
+	break;
+      }
+}
+
+int
+vcd_xml_dump_destroy (VcdXmlDump_t *p_dump)
+{
+  int written;
+
+  vcd_assert (p_dump != NULL);
+
+  vcd_xml_dump_until (p_dump, VCD_XML_DUMP_PBC);
+
+  _close_element (p_dump);
+  vcd_assert (p_dump->open_count == 0);
 
-  xmlFreeDoc (doc);
+  written = xmlOutputBufferClose (p_dump->out);
+
+  xmlSaveClose (p_dump->save);
+  xmlBufferFree (p_dump->buf);
+  xmlFreeDoc (p_dump->doc);
+  free (p_dump);
+
+  return written < 0 ? -1 : 0;
 }
 
 int
 vcd_xml_dump (vcdxml_t *obj, const char xml_fname[])
 {
-  _make_xml (obj, xml_fname);
+  VcdXmlDump_t *p_dump = vcd_xml_dump_new (obj, xml_fname);
+
+  if (!p_dump)
+    return -1;
 
-  return 0;
+  return vcd_xml_dump_destroy (p_dump);
 }
 
 /*
@@ -23,8 +23,35 @@
 
 #include "vcdxml.h"
 
+/* writes the description of obj to xml_fname; returns 0 on success */
 int vcd_xml_dump (vcdxml_t *obj, const char xml_fname[]);
 
+/* The description can also be written part by part while obj is still
+   being filled in, e.g. while the items are ripped. Only the element
+   being written is ever held as a document tree. */
+
+typedef struct _VcdXmlDump VcdXmlDump_t;
+
+/* the parts of the description, in document order */
+typedef enum {
+  VCD_XML_DUMP_HEAD,        /* options, info, pvd and filesystem */
+  VCD_XML_DUMP_SEGMENTS,
+  VCD_XML_DUMP_SEQUENCES,
+  VCD_XML_DUMP_PBC
+} vcd_xml_dump_part_t;
+
+/* creates xml_fname and writes the document prolog; returns NULL if
+   the file can't be created */
+VcdXmlDump_t *vcd_xml_dump_new (vcdxml_t *obj, const char xml_fname[]);
+
+/* writes the parts up to and including part that have not been
+   written yet; they must not change in obj afterwards */
+void vcd_xml_dump_until (VcdXmlDump_t *p_dump, vcd_xml_dump_part_t part);
+
+/* writes the remaining parts and closes the file; returns 0 on
+   success */
+int vcd_xml_dump_destroy (VcdXmlDump_t *p_dump);
+
 /*!
    Print command line used as a XML comment. Start is either 0 or 
    1. The program might be invoked either from a binary or a libtool
@@ -437,6 +437,9 @@ main (int argc, const char *argv[])
   else
     vcd_xml_verbosity = VCD_LOG_INFO;
 
+  /* don't even format what the handler would throw away */
+  vcd_log_set_level (vcd_xml_verbosity);
+
   /* done with argument processing */
 
   if (obj.vcd_type == VCD_TYPE_VCD11
@@ -515,7 +518,11 @@ main (int argc, const char *argv[])
       _cdio_list_append (obj.option_list, _opt);
     }
 
-  vcd_xml_dump (&obj, xml_fname);
+  if (vcd_xml_dump (&obj, xml_fname))
+    {
+      fprintf (stderr, "writing `%s' failed\n", xml_fname);
+      exit (EXIT_FAILURE);
+    }
 
   fprintf (stdout, "(Super) VideoCD xml description created successfully as `%s'\n",
            xml_fname);
@@ -35,6 +35,11 @@
 #include <stdlib.h>
 #endif
 #include <stdio.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 /* important date to celebrate (for me at least =)
    -- until user customization is implemented... */
@@ -59,20 +64,311 @@ mk_dsource (const char prefix[], const char pathname[])
   return vcd_data_source_new_stdio (pathname);
 }
 
+/* MPEG files already scanned for an earlier image; the key is the file
+   name together with the scan flags, as they change the result */
+typedef struct {
+  char *pathname;
+  bool strict_aps;
+  bool fix_scan_info;
+  VcdMpegSource_t *p_source; /* NULL until scanned */
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;      /* held while scanning */
+#endif
+} _scan_cache_entry_t;
+
+static struct {
+  bool enabled;
+  CdioList_t *entries;
+  unsigned hits;
+  unsigned misses;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;
+#endif
+} _scan_cache = {
+  false, NULL, 0, 0,
+#ifdef HAVE_PTHREAD_H
+  PTHREAD_MUTEX_INITIALIZER
+#endif
+};
+
+void
+vcd_xml_scan_cache_enable (void)
+{
+  _scan_cache.enabled = true;
+}
+
+void
+vcd_xml_scan_cache_stats (unsigned *p_hits, unsigned *p_misses)
+{
+  if (p_hits)
+    *p_hits = _scan_cache.hits;
+  if (p_misses)
+    *p_misses = _scan_cache.misses;
+}
+
+static void
+_scan_cache_entry_free (void *user_data)
+{
+  _scan_cache_entry_t *p_entry = user_data;
+
+  if (p_entry->p_source)
+    vcd_mpeg_source_destroy (p_entry->p_source, true);
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy (&p_entry->lock);
+#endif
+  free (p_entry->pathname);
+  free (p_entry);
+}
+
+void
+vcd_xml_scan_cache_free (void)
+{
+  if (_scan_cache.entries)
+    _cdio_list_free (_scan_cache.entries, true, _scan_cache_entry_free);
+
+  _scan_cache.entries = NULL;
+  _scan_cache.enabled = false;
+}
+
+/* only regular files are cached; a pipe or a device may well give
+   something else the next time it's read */
+static bool
+_scan_cache_regular (const char prefix[], const char pathname[])
+{
+  struct stat statbuf;
+  char *_fname;
+  bool regular;
+
+  if (!strcmp (pathname, "-"))
+    return false;
+
+  if (!prefix)
+    return !stat (pathname, &statbuf) && S_ISREG (statbuf.st_mode);
+
+  if (!(_fname = malloc (strlen (prefix) + strlen (pathname) + 1)))
+    return false;
+
+  strcpy (_fname, prefix);
+  strcat (_fname, pathname);
+
+  regular = !stat (_fname, &statbuf) && S_ISREG (statbuf.st_mode);
+
+  free (_fname);
+
+  return regular;
+}
+
+static _scan_cache_entry_t *
+_scan_cache_get (const char pathname[], bool strict_aps, bool fix_scan_info)
+{
+  _scan_cache_entry_t *p_entry = NULL;
+  CdioListNode_t *node;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&_scan_cache.lock);
+#endif
+
+  if (!_scan_cache.entries)
+    _scan_cache.entries = _cdio_list_new ();
+
+  _CDIO_LIST_FOREACH (node, _scan_cache.entries)
+    {
+      _scan_cache_entry_t *_entry = _cdio_list_node_data (node);
+
+      if (_entry->strict_aps == strict_aps
+          && _entry->fix_scan_info == fix_scan_info
+          && !strcmp (_entry->pathname, pathname))
+        {
+          p_entry = _entry;
+          break;
+        }
+    }
+
+  if (!p_entry)
+    {
+      p_entry = calloc (1, sizeof (_scan_cache_entry_t));
+      p_entry->pathname = strdup (pathname);
+      p_entry->strict_aps = strict_aps;
+      p_entry->fix_scan_info = fix_scan_info;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_init (&p_entry->lock, NULL);
+#endif
+      _cdio_list_append (_scan_cache.entries, p_entry);
+    }
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&_scan_cache.lock);
+#endif
+
+  return p_entry;
+}
+
+/* a scanned source for pathname; with the scan cache enabled a file
+   already scanned for another image isn't read again.  fingerprint
+   is for sequences going into a manifest */
+static VcdMpegSource_t *
+_mpeg_source (const char prefix[], const char pathname[], bool strict_aps,
+              bool fix_scan_info, bool fingerprint, const char id[])
+{
+  VcdMpegSource_t *_mpeg_src =
+    vcd_mpeg_source_new (mk_dsource (prefix, pathname));
+  vcd_mpeg_prog_cb_t _callback =
+    vcd_xml_show_progress ? vcd_xml_scan_progress_cb : NULL;
+  _scan_cache_entry_t *p_entry = NULL;
+  vcd_xml_catch_t _catch;
+
+  if (fingerprint)
+    vcd_mpeg_source_want_fingerprint (_mpeg_src);
+
+  /* a pipe can be read only once anyway, and a cached scan may lack
+     the fingerprint */
+  if (_scan_cache.enabled && _scan_cache_regular (prefix, pathname)
+      && !fingerprint)
+    p_entry = _scan_cache_get (pathname, strict_aps, fix_scan_info);
+
+#ifdef HAVE_PTHREAD_H
+  if (p_entry)
+    pthread_mutex_lock (&p_entry->lock);
+#endif
+
+  /* an error while scanning ends the build, not the process */
+  vcd_xml_catch_push (&_catch);
+  if (setjmp (_catch.env))
+    {
+#ifdef HAVE_PTHREAD_H
+      if (p_entry)
+        pthread_mutex_unlock (&p_entry->lock);
+#endif
+      vcd_mpeg_source_destroy (_mpeg_src, true);
+      vcd_xml_catch_rethrow ();
+    }
+
+  if (!p_entry)
+    vcd_mpeg_source_scan (_mpeg_src, strict_aps, fix_scan_info,
+                          _callback, (void *) id);
+  else if (p_entry->p_source)
+    {
+      vcd_debug ("`%s' scanned before, not scanning it again", pathname);
+      vcd_mpeg_source_copy_scan (_mpeg_src, p_entry->p_source);
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock (&_scan_cache.lock);
+#endif
+      _scan_cache.hits++;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock (&_scan_cache.lock);
+#endif
+    }
+  else
+    {
+      VcdMpegSource_t *p_cached;
+
+      vcd_mpeg_source_scan (_mpeg_src, strict_aps, fix_scan_info,
+                            _callback, (void *) id);
+
+      /* the cache keeps a source of its own, as _mpeg_src goes away
+         with the image it's added to */
+      p_cached = vcd_mpeg_source_new (mk_dsource (prefix, pathname));
+      vcd_mpeg_source_copy_scan (p_cached, _mpeg_src);
+      p_entry->p_source = p_cached;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock (&_scan_cache.lock);
+#endif
+      _scan_cache.misses++;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock (&_scan_cache.lock);
+#endif
+    }
+
+  vcd_xml_catch_pop (&_catch);
+
+#ifdef HAVE_PTHREAD_H
+  if (p_entry)
+    pthread_mutex_unlock (&p_entry->lock);
+#endif
+
+  return _mpeg_src;
+}
+
+static void
+_print_stats (const VcdObj_t *p_vcdobj)
+{
+  vcd_obj_stats_t stats;
+  int i;
+
+  vcd_obj_get_stats (p_vcdobj, &stats);
+
+  if (vcd_xml_gui_mode)
+    {
+      for (i = 0; i < VCD_STAGE_COUNT; i++)
+        fprintf (stdout, "<stats stage=\"%s\" seconds=\"%f\" bytes=\"%llu\""
+                 " count=\"%lu\" />\n", vcd_stage_name (i),
+                 stats.stage[i].seconds,
+                 (unsigned long long) stats.stage[i].bytes,
+                 stats.stage[i].count);
+
+      fprintf (stdout, "<stats seconds=\"%f\" sectors=\"%lu\" seeks=\"%lu\""
+               " video=\"%lu\" audio=\"%lu\" ogt=\"%lu\" zero=\"%lu\""
+               " empty=\"%lu\" arena-bytes=\"%llu\" peak-rss=\"%ld\" />\n",
+               stats.seconds, stats.sectors, stats.seeks,
+               stats.packets.video, stats.packets.audio, stats.packets.ogt,
+               stats.packets.zero, stats.packets.empty,
+               (unsigned long long) stats.arena_bytes, stats.peak_rss);
+      fflush (stdout);
+      return;
+    }
+
+  fprintf (stdout, "%-10s %10s %12s %10s %9s\n",
+           "stage", "seconds", "bytes", "count", "MB/s");
+
+  for (i = 0; i < VCD_STAGE_COUNT; i++)
+    {
+      const vcd_stage_stats_t *p_stage = &stats.stage[i];
+
+      fprintf (stdout, "%-10s %10.3f %12llu %10lu %9.1f\n",
+               vcd_stage_name (i), p_stage->seconds,
+               (unsigned long long) p_stage->bytes, p_stage->count,
+               p_stage->seconds > 0
+               ? p_stage->bytes / p_stage->seconds / (1024 * 1024) : 0.0);
+    }
+
+  fprintf (stdout, "wrote %lu sectors in %.3f seconds, %lu seeks\n",
+           stats.sectors, stats.seconds, stats.seeks);
+  fprintf (stdout, "packets: %lu video, %lu audio, %lu ogt, %lu zero,"
+           " %lu empty\n", stats.packets.video, stats.packets.audio,
+           stats.packets.ogt, stats.packets.zero, stats.packets.empty);
+  fprintf (stdout, "memory: %llu bytes in output arena",
+           (unsigned long long) stats.arena_bytes);
+  if (stats.peak_rss)
+    fprintf (stdout, ", %ld KiB peak resident", stats.peak_rss);
+  fprintf (stdout, "\n");
+  fflush (stdout);
+}
+
 bool
 vcd_xml_master (const vcdxml_t *p_vcdxml, VcdImageSink_t *p_image_sink,
-		time_t *create_time)
+		time_t *create_time, vcd_obj_stats_t *p_stats)
 {
   VcdObj_t *_vcd;
   CdioListNode_t *node;
   int idx;
   bool _relaxed_aps = false;
   bool _update_scan_offsets = false;
+  vcd_xml_catch_t _catch;
 
   vcd_assert (p_vcdxml != NULL);
 
   _vcd = vcd_obj_new (p_vcdxml->vcd_type);
 
+  /* an error fails just this image; p_image_sink is left to the
+     caller then */
+  vcd_xml_catch_push (&_catch);
+  if (setjmp (_catch.env))
+    {
+      vcd_obj_destroy (_vcd);
+      return true;
+    }
+
   if (vcd_xml_check_mode)
     vcd_obj_set_param_str (_vcd, VCD_PARM_PREPARER_ID,
 			   "GNU VCDIMAGER CHECK MODE");
@@ -91,6 +387,14 @@ vcd_xml_master (const vcdxml_t *p_vcdxml, VcdImageSink_t *p_image_sink,
   vcd_obj_set_param_bool (_vcd, VCD_PARM_NEXT_VOL_LID2,
 			  p_vcdxml->info.use_lid2);
 
+  if (p_vcdxml->manifest_fname)
+    vcd_obj_set_param_str (_vcd, VCD_PARM_MANIFEST,
+			   p_vcdxml->manifest_fname);
+
+  if (p_vcdxml->reuse_image_fname)
+    vcd_obj_set_param_str (_vcd, VCD_PARM_REUSE_IMAGE,
+			   p_vcdxml->reuse_image_fname);
+
   if (p_vcdxml->pvd.volume_id)
     vcd_obj_set_param_str (_vcd, VCD_PARM_VOLUME_ID,
 			   p_vcdxml->pvd.volume_id);
@@ -232,21 +536,14 @@ vcd_xml_master (const vcdxml_t *p_vcdxml, VcdImageSink_t *p_image_sink,
   _CDIO_LIST_FOREACH (node, p_vcdxml->segment_list)
     {
       struct segment_t *p_segment = _cdio_list_node_data (node);
-      VcdDataSource_t *_source = mk_dsource (p_vcdxml->file_prefix,
-					   p_segment->src);
       CdioListNode_t *p_node2;
       VcdMpegSource_t *_mpeg_src;
 
       vcd_debug ("adding segment #%d, %s", idx, p_segment->src);
 
-      vcd_assert (_source != NULL);
-
-      _mpeg_src = vcd_mpeg_source_new (_source);
-
-      vcd_mpeg_source_scan (_mpeg_src, !_relaxed_aps, _update_scan_offsets,
-			    vcd_xml_show_progress
-			    ? vcd_xml_scan_progress_cb : NULL,
-			    p_segment->id);
+      _mpeg_src = _mpeg_source (p_vcdxml->file_prefix, p_segment->src,
+				!_relaxed_aps, _update_scan_offsets, false,
+				p_segment->id);
 
       vcd_obj_append_segment_play_item (_vcd, _mpeg_src, p_segment->id);
 
@@ -266,21 +563,16 @@ vcd_xml_master (const vcdxml_t *p_vcdxml, VcdImageSink_t *p_image_sink,
   _CDIO_LIST_FOREACH (node, p_vcdxml->sequence_list)
     {
       struct sequence_t *sequence = _cdio_list_node_data (node);
-      VcdDataSource_t *data_source;
       CdioListNode_t *node2;
       VcdMpegSource_t *_mpeg_src;
 
       vcd_debug ("adding sequence #%d, %s", idx, sequence->src);
 
-      data_source = mk_dsource (p_vcdxml->file_prefix, sequence->src);
-      vcd_assert (data_source != NULL);
-
-      _mpeg_src = vcd_mpeg_source_new (data_source);
-
-      vcd_mpeg_source_scan (_mpeg_src, !_relaxed_aps, _update_scan_offsets,
-			    (vcd_xml_show_progress)
-			    ? vcd_xml_scan_progress_cb : NULL,
-			    sequence->id);
+      _mpeg_src = _mpeg_source (p_vcdxml->file_prefix, sequence->src,
+				!_relaxed_aps, _update_scan_offsets,
+				p_vcdxml->manifest_fname
+				|| p_vcdxml->reuse_image_fname,
+				sequence->id);
 
       vcd_obj_append_sequence_play_item (_vcd, _mpeg_src, sequence->id,
 					 sequence->default_entry_id);
@@ -309,6 +601,10 @@ vcd_xml_master (const vcdxml_t *p_vcdxml, VcdImageSink_t *p_image_sink,
     unsigned sectors;
     char *_tmp;
 
+    if (vcd_xml_show_progress)
+      vcd_obj_set_param_uint (_vcd, VCD_PARM_PROGRESS_INTERVAL,
+			      VCD_XML_PROGRESS_INTERVAL);
+
     sectors = vcd_obj_begin_output (_vcd);
 
     vcd_obj_write_image (_vcd, p_image_sink, vcd_xml_show_progress
@@ -323,6 +619,14 @@ vcd_xml_master (const vcdxml_t *p_vcdxml, VcdImageSink_t *p_image_sink,
     free (_tmp);
   }
 
+  if (vcd_xml_show_stats)
+    _print_stats (_vcd);
+
+  if (p_stats)
+    vcd_obj_get_stats (_vcd, p_stats);
+
+  vcd_xml_catch_pop (&_catch);
+
   vcd_obj_destroy (_vcd);
 
   return false;
@@ -21,11 +21,24 @@
 #ifndef __VCD_XML_MASTER_H__
 #define __VCD_XML_MASTER_H__
 #include "vcdxml.h"
+#include "vcd.h"
 
 #include <time.h>
 
+/* p_stats, if not NULL, is filled in with the stats of the build;
+   returns true if an error ended it, p_image_sink is not destroyed
+   then */
 bool vcd_xml_master (const vcdxml_t *p_vcdxml, 
-		     VcdImageSink_t *p_image_sink, time_t *p_create_time);
+		     VcdImageSink_t *p_image_sink, time_t *p_create_time,
+		     vcd_obj_stats_t *p_stats);
+
+/* once enabled, MPEG files used by several images built in this
+   process are scanned only for the first of them */
+void vcd_xml_scan_cache_enable (void);
+
+void vcd_xml_scan_cache_stats (unsigned *p_hits, unsigned *p_misses);
+
+void vcd_xml_scan_cache_free (void);
 
 #endif /* __VCD_XML_MASTER_H__ */
 
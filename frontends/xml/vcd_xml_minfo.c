@@ -32,6 +32,7 @@
 #include "mpeg_stream.h"
 #include "stream_stdio.h"
 #include "util.h"
+#include "vcd_assert.h"
 #include "vcd.h"
 
 #include "vcd_xml_common.h"
@@ -41,72 +42,79 @@ enum {
   OP_VERSION = 1 << 1
 };
 
-static int _TAG_LEVEL = 0;
-static char *_TAG_STACK[16];
-
-static FILE *_TAG_FD = 0;
+/* state of the XML being written; kept together rather than in
+   globals so that the writer can be used for more than one file */
+typedef struct
+{
+  FILE *fd;
+  int level;
+  char *stack[16];
+} tag_writer_t;
 
 static void
-_TAG_INDENT (void)
+_tag_indent (tag_writer_t *p_tw)
 {
   int _i;
 
-  for (_i = 0; _i < _TAG_LEVEL; _i++)
-    fputs ("  ", _TAG_FD);
+  for (_i = 0; _i < p_tw->level; _i++)
+    fputs ("  ", p_tw->fd);
 }
 
 static void
-_TAG_OPEN (const char tag[], const char fmt[], ...)
+_tag_open (tag_writer_t *p_tw, const char tag[], const char fmt[], ...)
 {
   va_list args;
   va_start (args, fmt);
 
-  _TAG_STACK[_TAG_LEVEL] = strdup (tag);
+  vcd_assert (p_tw->level < (int) (sizeof (p_tw->stack)
+                                   / sizeof (p_tw->stack[0])));
+
+  p_tw->stack[p_tw->level] = strdup (tag);
 
-  _TAG_INDENT();
+  _tag_indent (p_tw);
   if (fmt)
     {
       char buf[1024] = { 0, };
 
       vsnprintf (buf, sizeof (buf), fmt, args);
 
-      fprintf (_TAG_FD, "<%s %s>", tag, buf);
+      fprintf (p_tw->fd, "<%s %s>", tag, buf);
     }
   else
-    fprintf (_TAG_FD, "<%s>", tag);
+    fprintf (p_tw->fd, "<%s>", tag);
 
-  fputs ("\n", _TAG_FD);
+  fputs ("\n", p_tw->fd);
 
-  _TAG_LEVEL++;
+  p_tw->level++;
 
   va_end (args);
 }
 
 static void
-_TAG_CLOSE (void)
+_tag_close (tag_writer_t *p_tw)
 {
-  _TAG_LEVEL--;
+  p_tw->level--;
 
-  _TAG_INDENT();
-  fprintf (_TAG_FD, "</%s>\n", _TAG_STACK[_TAG_LEVEL]);
+  _tag_indent (p_tw);
+  fprintf (p_tw->fd, "</%s>\n", p_tw->stack[p_tw->level]);
 
-  free (_TAG_STACK[_TAG_LEVEL]);
+  free (p_tw->stack[p_tw->level]);
 }
 
 static void
-_TAG_COMMENT (const char fmt[])
+_tag_comment (tag_writer_t *p_tw, const char fmt[])
 {
-  _TAG_INDENT ();
-  fprintf (_TAG_FD, " <!-- %s -->\n", fmt);
+  _tag_indent (p_tw);
+  fprintf (p_tw->fd, " <!-- %s -->\n", fmt);
 }
 
 static void
-_TAG_PRINT (const char tag[], const char fmt[], ...)
+_tag_print (tag_writer_t *p_tw, const char tag[], const char fmt[], ...)
 {
   va_list args;
   va_start (args, fmt);
 
-  _TAG_INDENT ();
+  _tag_indent (p_tw);
 
   if (fmt)
     {
@@ -114,19 +122,16 @@ _TAG_PRINT (const char tag[], const char fmt[], ...)
 
       vsnprintf (buf, sizeof (buf), fmt, args);
 
-      fprintf (_TAG_FD, "<%s>%s</%s>", tag, buf, tag);
+      fprintf (p_tw->fd, "<%s>%s</%s>", tag, buf, tag);
     }
   else
-    fprintf (_TAG_FD, "<%s />", tag);
+    fprintf (p_tw->fd, "<%s />", tag);
 
-  fputs ("\n", _TAG_FD);
+  fputs ("\n", p_tw->fd);
 
   va_end (args);
 }
 
-#define _TAG_PRINT2(tag, tp, val) \
- { _TAG_INDENT (); fprintf (_TAG_FD, "<" tag ">" tp "</" tag ">\n", val); }
-
 int
 main (int argc, const char *argv[])
 {
@@ -226,6 +231,9 @@ main (int argc, const char *argv[])
   else
     vcd_xml_verbosity = VCD_LOG_INFO;
 
+  /* don't even format what the handler would throw away */
+  vcd_log_set_level (vcd_xml_verbosity);
+
   if (_gui_flag)
     vcd_xml_gui_mode = true;
 
@@ -235,6 +243,9 @@ main (int argc, const char *argv[])
   {
     VcdMpegSource_t *src;
     CdioListNode_t *n;
+    tag_writer_t tw;
+
+    memset (&tw, 0, sizeof (tw));
 
     vcd_debug ("trying to open mpeg stream...");
 
@@ -249,31 +260,31 @@ main (int argc, const char *argv[])
 
     if (_output_file && strcmp (_output_file, "-"))
       {
-        if (!(_TAG_FD = fopen (_output_file, "w")))
+        if (!(tw.fd = fopen (_output_file, "w")))
           vcd_error ("fopen (): %s", strerror (errno));
       }
     else
       {
-        _TAG_FD = stdout;
+        tw.fd = stdout;
         _output_file = 0;
       }
 
-    _TAG_OPEN ("mpeg-info", "src=\"%s\"", _mpeg_fname);
+    _tag_open (&tw, "mpeg-info", "src=\"%s\"", _mpeg_fname);
 
     if (_generic_info)
       {
         const struct vcd_mpeg_stream_info *_info = vcd_mpeg_source_get_info (src);
         int i;
 
-        _TAG_OPEN ("mpeg-properties", 0);
+        _tag_open (&tw, "mpeg-properties", 0);
 
-        _TAG_PRINT ("version", "%d", _info->version);
+        _tag_print (&tw, "version", "%d", _info->version);
 
-        _TAG_PRINT ("playing-time", "%f", _info->playing_time);
-        _TAG_PRINT ("pts-offset", "%f", _info->min_pts);
-        _TAG_PRINT ("packets", "%d", _info->packets);
+        _tag_print (&tw, "playing-time", "%f", _info->playing_time);
+        _tag_print (&tw, "pts-offset", "%f", _info->min_pts);
+        _tag_print (&tw, "packets", "%d", _info->packets);
 
-        _TAG_PRINT ("bit-rate", "%d", (int) _info->muxrate);
+        _tag_print (&tw, "bit-rate", "%d", (int) _info->muxrate);
 
         for (i = 0; i < 3; i++)
           {
@@ -282,7 +293,7 @@ main (int argc, const char *argv[])
             if (!_vinfo->seen)
               continue;
 
-            _TAG_OPEN ("video-stream", "index=\"%d\"", i);
+            _tag_open (&tw, "video-stream", "index=\"%d\"", i);
 
             {
               const char *_str[] = {
@@ -291,35 +302,35 @@ main (int argc, const char *argv[])
                 "secondary still picture stream"
               };
 
-              _TAG_COMMENT (_str[i]);
+              _tag_comment (&tw, _str[i]);
             }
 
-            _TAG_PRINT ("horizontal-size", "%d", _vinfo->hsize);
-            _TAG_PRINT ("vertical-size", "%d", _vinfo->vsize);
-            _TAG_PRINT ("frame-rate", "%f", _vinfo->frate);
+            _tag_print (&tw, "horizontal-size", "%d", _vinfo->hsize);
+            _tag_print (&tw, "vertical-size", "%d", _vinfo->vsize);
+            _tag_print (&tw, "frame-rate", "%f", _vinfo->frate);
 
-            _TAG_PRINT ("bit-rate", "%d", _vinfo->bitrate);
+            _tag_print (&tw, "bit-rate", "%d", _vinfo->bitrate);
 
             if (_dump_aps && _vinfo->aps_list)
               {
-                _TAG_OPEN ("aps-list", 0);
+                _tag_open (&tw, "aps-list", 0);
                 if (_relaxed_aps)
-                  _TAG_COMMENT ("relaxed aps");
+                  _tag_comment (&tw, "relaxed aps");
 
                 _CDIO_LIST_FOREACH (n, _vinfo->aps_list)
                   {
                     struct aps_data *_data = _cdio_list_node_data (n);
 
-                    _TAG_INDENT ();
-                    fprintf (_TAG_FD, "<aps packet-no=\"%u\">%f</aps>\n",
+                    _tag_indent (&tw);
+                    fprintf (tw.fd, "<aps packet-no=\"%u\">%f</aps>\n",
                              (unsigned int) _data->packet_no,
                              _data->timestamp);
                   }
 
-                _TAG_CLOSE ();
+                _tag_close (&tw);
               }
 
-            _TAG_CLOSE ();
+            _tag_close (&tw);
           }
 
         for (i = 0; i < 3; i++)
@@ -329,7 +340,7 @@ main (int argc, const char *argv[])
             if (!_ainfo->seen)
               continue;
 
-            _TAG_OPEN ("audio-stream", "index=\"%d\"", i);
+            _tag_open (&tw, "audio-stream", "index=\"%d\"", i);
 
             {
               const char *_str[] = {
@@ -338,12 +349,12 @@ main (int argc, const char *argv[])
                 "extended MC5.1 audio stream"
               };
 
-              _TAG_COMMENT (_str[i]);
+              _tag_comment (&tw, _str[i]);
             }
 
-            _TAG_PRINT ("layer", "%d", _ainfo->layer);
-            _TAG_PRINT ("sampling-frequency", "%d", _ainfo->sampfreq);
-            _TAG_PRINT ("bit-rate", "%d", _ainfo->bitrate);
+            _tag_print (&tw, "layer", "%d", _ainfo->layer);
+            _tag_print (&tw, "sampling-frequency", "%d", _ainfo->sampfreq);
+            _tag_print (&tw, "bit-rate", "%d", _ainfo->bitrate);
 
             {
               const char *_mode_str[] = {
@@ -354,10 +365,10 @@ main (int argc, const char *argv[])
                 "single_channel",
                 "invalid"
               };
-              _TAG_PRINT ("mode", "%s", _mode_str[_ainfo->mode]);
+              _tag_print (&tw, "mode", "%s", _mode_str[_ainfo->mode]);
             }
 
-            _TAG_CLOSE ();
+            _tag_close (&tw);
           }
 
         for (i = 0; i < 4; i++)
@@ -365,22 +376,22 @@ main (int argc, const char *argv[])
             if (!_info->ogt[i])
               continue;
 
-            _TAG_OPEN ("ogt-stream", "index=\"%d\"", i);
-            _TAG_CLOSE ();
+            _tag_open (&tw, "ogt-stream", "index=\"%d\"", i);
+            _tag_close (&tw);
           }
 
 
         /* fprintf (stdout, " v: %d a: %d\n", _info->video_type, _info->audio_type); */
 
-        _TAG_CLOSE ();
+        _tag_close (&tw);
       }
 
-    _TAG_CLOSE ();
+    _tag_close (&tw);
 
     if (_output_file)
-      fclose (_TAG_FD);
+      fclose (tw.fd);
     else
-      fflush (_TAG_FD);
+      fflush (tw.fd);
 
     vcd_mpeg_source_destroy (src, true);
   }
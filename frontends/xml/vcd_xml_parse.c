@@ -27,13 +27,17 @@
 #include <string.h>
 
 #include <libxml/xmlmemory.h>
+#include <libxml/hash.h>
 #include <libxml/parser.h>
+#include <libxml/valid.h>
+#include <libxml/xmlreader.h>
 
 #include <libvcd/logging.h>
 
 /* Private headers */
 #include "util.h"
 #include "vcd_xml_parse.h"
+#include "vcd_xml_dtd.h"
 
 /*
  * shortcut templates...
@@ -234,6 +238,18 @@ _parse_mpeg_segment (vcdxml_t *obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
   return false;
 }
 
+static bool
+_parse_segment_item (vcdxml_t *obj, xmlDocPtr doc, xmlNodePtr node,
+		     xmlNsPtr ns)
+{
+  if (!xmlStrcmp (node->name, (const xmlChar *) "segment-item"))
+    return _parse_mpeg_segment (obj, doc, node, ns);
+
+  vcd_assert_not_reached ();
+
+  return true;
+}
+
 static bool
 _parse_segments (vcdxml_t *obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
 {
@@ -246,10 +262,7 @@ _parse_segments (vcdxml_t *obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
       if (cur->ns != ns)
 	continue;
 
-      if (!xmlStrcmp (cur->name, (const xmlChar *) "segment-item"))
-	rc = _parse_mpeg_segment (obj, doc, cur, ns);
-      else
-	vcd_assert_not_reached ();
+      rc = _parse_segment_item (obj, doc, cur, ns);
 
       if (rc)
 	return rc;
@@ -494,6 +507,22 @@ _parse_pbc_endlist (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node,
   return false;
 }
 
+static bool
+_parse_pbc_item (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node,
+		 xmlNsPtr ns)
+{
+  if (!xmlStrcmp (node->name, (const xmlChar *) "selection"))
+    return _parse_pbc_selection (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "playlist"))
+    return _parse_pbc_playlist (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "endlist"))
+    return _parse_pbc_endlist (p_obj, doc, node, ns);
+
+  vcd_assert_not_reached ();
+
+  return true;
+}
+
 static bool
 _parse_pbc (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
 {
@@ -506,14 +535,7 @@ _parse_pbc (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
       if (cur->ns != ns)
 	continue;
 
-      if (!xmlStrcmp (cur->name, (const xmlChar *) "selection"))
-	rc = _parse_pbc_selection (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "playlist"))
-	rc = _parse_pbc_playlist (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "endlist"))
-	rc = _parse_pbc_endlist (p_obj, doc, cur, ns);
-      else
-	vcd_assert_not_reached ();
+      rc = _parse_pbc_item (p_obj, doc, cur, ns);
 
       if (rc)
 	return rc;
@@ -579,6 +601,18 @@ _parse_mpeg_sequence (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node,
   return false;
 }
 
+static bool
+_parse_sequence_item (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node,
+		      xmlNsPtr ns)
+{
+  if (!xmlStrcmp (node->name, (const xmlChar *) "sequence-item"))
+    return _parse_mpeg_sequence (p_obj, doc, node, ns);
+
+  vcd_assert_not_reached ();
+
+  return true;
+}
+
 static bool
 _parse_sequences (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
 {
@@ -591,11 +625,7 @@ _parse_sequences (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
       if (cur->ns != ns)
 	continue;
 
-
-      if (!xmlStrcmp (cur->name, (const xmlChar *) "sequence-item"))
-	rc = _parse_mpeg_sequence (p_obj, doc, cur, ns);
-      else
-	vcd_assert_not_reached ();
+      rc = _parse_sequence_item (p_obj, doc, cur, ns);
 
       if (rc)
 	return rc;
@@ -786,10 +816,11 @@ _type_id_by_str (const char class[], const char version[])
   return type_str[i].id;
 }
 
+/* the class and version of the videocd element */
 static bool
-_parse_videocd (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
+_parse_videocd_attrs (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node,
+		      xmlNsPtr ns)
 {
-  xmlNodePtr cur;
   char *_class = NULL;
   char *_version = NULL;
 
@@ -799,7 +830,45 @@ _parse_videocd (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
   GET_PROP_STR (_version, "version", doc, node, ns);
 
   p_obj->vcd_type = _type_id_by_str (_class, _version);
-  if (p_obj->vcd_type == VCD_TYPE_INVALID)
+
+  xmlFree (_class);
+  xmlFree (_version);
+
+  return p_obj->vcd_type == VCD_TYPE_INVALID;
+}
+
+/* one of the blocks directly below the videocd element */
+static bool
+_parse_videocd_block (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node,
+		      xmlNsPtr ns)
+{
+  if (!xmlStrcmp (node->name, (const xmlChar *) "meta"))
+    { /* NOOP */ }
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "option"))
+    return _parse_option (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "info"))
+    return _parse_info (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "pvd"))
+    return _parse_pvd (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "pbc"))
+    return _parse_pbc (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "segment-items"))
+    return _parse_segments (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "filesystem"))
+    return _parse_filesystem (p_obj, doc, node, ns);
+  else if (!xmlStrcmp (node->name, (const xmlChar *) "sequence-items"))
+    return _parse_sequences (p_obj, doc, node, ns);
+  else vcd_warn ("XML: unexpected element: %s", node->name);
+
+  return false;
+}
+
+static bool
+_parse_videocd (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
+{
+  xmlNodePtr cur;
+
+  if (_parse_videocd_attrs (p_obj, doc, node, ns))
     return true;
 
   FOR_EACH (cur, node)
@@ -809,23 +878,7 @@ _parse_videocd (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
       if (cur->ns != ns)
 	continue;
 
-      if (!xmlStrcmp (cur->name, (const xmlChar *) "meta"))
-	{ /* NOOP */ }
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "option"))
-	rc = _parse_option (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "info"))
-	rc = _parse_info (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "pvd"))
-	rc = _parse_pvd (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "pbc"))
-	rc = _parse_pbc (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "segment-items"))
-	rc = _parse_segments (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "filesystem"))
-	rc = _parse_filesystem (p_obj, doc, cur, ns);
-      else if (!xmlStrcmp (cur->name, (const xmlChar *) "sequence-items"))
-	rc = _parse_sequences (p_obj, doc, cur, ns);
-      else vcd_warn ("XML: unexpected element: %s", cur->name);
+      rc = _parse_videocd_block (p_obj, doc, cur, ns);
 
       if (rc)
 	return rc;
@@ -853,3 +906,253 @@ vcd_xml_parse (vcdxml_t *p_obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns)
 
   return _parse_videocd (p_obj, doc, node, ns);
 }
+
+/*
+ * streaming
+ */
+
+typedef bool (*_parse_item_t) (vcdxml_t *, xmlDocPtr, xmlNodePtr, xmlNsPtr);
+
+/* the blocks that can grow large; when streaming, their items are
+   parsed one by one, and every other block as a whole */
+static const struct {
+  const char *name;
+  _parse_item_t parse_item;
+} _item_blocks[] = {
+  { "segment-items", _parse_segment_item },
+  { "sequence-items", _parse_sequence_item },
+  { "pbc", _parse_pbc_item },
+  { NULL, NULL }
+};
+
+static _parse_item_t
+_item_block (const xmlChar *name)
+{
+  int i;
+
+  for (i = 0; _item_blocks[i].name; i++)
+    if (!xmlStrcmp (name, (const xmlChar *) _item_blocks[i].name))
+      return _item_blocks[i].parse_item;
+
+  return NULL;
+}
+
+/* validating, the reader records every IDREF attribute in a table
+   that's only checked at the end of the document, which grows with
+   every pbc item, and which it searches for each IDREF attribute it
+   frees (slow with thousands of items referring to the same menu);
+   so the table is dropped after each item, and the references are
+   checked by _check_refs () instead */
+static void
+_drop_refs (xmlDocPtr doc)
+{
+  if (doc->refs)
+    {
+      xmlFreeRefTable (doc->refs);
+      doc->refs = NULL;
+    }
+}
+
+static bool
+_check_ref (xmlHashTablePtr ids, const char ref[], const pbc_t *p_pbc)
+{
+  if (!ref || xmlHashLookup (ids, (const xmlChar *) ref))
+    return false;
+
+  vcd_warn ("XML: pbc item '%s' refers to unknown ID '%s'", p_pbc->id, ref);
+
+  return true;
+}
+
+static bool
+_check_ref_list (xmlHashTablePtr ids, CdioList_t *ref_list,
+		 const pbc_t *p_pbc)
+{
+  CdioListNode_t *node;
+
+  if (!ref_list)
+    return false;
+
+  _CDIO_LIST_FOREACH (node, ref_list)
+    if (_check_ref (ids, _cdio_list_node_data (node), p_pbc))
+      return true;
+
+  return false;
+}
+
+static void
+_add_id (xmlHashTablePtr ids, const char id[])
+{
+  if (id)
+    xmlHashAddEntry (ids, (const xmlChar *) id, (void *) id);
+}
+
+/* checks that the IDREFs of the pbc items refer to the ID of a
+   segment, sequence, entry or pbc item in p_obj */
+static bool
+_check_refs (const vcdxml_t *p_obj)
+{
+  xmlHashTablePtr ids = xmlHashCreate (_cdio_list_length (p_obj->pbc_list));
+  CdioListNode_t *node;
+  bool rc = false;
+
+  _CDIO_LIST_FOREACH (node, p_obj->segment_list)
+    _add_id (ids, ((struct segment_t *) _cdio_list_node_data (node))->id);
+
+  _CDIO_LIST_FOREACH (node, p_obj->sequence_list)
+    {
+      struct sequence_t *p_sequence = _cdio_list_node_data (node);
+      CdioListNode_t *node2;
+
+      _add_id (ids, p_sequence->id);
+      _add_id (ids, p_sequence->default_entry_id);
+
+      _CDIO_LIST_FOREACH (node2, p_sequence->entry_point_list)
+	_add_id (ids, ((struct entry_point_t *)
+		       _cdio_list_node_data (node2))->id);
+    }
+
+  _CDIO_LIST_FOREACH (node, p_obj->pbc_list)
+    _add_id (ids, ((pbc_t *) _cdio_list_node_data (node))->id);
+
+  _CDIO_LIST_FOREACH (node, p_obj->pbc_list)
+    {
+      const pbc_t *p_pbc = _cdio_list_node_data (node);
+
+      if (_check_ref (ids, p_pbc->prev_id, p_pbc)
+	  || _check_ref (ids, p_pbc->next_id, p_pbc)
+	  || _check_ref (ids, p_pbc->retn_id, p_pbc)
+	  || _check_ref (ids, p_pbc->default_id, p_pbc)
+	  || _check_ref (ids, p_pbc->timeout_id, p_pbc)
+	  || _check_ref (ids, p_pbc->item_id, p_pbc)
+	  || _check_ref (ids, p_pbc->image_id, p_pbc)
+	  || _check_ref_list (ids, p_pbc->item_id_list, p_pbc)
+	  || _check_ref_list (ids, p_pbc->select_id_list, p_pbc))
+	{
+	  rc = true;
+	  break;
+	}
+    }
+
+  xmlHashFree (ids, NULL);
+
+  return rc;
+}
+
+/* parses the subtree at the reader's position, which the reader frees
+   again once it has moved past it */
+static bool
+_parse_expanded (vcdxml_t *p_obj, xmlTextReaderPtr reader, xmlNsPtr ns,
+		 _parse_item_t parse)
+{
+  xmlNodePtr node = xmlTextReaderExpand (reader);
+  bool rc;
+
+  if (!node)
+    return true;
+
+  /* the subtree is complete now, and so is its validation */
+  if (xmlTextReaderIsValid (reader) != 1)
+    return true;
+
+  rc = parse (p_obj, node->doc, node, ns);
+
+  _drop_refs (node->doc);
+
+  return rc;
+}
+
+bool
+vcd_xml_parse_reader (vcdxml_t *p_obj, xmlTextReaderPtr reader)
+{
+  _parse_item_t parse_item = NULL; /* inside an item block if set */
+  xmlDocPtr doc = NULL;
+  xmlNsPtr ns = NULL;
+  int ret;
+
+  vcd_assert (p_obj != NULL);
+  vcd_assert (reader != NULL);
+
+  ret = xmlTextReaderRead (reader);
+
+  while (ret == 1)
+    {
+      const int depth = xmlTextReaderDepth (reader);
+      xmlNodePtr node = xmlTextReaderCurrentNode (reader);
+      bool skip = false;
+      bool rc = false;
+
+      switch (xmlTextReaderNodeType (reader))
+	{
+	case XML_READER_TYPE_ELEMENT:
+	  break;
+
+	case XML_READER_TYPE_END_ELEMENT:
+	  if (depth == 1)
+	    parse_item = NULL;
+	  /* fall through */
+
+	default:
+	  ret = xmlTextReaderRead (reader);
+	  continue;
+	}
+
+      if (depth == 0)
+	{
+	  /* not xmlTextReaderCurrentDoc (), which would keep the reader
+	     from freeing the document */
+	  doc = node->doc;
+
+	  if (!(ns = xmlSearchNsByHref (doc, node,
+				       (const xmlChar *) VIDEOCD_DTD_XMLNS)))
+	    {
+	      vcd_warn ("XML: namespace not found in document");
+	      return true;
+	    }
+
+	  if (xmlStrcmp (node->name, (const xmlChar *) "videocd")
+	      || node->ns != ns)
+	    {
+	      vcd_warn ("XML: root element not videocd...");
+	      return true;
+	    }
+
+	  rc = _parse_videocd_attrs (p_obj, doc, node, ns);
+	}
+      else if (node->ns != ns)
+	skip = true;
+      else if (depth == 1 && _item_block (node->name))
+	{
+	  if (!xmlTextReaderIsEmptyElement (reader))
+	    parse_item = _item_block (node->name);
+	}
+      else if (depth == 1)
+	{
+	  rc = _parse_expanded (p_obj, reader, ns, _parse_videocd_block);
+	  skip = true;
+	}
+      else if (depth == 2 && parse_item)
+	{
+	  rc = _parse_expanded (p_obj, reader, ns, parse_item);
+	  skip = true;
+	}
+      else
+	skip = true;
+
+      if (rc)
+	return rc;
+
+      ret = skip ? xmlTextReaderNext (reader) : xmlTextReaderRead (reader);
+    }
+
+  if (ret != 0 || xmlTextReaderIsValid (reader) != 1)
+    return true;
+
+  if (!ns)
+    {
+      vcd_warn ("XML: document seems to be empty (no root node found)");
+      return true;
+    }
+
+  return _check_refs (p_obj);
+}
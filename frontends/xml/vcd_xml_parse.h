@@ -23,9 +23,19 @@
 
 #include "vcdxml.h"
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
 
 bool vcd_xml_parse (vcdxml_t *obj, xmlDocPtr doc, xmlNodePtr node, xmlNsPtr ns);
 
+/* like vcd_xml_parse (), but reads the document from reader as it
+   goes, so that only one segment, sequence or pbc item of the tree is
+   held in memory at a time. What's built into obj, and reader's table
+   of IDs for validation, still grow with the document; its IDREFs are
+   checked against the IDs in obj at the end instead of being kept.
+   reader should validate (XML_PARSE_DTDVALID); nothing is built from
+   an invalid item. */
+bool vcd_xml_parse_reader (vcdxml_t *obj, xmlTextReaderPtr reader);
+
 #endif /* __VCD_XML_PARSE_H__ */
 
 
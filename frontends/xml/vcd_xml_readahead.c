@@ -0,0 +1,291 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+
+/* Private includes */
+#include "vcd_assert.h"
+#include "vcd_xml_readahead.h"
+
+unsigned vcd_xml_read_batch = VCD_XML_READ_BATCH_DEFAULT;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_mutex_t gl_cdio_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+struct _VcdXmlReadAhead
+{
+  CdIo_t *p_cdio;
+  const vcdinfo_image_map_t *p_map;
+  const uint8_t *mapped;  /* first sector of the current batch if mapped */
+  unsigned stride;
+  unsigned cur_count;     /* sectors in the current batch */
+  lsn_t next_lsn;  /* next sector to be read */
+  lsn_t end_lsn;
+  unsigned batch;
+
+  vcd_xml_m2f2sector_t *buf[2];
+  unsigned count[2]; /* 0 means slot is free */
+  int cur;           /* slot owned by the caller, -1 if none */
+
+#ifdef HAVE_PTHREAD_H
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  bool eof;
+  bool stop;
+#endif
+};
+
+/* reads the next batch into slot; returns 0 at end of range */
+static unsigned
+_read_batch (VcdXmlReadAhead_t *p_ra, int slot)
+{
+  unsigned count;
+
+  if (p_ra->next_lsn >= p_ra->end_lsn)
+    return 0;
+
+  count = p_ra->end_lsn - p_ra->next_lsn;
+  if (count > p_ra->batch)
+    count = p_ra->batch;
+
+  memset (p_ra->buf[slot], 0, count * sizeof (vcd_xml_m2f2sector_t));
+  vcd_xml_cdio_lock ();
+  cdio_read_mode2_sectors (p_ra->p_cdio, p_ra->buf[slot], p_ra->next_lsn,
+                           true, count);
+  vcd_xml_cdio_unlock ();
+
+  p_ra->next_lsn += count;
+
+  return count;
+}
+
+#ifdef HAVE_PTHREAD_H
+
+static void *
+_reader_thread (void *user_data)
+{
+  VcdXmlReadAhead_t *p_ra = user_data;
+  int slot = 0;
+
+  for (;;)
+    {
+      unsigned count;
+      bool stop;
+
+      pthread_mutex_lock (&p_ra->lock);
+      while (p_ra->count[slot] && !p_ra->stop)
+        pthread_cond_wait (&p_ra->cond, &p_ra->lock);
+      stop = p_ra->stop;
+      pthread_mutex_unlock (&p_ra->lock);
+
+      if (stop)
+        break;
+
+      /* slot is free and not visible to the caller: read unlocked */
+      count = _read_batch (p_ra, slot);
+
+      pthread_mutex_lock (&p_ra->lock);
+      if (count)
+        p_ra->count[slot] = count;
+      else
+        p_ra->eof = true;
+      pthread_cond_broadcast (&p_ra->cond);
+      pthread_mutex_unlock (&p_ra->lock);
+
+      if (!count)
+        break;
+
+      slot ^= 1;
+    }
+
+  return NULL;
+}
+
+#endif /* HAVE_PTHREAD_H */
+
+void
+vcd_xml_cdio_lock (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&gl_cdio_lock);
+#endif
+}
+
+void
+vcd_xml_cdio_unlock (void)
+{
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&gl_cdio_lock);
+#endif
+}
+
+VcdXmlReadAhead_t *
+vcd_xml_read_ahead_new (CdIo_t *p_cdio, const vcdinfo_image_map_t *p_map,
+                        lsn_t start_lsn, lsn_t end_lsn, unsigned batch)
+{
+  VcdXmlReadAhead_t *p_ra = calloc(1, sizeof (VcdXmlReadAhead_t));
+
+  vcd_assert (p_cdio != NULL);
+  vcd_assert (batch > 0);
+
+  p_ra->p_cdio = p_cdio;
+  p_ra->next_lsn = start_lsn;
+  p_ra->end_lsn = end_lsn;
+  p_ra->batch = batch;
+  p_ra->cur = -1;
+
+  /* only use the mapping if it covers the whole range */
+  if (p_map && start_lsn < end_lsn
+      && vcdinfo_image_map_sector (p_map, start_lsn)
+      && vcdinfo_image_map_sector (p_map, end_lsn - 1))
+    {
+      p_ra->p_map = p_map;
+      p_ra->stride = vcdinfo_image_map_stride (p_map);
+      return p_ra;
+    }
+
+  p_ra->buf[0] = calloc(batch, sizeof (vcd_xml_m2f2sector_t));
+  p_ra->buf[1] = calloc(batch, sizeof (vcd_xml_m2f2sector_t));
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init (&p_ra->lock, NULL);
+  pthread_cond_init (&p_ra->cond, NULL);
+
+  if (pthread_create (&p_ra->thread, NULL, _reader_thread, p_ra))
+    vcd_error ("could not create read-ahead thread");
+#endif
+
+  return p_ra;
+}
+
+unsigned
+vcd_xml_read_ahead_next (VcdXmlReadAhead_t *p_ra)
+{
+  unsigned count;
+  int slot;
+
+  vcd_assert (p_ra != NULL);
+
+  if (p_ra->p_map)
+    {
+      if (p_ra->next_lsn >= p_ra->end_lsn)
+        return 0;
+
+      count = p_ra->end_lsn - p_ra->next_lsn;
+      if (count > p_ra->batch)
+        count = p_ra->batch;
+
+      p_ra->mapped = vcdinfo_image_map_sector (p_ra->p_map, p_ra->next_lsn);
+      p_ra->next_lsn += count;
+      p_ra->cur_count = count;
+
+      return count;
+    }
+
+  slot = (p_ra->cur + 1) % 2;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&p_ra->lock);
+
+  /* hand the previous batch back to the reader */
+  if (p_ra->cur >= 0)
+    {
+      p_ra->count[p_ra->cur] = 0;
+      pthread_cond_broadcast (&p_ra->cond);
+    }
+
+  while (!p_ra->count[slot] && !p_ra->eof)
+    pthread_cond_wait (&p_ra->cond, &p_ra->lock);
+
+  count = p_ra->count[slot];
+
+  pthread_mutex_unlock (&p_ra->lock);
+#else
+  count = _read_batch (p_ra, slot);
+#endif
+
+  p_ra->cur = slot;
+  p_ra->cur_count = count;
+
+  return count;
+}
+
+const vcd_xml_m2f2sector_t *
+vcd_xml_read_ahead_sector (const VcdXmlReadAhead_t *p_ra, unsigned idx)
+{
+  vcd_assert (p_ra != NULL);
+  vcd_assert (idx < p_ra->cur_count);
+
+  if (p_ra->p_map)
+    return (const vcd_xml_m2f2sector_t *) (p_ra->mapped
+                                           + (size_t) idx * p_ra->stride);
+
+  return &p_ra->buf[p_ra->cur][idx];
+}
+
+void
+vcd_xml_read_ahead_destroy (VcdXmlReadAhead_t *p_ra)
+{
+  vcd_assert (p_ra != NULL);
+
+  if (p_ra->p_map)
+    {
+      free (p_ra);
+      return;
+    }
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&p_ra->lock);
+  p_ra->stop = true;
+  pthread_cond_broadcast (&p_ra->cond);
+  pthread_mutex_unlock (&p_ra->lock);
+
+  pthread_join (p_ra->thread, NULL);
+
+  pthread_cond_destroy (&p_ra->cond);
+  pthread_mutex_destroy (&p_ra->lock);
+#endif
+
+  free (p_ra->buf[0]);
+  free (p_ra->buf[1]);
+  free (p_ra);
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
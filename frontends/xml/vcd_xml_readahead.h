@@ -0,0 +1,74 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* double-buffered mode2 sector reader; while the caller processes one
+   batch of sectors, the next one is read by a background thread (if
+   the platform has pthreads) */
+
+#ifndef __VCD_XML_READAHEAD_H__
+#define __VCD_XML_READAHEAD_H__
+
+#include <cdio/cdio.h>
+#include <libvcd/info.h>
+
+#define VCD_XML_READ_BATCH_DEFAULT 64
+#define VCD_XML_READ_BATCH_MAX     512
+
+/* layout returned by cdio_read_mode2_sectors (..., true, ...) */
+typedef struct
+{
+  uint8_t subheader[CDIO_CD_SUBHEADER_SIZE];
+  uint8_t data[M2F2_SECTOR_SIZE];
+  uint8_t spare[4];
+} vcd_xml_m2f2sector_t;
+
+typedef struct _VcdXmlReadAhead VcdXmlReadAhead_t;
+
+/* sectors per cdio_read_mode2_sectors () call, set by --read-batch */
+extern unsigned vcd_xml_read_batch;
+
+/* starts reading the range [start_lsn, end_lsn); if p_map is not
+   NULL sectors are taken directly from the mapped image instead */
+VcdXmlReadAhead_t *
+vcd_xml_read_ahead_new (CdIo_t *p_cdio, const vcdinfo_image_map_t *p_map,
+                        lsn_t start_lsn, lsn_t end_lsn, unsigned batch);
+
+/* makes the next batch current and returns its sector count; the
+   batch stays valid until the next call.  Returns 0 once the range is
+   exhausted. */
+unsigned
+vcd_xml_read_ahead_next (VcdXmlReadAhead_t *p_ra);
+
+/* returns sector idx of the current batch */
+const vcd_xml_m2f2sector_t *
+vcd_xml_read_ahead_sector (const VcdXmlReadAhead_t *p_ra, unsigned idx);
+
+/* may be called before the range is exhausted */
+void
+vcd_xml_read_ahead_destroy (VcdXmlReadAhead_t *p_ra);
+
+/* libcdio keeps unlocked static state (its log handler's recursion
+   guard among others), so threads other than the main one make their
+   libcdio calls between these two */
+void
+vcd_xml_cdio_lock (void);
+
+void
+vcd_xml_cdio_unlock (void);
+
+#endif /* __VCD_XML_READAHEAD_H__ */
@@ -23,6 +23,7 @@
 #include "vcd_xml_dtd.h"
 #include "vcd_xml_dump.h"
 #include "vcd_xml_common.h"
+#include "vcd_xml_readahead.h"
 
 
 /* FIXME: Make this really private: */
@@ -58,6 +59,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 
 #include <popt.h>
 
@@ -929,61 +933,238 @@ _rip_isofs (vcdxml_t *p_vcdxml, CdIo_t *p_cdio)
   return 0;
 }
 
+/* set if the image file could be mapped; shared by all rip jobs */
+static vcdinfo_image_map_t *gl_image_map = NULL;
+
+static void
+_flush_segment_data (FILE *outfd, const uint8_t *outbuf, unsigned count)
+{
+  if (!count)
+    return;
+
+  fwrite (outbuf, M2F2_SECTOR_SIZE, count, outfd);
+
+  if (ferror (outfd))
+    {
+      perror ("fwrite()");
+      exit (EXIT_FAILURE);
+    }
+}
+
 static int
-_rip_segments (vcdxml_t *p_vcdxml, CdIo_t *p_cdio)
+_rip_segment (CdIo_t *p_cdio, struct segment_t *p_seg, lsn_t start_lsn)
 {
-  CdioListNode_t *node;
-  lsn_t start_extent;
+  uint32_t n, total;
+  FILE *outfd = NULL;
+  VcdMpegStreamCtx mpeg_ctx;
+  double last_pts = 0;
 
-  start_extent = p_vcdxml->info.segments_start;
+  VcdXmlReadAhead_t *p_ra;
+  unsigned batch_count = 0;
+  uint32_t batch_start = 0;
 
-  vcd_assert (start_extent % CDIO_CD_FRAMES_PER_SEC == 0);
+  /* payloads of consecutive sectors, written out once per batch */
+  uint8_t *outbuf;
+  unsigned out_count = 0;
 
-  _CDIO_LIST_FOREACH (node, p_vcdxml->segment_list)
+  vcd_assert (p_seg->segments_count > 0);
+
+  memset (&mpeg_ctx, 0, sizeof (VcdMpegStreamCtx));
+
+  vcd_info ("extracting %s... (start lsn %u, %d segments)",
+	    p_seg->src, (unsigned int) start_lsn,
+	    p_seg->segments_count);
+
+  if (!(outfd = fopen (p_seg->src, "wb")))
     {
-      struct segment_t *p_seg = _cdio_list_node_data (node);
-      uint32_t n;
-      FILE *outfd = NULL;
-      VcdMpegStreamCtx mpeg_ctx;
-      double last_pts = 0;
+      perror ("fopen()");
+      exit (EXIT_FAILURE);
+    }
 
-      vcd_assert (p_seg->segments_count > 0);
+  total = p_seg->segments_count * VCDINFO_SEGMENT_SECTOR_SIZE;
 
-      memset (&mpeg_ctx, 0, sizeof (VcdMpegStreamCtx));
+  p_ra = vcd_xml_read_ahead_new (p_cdio, gl_image_map, start_lsn,
+				 start_lsn + total, vcd_xml_read_batch);
+  outbuf = calloc (vcd_xml_read_batch, M2F2_SECTOR_SIZE);
 
-      vcd_info ("extracting %s... (start lsn %u, %d segments)",
-		p_seg->src, (unsigned int) start_extent,
-		p_seg->segments_count);
+  for (n = 0; n < total; n++)
+    {
+      const vcd_xml_m2f2sector_t *p_sect;
 
-      if (!(outfd = fopen (p_seg->src, "wb")))
-        {
-          perror ("fopen()");
-          exit (EXIT_FAILURE);
-        }
+      if (n - batch_start >= batch_count)
+	{
+	  _flush_segment_data (outfd, outbuf, out_count);
+	  out_count = 0;
+
+	  batch_start = n;
+	  batch_count = vcd_xml_read_ahead_next (p_ra);
+	  vcd_assert (batch_count > 0);
+	}
 
-      for (n = 0; n < p_seg->segments_count * VCDINFO_SEGMENT_SECTOR_SIZE; n++)
+      p_sect = vcd_xml_read_ahead_sector (p_ra, n - batch_start);
+
+      if (!p_sect->subheader[0]
+	  && !p_sect->subheader[1]
+	  && (p_sect->subheader[2] | SM_FORM2) == SM_FORM2
+	  && !p_sect->subheader[3])
 	{
-	  struct m2f2sector
-          {
-            uint8_t subheader[8];
-            uint8_t data[M2F2_SECTOR_SIZE];
-            uint8_t spare[4];
-          }
-          buf;
+	  vcd_warn ("no EOF seen, but stream ended");
+	  break;
+	}
+
+      vcd_mpeg_parse_packet (p_sect->data, M2F2_SECTOR_SIZE, false,
+			     &mpeg_ctx);
+
+      if (mpeg_ctx.packet.has_pts)
+	{
+	  last_pts = mpeg_ctx.packet.pts;
+	  if (mpeg_ctx.stream.seen_pts)
+	    last_pts -= mpeg_ctx.stream.min_pts;
+	  if (last_pts < 0)
+	    last_pts = 0;
+	  /* vcd_debug ("pts %f @%d", mpeg_ctx.packet.pts, n); */
+	}
+
+      if (p_sect->subheader[2] & SM_TRIG)
+	{
+	  double *_ap_ts = calloc(1, sizeof (double));
+
+	  vcd_debug ("autopause @%u (%f)", (unsigned int) n, last_pts);
+	  *_ap_ts = last_pts;
+
+	  _cdio_list_append (p_seg->autopause_list, _ap_ts);
+	}
+
+      memcpy (outbuf + out_count * M2F2_SECTOR_SIZE, p_sect->data,
+	      M2F2_SECTOR_SIZE);
+      out_count++;
+
+      if (p_sect->subheader[2] & SM_EOF)
+	break;
+    }
+
+  _flush_segment_data (outfd, outbuf, out_count);
+
+  free (outbuf);
+  vcd_xml_read_ahead_destroy (p_ra);
+
+  fclose (outfd);
+
+  return 0;
+}
+
+static int
+_rip_sequence (CdIo_t *p_cdio, struct sequence_t *_seq, uint32_t end_lsn,
+	       bool next_seq)
+{
+  FILE *outfd = NULL;
+  bool in_data = false;
+  VcdMpegStreamCtx mpeg_ctx;
+  uint32_t start_lsn, n, last_nonzero, first_data;
+  double last_pts = 0;
+
+  _read_progress_t _progress;
+
+  VcdXmlReadAhead_t *p_ra;
+  unsigned batch_count = 0;
+  uint32_t batch_start;
+
+  memset (&mpeg_ctx, 0, sizeof (VcdMpegStreamCtx));
+
+  start_lsn = _seq->start_extent;
+
+  vcd_info ("extracting %s... (start lsn %lu (+%lu))",
+	    _seq->src, (long unsigned int) start_lsn,
+	    (long unsigned int) (end_lsn - start_lsn));
+
+  if (!(outfd = fopen (_seq->src, "wb")))
+    {
+      perror ("fopen()");
+      exit (EXIT_FAILURE);
+    }
+
+  last_nonzero = start_lsn - 1;
+  first_data = 0;
+
+  _progress.done = 0;
+  _progress.total = end_lsn;
+
+  p_ra = vcd_xml_read_ahead_new (p_cdio, gl_image_map, start_lsn, end_lsn,
+				 vcd_xml_read_batch);
+  batch_start = start_lsn;
+
+  for (n = start_lsn; n < end_lsn; n++)
+    {
+      const vcd_xml_m2f2sector_t *p_sect;
+
+      if (vcd_xml_show_progress && n - _progress.done > (end_lsn / 100))
+	{
+	  _progress.done = n;
+	  vcd_xml_read_progress_cb (&_progress, _seq->src);
+	}
+
+      if (n - batch_start >= batch_count)
+	{
+	  batch_start = n;
+	  batch_count = vcd_xml_read_ahead_next (p_ra);
+	  vcd_assert (batch_count > 0);
+	}
+
+      p_sect = vcd_xml_read_ahead_sector (p_ra, n - batch_start);
+
+      if (next_seq && n + CDIO_POSTGAP_SECTORS == end_lsn + 1)
+	vcd_warn ("reading into gap @%u... :-(", (unsigned int) n);
+
+      if (!(p_sect->subheader[2] & SM_FORM2))
+	{
+	  vcd_warn ("encountered non-form2 sector -- leaving loop");
+	  break;
+	}
+
+      if (in_data)
+	{ /* end conditions... */
+	  if (!p_sect->subheader[0])
+	    {
+	      vcd_debug ("fn -edge @%u", (unsigned int) n);
+	      break;
+	    }
+
+	  if (!(p_sect->subheader[2] & SM_REALT))
+	    {
+	      vcd_debug ("subheader: no realtime data anymore @%u",
+			 (unsigned int) n);
+	      break;
+	    }
+	}
+
+      if (p_sect->subheader[1] && !in_data)
+	{
+	  vcd_debug ("cn +edge @%u", (unsigned int) n);
+	  in_data = true;
+	}
+
+
+#if defined(DEBUG)
+      if (!in_data)
+	vcd_debug ("%2.2x %2.2x %2.2x %2.2x",
+		   p_sect->subheader[0],
+		   p_sect->subheader[1],
+		   p_sect->subheader[2],
+		   p_sect->subheader[3]);
+#endif
 
-	  memset (&buf, 0, sizeof (buf));
-	  cdio_read_mode2_sector (p_cdio, &buf, start_extent + n, true);
+      if (in_data)
+	{
+	  CdioListNode_t *_node;
+
+	  vcd_mpeg_parse_packet (p_sect->data, M2F2_SECTOR_SIZE,
+				 false, &mpeg_ctx);
 
-	  if (!buf.subheader[0]
-              && !buf.subheader[1]
-              && (buf.subheader[2] | SM_FORM2) == SM_FORM2
-              && !buf.subheader[3])
-            {
-              vcd_warn ("no EOF seen, but stream ended");
-              break;
-            }
+	  if (!mpeg_ctx.packet.zero)
+	    last_nonzero = n;
 
-	  vcd_mpeg_parse_packet (buf.data, M2F2_SECTOR_SIZE, false, &mpeg_ctx);
+	  if (!first_data && !mpeg_ctx.packet.zero)
+	    first_data = n;
 
 	  if (mpeg_ctx.packet.has_pts)
 	    {
@@ -995,241 +1176,264 @@ _rip_segments (vcdxml_t *p_vcdxml, CdIo_t *p_cdio)
 	      /* vcd_debug ("pts %f @%d", mpeg_ctx.packet.pts, n); */
 	    }
 
-	  if (buf.subheader[2] & SM_TRIG)
+	  if (p_sect->subheader[2] & SM_TRIG)
 	    {
 	      double *_ap_ts = calloc(1, sizeof (double));
 
-	      vcd_debug ("autopause @%u (%f)", (unsigned int) n, last_pts);
+	      vcd_debug ("autopause @%u (%f)", (unsigned int) n,
+			 last_pts);
 	      *_ap_ts = last_pts;
 
-	      _cdio_list_append (p_seg->autopause_list, _ap_ts);
+	      _cdio_list_append (_seq->autopause_list, _ap_ts);
 	    }
 
-	  fwrite (buf.data, M2F2_SECTOR_SIZE, 1, outfd);
+	  _CDIO_LIST_FOREACH (_node, _seq->entry_point_list)
+	    {
+	      struct entry_point_t *_ep = _cdio_list_node_data (_node);
 
-	  if (ferror (outfd))
-            {
-              perror ("fwrite()");
-              exit (EXIT_FAILURE);
-            }
+	      if (_ep->extent == n)
+		{
+		  vcd_debug ("entry point @%u (%f)", (unsigned int) n,
+			     last_pts);
+		  _ep->timestamp = last_pts;
+		}
+	    }
 
-	  if (buf.subheader[2] & SM_EOF)
-            break;
+	  if (first_data)
+	    {
+	      fwrite (p_sect->data, M2F2_SECTOR_SIZE, 1, outfd);
+
+	      if (ferror (outfd))
+		{
+		  perror ("fwrite()");
+		  exit (EXIT_FAILURE);
+		}
+	    }
+
+	} /* if (in_data) */
+
+      if (p_sect->subheader[2] & SM_EOF)
+	{
+	  vcd_debug ("encountered subheader EOF @%u", (unsigned int) n);
+	  break;
 	}
+    } /* for */
 
-      fclose (outfd);
+  vcd_xml_read_ahead_destroy (p_ra);
 
-      start_extent += p_seg->segments_count * VCDINFO_SEGMENT_SECTOR_SIZE;
+  _progress.done = _progress.total;
+  vcd_xml_read_progress_cb (&_progress, _seq->src);
+
+  if (in_data)
+    {
+      uint32_t length;
+
+      if (n == end_lsn)
+	vcd_debug ("stream till end of track");
+
+      length = (1 + last_nonzero) - first_data;
+
+      vcd_debug ("truncating file to %u packets",
+		 (unsigned int) length);
+
+      fflush (outfd);
+      if (ftruncate (fileno (outfd), length * M2F2_SECTOR_SIZE))
+	perror ("ftruncate()");
     }
 
+  fclose (outfd);
+
   return 0;
 }
 
-static int
-_rip_sequences (vcdxml_t *p_vcdxml, CdIo_t *p_cdio, int i_track)
-{
-  CdioListNode_t *node;
-  int counter=1;
+/* parallel extraction -- each job writes its own file and only touches
+   the autopause/entry lists of its own item, so the resulting XML does
+   not depend on the order in which jobs complete */
 
-  _CDIO_LIST_FOREACH (node, p_vcdxml->sequence_list)
-    {
-      struct sequence_t *_seq = _cdio_list_node_data (node);
-      CdioListNode_t *nnode = _cdio_list_node_next (node);
-      struct sequence_t *_nseq = nnode ? _cdio_list_node_data (nnode) : NULL;
-      FILE *outfd = NULL;
-      bool in_data = false;
-      VcdMpegStreamCtx mpeg_ctx;
-      uint32_t start_lsn, end_lsn, n, last_nonzero, first_data;
-      double last_pts = 0;
+typedef struct
+{
+  struct segment_t *p_seg;
+  struct sequence_t *p_seq;
+  lsn_t lsn;   /* start lsn for segments, end lsn for sequences */
+  bool next_seq;
+} _rip_job_t;
 
-      _read_progress_t _progress;
+typedef struct
+{
+  _rip_job_t *jobs;
+  unsigned count;
+  unsigned next;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;
+#endif
+} _rip_queue_t;
 
-      struct m2f2sector
-      {
-	uint8_t subheader[CDIO_CD_SUBHEADER_SIZE];
-	uint8_t data[M2F2_SECTOR_SIZE];
-	uint8_t spare[4];
-      }
-      buf[15];
+static int gl_rip_jobs = 1;
+static const char *gl_rip_source = NULL;
+static driver_id_t gl_rip_driver = DRIVER_UNKNOWN;
 
-      if (i_track > 0 && i_track!=counter++) {
-	vcd_info("Track %d selected, skipping track %d", i_track,counter-1);
-	continue;
-      }
+static void
+_rip_job (CdIo_t *p_cdio, const _rip_job_t *p_job)
+{
+  if (p_job->p_seg)
+    _rip_segment (p_cdio, p_job->p_seg, p_job->lsn);
+  else
+    _rip_sequence (p_cdio, p_job->p_seq, p_job->lsn, p_job->next_seq);
+}
 
-      if (i_track < 0 && -i_track==counter++) {
-	vcd_info("Skipping track %d", -i_track);
-	continue;
-      }
+#ifdef HAVE_PTHREAD_H
+static void *
+_rip_worker (void *user_data)
+{
+  _rip_queue_t *p_queue = user_data;
+  CdIo_t *p_cdio;
 
-      memset (&mpeg_ctx, 0, sizeof (VcdMpegStreamCtx));
+  vcd_xml_cdio_lock ();
+  p_cdio = cdio_open (gl_rip_source, gl_rip_driver);
+  vcd_xml_cdio_unlock ();
 
-      start_lsn = _seq->start_extent;
-      end_lsn = _nseq ? _nseq->start_extent : cdio_get_disc_last_lsn (p_cdio);
+  if (!p_cdio)
+    {
+      vcd_error ("worker could not open `%s'", gl_rip_source);
+      return NULL;
+    }
 
-      vcd_info ("extracting %s... (start lsn %lu (+%lu))",
-		_seq->src, (long unsigned int) start_lsn,
-		(long unsigned int) (end_lsn - start_lsn));
+  while (true)
+    {
+      unsigned idx;
 
-      if (!(outfd = fopen (_seq->src, "wb")))
-        {
-          perror ("fopen()");
-          exit (EXIT_FAILURE);
-        }
+      pthread_mutex_lock (&p_queue->lock);
+      idx = p_queue->next++;
+      pthread_mutex_unlock (&p_queue->lock);
 
-      last_nonzero = start_lsn - 1;
-      first_data = 0;
+      if (idx >= p_queue->count)
+	break;
 
-      _progress.total = end_lsn;
+      _rip_job (p_cdio, &p_queue->jobs[idx]);
+    }
 
-      for (n = start_lsn; n < end_lsn; n++)
-	{
-	  const int buf_idx = (n - start_lsn) % 15;
+  vcd_xml_cdio_lock ();
+  cdio_destroy (p_cdio);
+  vcd_xml_cdio_unlock ();
 
-	  if (n - _progress.done > (end_lsn / 100))
-	    {
-	      _progress.done = n;
-	      vcd_xml_read_progress_cb (&_progress, _seq->src);
-	    }
+  return NULL;
+}
+#endif
 
-	  if (!buf_idx)
-	    {
-	      const int secs_left = end_lsn - n;
+static void
+_rip_run_jobs (CdIo_t *p_cdio, _rip_job_t jobs[], unsigned count)
+{
+  _rip_queue_t queue;
+  unsigned n;
 
-	      memset (buf, 0, sizeof (buf));
-	      cdio_read_mode2_sectors (p_cdio, buf, n, true, (secs_left > 15
-							   ? 15 : secs_left));
-	    }
+  queue.jobs = jobs;
+  queue.count = count;
+  queue.next = 0;
 
-	  if (_nseq && n + CDIO_POSTGAP_SECTORS == end_lsn + 1)
-	    vcd_warn ("reading into gap @%u... :-(", (unsigned int) n);
+#ifdef HAVE_PTHREAD_H
+  if (gl_rip_jobs > 1 && count > 1)
+    {
+      unsigned nthreads = (unsigned) gl_rip_jobs < count
+	? (unsigned) gl_rip_jobs : count;
+      pthread_t *threads = calloc (nthreads, sizeof (pthread_t));
+      unsigned started = 0;
 
-	  if (!(buf[buf_idx].subheader[2] & SM_FORM2))
-	    {
-	      vcd_warn ("encountered non-form2 sector -- leaving loop");
-	      break;
-	    }
+      pthread_mutex_init (&queue.lock, NULL);
 
-	  if (in_data)
-	    { /* end conditions... */
-	      if (!buf[buf_idx].subheader[0])
-		{
-		  vcd_debug ("fn -edge @%u", (unsigned int) n);
-		  break;
-		}
+      for (n = 0; n < nthreads; n++)
+	if (!pthread_create (&threads[n], NULL, _rip_worker, &queue))
+	  started++;
+	else
+	  break;
 
-	      if (!(buf[buf_idx].subheader[2] & SM_REALT))
-		{
-		  vcd_debug ("subheader: no realtime data anymore @%u",
-			     (unsigned int) n);
-		  break;
-		}
-	    }
+      if (!started)
+	vcd_warn ("could not start worker threads -- ripping sequentially");
 
-	  if (buf[buf_idx].subheader[1] && !in_data)
-	    {
-	      vcd_debug ("cn +edge @%u", (unsigned int) n);
-	      in_data = true;
-	    }
+      for (n = 0; n < started; n++)
+	pthread_join (threads[n], NULL);
 
+      pthread_mutex_destroy (&queue.lock);
+      free (threads);
 
-#if defined(DEBUG)
-	  if (!in_data)
-	    vcd_debug ("%2.2x %2.2x %2.2x %2.2x",
-		       buf[buf_idx].subheader[0],
-		       buf[buf_idx].subheader[1],
-		       buf[buf_idx].subheader[2],
-		       buf[buf_idx].subheader[3]);
+      if (started)
+	return;
+    }
 #endif
 
-	  if (in_data)
-	    {
-	      CdioListNode_t *_node;
-
-	      vcd_mpeg_parse_packet (buf[buf_idx].data, M2F2_SECTOR_SIZE,
-				     false, &mpeg_ctx);
+  for (n = 0; n < count; n++)
+    _rip_job (p_cdio, &jobs[n]);
+}
 
-	      if (!mpeg_ctx.packet.zero)
-		last_nonzero = n;
+static int
+_rip_segments (vcdxml_t *p_vcdxml, CdIo_t *p_cdio)
+{
+  CdioListNode_t *node;
+  lsn_t start_extent;
+  _rip_job_t *jobs;
+  unsigned count = 0;
 
-	      if (!first_data && !mpeg_ctx.packet.zero)
-		first_data = n;
+  start_extent = p_vcdxml->info.segments_start;
 
-	      if (mpeg_ctx.packet.has_pts)
-		{
-		  last_pts = mpeg_ctx.packet.pts;
-		  if (mpeg_ctx.stream.seen_pts)
-		    last_pts -= mpeg_ctx.stream.min_pts;
-		  if (last_pts < 0)
-		    last_pts = 0;
-		  /* vcd_debug ("pts %f @%d", mpeg_ctx.packet.pts, n); */
-		}
+  vcd_assert (start_extent % CDIO_CD_FRAMES_PER_SEC == 0);
 
-	      if (buf[buf_idx].subheader[2] & SM_TRIG)
-		{
-		  double *_ap_ts = calloc(1, sizeof (double));
+  jobs = calloc (_cdio_list_length (p_vcdxml->segment_list) + 1,
+		 sizeof (_rip_job_t));
 
-		  vcd_debug ("autopause @%u (%f)", (unsigned int) n,
-			     last_pts);
-		  *_ap_ts = last_pts;
+  _CDIO_LIST_FOREACH (node, p_vcdxml->segment_list)
+    {
+      struct segment_t *p_seg = _cdio_list_node_data (node);
 
-		  _cdio_list_append (_seq->autopause_list, _ap_ts);
-		}
+      jobs[count].p_seg = p_seg;
+      jobs[count].lsn = start_extent;
+      count++;
 
-	      _CDIO_LIST_FOREACH (_node, _seq->entry_point_list)
-		{
-		  struct entry_point_t *_ep = _cdio_list_node_data (_node);
-
-		  if (_ep->extent == n)
-		    {
-		      vcd_debug ("entry point @%u (%f)", (unsigned int) n,
-				 last_pts);
-		      _ep->timestamp = last_pts;
-		    }
-		}
+      start_extent += p_seg->segments_count * VCDINFO_SEGMENT_SECTOR_SIZE;
+    }
 
-	      if (first_data)
-		{
-		  fwrite (buf[buf_idx].data, M2F2_SECTOR_SIZE, 1, outfd);
+  _rip_run_jobs (p_cdio, jobs, count);
 
-		  if (ferror (outfd))
-		    {
-		      perror ("fwrite()");
-		      exit (EXIT_FAILURE);
-		    }
-		}
+  free (jobs);
 
-	    } /* if (in_data) */
+  return 0;
+}
 
-	  if (buf[buf_idx].subheader[2] & SM_EOF)
-	    {
-	      vcd_debug ("encountered subheader EOF @%u", (unsigned int) n);
-	      break;
-	    }
-	} /* for */
+static int
+_rip_sequences (vcdxml_t *p_vcdxml, CdIo_t *p_cdio, int i_track)
+{
+  CdioListNode_t *node;
+  int counter=1;
+  _rip_job_t *jobs;
+  unsigned count = 0;
 
-      _progress.done = _progress.total;
-      vcd_xml_read_progress_cb (&_progress, _seq->src);
+  jobs = calloc (_cdio_list_length (p_vcdxml->sequence_list) + 1,
+		 sizeof (_rip_job_t));
 
-      if (in_data)
-	{
-	  uint32_t length;
+  _CDIO_LIST_FOREACH (node, p_vcdxml->sequence_list)
+    {
+      struct sequence_t *_seq = _cdio_list_node_data (node);
+      CdioListNode_t *nnode = _cdio_list_node_next (node);
+      struct sequence_t *_nseq = nnode ? _cdio_list_node_data (nnode) : NULL;
 
-	  if (n == end_lsn)
-	    vcd_debug ("stream till end of track");
+      if (i_track > 0 && i_track!=counter++) {
+	vcd_info("Track %d selected, skipping track %d", i_track,counter-1);
+	continue;
+      }
 
-	  length = (1 + last_nonzero) - first_data;
+      if (i_track < 0 && -i_track==counter++) {
+	vcd_info("Skipping track %d", -i_track);
+	continue;
+      }
 
-	  vcd_debug ("truncating file to %u packets",
-		     (unsigned int) length);
+      jobs[count].p_seq = _seq;
+      jobs[count].lsn = _nseq ? _nseq->start_extent
+	: cdio_get_disc_last_lsn (p_cdio);
+      jobs[count].next_seq = _nseq != NULL;
+      count++;
+    }
 
-	  fflush (outfd);
-	  if (ftruncate (fileno (outfd), length * M2F2_SECTOR_SIZE))
-	    perror ("ftruncate()");
-	}
+  _rip_run_jobs (p_cdio, jobs, count);
 
-      fclose (outfd);
-    } /* _CDIO_LIST_FOREACH */
+  free (jobs);
 
   return 0;
 }
@@ -1252,6 +1456,21 @@ _vcd_log_handler (vcd_log_level_t level, const char message[])
 #define DEFAULT_XML_FNAME      "videocd.xml"
 #define DEFAULT_IMG_FNAME      "videocd.bin"
 
+/* the description is written to this file next to the XML file,
+   which it replaces once it is complete; removed if ripping fails */
+static char *_tmp_xml_fname = NULL;
+
+static void
+_remove_tmp_xml (void)
+{
+  if (!_tmp_xml_fname)
+    return;
+
+  remove (_tmp_xml_fname);
+  free (_tmp_xml_fname);
+  _tmp_xml_fname = NULL;
+}
+
 poptContext optCon;
 
 int
@@ -1259,6 +1478,7 @@ main (int argc, const char *argv[])
 {
   CdIo_t *img_src = NULL;
   vcdxml_t vcdxml;
+  VcdXmlDump_t *p_dump;
 
   /* cl params */
   char *xml_fname = NULL;
@@ -1274,6 +1494,8 @@ main (int argc, const char *argv[])
   int _gui_flag = 0;
   int _track_flag=0;
   int _x_track_flag=0;
+  int read_batch = VCD_XML_READ_BATCH_DEFAULT;
+  int jobs = 1;
 
   typedef enum {
     OP_SOURCE_UNDEF = DRIVER_UNKNOWN,
@@ -1346,6 +1568,14 @@ main (int argc, const char *argv[])
       {"progress", 'p', POPT_ARG_NONE, &_progress_flag, 0,
        "show progress"},
 
+      {"read-batch", '\0', POPT_ARG_INT, &read_batch, 0,
+       "number of sectors to read ahead per request (default: 64, max: 512)",
+       "SECTORS"},
+
+      {"jobs", 'j', POPT_ARG_INT, &jobs, 0,
+       "number of tracks/segments to extract in parallel (default: 1)",
+       "N"},
+
       { "track", 't', POPT_ARG_INT, &_track_flag, 0,
 	"rip only this track"},
 
@@ -1419,12 +1649,34 @@ main (int argc, const char *argv[])
   else
     vcd_xml_verbosity = VCD_LOG_INFO;
 
+  /* don't even format what the handler would throw away */
+  vcd_log_set_level (vcd_xml_verbosity);
+
   if (_gui_flag)
     vcd_xml_gui_mode = true;
 
   if (_progress_flag)
     vcd_xml_show_progress = true;
 
+  if (read_batch < 1 || read_batch > VCD_XML_READ_BATCH_MAX)
+    vcd_error ("--read-batch must be between 1 and %d",
+               VCD_XML_READ_BATCH_MAX);
+
+  vcd_xml_read_batch = read_batch;
+
+  if (jobs < 1)
+    vcd_error ("--jobs must be at least 1");
+
+#ifndef HAVE_TLS
+  /* without thread-local storage the logging and string helpers keep
+     one state for all threads */
+  if (jobs > 1)
+    {
+      vcd_warn ("--jobs not supported by this build -- ripping sequentially");
+      jobs = 1;
+    }
+#endif
+
   if (!xml_fname) {
     xml_fname = strdup (DEFAULT_XML_FNAME);
   }
@@ -1454,6 +1706,24 @@ main (int argc, const char *argv[])
   if (NULL == source_name)
     source_name = cdio_get_default_device(img_src);
 
+  gl_rip_source = source_name;
+  gl_rip_driver = cdio_get_driver_id (img_src);
+
+  switch (gl_rip_driver)
+    {
+    case DRIVER_BINCUE:
+    case DRIVER_NRG:
+    case DRIVER_CDRDAO:
+      gl_rip_jobs = jobs;
+      break;
+    default:
+      /* concurrent reads on a physical drive only cause seek storms */
+      if (jobs > 1)
+        vcd_warn ("--jobs ignored for CD-ROM devices");
+      gl_rip_jobs = 1;
+      break;
+    }
+
   vcdxml.comment = vcd_xml_dump_cl_comment (argc, argv,
 					      nocommand_comment_flag);
 
@@ -1476,20 +1746,66 @@ main (int argc, const char *argv[])
     vcd_warn ("and auto-pause locations might not be checked.");
   }
 
+  /* each part of the description is written as soon as ripping
+     can't change it anymore, to a temporary file so that a failure
+     doesn't leave a partial one in place of xml_fname; vcd_error ()
+     exits */
+  if (strcmp (xml_fname, "-"))
+    {
+      _tmp_xml_fname = calloc (1, strlen (xml_fname) + strlen (".tmp") + 1);
+      if (!_tmp_xml_fname)
+	{
+	  vcd_error ("out of memory");
+	  exit (EXIT_FAILURE);
+	}
+      strcpy (_tmp_xml_fname, xml_fname);
+      strcat (_tmp_xml_fname, ".tmp");
+
+      atexit (_remove_tmp_xml);
+    }
+
+  vcd_info ("Writing XML description to `%s'...", xml_fname);
+  if (!(p_dump = vcd_xml_dump_new (&vcdxml, _tmp_xml_fname
+				   ? _tmp_xml_fname : xml_fname)))
+    {
+      vcd_error ("can't create `%s'",
+		 _tmp_xml_fname ? _tmp_xml_fname : xml_fname);
+      exit (EXIT_FAILURE);
+    }
+
+  vcd_xml_dump_until (p_dump, VCD_XML_DUMP_HEAD);
+
   if (!norip_flag)
     {
+      if (!noseg_flag || !noseq_flag)
+	gl_image_map = vcdinfo_image_map_new (img_src);
+
       if (!nofile_flag)
 	_rip_isofs (&vcdxml, img_src);
 
       if (!noseg_flag)
 	_rip_segments (&vcdxml, img_src);
 
+      vcd_xml_dump_until (p_dump, VCD_XML_DUMP_SEGMENTS);
+
       if (!noseq_flag)
 	_rip_sequences (&vcdxml, img_src, _track_flag);
+
+      vcdinfo_image_map_destroy (gl_image_map);
+      gl_image_map = NULL;
     }
 
-  vcd_info ("Writing XML description to `%s'...", xml_fname);
-  vcd_xml_dump (&vcdxml, xml_fname);
+  if (vcd_xml_dump_destroy (p_dump))
+    vcd_error ("writing `%s' failed",
+	       _tmp_xml_fname ? _tmp_xml_fname : xml_fname);
+
+  if (_tmp_xml_fname && rename (_tmp_xml_fname, xml_fname))
+    vcd_error ("could not rename `%s' to `%s': %s", _tmp_xml_fname,
+	       xml_fname, strerror (errno));
+
+  free (_tmp_xml_fname);
+  _tmp_xml_fname = NULL;
+
   vcd_xml_destroy(&vcdxml);
   free(xml_fname);
   free(source_name);
@@ -35,6 +35,10 @@ typedef struct vcdxml_tag {
 
   char *file_prefix;
 
+  /* see VCD_PARM_MANIFEST and VCD_PARM_REUSE_IMAGE */
+  const char *manifest_fname;
+  const char *reuse_image_fname;
+
   vcd_type_t vcd_type;
   CdioList_t *option_list;
 
@@ -33,6 +33,7 @@
 #include <libvcd/version.h>
 #include <libvcd/types.h>
 #include <libvcd/files.h>
+#include <libvcd/logging.h>
 
 /* We don't want to pull in cdio's config */
 #define __CDIO_CONFIG_H__
@@ -874,6 +875,25 @@ extern "C" {
   vcdinfo_open(vcdinfo_obj_t **p_obj, char *source_name[],
 	       driver_id_t source_type, const char access_mode[]);
 
+  /*!
+    Like vcdinfo_open, but SEARCH.DAT and SCANDATA.DAT are only read
+    from the medium when they are first asked for
+    (vcdinfo_get_searchDat, vcdinfo_get_scandata), which return NULL
+    if that fails.
+  */
+  vcdinfo_open_return_t
+  vcdinfo_open_lazy(vcdinfo_obj_t **p_obj, char *source_name[],
+		    driver_id_t source_type, const char access_mode[]);
+
+  /*!
+    Send messages logged while data is read for p_vcdinfo, such as the
+    files left for later by vcdinfo_open_lazy, to handler. NULL
+    undoes this.
+  */
+  void vcdinfo_set_log_handler(vcdinfo_obj_t *p_vcdinfo,
+                               vcd_log_handler2_t handler,
+                               void *p_user_data);
+
 
   /*!
     Dispose of any resources associated with the vcdinfo structure.
@@ -889,6 +909,38 @@ extern "C" {
   */
   bool vcdinfo_is_rejected(uint16_t offset);
 
+  /*!
+    Memory mapping of a BIN/CUE or NRG image file, letting callers read
+    sectors without going through libcdio for each of them.
+  */
+  typedef struct _VcdImageMap vcdinfo_image_map_t;
+
+  /*!
+    Map the image file behind p_cdio into memory. NULL is returned if
+    that is not possible, in which case sectors have to be read with
+    cdio_read_mode2_sectors as usual.
+  */
+  vcdinfo_image_map_t *vcdinfo_image_map_new (CdIo_t *p_cdio);
+
+  /*!
+    Return a pointer to sector lsn laid out as cdio_read_mode2_sector
+    returns it with b_form2 set (subheader first), or NULL if lsn lies
+    outside of the image.
+  */
+  const uint8_t *vcdinfo_image_map_sector (const vcdinfo_image_map_t *p_map,
+                                           lsn_t lsn);
+
+  /*!
+    Return the distance in bytes between two consecutive sectors
+    returned by vcdinfo_image_map_sector.
+  */
+  unsigned vcdinfo_image_map_stride (const vcdinfo_image_map_t *p_map);
+
+  /*!
+    Unmap the image. Pointers handed out before become invalid.
+  */
+  void vcdinfo_image_map_destroy (vcdinfo_image_map_t *p_map);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -54,6 +54,11 @@ extern vcd_log_level_t vcd_loglevel_default;
  * message being logged, the handler will receive the log level and
  * the message string.
  *
+ * Given a VCD_LOG_ERROR message, the handler need not return; it may
+ * end the process or longjmp () out of the code that logged it, as
+ * long as it is called by that thread (i.e. not through
+ * vcd_log_async_start ()).
+ *
  * @see vcd_log_set_handler
  * @see vcd_log_level_t
  *
@@ -76,6 +81,91 @@ typedef void (*vcd_log_handler_t) (vcd_log_level_t level,
 vcd_log_handler_t
 vcd_log_set_handler (vcd_log_handler_t new_handler);
 
+/**
+ * This type defines the signature of a log handler that is given back
+ * the pointer it was installed with, so that messages can be told
+ * apart when several objects are in use at the same time.
+ *
+ * @see vcd_log_set_thread_handler
+ *
+ * @param level       The log level.
+ * @param message     The log message.
+ * @param p_user_data The pointer given when the handler was set.
+ */
+typedef void (*vcd_log_handler2_t) (vcd_log_level_t level,
+                                    const char message[],
+                                    void *p_user_data);
+
+/**
+ * Set a log handler for the messages logged by the calling thread.
+ * Other threads keep using the handler set by vcd_log_set_handler ().
+ * A handler set for an object with vcd_obj_set_log_handler () or
+ * vcdinfo_set_log_handler () takes precedence while that object is
+ * being worked on. If new_handler is NULL, the calling thread goes back
+ * to the process-wide handler.
+ *
+ * vcd_log_set_handler () itself should be called before other threads
+ * start logging.
+ *
+ * @param new_handler The new log handler or NULL.
+ * @param p_user_data Passed to new_handler with every message.
+ */
+void
+vcd_log_set_thread_handler (vcd_log_handler2_t new_handler,
+                            void *p_user_data);
+
+/**
+ * Drop messages below level before they are formatted, whatever
+ * handler they would go to. Programs whose handler filters messages
+ * by a verbosity setting of its own should pass that setting here,
+ * so that the messages it would throw away are not built in the
+ * first place. The default is VCD_LOG_DEBUG, which drops nothing;
+ * assertions are never dropped. Messages below vcd_loglevel_default
+ * are dropped as well while the internal default handler is in use.
+ *
+ * @param level The lowest level still handled.
+ */
+void
+vcd_log_set_level (vcd_log_level_t level);
+
+/**
+ * Tell whether a message of the given level would be handled at all,
+ * for callers which have to do some work to put a message together.
+ *
+ * @param level The log level.
+ * @return false if the message would be dropped.
+ */
+bool
+vcd_log_enabled (vcd_log_level_t level);
+
+/**
+ * Have the messages for the process-wide handler (see
+ * vcd_log_set_handler ()) passed to it by a background thread, so
+ * that threads doing the actual work don't wait for the handler and
+ * its I/O. Messages are queued without taking any locks, in a ring
+ * buffer of i_slots entries; when it is full, messages are dropped and
+ * a warning tells how many. Errors and assertions are never dropped,
+ * and the thread logging one waits until it has been handled.
+ *
+ * Handlers set with vcd_log_set_thread_handler () or for an object
+ * are still called directly.
+ *
+ * @param i_slots Size of the ring buffer, rounded up to a power of
+ *                two; 0 means 256.
+ * @return 0 on success, -1 if the background thread is running
+ *         already, could not be started or isn't supported here.
+ */
+int
+vcd_log_async_start (unsigned int i_slots);
+
+/**
+ * Wait for all queued messages to be handled, then stop the
+ * background thread started by vcd_log_async_start (). Other threads
+ * must be done logging by then.
+ */
+void
+vcd_log_async_stop (void);
+
 /**
  * Handle an message with the given log level
  *
@@ -123,6 +213,12 @@ vcd_warn (const char format[], ...) GNUC_PRINTF(1,2);
 void
 vcd_error (const char format[], ...) GNUC_PRINTF(1,2);
 
+/* builds for which VCD_NO_DEBUG_LOG is defined (configure
+   --disable-debug-log) leave debug messages out altogether */
+#ifdef VCD_NO_DEBUG_LOG
+# define vcd_debug(...) ((void) 0)
+#endif
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
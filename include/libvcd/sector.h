@@ -104,11 +104,46 @@ void
 _vcd_make_mode2 (void *raw_sector, const void *data, uint32_t extent,
                  uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci);
 
+/** the steps of _vcd_make_mode2 (), for callers which want to
+ * account for them one at a time: sync, address, subheader and
+ * payload first, then the EDC and finally the ECC (form 1 only)
+ */
+void
+_vcd_make_mode2_header (void *raw_sector, const void *data, uint32_t extent,
+                        uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci);
+
+void
+_vcd_make_mode2_edc (void *raw_sector);
+
+void
+_vcd_make_mode2_ecc (void *raw_sector);
+
 /* ...data must be a buffer of size 2336 */
 
 void
 _vcd_make_raw_mode2 (void *raw_sector, const void *data, uint32_t extent);
 
+/** what _vcd_check_mode2 () can find wrong with a sector */
+#define VCD_SECTOR_BAD_SYNC      (1<<0)
+#define VCD_SECTOR_BAD_ADDRESS   (1<<1) /**< MSF doesn't match extent */
+#define VCD_SECTOR_BAD_MODE      (1<<2) /**< not mode 2 */
+#define VCD_SECTOR_BAD_SUBHEADER (1<<3) /**< the two copies differ */
+#define VCD_SECTOR_BAD_EDC       (1<<4)
+#define VCD_SECTOR_BAD_ECC       (1<<5) /**< form 1 P or Q parity */
+#define VCD_SECTOR_CHECKS        6
+
+/** check a 2352 byte mode 2 form 1/2 sector as made by _vcd_make_mode2 ()
+ *
+ * returns 0 if it's alright, else the VCD_SECTOR_BAD_* flags of what
+ * isn't; the address isn't checked if extent is SECTOR_NIL
+ */
+int
+_vcd_check_mode2 (const void *raw_sector, uint32_t extent);
+
+/** short name of a single VCD_SECTOR_BAD_* flag, e.g. "EDC" */
+const char *
+_vcd_check_mode2_name (int problem);
+
 #endif /* _VCD_SECTOR_H_ */
 
 
@@ -0,0 +1,179 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <string.h>
+#include <stdlib.h>
+
+/* Public headers */
+#include <libvcd/types.h>
+
+/* Private headers */
+#include "vcd_assert.h"
+#include "arena.h"
+
+#define VCD_ARENA_CHUNK_SIZE (64*1024)
+
+/* requests larger than this get a chunk of their own */
+#define VCD_ARENA_LARGE_SIZE (VCD_ARENA_CHUNK_SIZE / 4)
+
+typedef union {
+  void *p;
+  double d;
+  long l;
+} _arena_align_t;
+
+#define ARENA_ALIGN(size) \
+  (((size) + sizeof (_arena_align_t) - 1) & ~(sizeof (_arena_align_t) - 1))
+
+typedef struct _arena_chunk _arena_chunk_t;
+
+struct _arena_chunk
+{
+  _arena_chunk_t *next;
+  size_t size;
+  size_t used;
+};
+
+#define CHUNK_HEADER_SIZE ARENA_ALIGN (sizeof (_arena_chunk_t))
+
+struct _VcdArena
+{
+  _arena_chunk_t *chunks; /* current chunk first */
+  vcd_arena_stats_t stats;
+};
+
+static _arena_chunk_t *
+_arena_chunk_new (VcdArena_t *arena, size_t size)
+{
+  _arena_chunk_t *chunk = malloc (CHUNK_HEADER_SIZE + size);
+
+  vcd_assert (chunk != NULL);
+
+  chunk->size = size;
+  chunk->used = 0;
+
+  arena->stats.chunks++;
+
+  return chunk;
+}
+
+VcdArena_t *
+_vcd_arena_new (void)
+{
+  return calloc(1, sizeof (VcdArena_t));
+}
+
+void
+_vcd_arena_destroy (VcdArena_t *arena)
+{
+  vcd_assert (arena != NULL);
+
+  while (arena->chunks)
+    {
+      _arena_chunk_t *next = arena->chunks->next;
+
+      free (arena->chunks);
+      arena->chunks = next;
+    }
+
+  free (arena);
+}
+
+void *
+_vcd_arena_alloc (VcdArena_t *arena, size_t size)
+{
+  _arena_chunk_t *chunk;
+  void *retval;
+
+  vcd_assert (arena != NULL);
+
+  size = ARENA_ALIGN (size ? size : 1);
+
+  if (size > VCD_ARENA_LARGE_SIZE)
+    {
+      /* link it behind the current chunk, which stays in use */
+      chunk = _arena_chunk_new (arena, size);
+
+      if (arena->chunks)
+        {
+          chunk->next = arena->chunks->next;
+          arena->chunks->next = chunk;
+        }
+      else
+        {
+          chunk->next = NULL;
+          arena->chunks = chunk;
+        }
+    }
+  else if (!arena->chunks
+           || arena->chunks->size - arena->chunks->used < size)
+    {
+      chunk = _arena_chunk_new (arena, VCD_ARENA_CHUNK_SIZE);
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
+  else
+    chunk = arena->chunks;
+
+  retval = (char *) chunk + CHUNK_HEADER_SIZE + chunk->used;
+  chunk->used += size;
+
+  memset (retval, 0, size);
+
+  arena->stats.allocs++;
+  arena->stats.bytes += size;
+
+  return retval;
+}
+
+char *
+_vcd_arena_strdup (VcdArena_t *arena, const char str[])
+{
+  size_t len;
+  char *retval;
+
+  vcd_assert (str != NULL);
+
+  len = strlen (str) + 1;
+  retval = _vcd_arena_alloc (arena, len);
+  memcpy (retval, str, len);
+
+  return retval;
+}
+
+void
+_vcd_arena_get_stats (const VcdArena_t *arena, vcd_arena_stats_t *stats)
+{
+  vcd_assert (arena != NULL);
+  vcd_assert (stats != NULL);
+
+  *stats = arena->stats;
+}
+
+
+/* 
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
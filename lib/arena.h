@@ -0,0 +1,61 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* region based memory allocation; everything allocated from an arena
+   is released at once by _vcd_arena_destroy () */
+
+#ifndef __VCD_ARENA_H__
+#define __VCD_ARENA_H__
+
+#include <stddef.h>
+#include <libvcd/types.h>
+
+typedef struct _VcdArena VcdArena_t;
+
+typedef struct {
+  unsigned allocs;  /* number of _vcd_arena_alloc () requests served */
+  unsigned chunks;  /* number of malloc () calls backing them */
+  size_t bytes;     /* total bytes handed out */
+} vcd_arena_stats_t;
+
+VcdArena_t *
+_vcd_arena_new (void);
+
+void
+_vcd_arena_destroy (VcdArena_t *arena);
+
+/* returns zero-filled memory, like calloc (1, size) */
+void *
+_vcd_arena_alloc (VcdArena_t *arena, size_t size);
+
+char *
+_vcd_arena_strdup (VcdArena_t *arena, const char str[]);
+
+void
+_vcd_arena_get_stats (const VcdArena_t *arena, vcd_arena_stats_t *stats);
+
+#endif /* __VCD_ARENA_H__ */
+
+
+/* 
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -26,6 +26,7 @@
 
 /* Private headers */
 #include "vcd_assert.h"
+#include "arena.h"
 #include "obj.h"
 #include "util.h"
 
@@ -50,12 +51,12 @@ _dict_insert (VcdObj_t *obj, const char key[], uint32_t sector, uint32_t length,
   if ((sector =_vcd_salloc (obj->iso_bitmap, sector, length)) == SECTOR_NIL)
     vcd_assert_not_reached ();
 
-  _new_node = calloc(1, sizeof (struct _dict_t));
+  _new_node = _vcd_arena_alloc (obj->output_arena, sizeof (struct _dict_t));
 
-  _new_node->key = strdup (key);
+  _new_node->key = _vcd_arena_strdup (obj->output_arena, key);
   _new_node->sector = sector;
   _new_node->length = length;
-  _new_node->buf = calloc(1, length * ISO_BLOCKSIZE);
+  _new_node->buf = _vcd_arena_alloc (obj->output_arena, length * ISO_BLOCKSIZE);
   _new_node->flags = end_flags;
 
   _cdio_list_prepend (obj->buffer_dict_list, _new_node);
@@ -146,20 +147,14 @@ _dict_get_sector (VcdObj_t *obj, uint32_t sector)
   return NULL;
 }
 
+/* nodes themselves live in obj->output_arena */
 static void
 _dict_clean (VcdObj_t *obj)
 {
   CdioListNode_t *node;
 
   while ((node = _cdio_list_begin (obj->buffer_dict_list)))
-    {
-      struct _dict_t *p = _cdio_list_node_data (node);
-
-      free (p->key);
-      free (p->buf);
-
-      _cdio_list_node_free (node, true, NULL);
-    }
+    _cdio_list_node_free (node, false, NULL);
 }
 
 #endif /* __VCD_DICT_H__ */
@@ -632,13 +632,6 @@ get_search_dat_size (const VcdObj_t *p_vcdobj)
     + (_get_scanpoint_count (p_vcdobj) * sizeof (msf_t));
 }
 
-static void uint32_free(uint32_t *data)
-{
-  if (data != NULL) free(data);
-}
-
-
-
 static CdioList_t *
 _make_track_scantable (const VcdObj_t *p_vcdobj)
 {
@@ -656,7 +649,8 @@ _make_track_scantable (const VcdObj_t *p_vcdobj)
 
       _CDIO_LIST_FOREACH (p_node2, track->info->shdr[0].aps_list)
         {
-          struct aps_data *_data = calloc(1, sizeof (struct aps_data));
+          struct aps_data *_data =
+            _vcd_arena_alloc (p_vcdobj->output_arena, sizeof (struct aps_data));
 
           *_data = *(struct aps_data *)_cdio_list_node_data (p_node2);
 
@@ -707,7 +701,8 @@ _make_track_scantable (const VcdObj_t *p_vcdobj)
 	  }
 
         {
-          uint32_t *lsect = calloc(1, sizeof (uint32_t));
+          uint32_t *lsect = _vcd_arena_alloc (p_vcdobj->output_arena,
+                                              sizeof (uint32_t));
 
           *lsect = aps_packet;
           _cdio_list_append (p_scantable, lsect);
@@ -717,7 +712,7 @@ _make_track_scantable (const VcdObj_t *p_vcdobj)
 
   }
 
-  _cdio_list_free (p_all_aps, true, (CdioDataFree_t) &uint32_free);
+  _cdio_list_free (p_all_aps, false, NULL);
 
   vcd_assert (scanpoints == _cdio_list_length (p_scantable));
 
@@ -759,7 +754,7 @@ set_search_dat (VcdObj_t *p_vcdobj, void *buf)
 
   vcd_assert (n = _get_scanpoint_count (p_vcdobj));
 
-  _cdio_list_free (p_scantable, true, (CdioDataFree_t) &uint32_free);
+  _cdio_list_free (p_scantable, false, NULL);
 }
 
 static uint32_t
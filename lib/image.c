@@ -65,6 +65,19 @@ vcd_image_sink_destroy (VcdImageSink_t *p_obj)
   free (p_obj);
 }
 
+void
+vcd_image_sink_discard (VcdImageSink_t *p_obj)
+{
+  vcd_assert (p_obj != NULL);
+
+  if (p_obj->op.discard)
+    p_obj->op.discard (p_obj->user_data);
+  else
+    p_obj->op.free (p_obj->user_data);
+
+  free (p_obj);
+}
+
 int
 vcd_image_sink_set_cuesheet (VcdImageSink_t *p_obj,
                              const CdioList_t *vcd_cue_list)
@@ -22,8 +22,10 @@
 #endif
 
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /* We don't want to pull in cdio's config */
 #define __CDIO_CONFIG_H__
@@ -56,6 +58,13 @@ typedef struct {
   char *bin_fname;
   char *cue_fname;
 
+  /* where a bin file of "-" goes */
+  int stdout_fd;
+
+  /* no seeking in bin_snk, sectors have to come in order */
+  bool sequential;
+  lsn_t next_lsn;
+
   bool init;
 } _img_bincue_snk_t;
 
@@ -65,7 +74,20 @@ _sink_init (_img_bincue_snk_t *_obj)
   if (_obj->init)
     return;
 
-  if (!(_obj->bin_snk = vcd_data_sink_new_stdio (_obj->bin_fname)))
+  if (!strcmp (_obj->bin_fname, "-"))
+    {
+      if (!strcmp (_obj->cue_fname, "-"))
+        vcd_error ("bin and cue file can't both be written to stdout");
+
+      _obj->sequential = true;
+    }
+
+  if (!strcmp (_obj->bin_fname, "-"))
+    _obj->bin_snk = vcd_data_sink_new_stdio_fd (_obj->stdout_fd);
+  else
+    _obj->bin_snk = vcd_data_sink_new_stdio (_obj->bin_fname);
+
+  if (!_obj->bin_snk)
     vcd_error ("init failed");
 
   if (!(_obj->cue_snk = vcd_data_sink_new_stdio (_obj->cue_fname)))
@@ -79,13 +101,59 @@ _sink_free (void *user_data)
 {
   _img_bincue_snk_t *_obj = user_data;
 
-  vcd_data_sink_destroy (_obj->bin_snk);
-  vcd_data_sink_destroy (_obj->cue_snk);
+  if (_obj->bin_snk)
+    vcd_data_sink_destroy (_obj->bin_snk);
+  if (_obj->cue_snk)
+    vcd_data_sink_destroy (_obj->cue_snk);
   free (_obj->bin_fname);
   free (_obj->cue_fname);
   free (_obj);
 }
 
+static void
+_sink_discard (void *user_data)
+{
+  _img_bincue_snk_t *_obj = user_data;
+
+  if (_obj->bin_snk)
+    {
+      vcd_data_sink_destroy (_obj->bin_snk);
+      _obj->bin_snk = NULL;
+      if (strcmp (_obj->bin_fname, "-"))
+        remove (_obj->bin_fname);
+    }
+
+  if (_obj->cue_snk)
+    {
+      vcd_data_sink_destroy (_obj->cue_snk);
+      _obj->cue_snk = NULL;
+      if (strcmp (_obj->cue_fname, "-"))
+        remove (_obj->cue_fname);
+    }
+
+  _sink_free (_obj);
+}
+
+static char *
+_bin_name_for_cue (const char cue_fname[])
+{
+  const char *base = strrchr (cue_fname, '/');
+  const char *ext;
+  char *retval;
+
+  base = base ? base + 1 : cue_fname;
+  ext = strrchr (base, '.');
+
+  if (!ext)
+    ext = base + strlen (base);
+
+  retval = calloc (1, (ext - base) + strlen (".bin") + 1);
+  memcpy (retval, base, ext - base);
+  strcat (retval, ".bin");
+
+  return retval;
+}
+
 static int
 _set_cuesheet (void *user_data, const CdioList_t *vcd_cue_list)
 {
@@ -96,8 +164,19 @@ _set_cuesheet (void *user_data, const CdioList_t *vcd_cue_list)
 
   _sink_init (_obj);
 
-  vcd_data_sink_printf (_obj->cue_snk, "FILE \"%s\" BINARY\r\n",
-			_obj->bin_fname);
+  if (strcmp (_obj->bin_fname, "-"))
+    vcd_data_sink_printf (_obj->cue_snk, "FILE \"%s\" BINARY\r\n",
+			  _obj->bin_fname);
+  else
+    {
+      /* the bin goes down a pipe; assume it will end up next to the
+         cue file, under the same name with .bin */
+      char *psz_bin = _bin_name_for_cue (_obj->cue_fname);
+
+      vcd_data_sink_printf (_obj->cue_snk, "FILE \"%s\" BINARY\r\n",
+			    psz_bin);
+      free (psz_bin);
+    }
 
   track_no = 0;
   index_no = 0;
@@ -188,7 +267,16 @@ _vcd_image_bincue_write (void *user_data, const void *data, lsn_t lsn)
 
   offset *= _obj->sector_2336_flag ? M2RAW_SECTOR_SIZE : CDIO_CD_FRAMESIZE_RAW;
 
-  vcd_data_sink_seek(_obj->bin_snk, offset);
+  if (!_obj->sequential)
+    vcd_data_sink_seek(_obj->bin_snk, offset);
+  else if (lsn != _obj->next_lsn)
+    {
+      vcd_error ("sequential output: got sector %d where %d was expected",
+                 lsn, _obj->next_lsn);
+      return -1;
+    }
+  else
+    _obj->next_lsn++;
 
   if (_obj->sector_2336_flag)
     vcd_data_sink_write(_obj->bin_snk, buf + 12 + 4, M2RAW_SECTOR_SIZE, 1);
@@ -230,6 +318,33 @@ _sink_set_arg (void *user_data, const char key[], const char value[])
       else
 	return -2;
     }
+  else if (!strcmp (key, "stdout-fd"))
+    {
+      char *endptr;
+      long fd;
+
+      if (!value)
+	return -2;
+
+      fd = strtol (value, &endptr, 10);
+
+      if (*endptr || endptr == value || fd < 0)
+	return -2;
+
+      _obj->stdout_fd = fd;
+    }
+  else if (!strcmp (key, "sequential"))
+    {
+      if (!value)
+	return -2;
+
+      if (!strcmp (value, "yes"))
+	_obj->sequential = true;
+      else if (!strcmp (value, "no"))
+	_obj->sequential = false;
+      else
+	return -2;
+    }
   else
     return -1;
 
@@ -245,13 +360,15 @@ vcd_image_sink_new_bincue (void)
     .set_cuesheet = _set_cuesheet,
     .write        = _vcd_image_bincue_write,
     .free         = _sink_free,
-    .set_arg      = _sink_set_arg
+    .set_arg      = _sink_set_arg,
+    .discard      = _sink_discard
   };
 
   _data = calloc(1, sizeof (_img_bincue_snk_t));
 
   _data->bin_fname = strdup ("videocd.bin");
   _data->cue_fname = strdup ("videocd.cue");
+  _data->stdout_fd = STDOUT_FILENO;
 
   return vcd_image_sink_new (_data, &_funcs);
 }
@@ -56,6 +56,10 @@ typedef struct {
   bool last_pause;
 
   CdioList_t *vcd_cue_list;
+
+  /* what has been written, for _sink_discard () */
+  bool toc_written;
+  CdioList_t *img_fnames;
 } _img_cdrdao_snk_t;
 
 static void
@@ -66,6 +70,28 @@ _sink_free (void *user_data)
   /* fixme -- destroy cue list */
 
   vcd_data_sink_destroy (_obj->last_bin_snk);
+  _cdio_list_free (_obj->img_fnames, true, NULL);
+  free (_obj->toc_fname);
+  free (_obj->img_base);
+  free (_obj);
+}
+
+static void
+_sink_discard (void *user_data)
+{
+  _img_cdrdao_snk_t *_obj = user_data;
+  CdioListNode_t *node;
+
+  if (_obj->last_bin_snk)
+    vcd_data_sink_destroy (_obj->last_bin_snk);
+
+  _CDIO_LIST_FOREACH (node, _obj->img_fnames)
+    remove (_cdio_list_node_data (node));
+
+  if (_obj->toc_written)
+    remove (_obj->toc_fname);
+
+  _cdio_list_free (_obj->img_fnames, true, NULL);
   free (_obj->toc_fname);
   free (_obj->img_base);
   free (_obj);
@@ -83,6 +109,8 @@ _set_cuesheet (void *user_data, const CdioList_t *vcd_cue_list)
   const vcd_cue_t *_last_cue = 0;
   unsigned last_track_lsn = 0;
 
+  _obj->toc_written = true;
+
   vcd_data_sink_printf (toc_snk,
 			"// CDRDAO TOC\n"
 			"//  generated by %s\n\n"
@@ -232,6 +260,7 @@ _vcd_image_cdrdao_write (void *user_data, const void *data, lsn_t lsn)
 		  (_pregap ? "_pregap" : ""));
 
 	_obj->last_bin_snk = vcd_data_sink_new_stdio (buf);
+	_cdio_list_append (_obj->img_fnames, strdup (buf));
 	_obj->last_snk_idx = in_track;
 	_obj->last_pause = _pregap;
       }
@@ -299,13 +328,15 @@ vcd_image_sink_new_cdrdao (void)
     .set_cuesheet = _set_cuesheet,
     .write        = _vcd_image_cdrdao_write,
     .free         = _sink_free,
-    .set_arg      = _sink_set_arg
+    .set_arg      = _sink_set_arg,
+    .discard      = _sink_discard
   };
 
   _data = calloc(1, sizeof (_img_cdrdao_snk_t));
 
   _data->toc_fname = strdup ("videocd.toc");
   _data->img_base = strdup ("videocd");
+  _data->img_fnames = _cdio_list_new ();
 
   return vcd_image_sink_new (_data, &_funcs);
 }
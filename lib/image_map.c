@@ -0,0 +1,255 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Direct access to the sectors of a disk image file.
+
+   libcdio does not tell us where in the image file a given sector is
+   stored, so rather than parsing cue sheets or NRG chunks a second
+   time we guess the layout (raw 2352 or 2336 byte sectors, starting at
+   offset 0) and check the guess by comparing a few sectors with what
+   cdio_read_mode2_sector () returns for them.  If anything disagrees
+   the image is not mapped and callers keep using libcdio. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/types.h>
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#include <fcntl.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+#include <cdio/iso9660.h>
+
+/* Public headers */
+#include <libvcd/info.h>
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "vcd_assert.h"
+
+struct _VcdImageMap
+{
+  const uint8_t *base;
+  size_t size;
+  unsigned stride;   /* bytes per sector in the image file */
+  unsigned offset;   /* position of the mode 2 subheader in a sector */
+  lsn_t end_lsn;
+};
+
+#ifdef HAVE_SYS_MMAN_H
+
+static const struct {
+  unsigned stride;
+  unsigned offset;
+} _layouts[] = {
+  { CDIO_CD_FRAMESIZE_RAW, CDIO_CD_SYNC_SIZE + CDIO_CD_HEADER_SIZE },
+  { M2RAW_SECTOR_SIZE, 0 },
+};
+
+static bool
+_check_sector (const vcdinfo_image_map_t *p_map, CdIo_t *p_cdio, lsn_t lsn)
+{
+  uint8_t buf[M2RAW_SECTOR_SIZE];
+  const uint8_t *p_sect = vcdinfo_image_map_sector (p_map, lsn);
+
+  if (!p_sect)
+    return false;
+
+  memset (buf, 0, sizeof (buf));
+  if (cdio_read_mode2_sector (p_cdio, buf, lsn, true))
+    return false;
+
+  return !memcmp (buf, p_sect, sizeof (buf));
+}
+
+static bool
+_check_layout (const vcdinfo_image_map_t *p_map, CdIo_t *p_cdio)
+{
+  track_t i_track = cdio_get_first_track_num (p_cdio);
+  track_t i_last = i_track + cdio_get_num_tracks (p_cdio);
+
+  if (i_track == CDIO_INVALID_TRACK || p_map->end_lsn <= ISO_PVD_SECTOR)
+    return false;
+
+  if (!_check_sector (p_map, p_cdio, ISO_PVD_SECTOR)
+      || !_check_sector (p_map, p_cdio, p_map->end_lsn - 1))
+    return false;
+
+  for (; i_track < i_last; i_track++)
+    {
+      lsn_t lsn = cdio_get_track_lsn (p_cdio, i_track);
+
+      if (lsn != CDIO_INVALID_LSN && !_check_sector (p_map, p_cdio, lsn))
+        return false;
+    }
+
+  return true;
+}
+
+#endif /* HAVE_SYS_MMAN_H */
+
+/*!
+  Map the image file behind p_cdio into memory. NULL is returned if
+  the source is not a BIN/CUE or NRG image, or if its sector layout
+  could not be confirmed.
+*/
+vcdinfo_image_map_t *
+vcdinfo_image_map_new (CdIo_t *p_cdio)
+{
+#ifdef HAVE_SYS_MMAN_H
+  vcdinfo_image_map_t *p_map;
+  const char *psz_source;
+  struct stat statbuf;
+  lsn_t end_lsn;
+  void *base;
+  unsigned i;
+  int fd;
+
+  vcd_assert (p_cdio != NULL);
+
+  switch (cdio_get_driver_id (p_cdio))
+    {
+    case DRIVER_BINCUE:
+    case DRIVER_NRG:
+      break;
+    default:
+      return NULL;
+    }
+
+  psz_source = cdio_get_arg (p_cdio, "source");
+  end_lsn = cdio_get_disc_last_lsn (p_cdio);
+
+  if (!psz_source || end_lsn == CDIO_INVALID_LSN)
+    return NULL;
+
+  if ((fd = open (psz_source, O_RDONLY)) < 0)
+    return NULL;
+
+  if (fstat (fd, &statbuf) || !statbuf.st_size)
+    {
+      close (fd);
+      return NULL;
+    }
+
+  base = mmap (NULL, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+
+  if (base == MAP_FAILED)
+    return NULL;
+
+  p_map = calloc(1, sizeof (vcdinfo_image_map_t));
+  p_map->base = base;
+  p_map->size = statbuf.st_size;
+  p_map->end_lsn = end_lsn;
+
+  for (i = 0; i < sizeof (_layouts) / sizeof (_layouts[0]); i++)
+    {
+      p_map->stride = _layouts[i].stride;
+      p_map->offset = _layouts[i].offset;
+
+      if (_check_layout (p_map, p_cdio))
+        {
+#ifdef MADV_SEQUENTIAL
+          madvise (base, statbuf.st_size, MADV_SEQUENTIAL);
+#endif
+          vcd_debug ("mapped `%s' (%u bytes per sector)", psz_source,
+                     p_map->stride);
+          return p_map;
+        }
+    }
+
+  vcd_debug ("sector layout of `%s' not recognized, not mapping it",
+             psz_source);
+
+  vcdinfo_image_map_destroy (p_map);
+#endif /* HAVE_SYS_MMAN_H */
+
+  return NULL;
+}
+
+/*!
+  Return a pointer to the mode 2 subheader of sector lsn, followed by
+  the rest of the sector as cdio_read_mode2_sector (..., true) would
+  return it, or NULL if lsn is outside the image. The pointer stays
+  valid until the map is destroyed.
+*/
+const uint8_t *
+vcdinfo_image_map_sector (const vcdinfo_image_map_t *p_map, lsn_t lsn)
+{
+  size_t pos;
+
+  vcd_assert (p_map != NULL);
+
+  if (lsn < 0 || lsn >= p_map->end_lsn)
+    return NULL;
+
+  pos = (size_t) lsn * p_map->stride + p_map->offset;
+
+  if (pos + M2RAW_SECTOR_SIZE > p_map->size)
+    return NULL;
+
+  return p_map->base + pos;
+}
+
+/*!
+  Return the distance in bytes between consecutive sectors returned by
+  vcdinfo_image_map_sector ().
+*/
+unsigned
+vcdinfo_image_map_stride (const vcdinfo_image_map_t *p_map)
+{
+  vcd_assert (p_map != NULL);
+
+  return p_map->stride;
+}
+
+void
+vcdinfo_image_map_destroy (vcdinfo_image_map_t *p_map)
+{
+  if (!p_map)
+    return;
+
+#ifdef HAVE_SYS_MMAN_H
+  munmap ((void *) p_map->base, p_map->size);
+#endif
+
+  free (p_map);
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -138,6 +138,22 @@ _sink_free (void *user_data)
   free (_obj);
 }
 
+static void
+_sink_discard (void *user_data)
+{
+  _img_nrg_snk_t *_obj = user_data;
+
+  if (_obj->nrg_snk)
+    {
+      vcd_data_sink_destroy (_obj->nrg_snk);
+      _obj->nrg_snk = NULL;
+      remove (_obj->nrg_fname);
+    }
+
+  free (_obj->nrg_fname);
+  free (_obj);
+}
+
 static int
 _set_cuesheet (void *user_data, const CdioList_t *vcd_cue_list)
 {
@@ -338,7 +354,8 @@ vcd_image_sink_new_nrg (void)
     .set_cuesheet = _set_cuesheet,
     .write        = _vcd_image_nrg_write,
     .free         = _sink_free,
-    .set_arg      = _sink_set_arg
+    .set_arg      = _sink_set_arg,
+    .discard      = _sink_discard
   };
 
   _data = calloc(1, sizeof (_img_nrg_snk_t));
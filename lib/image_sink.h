@@ -52,6 +52,7 @@ typedef struct {
   int (*write) (void *p_user_data, const void *buf, lsn_t lsn);
   void (*free) (void *p_user_data);
   int (*set_arg) (void *p_user_data, const char key[], const char value[]);
+  void (*discard) (void *p_user_data); /* like free, removing the files */
 } vcd_image_sink_funcs;
 
 VcdImageSink_t *
@@ -60,6 +61,13 @@ vcd_image_sink_new (void *user_data, const vcd_image_sink_funcs *funcs);
 void
 vcd_image_sink_destroy (VcdImageSink_t *p_obj);
 
+/*!
+  Destroy an image sink whose image didn't get finished, removing the
+  files written so far.
+*/
+void
+vcd_image_sink_discard (VcdImageSink_t *p_obj);
+
 int
 vcd_image_sink_set_cuesheet (VcdImageSink_t *p_obj, 
 			     const CdioList_t *p_vcd_cue_list);
@@ -59,16 +59,18 @@
 /* Private headers */
 #include "info_private.h"
 #include "pbc.h"
+#include "util.h"
 
 #define BUF_COUNT 16
 #define BUF_SIZE 80
 
-/* Return a pointer to a internal free buffer */
+/* Return a pointer to a internal free buffer; each thread has its own
+   ring of buffers */
 static char *
 _getbuf (void)
 {
-  static char _buf[BUF_COUNT][BUF_SIZE];
-  static int _num = -1;
+  static VCD_THREAD_LOCAL char _buf[BUF_COUNT][BUF_SIZE];
+  static VCD_THREAD_LOCAL int _num = -1;
 
   _num++;
   _num %= BUF_COUNT;
@@ -56,16 +56,18 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <errno.h>
+#include <ctype.h>
 
 #define BUF_COUNT 16
 #define BUF_SIZE 80
 
-/* Return a pointer to a internal free buffer */
+/* Return a pointer to a internal free buffer; each thread has its own
+   ring of buffers */
 static char *
 _getbuf (void)
 {
-  static char _buf[BUF_COUNT][BUF_SIZE];
-  static int _num = -1;
+  static VCD_THREAD_LOCAL char _buf[BUF_COUNT][BUF_SIZE];
+  static VCD_THREAD_LOCAL int _num = -1;
 
   _num++;
   _num %= BUF_COUNT;
@@ -75,6 +77,218 @@ _getbuf (void)
   return _buf[_num];
 }
 
+/* what _vcdinfo_load should read */
+#define _LOAD_PBC_X    (1 << 0)  /* PSD_X.VCD and LOT_X.VCD */
+#define _LOAD_SEARCH   (1 << 1)
+#define _LOAD_SCANDATA (1 << 2)
+#define _LOAD_ALL      (_LOAD_PBC_X | _LOAD_SEARCH | _LOAD_SCANDATA)
+
+/*
+   Return the entry named psz_name (without version number) of a list
+   returned by iso9660_fs_readdir, or NULL if there is none.
+*/
+static const iso9660_stat_t *
+_find_dir_entry (CdioList_t *p_entlist, const char psz_name[])
+{
+  CdioListNode_t *p_entnode;
+  const size_t len = strlen (psz_name);
+
+  if (NULL == p_entlist) return NULL;
+
+  _CDIO_LIST_FOREACH (p_entnode, p_entlist) {
+    const iso9660_stat_t *p_statbuf = _cdio_list_node_data (p_entnode);
+    const char *psz_entry = p_statbuf->filename;
+    size_t i;
+
+    for (i = 0; i < len && psz_entry[i]; i++)
+      if (toupper ((unsigned char) psz_entry[i]) != psz_name[i])
+        break;
+
+    if (i == len && (!psz_entry[i] || ';' == psz_entry[i]))
+      return p_statbuf;
+  }
+
+  return NULL;
+}
+
+static void
+_set_extent (vcdinfo_extent_t *p_ext, const iso9660_stat_t *p_statbuf)
+{
+  p_ext->lsn     = p_statbuf->lsn;
+  p_ext->secsize = p_statbuf->secsize;
+  p_ext->size    = p_statbuf->size;
+  p_ext->pending = p_ext->secsize > 0;
+}
+
+/*
+   Read the pending extents of exts[] into the corresponding bufs[].
+   Extents which follow each other on disc are read with a single
+   cdio_read_mode2_sectors call.
+*/
+static bool
+_read_extents (CdIo_t *p_cdio, vcdinfo_extent_t *exts[], void **bufs[],
+               unsigned count)
+{
+  unsigned order[4];
+  unsigned n = 0, i, j, k;
+
+  vcd_assert (count <= sizeof (order) / sizeof (order[0]));
+
+  /* insertion sort of the pending extents by lsn */
+  for (i = 0; i < count; i++) {
+    if (!exts[i]->pending) continue;
+
+    for (j = n; j > 0 && exts[order[j-1]]->lsn > exts[i]->lsn; j--)
+      order[j] = order[j-1];
+    order[j] = i;
+    n++;
+  }
+
+  for (i = 0; i < n; i = j) {
+    uint32_t run_secsize = exts[order[i]]->secsize;
+    uint8_t *p_run, *p;
+
+    /* extend the run while the next extent starts where this one ends */
+    for (j = i + 1; j < n; j++) {
+      const vcdinfo_extent_t *p_prev = exts[order[j-1]];
+
+      if (exts[order[j]]->lsn != p_prev->lsn + p_prev->secsize) break;
+      run_secsize += exts[order[j]]->secsize;
+    }
+
+    for (k = i; k < j; k++) {
+      free (*bufs[order[k]]);
+      *bufs[order[k]] = calloc(1, ISO_BLOCKSIZE * exts[order[k]]->secsize);
+      exts[order[k]]->pending = false;
+    }
+
+    if (j - i == 1) {
+      if (cdio_read_mode2_sectors (p_cdio, *bufs[order[i]],
+                                   exts[order[i]]->lsn, false, run_secsize))
+        return false;
+      continue;
+    }
+
+    vcd_debug ("reading %u adjacent files at sector %lu (%lu sectors)",
+               j - i, (long unsigned int) exts[order[i]]->lsn,
+               (long unsigned int) run_secsize);
+
+    p_run = calloc(1, ISO_BLOCKSIZE * run_secsize);
+    if (cdio_read_mode2_sectors (p_cdio, p_run, exts[order[i]]->lsn, false,
+                                 run_secsize)) {
+      free (p_run);
+      return false;
+    }
+
+    for (k = i, p = p_run; k < j; k++) {
+      const size_t len = ISO_BLOCKSIZE * exts[order[k]]->secsize;
+
+      memcpy (*bufs[order[k]], p, len);
+      p += len;
+    }
+
+    free (p_run);
+  }
+
+  return true;
+}
+
+/*
+   SEARCH.DAT may list more scan points than its ISO 9660 size allows
+   for; make room for all of them.
+*/
+static void
+_fixup_search (vcdinfo_obj_t *p_obj)
+{
+  uint32_t size = (3 * uint16_from_be (((SearchDat_t *)p_obj->search_buf)->scan_points))
+    + sizeof (SearchDat_t);
+
+  if (size > p_obj->search_ext.size) {
+    void *p_buf;
+
+    vcd_warn ("number of scanpoints leads to bigger size than "
+              "file size of SEARCH.DAT! -- enlarging buffer");
+
+    p_buf = calloc(1, ISO_BLOCKSIZE * _vcd_len2blocks(size, ISO_BLOCKSIZE));
+    memcpy (p_buf, p_obj->search_buf,
+            ISO_BLOCKSIZE * p_obj->search_ext.secsize);
+    free (p_obj->search_buf);
+    p_obj->search_buf = p_buf;
+  }
+}
+
+/*
+   Read whichever of the files selected by what have been found but
+   not read yet.  On error the affected buffers are released.
+*/
+static bool
+_vcdinfo_load_files (vcdinfo_obj_t *p_obj, unsigned what)
+{
+  vcdinfo_extent_t *exts[4];
+  void **bufs[4];
+  unsigned count = 0;
+  const bool search = (what & _LOAD_SEARCH) && p_obj->search_ext.pending;
+
+  if (what & _LOAD_PBC_X) {
+    exts[count] = &p_obj->psd_x_ext;
+    bufs[count++] = (void **) &p_obj->psd_x;
+    exts[count] = &p_obj->lot_x_ext;
+    bufs[count++] = (void **) &p_obj->lot_x;
+  }
+
+  if (what & _LOAD_SEARCH) {
+    exts[count] = &p_obj->search_ext;
+    bufs[count++] = &p_obj->search_buf;
+  }
+
+  if (what & _LOAD_SCANDATA) {
+    exts[count] = &p_obj->scandata_ext;
+    bufs[count++] = &p_obj->scandata_buf;
+  }
+
+  if (!_read_extents (p_obj->img, exts, bufs, count)) {
+    unsigned i;
+
+    for (i = 0; i < count; i++) {
+      CDIO_FREE_IF_NOT_NULL (*bufs[i]);
+      exts[i]->pending = false;
+    }
+
+    if (what & _LOAD_PBC_X)
+      p_obj->psd_x_size = 0;
+
+    return false;
+  }
+
+  if (search)
+    _fixup_search (p_obj);
+
+  return true;
+}
+
+static bool
+_vcdinfo_load (vcdinfo_obj_t *p_obj, unsigned what)
+{
+  _vcd_log_scope_t scope;
+  bool ok;
+
+#ifdef HAVE_PTHREAD_H
+  if (p_obj->load_lock_init)
+    pthread_mutex_lock (&p_obj->load_lock);
+#endif
+
+  _vcd_log_scope_enter (&scope, p_obj->log_handler, p_obj->log_user_data);
+  ok = _vcdinfo_load_files (p_obj, what);
+  _vcd_log_scope_leave (&scope);
+
+#ifdef HAVE_PTHREAD_H
+  if (p_obj->load_lock_init)
+    pthread_mutex_unlock (&p_obj->load_lock);
+#endif
+
+  return ok;
+}
+
 /*
    Initialize/allocate segment portion of vcdinfo_obj_t.
 
@@ -86,9 +300,11 @@ _getbuf (void)
 
    Another approach to get segment sizes is to read/scan the
    MPEGs. That would be rather slow.
+
+   b_have_dir tells whether the root directory has a SEGMENT entry.
 */
 static void
-_init_segments (vcdinfo_obj_t *p_obj)
+_init_segments (vcdinfo_obj_t *p_obj, bool b_have_dir)
 {
   InfoVcd_t *info = vcdinfo_get_infoVcd(p_obj);
   segnum_t num_segments = vcdinfo_get_num_segments(p_obj);
@@ -102,10 +318,10 @@ _init_segments (vcdinfo_obj_t *p_obj)
 
   if (NULL == p_obj->seg_sizes || 0 == num_segments) return;
 
-  entlist = iso9660_fs_readdir(p_obj->img, "SEGMENT");
+  entlist = b_have_dir ? iso9660_fs_readdir(p_obj->img, "SEGMENT") : NULL;
 
   i=0;
-  _CDIO_LIST_FOREACH (entnode, entlist) {
+  if (entlist) _CDIO_LIST_FOREACH (entnode, entlist) {
     iso9660_stat_t *statbuf = _cdio_list_node_data (entnode);
 
     if (statbuf->type == _STAT_DIR) continue;
@@ -137,7 +353,8 @@ _init_segments (vcdinfo_obj_t *p_obj)
     vcd_warn ("Number of segments found %d is not number of segments %d",
               i, num_segments);
 
-  _cdio_list_free (entlist, true, NULL);
+  if (entlist)
+    _cdio_list_free (entlist, true, NULL);
 
 
 #if 0
@@ -788,14 +1005,14 @@ vcdinfo_get_pvd (vcdinfo_obj_t *p_obj)
 void *
 vcdinfo_get_scandata (vcdinfo_obj_t *p_obj)
 {
-  if (!p_obj) return NULL;
+  if (!p_obj || !_vcdinfo_load (p_obj, _LOAD_SCANDATA)) return NULL;
   return p_obj->scandata_buf;
 }
 
 void *
 vcdinfo_get_searchDat (vcdinfo_obj_t *p_obj)
 {
-  if (!p_obj) return NULL;
+  if (!p_obj || !_vcdinfo_load (p_obj, _LOAD_SEARCH)) return NULL;
   return p_obj->search_buf;
 }
 
@@ -927,6 +1144,8 @@ _vcdinfo_get_offset_t (const vcdinfo_obj_t *p_obj, unsigned int offset,
 {
   CdioListNode_t *node;
   CdioList_t *offset_list = ext ? p_obj->offset_x_list : p_obj->offset_list;
+  const vcdinfo_offset_index_t *p_idx =
+    ext ? &p_obj->offset_x_idx : &p_obj->offset_idx;
 
   switch (offset) {
   case PSD_OFS_DISABLED:
@@ -936,6 +1155,9 @@ _vcdinfo_get_offset_t (const vcdinfo_obj_t *p_obj, unsigned int offset,
   default: ;
   }
 
+  if (p_idx->by_offset)
+    return offset < p_idx->offset_count ? p_idx->by_offset[offset] : NULL;
+
   _CDIO_LIST_FOREACH (node, offset_list)
     {
       vcdinfo_offset_t *p_ofs = _cdio_list_node_data (node);
@@ -1050,6 +1272,25 @@ vcdinfo_get_publisher_id(const vcdinfo_obj_t *p_obj)
   return iso9660_get_publisher_id(&(p_obj->pvd));
 }
 
+/* point pxd at the descriptor at byte offset rofs of psd */
+static void
+_set_pxd (PsdListDescriptor_t *pxd, const uint8_t *psd, unsigned rofs)
+{
+  pxd->descriptor_type = psd[rofs];
+
+  switch (pxd->descriptor_type)
+    {
+    case PSD_TYPE_PLAY_LIST:
+      pxd->pld = (PsdPlayListDescriptor_t *) (psd + rofs);
+      break;
+    case PSD_TYPE_EXT_SELECTION_LIST:
+    case PSD_TYPE_SELECTION_LIST:
+      pxd->psd = (PsdSelectionListDescriptor_t *) (psd + rofs);
+      break;
+    default: ;
+    }
+}
+
 /*!
   Get the PSD Selection List Descriptor for a given lid.
   NULL is returned if error or not found.
@@ -1062,9 +1303,33 @@ _vcdinfo_lid_get_pxd(const vcdinfo_obj_t *p_obj, PsdListDescriptor_t *pxd,
   unsigned mult = p_obj->info.offset_mult;
   const uint8_t *psd = ext ? p_obj->psd_x : p_obj->psd;
   CdioList_t *offset_list = ext ? p_obj->offset_x_list : p_obj->offset_list;
+  const vcdinfo_offset_index_t *p_idx =
+    ext ? &p_obj->offset_x_idx : &p_obj->offset_idx;
 
   if (offset_list == NULL) return false;
 
+  if (p_idx->by_lid)
+    {
+      const vcdinfo_offset_t *ofs =
+        lid < p_idx->lid_count ? p_idx->by_lid[lid] : NULL;
+
+      if (ofs)
+        {
+          _set_pxd (pxd, psd, ofs->offset * mult);
+          return true;
+        }
+
+      /* leave pxd as going through the whole list would */
+      if (p_idx->last_pld)
+        _set_pxd (pxd, psd, p_idx->last_pld->offset * mult);
+      if (p_idx->last_psd)
+        _set_pxd (pxd, psd, p_idx->last_psd->offset * mult);
+      if (p_idx->last)
+        pxd->descriptor_type = psd[p_idx->last->offset * mult];
+
+      return false;
+    }
+
   _CDIO_LIST_FOREACH (node, offset_list)
     {
       vcdinfo_offset_t *ofs = _cdio_list_node_data (node);
@@ -1205,7 +1470,7 @@ vcdinfo_get_seg_msf(const vcdinfo_obj_t *p_obj, segnum_t i_seg)
     return NULL;
   else {
     lsn_t lsn = vcdinfo_get_seg_lsn(p_obj, i_seg);
-    static msf_t msf;
+    static VCD_THREAD_LOCAL msf_t msf;
     cdio_lsn_to_msf(lsn, &msf);
     return &msf;
   }
@@ -1556,7 +1821,7 @@ vcdinfo_get_volume_count(const vcdinfo_obj_t *p_obj)
 const char *
 vcdinfo_get_volume_id(const vcdinfo_obj_t *p_obj)
 {
-  static char psz_vol_id[ISO_MAX_VOLUME_ID+1] = {'\0'};
+  static VCD_THREAD_LOCAL char psz_vol_id[ISO_MAX_VOLUME_ID+1] = {'\0'};
   char *psz_vol_id2;
   if ( NULL == p_obj || NULL == &p_obj->pvd ) return (NULL);
   psz_vol_id2 = iso9660_get_volume_id(&p_obj->pvd);
@@ -1572,7 +1837,7 @@ vcdinfo_get_volume_id(const vcdinfo_obj_t *p_obj)
 const char *
 vcdinfo_get_volumeset_id(const vcdinfo_obj_t *p_obj)
 {
-  static char volume_set_id[ISO_MAX_VOLUMESET_ID+1] = {'\0'};
+  static VCD_THREAD_LOCAL char volume_set_id[ISO_MAX_VOLUMESET_ID+1] = {'\0'};
   if ( NULL == p_obj || NULL == &p_obj->pvd ) return (NULL);
   strncpy(volume_set_id, p_obj->pvd.volume_set_id, ISO_MAX_VOLUMESET_ID);
   return vcdinfo_strip_trail(volume_set_id, ISO_MAX_VOLUMESET_ID);
@@ -1716,6 +1981,78 @@ vcdinfo_track_get_entry(const vcdinfo_obj_t *p_obj, track_t i_track)
   return vcdinfo_lsn_get_entry(p_obj, lsn);
 }
 
+static void
+_free_offset_index (vcdinfo_offset_index_t *p_idx)
+{
+  free (p_idx->by_offset);
+  free (p_idx->by_lid);
+  memset (p_idx, 0, sizeof (vcdinfo_offset_index_t));
+}
+
+/* LID of the list descriptor at p_desc, or 0 if it has none */
+static lid_t
+_desc_get_lid (const uint8_t *p_desc)
+{
+  switch (p_desc[0])
+    {
+    case PSD_TYPE_PLAY_LIST:
+      return vcdinf_pld_get_lid ((const PsdPlayListDescriptor_t *) p_desc);
+    case PSD_TYPE_EXT_SELECTION_LIST:
+    case PSD_TYPE_SELECTION_LIST:
+      return vcdinf_psd_get_lid ((const PsdSelectionListDescriptor_t *) p_desc);
+    default:
+      return 0;
+    }
+}
+
+/* Fill in the by_lid part of p_idx from offset_list. The LID is the
+   one in the descriptor, and the first entry with a given LID wins,
+   as with a search through the list. */
+static void
+_build_lid_index (vcdinfo_offset_index_t *p_idx, CdioList_t *offset_list,
+                  const uint8_t *psd, unsigned mult)
+{
+  CdioListNode_t *node;
+  lid_t max_lid = 0;
+
+  _CDIO_LIST_FOREACH (node, offset_list)
+    {
+      vcdinfo_offset_t *ofs = _cdio_list_node_data (node);
+      const lid_t lid = _desc_get_lid (psd + ofs->offset * mult);
+
+      if (lid > max_lid)
+        max_lid = lid;
+    }
+
+  p_idx->lid_count = max_lid + 1;
+  p_idx->by_lid = calloc (p_idx->lid_count, sizeof (vcdinfo_offset_t *));
+
+  _CDIO_LIST_FOREACH (node, offset_list)
+    {
+      vcdinfo_offset_t *ofs = _cdio_list_node_data (node);
+      const uint8_t *p_desc = psd + ofs->offset * mult;
+      const lid_t lid = _desc_get_lid (p_desc);
+
+      p_idx->last = ofs;
+
+      switch (p_desc[0])
+        {
+        case PSD_TYPE_PLAY_LIST:
+          p_idx->last_pld = ofs;
+          break;
+        case PSD_TYPE_EXT_SELECTION_LIST:
+        case PSD_TYPE_SELECTION_LIST:
+          p_idx->last_psd = ofs;
+          break;
+        default:
+          continue;
+        }
+
+      if (!p_idx->by_lid[lid])
+        p_idx->by_lid[lid] = ofs;
+    }
+}
+
 /*!
    Calls recursive routine to populate obj->offset_list or obj->offset_x_list
    by going through LOT.
@@ -1739,6 +2076,8 @@ vcdinfo_visit_lot (vcdinfo_obj_t *p_obj, bool extended)
   pbc_ctx.lot           = p_obj->lot;
   pbc_ctx.lot_x         = p_obj->lot_x;
   pbc_ctx.extended      = extended;
+  pbc_ctx.offset_index  = NULL;
+  pbc_ctx.offset_index_size = 0;
 
   ret = vcdinf_visit_lot(&pbc_ctx);
   if (NULL != p_obj->offset_x_list)
@@ -1747,6 +2086,23 @@ vcdinfo_visit_lot (vcdinfo_obj_t *p_obj, bool extended)
   if (NULL != p_obj->offset_list)
     _cdio_list_free(p_obj->offset_list, true, NULL);
   p_obj->offset_list = pbc_ctx.offset_list;
+
+  _free_offset_index (&p_obj->offset_idx);
+  _free_offset_index (&p_obj->offset_x_idx);
+
+  if (pbc_ctx.offset_index)
+    {
+      vcdinfo_offset_index_t *p_idx =
+        extended ? &p_obj->offset_x_idx : &p_obj->offset_idx;
+
+      p_idx->by_offset    = pbc_ctx.offset_index;
+      p_idx->offset_count = pbc_ctx.offset_index_size;
+      _build_lid_index (p_idx, extended ? p_obj->offset_x_list
+                        : p_obj->offset_list,
+                        extended ? p_obj->psd_x : p_obj->psd,
+                        p_obj->info.offset_mult);
+    }
+
   return ret;
 }
 
@@ -1757,7 +2113,7 @@ vcdinfo_visit_lot (vcdinfo_obj_t *p_obj, bool extended)
 const char *
 vcdinfo_strip_trail (const char str[], size_t n)
 {
-  static char buf[1024];
+  static VCD_THREAD_LOCAL char buf[1024];
   int j;
 
   vcd_assert (n < 1024);
@@ -1814,36 +2170,18 @@ vcdinfo_init(vcdinfo_obj_t *p_obj)
   return cdio_init();
 }
 
-/*!
-   Set up vcdinfo structure "p_obj" for reading from a particular
-   medium. This should be done before after initialization but before
-   any routines that need to retrieve data.
-
-   source_name is the device or file to use for inspection, and
-   source_type indicates what driver to use or class of drivers in the
-   case of DRIVER_DEVICE.
-   access_mode gives the CD access method for reading should the driver
-   allow for more than one kind of access method (e.g. MMC versus ioctl
-   on GNU/Linux)
-
-   If source_name is NULL we'll fill in the appropriate default device
-   name for the given source_type. However if in addtion source_type is
-   DRIVER_UNKNOWN, then we'll scan for a drive containing a VCD.
-
-   VCDINFO_OPEN_VCD is returned if everything went okay;
-   VCDINFO_OPEN_ERROR if there was an error and VCDINFO_OPEN_OTHER if the
-   medium is something other than a VCD.
-
-   Only if VCDINFO_OPEN_VCD is returned, the caller needs free the
-   vcdinfo_obj_t.
- */
-vcdinfo_open_return_t
-vcdinfo_open(vcdinfo_obj_t **pp_obj, char *source_name[],
-             driver_id_t source_type, const char access_mode[])
+/*
+   Common part of vcdinfo_open and vcdinfo_open_lazy.
+*/
+static vcdinfo_open_return_t
+_vcdinfo_open(vcdinfo_obj_t **pp_obj, char *source_name[],
+              driver_id_t source_type, const char access_mode[],
+              bool b_lazy)
 {
   CdIo_t *p_cdio;
   vcdinfo_obj_t *p_obj = calloc(1, sizeof(vcdinfo_obj_t));
-  iso9660_stat_t *statbuf;
+  CdioList_t *p_rootlist = NULL;
+  CdioList_t *p_extlist = NULL;
   bool free_source_name = false;
 
   /* If we don't specify a driver_id or a source_name, scan the
@@ -1884,6 +2222,11 @@ vcdinfo_open(vcdinfo_obj_t **pp_obj, char *source_name[],
   memset (p_obj, 0, sizeof (vcdinfo_obj_t));
   p_obj->img = p_cdio;  /* Note we do this after the above wipeout! */
 
+#ifdef HAVE_PTHREAD_H
+  if (b_lazy)
+    p_obj->load_lock_init = !pthread_mutex_init (&p_obj->load_lock, NULL);
+#endif
+
   if (!iso9660_fs_read_pvd(p_obj->img, &(p_obj->pvd))) {
     goto err_return;
   }
@@ -1913,146 +2256,100 @@ vcdinfo_open(vcdinfo_obj_t **pp_obj, char *source_name[],
     strncpy(p_obj->source_name, *source_name, len);
   }
 
+  /* Each directory is read only once; the files needed from it are
+     looked up in its listing. */
+  p_rootlist = iso9660_fs_readdir (p_cdio, "/");
+  if (_find_dir_entry (p_rootlist, "EXT"))
+    p_extlist = iso9660_fs_readdir (p_cdio, "EXT");
+
   if (p_obj->vcd_type == VCD_TYPE_SVCD || p_obj->vcd_type == VCD_TYPE_HQVCD) {
-    statbuf = iso9660_fs_stat (p_obj->img, "MPEGAV");
+    const iso9660_stat_t *p_statbuf;
+    CdioList_t *p_svcdlist = NULL;
 
-    if (NULL != statbuf) {
+    if (_find_dir_entry (p_rootlist, "MPEGAV"))
       vcd_warn ("non compliant /MPEGAV folder detected!");
-      free(statbuf);
-    }
 
+    if (_find_dir_entry (p_rootlist, "SVCD"))
+      p_svcdlist = iso9660_fs_readdir (p_cdio, "SVCD");
+
+    p_statbuf = _find_dir_entry (p_svcdlist, "TRACKS.SVD");
+    if (NULL == p_statbuf)
+      vcd_warn ("mandatory /SVCD/TRACKS.SVD not found!");
+    else {
+      vcd_debug ("found TRACKS.SVD signature at sector %lu",
+                 (unsigned long int) p_statbuf->lsn);
 
-    statbuf = iso9660_fs_stat (p_obj->img, "SVCD/TRACKS.SVD;1");
-    if (NULL != statbuf) {
-      lsn_t lsn = statbuf->lsn;
-      if (statbuf->size != ISO_BLOCKSIZE)
+      if (p_statbuf->size != ISO_BLOCKSIZE)
         vcd_warn ("TRACKS.SVD filesize != %d!", ISO_BLOCKSIZE);
 
       p_obj->tracks_buf = calloc(1, ISO_BLOCKSIZE);
 
-      free(statbuf);
-      if (cdio_read_mode2_sector (p_obj->img, p_obj->tracks_buf, lsn, false))
+      if (cdio_read_mode2_sector (p_cdio, p_obj->tracks_buf, p_statbuf->lsn,
+                                  false)) {
+        _cdio_list_free (p_svcdlist, true, NULL);
         goto err_return;
+      }
     }
-  }
 
-  _init_segments (p_obj);
+    p_statbuf = _find_dir_entry (p_svcdlist, "SEARCH.DAT");
+    if (NULL == p_statbuf)
+      vcd_warn ("mandatory /SVCD/SEARCH.DAT not found!");
+    else {
+      vcd_debug ("found SEARCH.DAT at sector %lu",
+                 (unsigned long int) p_statbuf->lsn);
+      _set_extent (&p_obj->search_ext, p_statbuf);
+    }
 
-  switch (p_obj->vcd_type) {
-  case VCD_TYPE_VCD2: {
-    /* FIXME: Can reduce CD reads by using
-       iso9660_fs_readdir(img, "EXT", true) and then scanning for
-       the files listed below.
-    */
-    statbuf = iso9660_fs_stat (p_cdio, "EXT/PSD_X.VCD;1");
-    if (NULL != statbuf) {
-      lsn_t lsn        = statbuf->lsn;
-      uint32_t secsize = statbuf->secsize;
+    if (p_svcdlist)
+      _cdio_list_free (p_svcdlist, true, NULL);
+  }
+
+  _init_segments (p_obj, _find_dir_entry (p_rootlist, "SEGMENT") != NULL);
 
-      p_obj->psd_x       = calloc(1, ISO_BLOCKSIZE * secsize);
-      p_obj->psd_x_size  = statbuf->size;
+  if (VCD_TYPE_VCD2 == p_obj->vcd_type) {
+    const iso9660_stat_t *p_statbuf;
 
+    p_statbuf = _find_dir_entry (p_extlist, "PSD_X.VCD");
+    if (NULL != p_statbuf) {
       vcd_debug ("found /EXT/PSD_X.VCD at sector %lu",
-                 (long unsigned int) lsn);
+                 (long unsigned int) p_statbuf->lsn);
 
-      free(statbuf);
-      if (cdio_read_mode2_sectors (p_cdio, p_obj->psd_x, lsn, false, secsize))
-        goto err_return;
+      _set_extent (&p_obj->psd_x_ext, p_statbuf);
+      p_obj->psd_x_size = p_statbuf->size;
     }
 
-    statbuf = iso9660_fs_stat (p_cdio, "EXT/LOT_X.VCD;1");
-    if (NULL != statbuf) {
-      lsn_t lsn        = statbuf->lsn;
-      uint32_t secsize = statbuf->secsize;
-      p_obj->lot_x       = calloc(1, ISO_BLOCKSIZE * secsize);
-
+    p_statbuf = _find_dir_entry (p_extlist, "LOT_X.VCD");
+    if (NULL != p_statbuf) {
       vcd_debug ("found /EXT/LOT_X.VCD at sector %lu",
-                 (unsigned long int) lsn);
+                 (unsigned long int) p_statbuf->lsn);
 
-      if (statbuf->size != LOT_VCD_SIZE * ISO_BLOCKSIZE)
+      if (p_statbuf->size != LOT_VCD_SIZE * ISO_BLOCKSIZE)
         vcd_warn ("LOT_X.VCD size != 65535");
 
-      free(statbuf);
-      if (cdio_read_mode2_sectors (p_cdio, p_obj->lot_x, lsn, false, secsize))
-        goto err_return;
-
+      _set_extent (&p_obj->lot_x_ext, p_statbuf);
     }
-    break;
   }
-  case VCD_TYPE_SVCD:
-  case VCD_TYPE_HQVCD: {
-    /* FIXME: Can reduce CD reads by using
-       iso9660_fs_readdir(p_cdio, "SVCD", true) and then scanning for
-       the files listed below.
-    */
-    statbuf = iso9660_fs_stat (p_cdio, "MPEGAV");
-    if (NULL != statbuf) {
-      vcd_warn ("non compliant /MPEGAV folder detected!");
-      free(statbuf);
-    }
-
-    statbuf = iso9660_fs_stat (p_cdio, "SVCD/TRACKS.SVD;1");
-    if (NULL == statbuf)
-      vcd_warn ("mandatory /SVCD/TRACKS.SVD not found!");
-    else {
-      vcd_debug ("found TRACKS.SVD signature at sector %lu",
-                 (unsigned long int) statbuf->lsn);
-      free(statbuf);
-    }
-
-    statbuf = iso9660_fs_stat (p_cdio, "SVCD/SEARCH.DAT;1");
-    if (NULL == statbuf)
-      vcd_warn ("mandatory /SVCD/SEARCH.DAT not found!");
-    else {
-      lsn_t    lsn       = statbuf->lsn;
-      uint32_t secsize   = statbuf->secsize;
-      uint32_t stat_size = statbuf->size;
-      uint32_t size;
-
-      vcd_debug ("found SEARCH.DAT at sector %lu", (unsigned long int) lsn);
-
-      p_obj->search_buf = calloc(1, ISO_BLOCKSIZE * secsize);
-
-      if (cdio_read_mode2_sectors (p_cdio, p_obj->search_buf, lsn, false, secsize))
-        goto err_return;
-
-      size = (3 * uint16_from_be (((SearchDat_t *)p_obj->search_buf)->scan_points))
-        + sizeof (SearchDat_t);
-
-      free(statbuf);
-      if (size > stat_size) {
-        vcd_warn ("number of scanpoints leads to bigger size than "
-                  "file size of SEARCH.DAT! -- rereading");
 
-        free (p_obj->search_buf);
-        p_obj->search_buf = calloc(1, ISO_BLOCKSIZE
-                                       * _vcd_len2blocks(size, ISO_BLOCKSIZE));
-
-        if (cdio_read_mode2_sectors (p_cdio, p_obj->search_buf, lsn, false,
-                                     secsize))
-          goto err_return;
-      }
-    }
-    break;
+  {
+    const iso9660_stat_t *p_statbuf = _find_dir_entry (p_extlist,
+                                                       "SCANDATA.DAT");
+    if (NULL != p_statbuf) {
+      vcd_debug ("found /EXT/SCANDATA.DAT at sector %u",
+                 (unsigned int) p_statbuf->lsn);
+      _set_extent (&p_obj->scandata_ext, p_statbuf);
     }
-  default:
-    ;
   }
 
-  statbuf = iso9660_fs_stat (p_cdio, "EXT/SCANDATA.DAT;1");
-  if (statbuf != NULL) {
-    lsn_t    lsn       = statbuf->lsn;
-    uint32_t secsize   = statbuf->secsize;
-
-    vcd_debug ("found /EXT/SCANDATA.DAT at sector %u", (unsigned int) lsn);
+  if (p_extlist)
+    _cdio_list_free (p_extlist, true, NULL);
+  if (p_rootlist)
+    _cdio_list_free (p_rootlist, true, NULL);
+  p_extlist = p_rootlist = NULL;
 
-    p_obj->scandata_buf = calloc(1, ISO_BLOCKSIZE * secsize);
-
-    free(statbuf);
-    if (cdio_read_mode2_sectors (p_cdio, p_obj->scandata_buf, lsn, false,
-                                 secsize))
-      return VCDINFO_OPEN_ERROR;
-  }
+  /* the extended PSD and LOT are handed out through const accessors,
+     so they are read now even when opening lazily */
+  if (!_vcdinfo_load (p_obj, b_lazy ? _LOAD_PBC_X : _LOAD_ALL))
+    goto err_return;
 
   return VCDINFO_OPEN_VCD;
 
@@ -2061,6 +2358,10 @@ vcdinfo_open(vcdinfo_obj_t **pp_obj, char *source_name[],
   return VCDINFO_OPEN_OTHER;
 
  err_return:
+  if (p_extlist)
+    _cdio_list_free (p_extlist, true, NULL);
+  if (p_rootlist)
+    _cdio_list_free (p_rootlist, true, NULL);
   if (free_source_name && *source_name) free(*source_name);
   vcdinfo_close(p_obj);
   return VCDINFO_OPEN_ERROR;
@@ -2068,6 +2369,61 @@ vcdinfo_open(vcdinfo_obj_t **pp_obj, char *source_name[],
 
 }
 
+/*!
+   Set up vcdinfo structure "p_obj" for reading from a particular
+   medium. This should be done before after initialization but before
+   any routines that need to retrieve data.
+
+   source_name is the device or file to use for inspection, and
+   source_type indicates what driver to use or class of drivers in the
+   case of DRIVER_DEVICE.
+   access_mode gives the CD access method for reading should the driver
+   allow for more than one kind of access method (e.g. MMC versus ioctl
+   on GNU/Linux)
+
+   If source_name is NULL we'll fill in the appropriate default device
+   name for the given source_type. However if in addtion source_type is
+   DRIVER_UNKNOWN, then we'll scan for a drive containing a VCD.
+
+   VCDINFO_OPEN_VCD is returned if everything went okay;
+   VCDINFO_OPEN_ERROR if there was an error and VCDINFO_OPEN_OTHER if the
+   medium is something other than a VCD.
+
+   Only if VCDINFO_OPEN_VCD is returned, the caller needs free the
+   vcdinfo_obj_t.
+ */
+vcdinfo_open_return_t
+vcdinfo_open(vcdinfo_obj_t **pp_obj, char *source_name[],
+             driver_id_t source_type, const char access_mode[])
+{
+  return _vcdinfo_open (pp_obj, source_name, source_type, access_mode,
+                        false);
+}
+
+/*!
+   Like vcdinfo_open, but SEARCH.DAT and SCANDATA.DAT are only read
+   when first asked for.  Opening many images just to look at INFO.VCD
+   and ENTRIES.VCD is much faster this way.  The object may be shared
+   by several threads reading it.
+*/
+vcdinfo_open_return_t
+vcdinfo_open_lazy(vcdinfo_obj_t **pp_obj, char *source_name[],
+                  driver_id_t source_type, const char access_mode[])
+{
+  return _vcdinfo_open (pp_obj, source_name, source_type, access_mode,
+                        true);
+}
+
+void
+vcdinfo_set_log_handler(vcdinfo_obj_t *p_obj, vcd_log_handler2_t handler,
+                        void *p_user_data)
+{
+  vcd_assert (p_obj != NULL);
+
+  p_obj->log_handler = handler;
+  p_obj->log_user_data = handler ? p_user_data : NULL;
+}
+
 /*!
  Dispose of any resources associated with vcdinfo structure "p_obj".
  Call this when "p_obj" it isn't needed anymore.
@@ -2082,6 +2438,8 @@ vcdinfo_close(vcdinfo_obj_t *p_obj)
       _cdio_list_free(p_obj->offset_list, true, NULL);
     if (p_obj->offset_x_list != NULL)
       _cdio_list_free(p_obj->offset_x_list, true, NULL);
+    _free_offset_index(&p_obj->offset_idx);
+    _free_offset_index(&p_obj->offset_x_idx);
     CDIO_FREE_IF_NOT_NULL(p_obj->seg_sizes);
     CDIO_FREE_IF_NOT_NULL(p_obj->lot);
     CDIO_FREE_IF_NOT_NULL(p_obj->lot_x);
@@ -2093,6 +2451,10 @@ vcdinfo_close(vcdinfo_obj_t *p_obj)
     CDIO_FREE_IF_NOT_NULL(p_obj->source_name);
 
     if (p_obj->img != NULL) cdio_destroy (p_obj->img);
+#ifdef HAVE_PTHREAD_H
+    if (p_obj->load_lock_init)
+      pthread_mutex_destroy (&p_obj->load_lock);
+#endif
     _vcdinfo_zero(p_obj);
   }
 
@@ -74,41 +74,21 @@ vcdinf_update_offset_list(struct _vcdinf_pbc_ctx *obj, bool extended)
   if (NULL==obj) return;
   {
     CdioListNode_t *node;
-    CdioList_t *unused_lids = _cdio_list_new();
-    CdioListNode_t *next_unused_node = _cdio_list_begin(unused_lids);
-
-    unsigned int last_lid=0;
     CdioList_t *offset_list = extended ? obj->offset_x_list : obj->offset_list;
 
     lid_t max_seen_lid=0;
 
+    /* The list is sorted by LID with the unassigned entries last, so
+       these are numbered on from the highest LID in use. Gaps in the
+       numbering are left alone. */
     _CDIO_LIST_FOREACH (node, offset_list)
       {
         vcdinfo_offset_t *ofs = _cdio_list_node_data (node);
-        if (!ofs->lid) {
-          /* We have a customer! Assign a LID from the free pool
-             or take one from the end if no skipped LIDs.
-          */
-          CdioListNode_t *node=_cdio_list_node_next(next_unused_node);
-          if (node != NULL) {
-            lid_t *next_unused_lid=_cdio_list_node_data(node);
-            ofs->lid = *next_unused_lid;
-            next_unused_node=node;
-          } else {
-            max_seen_lid++;
-            ofs->lid = max_seen_lid;
-          }
-        } else {
-          /* See if we've skipped any LID numbers. */
-          while (last_lid != ofs->lid ) {
-            lid_t * lid=calloc(1, sizeof(lid_t));
-            *lid = last_lid++;
-            _cdio_list_append(unused_lids, lid);
-          }
-          if (last_lid > max_seen_lid) max_seen_lid=last_lid;
-        }
+        if (!ofs->lid)
+          ofs->lid = ++max_seen_lid;
+        else if (ofs->lid > max_seen_lid)
+          max_seen_lid = ofs->lid;
       }
-    _cdio_list_free(unused_lids, true, NULL);
   }
 }
 
@@ -153,7 +133,6 @@ bool
 vcdinf_visit_pbc (struct _vcdinf_pbc_ctx *obj, lid_t lid, unsigned int offset,
                   bool in_lot)
 {
-  CdioListNode_t *node;
   vcdinfo_offset_t *ofs;
   unsigned int psd_size  = obj->extended ? obj->psd_x_size : obj->psd_size;
   const uint8_t *psd = obj->extended ? obj->psd_x : obj->psd;
@@ -195,27 +174,31 @@ vcdinf_visit_pbc (struct _vcdinf_pbc_ctx *obj, lid_t lid, unsigned int offset,
   } else
     offset_list = obj->offset_list;
 
-  _CDIO_LIST_FOREACH (node, offset_list)
+  if (!obj->offset_index)
     {
-      ofs = _cdio_list_node_data (node);
+      obj->offset_index_size = psd_size / obj->offset_mult + 1;
+      obj->offset_index = calloc (obj->offset_index_size,
+                                  sizeof (vcdinfo_offset_t *));
+    }
 
-      if (offset == ofs->offset)
-        {
-          if (in_lot)
-            ofs->in_lot = true;
+  vcd_assert (offset < obj->offset_index_size);
 
-          if (lid) {
-            /* Our caller thinks she knows what our LID is.
-               This should help out getting the LID for end descriptors
-               if not other things as well.
-             */
-            ofs->lid = lid;
-          }
+  if ((ofs = obj->offset_index[offset]) != NULL)
+    {
+      if (in_lot)
+        ofs->in_lot = true;
+
+      if (lid) {
+        /* Our caller thinks she knows what our LID is.
+           This should help out getting the LID for end descriptors
+           if not other things as well.
+         */
+        ofs->lid = lid;
+      }
 
-          ofs->ext = obj->extended;
+      ofs->ext = obj->extended;
 
-          return true; /* already been there... */
-        }
+      return true; /* already been there... */
     }
 
   ofs = calloc(1, sizeof (vcdinfo_offset_t));
@@ -230,6 +213,7 @@ vcdinf_visit_pbc (struct _vcdinf_pbc_ctx *obj, lid_t lid, unsigned int offset,
     {
     case PSD_TYPE_PLAY_LIST:
       _cdio_list_append (offset_list, ofs);
+      obj->offset_index[offset] = ofs;
       {
         const PsdPlayListDescriptor_t *d = (const void *) (psd + _rofs);
         const lid_t lid = vcdinf_pld_get_lid(d);
@@ -251,6 +235,7 @@ vcdinf_visit_pbc (struct _vcdinf_pbc_ctx *obj, lid_t lid, unsigned int offset,
     case PSD_TYPE_EXT_SELECTION_LIST:
     case PSD_TYPE_SELECTION_LIST:
       _cdio_list_append (offset_list, ofs);
+      obj->offset_index[offset] = ofs;
       {
         const PsdSelectionListDescriptor_t *d =
           (const void *) (psd + _rofs);
@@ -281,6 +266,7 @@ vcdinf_visit_pbc (struct _vcdinf_pbc_ctx *obj, lid_t lid, unsigned int offset,
 
     case PSD_TYPE_END_LIST:
       _cdio_list_append (offset_list, ofs);
+      obj->offset_index[offset] = ofs;
       break;
 
     default:
@@ -34,15 +34,44 @@
 
 #include <cdio/cdio.h>
 
+#ifdef HAVE_PTHREAD_H
+# include <pthread.h>
+#endif
+
 #include <cdio/ds.h>
 #include <cdio/iso9660.h>
 #include <libvcd/types.h>
 #include <libvcd/files_private.h>
+#include <libvcd/info.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
+  /*! Location of one of the files vcdinfo_open reads. */
+  typedef struct {
+    lsn_t    lsn;
+    uint32_t secsize;   /* size in sectors */
+    uint32_t size;      /* size in bytes */
+    bool     pending;   /* found, but not read yet */
+  } vcdinfo_extent_t;
+
+  /* Direct lookups into offset_list or offset_x_list, built along with
+     them by vcdinfo_visit_lot (). */
+  typedef struct {
+    vcdinfo_offset_t **by_offset;  /* indexed by vcdinfo_offset_t.offset */
+    unsigned int offset_count;
+    vcdinfo_offset_t **by_lid;     /* by the LID in the descriptor */
+    unsigned int lid_count;
+
+    /* what a failed search through the list used to leave in a
+       PsdListDescriptor_t: the last entry and the last play and
+       selection lists; NULL if there was none */
+    vcdinfo_offset_t *last;
+    vcdinfo_offset_t *last_pld;
+    vcdinfo_offset_t *last_psd;
+  } vcdinfo_offset_index_t;
+
   struct _VcdInfo {
     vcd_type_t vcd_type;
 
@@ -55,6 +84,8 @@ extern "C" {
 
     CdioList_t *offset_list;
     CdioList_t *offset_x_list;
+    vcdinfo_offset_index_t offset_idx;
+    vcdinfo_offset_index_t offset_x_idx;
     uint32_t *seg_sizes;
     lsn_t   first_segment_lsn;
 
@@ -71,8 +102,26 @@ extern "C" {
     void *search_buf;
     void *scandata_buf;
 
+    /* where the buffers above come from; with vcdinfo_open_lazy
+       SEARCH.DAT and SCANDATA.DAT are only read on first access */
+    vcdinfo_extent_t psd_x_ext;
+    vcdinfo_extent_t lot_x_ext;
+    vcdinfo_extent_t search_ext;
+    vcdinfo_extent_t scandata_ext;
+
     char *source_name; /* VCD device or file currently open */
 
+    /* see vcdinfo_set_log_handler () */
+    vcd_log_handler2_t log_handler;
+    void *log_user_data;
+
+#ifdef HAVE_PTHREAD_H
+    /* held while reading the files left for later, so that threads
+       sharing the object read each of them once */
+    pthread_mutex_t load_lock;
+    bool load_lock_init;
+#endif
+
   };
 
   /*!  Return the starting MSF (minutes/secs/frames) for sequence
@@ -95,6 +144,11 @@ extern "C" {
     uint8_t *psd_x;
     unsigned int psd_x_size;
     bool extended;
+
+    /* entries of the list being built, by offset; lets
+       vcdinf_visit_pbc () find places it has been to in one step */
+    vcdinfo_offset_t **offset_index;
+    unsigned int offset_index_size;
   };
 
   /*!
@@ -24,12 +24,20 @@
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <string.h>
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_ATOMIC_BUILTINS)
+# define VCD_LOG_ASYNC 1
+# include <pthread.h>
+# include <time.h>
+#endif
 
 /* Public headers */
 #include <libvcd/logging.h>
 
 /* Private headers */
 #include "vcd_assert.h"
+#include "util.h"
 
 vcd_log_level_t vcd_loglevel_default = VCD_LOG_WARN;
 
@@ -40,6 +48,7 @@ default_vcd_log_handler (vcd_log_level_t level, const char message[])
     {
     case VCD_LOG_ERROR:
       if (level >= vcd_loglevel_default) {
+        fflush (stdout);
         fprintf (stderr, "**ERROR: %s\n", message);
         fflush (stderr);
         exit (EXIT_FAILURE);
@@ -53,6 +62,7 @@ default_vcd_log_handler (vcd_log_level_t level, const char message[])
     case VCD_LOG_WARN:
       if (level >= vcd_loglevel_default) {
         fprintf (stdout, "++ WARN: %s\n", message);
+        fflush (stdout);
       }
       break;
     case VCD_LOG_INFO:
@@ -62,6 +72,7 @@ default_vcd_log_handler (vcd_log_level_t level, const char message[])
       break;
     case VCD_LOG_ASSERT:
       if (level >= vcd_loglevel_default) {
+        fflush (stdout);
         fprintf (stderr, "!ASSERT: %s\n", message);
         fflush (stderr);
       }
@@ -71,8 +82,6 @@ default_vcd_log_handler (vcd_log_level_t level, const char message[])
       vcd_assert_not_reached ();
       break;
     }
-
-  fflush (stdout);
 }
 
 static vcd_log_handler_t _handler = default_vcd_log_handler;
@@ -87,11 +96,77 @@ vcd_log_set_handler (vcd_log_handler_t new_handler)
   return old_handler;
 }
 
+/* handler of the calling thread, if any; see _vcd_log_scope_enter () */
+static VCD_THREAD_LOCAL _vcd_log_scope_t _thread_handler = { NULL, NULL };
+
+void
+vcd_log_set_thread_handler (vcd_log_handler2_t new_handler,
+                            void *p_user_data)
+{
+  _thread_handler.handler = new_handler;
+  _thread_handler.p_user_data = new_handler ? p_user_data : NULL;
+}
+
+/* route messages of the calling thread to handler until the matching
+   _vcd_log_scope_leave (); does nothing if handler is NULL */
+void
+_vcd_log_scope_enter (_vcd_log_scope_t *p_saved,
+                      vcd_log_handler2_t handler, void *p_user_data)
+{
+  *p_saved = _thread_handler;
+
+  if (handler)
+    vcd_log_set_thread_handler (handler, p_user_data);
+}
+
+void
+_vcd_log_scope_leave (const _vcd_log_scope_t *p_saved)
+{
+  _thread_handler = *p_saved;
+}
+
+#ifdef VCD_LOG_ASYNC
+/* see vcd_log_async_start () */
+static bool _async_running = false;
+
+static void
+_async_log (vcd_log_level_t level, const char message[]);
+#endif
+
+/* see vcd_log_set_level () */
+static vcd_log_level_t _min_level = VCD_LOG_DEBUG;
+
+void
+vcd_log_set_level (vcd_log_level_t level)
+{
+  _min_level = level;
+}
+
+bool
+vcd_log_enabled (vcd_log_level_t level)
+{
+  if (level >= VCD_LOG_ASSERT)
+    return true;
+
+  if (level < _min_level)
+    return false;
+
+  /* the default handler would throw it away */
+  if (!_thread_handler.handler && _handler == default_vcd_log_handler
+      && level < vcd_loglevel_default)
+    return false;
+
+  return true;
+}
+
 static void
 vcd_logv (vcd_log_level_t level, const char format[], va_list args)
 {
-  char buf[1024] = { 0, };
-  static int in_recursion = 0;
+  char buf[1024];
+  static VCD_THREAD_LOCAL int in_recursion = 0;
+
+  if (!vcd_log_enabled (level))
+    return;
 
   if (in_recursion)
     vcd_assert_not_reached ();
@@ -100,7 +175,18 @@ vcd_logv (vcd_log_level_t level, const char format[], va_list args)
 
   vsnprintf(buf, sizeof(buf)-1, format, args);
 
-  _handler(level, buf);
+  /* a handler may leave by exit () or longjmp () on errors */
+  if (level == VCD_LOG_ERROR)
+    in_recursion = 0;
+
+  if (_thread_handler.handler)
+    _thread_handler.handler (level, buf, _thread_handler.p_user_data);
+#ifdef VCD_LOG_ASYNC
+  else if (_async_running)
+    _async_log (level, buf);
+#endif
+  else
+    _handler(level, buf);
 
   in_recursion = 0;
 }
@@ -124,6 +210,10 @@ vcd_ ## level (const char format[], ...) \
   va_end (args); \
 }
 
+/* the functions are there even if the header turns vcd_debug () into
+   nothing, so that programs built without VCD_NO_DEBUG_LOG still link */
+#undef vcd_debug
+
 VCD_LOG_TEMPLATE(debug, DEBUG)
 VCD_LOG_TEMPLATE(info, INFO)
 VCD_LOG_TEMPLATE(warn, WARN)
@@ -131,6 +221,226 @@ VCD_LOG_TEMPLATE(error, ERROR)
 
 #undef VCD_LOG_TEMPLATE
 
+/*
+ * asynchronous logging
+ */
+
+#ifdef VCD_LOG_ASYNC
+
+/* a bounded multi-producer, single-consumer queue; every slot carries
+   a sequence number telling whether it is free for the producer which
+   got position pos (seq == pos) or holds a message for the consumer
+   (seq == pos + 1) */
+
+typedef struct
+{
+  unsigned long seq;
+  vcd_log_level_t level;
+  char message[1024];
+} _log_slot_t;
+
+static struct
+{
+  _log_slot_t *slots;
+  unsigned long mask;
+
+  unsigned long enqueue_pos;   /* shared by the producers */
+  unsigned long dequeue_pos;   /* advanced by the consumer only */
+  unsigned long dropped;
+
+  pthread_t thread;
+  int stop;
+} _async;
+
+/* queues message, returning false if the queue is full; *p_pos is
+   set to the position it got */
+static bool
+_async_push (vcd_log_level_t level, const char message[],
+             unsigned long *p_pos)
+{
+  unsigned long pos = __atomic_load_n (&_async.enqueue_pos, __ATOMIC_RELAXED);
+
+  for (;;)
+    {
+      _log_slot_t *p_slot = &_async.slots[pos & _async.mask];
+      const unsigned long seq =
+        __atomic_load_n (&p_slot->seq, __ATOMIC_ACQUIRE);
+      const long diff = (long) (seq - pos);
+
+      if (diff == 0)
+        {
+          if (__atomic_compare_exchange_n (&_async.enqueue_pos, &pos, pos + 1,
+                                           true, __ATOMIC_RELAXED,
+                                           __ATOMIC_RELAXED))
+            {
+              p_slot->level = level;
+              strncpy (p_slot->message, message, sizeof (p_slot->message) - 1);
+              p_slot->message[sizeof (p_slot->message) - 1] = '\0';
+              __atomic_store_n (&p_slot->seq, pos + 1, __ATOMIC_RELEASE);
+              *p_pos = pos;
+              return true;
+            }
+          /* pos has been reloaded by the failed exchange */
+        }
+      else if (diff < 0)
+        return false;
+      else
+        pos = __atomic_load_n (&_async.enqueue_pos, __ATOMIC_RELAXED);
+    }
+}
+
+/* hands the queued messages to the process-wide handler, returns how
+   many there were */
+static unsigned
+_async_drain (void)
+{
+  unsigned count = 0;
+  unsigned long dropped;
+
+  for (;;)
+    {
+      const unsigned long pos = _async.dequeue_pos;
+      _log_slot_t *p_slot = &_async.slots[pos & _async.mask];
+
+      if (__atomic_load_n (&p_slot->seq, __ATOMIC_ACQUIRE) != pos + 1)
+        break;
+
+      _handler (p_slot->level, p_slot->message);
+
+      __atomic_store_n (&p_slot->seq, pos + _async.mask + 1,
+                        __ATOMIC_RELEASE);
+      __atomic_store_n (&_async.dequeue_pos, pos + 1, __ATOMIC_RELEASE);
+      count++;
+    }
+
+  dropped = __atomic_exchange_n (&_async.dropped, 0, __ATOMIC_RELAXED);
+  if (dropped)
+    {
+      char buf[80];
+
+      snprintf (buf, sizeof (buf),
+                "%lu log messages dropped, the queue was full", dropped);
+      _handler (VCD_LOG_WARN, buf);
+    }
+
+  return count;
+}
+
+static void
+_async_sleep (void)
+{
+  const struct timespec idle = { 0, 1000 * 1000 };
+
+  nanosleep (&idle, NULL);
+}
+
+static void *
+_async_thread (void *p_user_data)
+{
+  while (!__atomic_load_n (&_async.stop, __ATOMIC_ACQUIRE))
+    if (!_async_drain ())
+      _async_sleep ();
+
+  _async_drain ();
+
+  return NULL;
+}
+
+static void
+_async_log (vcd_log_level_t level, const char message[])
+{
+  unsigned long pos;
+
+  if (level < VCD_LOG_ERROR)
+    {
+      if (!_async_push (level, message, &pos))
+        __atomic_add_fetch (&_async.dropped, 1, __ATOMIC_RELAXED);
+      return;
+    }
+
+  /* a handler logging an error itself would wait for itself */
+  if (pthread_equal (pthread_self (), _async.thread))
+    {
+      _handler (level, message);
+      return;
+    }
+
+  /* errors and assertions may end the process; they must not get
+     lost, and the caller must not go on before they were handled */
+  while (!_async_push (level, message, &pos))
+    _async_sleep ();
+
+  while (__atomic_load_n (&_async.dequeue_pos, __ATOMIC_ACQUIRE) <= pos)
+    _async_sleep ();
+}
+
+int
+vcd_log_async_start (unsigned int i_slots)
+{
+  unsigned long n = 1, i;
+
+  if (_async_running)
+    return -1;
+
+  if (!i_slots)
+    i_slots = 256;
+
+  while (n < i_slots)
+    n <<= 1;
+
+  if (!(_async.slots = calloc (n, sizeof (_log_slot_t))))
+    return -1;
+
+  for (i = 0; i < n; i++)
+    _async.slots[i].seq = i;
+
+  _async.mask = n - 1;
+  _async.enqueue_pos = _async.dequeue_pos = 0;
+  _async.dropped = 0;
+  _async.stop = 0;
+
+  if (pthread_create (&_async.thread, NULL, _async_thread, NULL))
+    {
+      free (_async.slots);
+      _async.slots = NULL;
+      return -1;
+    }
+
+  _async_running = true;
+
+  return 0;
+}
+
+void
+vcd_log_async_stop (void)
+{
+  if (!_async_running)
+    return;
+
+  _async_running = false;
+
+  __atomic_store_n (&_async.stop, 1, __ATOMIC_RELEASE);
+  pthread_join (_async.thread, NULL);
+
+  free (_async.slots);
+  _async.slots = NULL;
+}
+
+#else /* !VCD_LOG_ASYNC */
+
+int
+vcd_log_async_start (unsigned int i_slots)
+{
+  return -1;
+}
+
+void
+vcd_log_async_stop (void)
+{
+}
+
+#endif /* !VCD_LOG_ASYNC */
+
 
 /*
  * Local variables:
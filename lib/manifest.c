@@ -0,0 +1,179 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+/* Public headers */
+#include <libvcd/types.h>
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "vcd_assert.h"
+#include "manifest.h"
+
+/* the file format is line based text:
+
+   # comment
+   image sectors=<n>
+   sequence <index> extent=<lsn> sectors=<n> key=<16 hex digits>
+*/
+
+#define VCD_MANIFEST_MAGIC "# GNU VCDImager image manifest"
+
+VcdManifest_t *
+_vcd_manifest_read (const char fname[])
+{
+  VcdManifest_t *p_manifest;
+  unsigned alloced = 0;
+  char line[256];
+  FILE *fd;
+
+  vcd_assert (fname != NULL);
+
+  if (!(fd = fopen (fname, "r")))
+    return NULL;
+
+  if (!fgets (line, sizeof (line), fd)
+      || strncmp (line, VCD_MANIFEST_MAGIC, strlen (VCD_MANIFEST_MAGIC)))
+    {
+      vcd_warn ("`%s' is not an image manifest", fname);
+      fclose (fd);
+      return NULL;
+    }
+
+  p_manifest = calloc (1, sizeof (VcdManifest_t));
+
+  while (fgets (line, sizeof (line), fd))
+    {
+      vcd_manifest_entry_t _entry;
+      unsigned long long _key;
+      unsigned _sectors;
+
+      if (line[0] == '#' || line[0] == '\n')
+        continue;
+
+      if (sscanf (line, "image sectors=%u", &_sectors) == 1)
+        {
+          p_manifest->sectors = _sectors;
+          continue;
+        }
+
+      if (sscanf (line, "sequence %u extent=%u sectors=%u key=%llx",
+                  &_entry.sequence, &_entry.extent, &_entry.sectors,
+                  &_key) != 4)
+        {
+          vcd_warn ("ignoring malformed line in manifest `%s': %s",
+                    fname, line);
+          continue;
+        }
+
+      _entry.key = _key;
+
+      if (p_manifest->count == alloced)
+        {
+          alloced = alloced ? alloced * 2 : 32;
+          p_manifest->entries =
+            realloc (p_manifest->entries,
+                     alloced * sizeof (vcd_manifest_entry_t));
+        }
+
+      p_manifest->entries[p_manifest->count++] = _entry;
+    }
+
+  fclose (fd);
+
+  return p_manifest;
+}
+
+int
+_vcd_manifest_write (const VcdManifest_t *p_manifest, const char fname[])
+{
+  unsigned n;
+  FILE *fd;
+
+  vcd_assert (p_manifest != NULL);
+  vcd_assert (fname != NULL);
+
+  if (!(fd = fopen (fname, "w")))
+    {
+      vcd_error ("could not write manifest `%s': %s", fname,
+                 strerror (errno));
+      return -1;
+    }
+
+  fprintf (fd, VCD_MANIFEST_MAGIC " -- do not edit\n");
+  fprintf (fd, "image sectors=%u\n", p_manifest->sectors);
+
+  for (n = 0; n < p_manifest->count; n++)
+    {
+      const vcd_manifest_entry_t *_entry = &p_manifest->entries[n];
+
+      fprintf (fd, "sequence %u extent=%u sectors=%u key=%016llx\n",
+               _entry->sequence, _entry->extent, _entry->sectors,
+               (unsigned long long) _entry->key);
+    }
+
+  if (fclose (fd))
+    {
+      vcd_error ("could not write manifest `%s': %s", fname,
+                 strerror (errno));
+      return -1;
+    }
+
+  return 0;
+}
+
+const vcd_manifest_entry_t *
+_vcd_manifest_find (const VcdManifest_t *p_manifest, uint64_t key)
+{
+  unsigned n;
+
+  vcd_assert (p_manifest != NULL);
+
+  for (n = 0; n < p_manifest->count; n++)
+    if (p_manifest->entries[n].key == key)
+      return &p_manifest->entries[n];
+
+  return NULL;
+}
+
+void
+_vcd_manifest_destroy (VcdManifest_t *p_manifest)
+{
+  if (!p_manifest)
+    return;
+
+  free (p_manifest->entries);
+  free (p_manifest);
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,64 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* image manifests, which record where in a written image each
+   sequence track ended up, together with a key over everything its
+   sectors were made from (see VCD_PARM_MANIFEST) */
+
+#ifndef __VCD_MANIFEST_H__
+#define __VCD_MANIFEST_H__
+
+#include <libvcd/types.h>
+
+typedef struct {
+  unsigned sequence;  /* index into the sequence list */
+  uint32_t extent;    /* first sector, pregap included */
+  uint32_t sectors;   /* pregap, margins and packets */
+  uint64_t key;
+} vcd_manifest_entry_t;
+
+typedef struct {
+  uint32_t sectors;   /* of the whole image */
+  unsigned count;
+  vcd_manifest_entry_t *entries;
+} VcdManifest_t;
+
+/* returns NULL if fname can't be read or isn't a manifest */
+VcdManifest_t *
+_vcd_manifest_read (const char fname[]);
+
+int
+_vcd_manifest_write (const VcdManifest_t *p_manifest, const char fname[]);
+
+/* entry with the given key, or NULL */
+const vcd_manifest_entry_t *
+_vcd_manifest_find (const VcdManifest_t *p_manifest, uint64_t key);
+
+void
+_vcd_manifest_destroy (VcdManifest_t *p_manifest);
+
+#endif /* __VCD_MANIFEST_H__ */
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,857 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <cdio/cdio.h>
+
+/* Public headers */
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "vcd_assert.h"
+#include "mpeg_mux.h"
+#include "mpeg_pack.h"
+#include "util.h"
+
+/* how it works: both elementary streams are indexed into access
+   units (pictures resp. audio frames) with their decoding and
+   presentation times, a bit ahead of what is being multiplexed. Each
+   pack carries the stream whose next byte is needed first, among
+   those whose STD buffer model has room for another packet. Bytes
+   leave the buffer when their access unit is decoded, at its DTS. If
+   no buffer has room, VCD, which is read at a constant rate, gets a
+   padding pack, while SVCD skips the SCR ahead to when one has.
+
+   The state of the multiplexer between two packs is just the SCR and
+   the number of bytes delivered from each stream, which the pack
+   source of mpeg_pack.c saves every so many packs, so that seeking
+   backwards only has to redo the packs from the checkpoint before. */
+
+#define MUX_PACK_SIZE    VCD_MPEG_PACK_SIZE
+#define MUX_INDEX_CHUNK  (256*1024)
+#define MUX_INDEX_AHEAD  16     /* bytes of a header beyond a chunk */
+
+#define MUX_NONE         ((uint32_t) -1)
+
+enum {
+  MUX_VIDEO = 0,
+  MUX_AUDIO = 1,
+  MUX_STREAMS
+};
+
+typedef struct {
+  uint32_t offset;     /* first byte; the headers before a picture
+                          belong to it */
+  uint32_t ts_offset;  /* picture start code resp. frame header */
+  int64_t pts;
+  int64_t dts;
+} _mux_au_t;
+
+typedef struct {
+  VcdDataSource_t *source;
+  uint8_t stream_id;
+  unsigned buffer_size;  /* of the STD, in bytes */
+  bool buffer_scale;     /* size given in units of 1024, not 128 bytes */
+
+  _mux_au_t *aus;
+  unsigned au_count;
+  unsigned au_alloced;
+
+  uint32_t indexed;      /* bytes looked at so far */
+  uint32_t length;       /* once eof */
+  bool eof;
+
+  /* video */
+  double frame_ticks;
+  unsigned pictures;
+  unsigned gop_base;     /* pictures before the last GOP header */
+  unsigned last_tref;
+  uint32_t group_start;  /* of the headers before the next picture */
+
+  /* audio */
+  unsigned frames;
+  bool sync_warned;
+
+  bool late_warned;
+} _mux_es_t;
+
+typedef struct {
+  uint32_t pack;         /* the one made next, first for mpeg_pack.c */
+  int64_t scr;           /* ...and its SCR */
+  uint32_t delivered[MUX_STREAMS];
+} _mux_state_t;
+
+typedef struct {
+  bool mpeg2;
+  bool vbr;              /* SCR may skip ahead instead of padding */
+  unsigned scr_step;     /* 90kHz ticks from one pack to the next,
+                            at least */
+  unsigned mux_rate;     /* in units of 50 bytes/s */
+  unsigned header_packs; /* system header packs at the start */
+  int64_t delay;         /* from the first SCR to the first PTS */
+
+  _mux_es_t es[MUX_STREAMS];
+  unsigned streams;
+
+  _mux_state_t state;
+  VcdMpegPacker_t packer;
+} _MuxData;
+
+static const double frame_rates[16] = {
+  0.0, 24000.0/1001, 24.0, 25.0,
+  30000.0/1001, 30.0, 50.0, 60000.0/1001,
+  60.0, 0.0,
+};
+
+/* access unit index */
+
+static void
+_append_au (_mux_es_t *es, uint32_t offset, uint32_t ts_offset,
+            int64_t pts, int64_t dts)
+{
+  _mux_au_t *p_au;
+
+  if (es->au_count == es->au_alloced)
+    {
+      es->au_alloced = es->au_alloced ? es->au_alloced * 2 : 1024;
+      es->aus = realloc (es->aus, es->au_alloced * sizeof (_mux_au_t));
+    }
+
+  p_au = &es->aus[es->au_count++];
+
+  p_au->offset = offset;
+  p_au->ts_offset = ts_offset;
+  p_au->pts = pts;
+  p_au->dts = dts;
+}
+
+static void
+_index_video (const _MuxData *md, _mux_es_t *es, const uint8_t *buf,
+              unsigned len, unsigned scan_len)
+{
+  unsigned n;
+
+  for (n = 0; n < scan_len && n + 4 <= len; n++)
+    {
+      const uint32_t pos = es->indexed + n;
+      unsigned tref;
+      int64_t pts, dts;
+
+      if (buf[n] || buf[n + 1] || buf[n + 2] != 1)
+        continue;
+
+      switch (buf[n + 3])
+        {
+        case 0xb3: /* sequence header */
+          if (n + 8 <= len)
+            {
+              const double frate = frame_rates[buf[n + 7] & 0xf];
+
+              if (frate == 0.0)
+                vcd_error ("mux: invalid frame rate in video sequence header");
+
+              es->frame_ticks = 90000.0 / frate;
+            }
+          /* fall through */
+
+        case 0xb8: /* GOP header */
+          if (buf[n + 3] == 0xb8)
+            es->gop_base = es->pictures;
+
+          if (es->group_start == MUX_NONE)
+            es->group_start = es->au_count ? pos : 0;
+          break;
+
+        case 0x00: /* picture */
+          if (n + 6 > len)
+            break;
+
+          if (es->frame_ticks == 0.0)
+            vcd_error ("mux: video elementary stream does not start with"
+                       " a sequence header");
+
+          tref = (buf[n + 4] << 2) | (buf[n + 5] >> 6);
+
+          /* the second field of a field picture pair has the
+             temporal reference of the first one */
+          if (es->group_start == MUX_NONE && es->au_count
+              && tref == es->last_tref)
+            break;
+
+          if (es->group_start == MUX_NONE)
+            es->group_start = es->au_count ? pos : 0;
+
+          /* decoding one picture period before presentation, unless
+             reordering delays the presentation by more */
+          pts = md->delay
+            + (int64_t) floor ((es->gop_base + tref) * es->frame_ticks + 0.5);
+          dts = md->delay
+            + (int64_t) floor (((double) es->pictures - 1) * es->frame_ticks
+                               + 0.5);
+          if (pts < dts)
+            pts = dts;
+
+          _append_au (es, es->group_start, pos, pts, dts);
+
+          es->group_start = MUX_NONE;
+          es->last_tref = tref;
+          es->pictures++;
+          n += 5;
+          break;
+
+        default:
+          break;
+        }
+    }
+}
+
+/* returns the length of the MPEG-1 audio frame with header buf, or 0
+   if it's not one */
+static unsigned
+_audio_frame (const uint8_t *buf, unsigned *p_samples, unsigned *p_sampfreq)
+{
+  static const unsigned bit_rates[4][16] = {
+    {0, },
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},
+    {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0},
+    {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0}
+  };
+  static const unsigned sampfreqs[4] = { 44100, 48000, 32000, 0 };
+
+  const unsigned layer_bits = (buf[1] >> 1) & 3; /* %11 is layer I */
+  const unsigned bitrate = bit_rates[layer_bits][buf[2] >> 4] * 1000;
+  const unsigned sampfreq = sampfreqs[(buf[2] >> 2) & 3];
+  const unsigned padding = (buf[2] >> 1) & 1;
+
+  if (buf[0] != 0xff || (buf[1] & 0xf8) != 0xf8 || !bitrate || !sampfreq)
+    return 0;
+
+  *p_sampfreq = sampfreq;
+
+  if (layer_bits == 3)
+    {
+      *p_samples = 384;
+      return (12 * bitrate / sampfreq + padding) * 4;
+    }
+
+  *p_samples = 1152;
+  return 144 * bitrate / sampfreq + padding;
+}
+
+/* audio is indexed frame by frame; es->indexed is where the next
+   frame header is expected */
+static void
+_index_audio (const _MuxData *md, _mux_es_t *es, const uint8_t *buf,
+              unsigned len)
+{
+  unsigned n = 0;
+
+  while (n + 4 <= len)
+    {
+      unsigned samples, sampfreq;
+      const unsigned frame_len = _audio_frame (buf + n, &samples, &sampfreq);
+
+      if (!frame_len)
+        {
+          if (!es->sync_warned)
+            vcd_warn ("mux: lost audio frame sync at byte %u"
+                      " -- skipping to the next frame header",
+                      (unsigned) (es->indexed + n));
+          es->sync_warned = true;
+          n++;
+          continue;
+        }
+
+      _append_au (es, es->indexed + n, es->indexed + n,
+                  md->delay + (int64_t) floor ((double) es->frames * samples
+                                               * 90000 / sampfreq + 0.5),
+                  0);
+      es->aus[es->au_count - 1].dts = es->aus[es->au_count - 1].pts;
+      es->frames++;
+
+      n += frame_len;
+    }
+
+  es->indexed += n;
+}
+
+static void
+_index_more (const _MuxData *md, _mux_es_t *es)
+{
+  uint8_t *buf = malloc (MUX_INDEX_CHUNK + MUX_INDEX_AHEAD);
+  const unsigned want = MUX_INDEX_CHUNK + MUX_INDEX_AHEAD;
+  unsigned got;
+
+  vcd_assert (!es->eof);
+
+  vcd_data_source_seek (es->source, es->indexed);
+  got = vcd_data_source_read (es->source, buf, 1, want);
+
+  if (got < want)
+    {
+      es->eof = true;
+      es->length = es->indexed + got;
+    }
+
+  if (es->stream_id == 0xe0)
+    {
+      const unsigned scan_len = es->eof ? got : MUX_INDEX_CHUNK;
+
+      _index_video (md, es, buf, got, scan_len);
+      es->indexed += scan_len;
+
+      if (es->eof && !es->au_count)
+        vcd_error ("mux: no pictures found in video elementary stream");
+    }
+  else
+    {
+      _index_audio (md, es, buf, got);
+
+      if (es->eof)
+        {
+          es->indexed = es->length;
+
+          if (!es->au_count)
+            vcd_error ("mux: no frames found in audio elementary stream");
+        }
+    }
+
+  free (buf);
+}
+
+/* indexes until the access unit containing byte pos is complete */
+static void
+_index_past (const _MuxData *md, _mux_es_t *es, uint32_t pos)
+{
+  while (!es->eof
+         && (!es->au_count || es->aus[es->au_count - 1].offset <= pos))
+    _index_more (md, es);
+}
+
+/* indexes until an access unit decoded after t is known */
+static void
+_index_past_dts (const _MuxData *md, _mux_es_t *es, int64_t t)
+{
+  while (!es->eof
+         && (!es->au_count || es->aus[es->au_count - 1].dts <= t))
+    _index_more (md, es);
+}
+
+/* the access unit containing byte pos */
+static unsigned
+_au_at (const _mux_es_t *es, uint32_t pos)
+{
+  unsigned lo = 0, hi = es->au_count;
+
+  while (hi - lo > 1)
+    {
+      const unsigned mid = (lo + hi) / 2;
+
+      if (es->aus[mid].offset <= pos)
+        lo = mid;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+/* the first access unit with time stamps for a byte at pos or
+   later, MUX_NONE if there's none */
+static uint32_t
+_au_stamped_from (const _mux_es_t *es, uint32_t pos)
+{
+  unsigned lo = 0, hi = es->au_count;
+
+  while (lo < hi)
+    {
+      const unsigned mid = (lo + hi) / 2;
+
+      if (es->aus[mid].ts_offset < pos)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo < es->au_count ? lo : MUX_NONE;
+}
+
+/* bytes which have left the STD buffer by time t */
+static uint32_t
+_removed (const _MuxData *md, _mux_es_t *es, int64_t t)
+{
+  unsigned lo = 0, hi;
+
+  _index_past_dts (md, es, t);
+
+  hi = es->au_count;
+
+  while (lo < hi)
+    {
+      const unsigned mid = (lo + hi) / 2;
+
+      if (es->aus[mid].dts <= t)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo < es->au_count ? es->aus[lo].offset : es->length;
+}
+
+static bool
+_es_done (const _mux_es_t *es, uint32_t delivered)
+{
+  return es->eof && delivered >= es->length;
+}
+
+/* pack writing */
+
+/* system header describing stream s, or all of them for s < 0 */
+static unsigned
+_put_system_header (const _MuxData *md, uint8_t *p, int s)
+{
+  const unsigned rate = md->mux_rate;
+  const bool _audio = s < 0 ? md->streams > MUX_AUDIO : s == MUX_AUDIO;
+  const bool _video = s < 0 || s == MUX_VIDEO;
+  unsigned len = 12;
+  unsigned n;
+
+  p[0] = p[1] = 0x00;
+  p[2] = 0x01;
+  p[3] = 0xbb;
+
+  p[6] = 0x80 | (rate >> 15);
+  p[7] = (rate >> 7) & 0xff;
+  p[8] = ((rate & 0x7f) << 1) | 1;
+  p[9] = ((_audio ? 1 : 0) << 2) | (md->mpeg2 ? 0 : 1); /* CSPS_flag */
+  p[10] = 0xe0 | (_video ? 1 : 0); /* locked to the system clock */
+  p[11] = md->mpeg2 ? 0x7f : 0xff;
+
+  for (n = 0; n < md->streams; n++)
+    {
+      const _mux_es_t *es = &md->es[n];
+      const unsigned size =
+        es->buffer_size / (es->buffer_scale ? 1024 : 128);
+
+      if (s >= 0 && n != (unsigned) s)
+        continue;
+
+      p[len++] = es->stream_id;
+      p[len++] = 0xc0 | (es->buffer_scale ? 0x20 : 0) | (size >> 8);
+      p[len++] = size & 0xff;
+    }
+
+  p[4] = (len - 6) >> 8;
+  p[5] = (len - 6) & 0xff;
+
+  return len;
+}
+
+static unsigned
+_put_pes_header (const _MuxData *md, uint8_t *p, const _mux_es_t *es,
+                 unsigned payload, unsigned stuff, bool std,
+                 unsigned stamps, const _mux_au_t *p_au)
+{
+  const unsigned len =
+    _vcd_mpeg_pes_header_len (md->mpeg2, stuff, std, stamps);
+  const unsigned size = es->buffer_size / (es->buffer_scale ? 1024 : 128);
+  unsigned pos = 6;
+
+  p[0] = p[1] = 0x00;
+  p[2] = 0x01;
+  p[3] = es->stream_id;
+  p[4] = (len - 6 + payload) >> 8;
+  p[5] = (len - 6 + payload) & 0xff;
+
+  if (!md->mpeg2)
+    {
+      memset (p + pos, 0xff, stuff);
+      pos += stuff;
+
+      if (std)
+        {
+          p[pos++] = 0x40 | (es->buffer_scale ? 0x20 : 0) | (size >> 8);
+          p[pos++] = size & 0xff;
+        }
+
+      switch (stamps)
+        {
+        case 0:
+          p[pos++] = 0x0f;
+          break;
+        case 1:
+          _vcd_mpeg_put_timecode (p + pos, 0x2, p_au->pts);
+          pos += 5;
+          break;
+        case 2:
+          _vcd_mpeg_put_timecode (p + pos, 0x3, p_au->pts);
+          _vcd_mpeg_put_timecode (p + pos + 5, 0x1, p_au->dts);
+          pos += 10;
+          break;
+        }
+    }
+  else
+    {
+      p[pos++] = 0x81; /* original */
+      p[pos++] = (stamps ? (stamps == 1 ? 0x80 : 0xc0) : 0) | (std ? 1 : 0);
+      p[pos++] = len - 9;
+
+      switch (stamps)
+        {
+        case 1:
+          _vcd_mpeg_put_timecode (p + pos, 0x2, p_au->pts);
+          pos += 5;
+          break;
+        case 2:
+          _vcd_mpeg_put_timecode (p + pos, 0x3, p_au->pts);
+          _vcd_mpeg_put_timecode (p + pos + 5, 0x1, p_au->dts);
+          pos += 10;
+          break;
+        }
+
+      if (std)
+        {
+          p[pos++] = 0x1e; /* just the P-STD buffer */
+          p[pos++] = 0x40 | (es->buffer_scale ? 0x20 : 0) | (size >> 8);
+          p[pos++] = size & 0xff;
+        }
+
+      memset (p + pos, 0xff, stuff);
+      pos += stuff;
+    }
+
+  vcd_assert (pos == len);
+
+  return len;
+}
+
+/* the packet of stream s in the pack at time scr, starting at p with
+   room bytes left in the pack */
+static void
+_put_packet (_MuxData *md, unsigned s, uint8_t *p, unsigned room,
+             int64_t scr)
+{
+  _mux_es_t *es = &md->es[s];
+  const uint32_t delivered = md->state.delivered[s];
+  const bool std = !delivered;
+  const _mux_au_t *p_au = NULL;
+  unsigned stamps = 0;
+  unsigned payload, hlen, stuff = 0;
+  uint32_t avail;
+  uint32_t idx;
+
+  _index_past (md, es, delivered + room);
+
+  avail = es->eof ? es->length - delivered : room;
+
+  /* time stamps go with the first access unit starting in the
+     packet -- if it still starts in it with them in the header */
+  idx = _au_stamped_from (es, delivered);
+
+  if (idx != MUX_NONE)
+    {
+      const _mux_au_t *p_next = &es->aus[idx];
+      const unsigned _stamps = p_next->pts != p_next->dts ? 2 : 1;
+      const unsigned _room =
+        room - _vcd_mpeg_pes_header_len (md->mpeg2, 0, std, _stamps);
+
+      if (p_next->ts_offset < delivered + MIN (_room, avail))
+        {
+          p_au = p_next;
+          stamps = _stamps;
+        }
+    }
+
+  hlen = _vcd_mpeg_pes_header_len (md->mpeg2, 0, std, stamps);
+  payload = MIN (room - hlen, avail);
+
+  /* what's left over is padding -- or header stuffing, if too
+     little for a padding packet */
+  if (room - hlen - payload < 6)
+    stuff = room - hlen - payload;
+
+  hlen = _put_pes_header (md, p, es, payload, stuff, std, stamps, p_au);
+
+  vcd_data_source_seek (es->source, delivered);
+  if (vcd_data_source_read (es->source, p + hlen, 1, payload) != payload)
+    vcd_error ("mux: short read from elementary stream");
+
+  if (room - hlen - payload)
+    _vcd_mpeg_put_padding (p + hlen + payload, room - hlen - payload);
+
+  md->state.delivered[s] += payload;
+
+  /* all of an access unit has to be there when it's decoded */
+  if (!es->late_warned
+      && es->aus[_au_at (es, delivered + payload - 1)].dts
+      < scr + md->scr_step)
+    {
+      vcd_warn ("mux: %s stream data arrives after its decoding time"
+                " (%.2f s) -- bitrate too high for this VCD type?",
+                s == MUX_VIDEO ? "video" : "audio",
+                (double) scr / 90000);
+      es->late_warned = true;
+    }
+}
+
+/* the stream to send from in a pack at time scr, with room bytes
+   for the packet; -1 if all buffers are too full, then *p_t_room is
+   when one of them has room again, or MUX_STREAMS once all is sent */
+static int
+_pick_stream (_MuxData *md, unsigned room, int64_t scr, int64_t *p_t_room)
+{
+  int64_t best_dts = 0;
+  int best = MUX_STREAMS;
+  bool _blocked = false;
+  unsigned s;
+
+  for (s = 0; s < md->streams; s++)
+    {
+      _mux_es_t *es = &md->es[s];
+      const uint32_t delivered = md->state.delivered[s];
+      uint32_t bytes, removed;
+      int64_t dts;
+
+      _index_past (md, es, delivered);
+
+      if (_es_done (es, delivered))
+        continue;
+
+      if (best == MUX_STREAMS)
+        best = -1;
+
+      bytes = room - _vcd_mpeg_pes_header_len (md->mpeg2, 0, !delivered, 0);
+      if (es->eof)
+        bytes = MIN (bytes, es->length - delivered);
+
+      removed = _removed (md, es, scr);
+
+      /* (late data, already due, doesn't wait for room) */
+      if (delivered > removed
+          && delivered - removed + bytes > es->buffer_size)
+        {
+          /* when the access unit leaving the buffer next is decoded */
+          const int64_t t = es->aus[_au_at (es, removed)].dts;
+
+          if (!_blocked || t < *p_t_room)
+            *p_t_room = t;
+          _blocked = true;
+
+          continue;
+        }
+
+      dts = es->aus[_au_at (es, delivered)].dts;
+
+      if (best < 0 || dts < best_dts)
+        {
+          best = s;
+          best_dts = dts;
+        }
+    }
+
+  return best;
+}
+
+/* makes the next pack, returns false after the last one */
+static bool
+_make_pack (void *user_data, uint8_t *pack)
+{
+  _MuxData *const md = user_data;
+  const unsigned pos = md->mpeg2 ? 14 : 12;
+  int64_t t_room = 0;
+  int best;
+
+  if (md->state.pack < md->header_packs)
+    {
+      /* (S)VCD players want the system header(s) in packs of their
+         own; VCD has one per stream */
+      unsigned len = _vcd_mpeg_put_pack_header (pack, md->mpeg2,
+                                                md->mux_rate,
+                                                md->state.scr);
+
+      len += _put_system_header (md, pack + len,
+                                 md->header_packs > 1
+                                 ? (int) md->state.pack : -1);
+      _vcd_mpeg_put_padding (pack + len, MUX_PACK_SIZE - len);
+    }
+  else
+    {
+      while ((best = _pick_stream (md, MUX_PACK_SIZE - pos, md->state.scr,
+                                   &t_room)) < 0
+             && md->vbr)
+        /* at a variable rate, time is better skipped than padded */
+        md->state.scr = t_room;
+
+      if (best == MUX_STREAMS)
+        return false;
+
+      _vcd_mpeg_put_pack_header (pack, md->mpeg2, md->mux_rate,
+                                 md->state.scr);
+
+      if (best < 0)
+        _vcd_mpeg_put_padding (pack + pos, MUX_PACK_SIZE - pos);
+      else
+        _put_packet (md, best, pack + pos, MUX_PACK_SIZE - pos,
+                     md->state.scr);
+    }
+
+  md->state.pack++;
+  md->state.scr += md->scr_step;
+
+  return true;
+}
+
+/* pack source functions */
+
+static int
+_mux_close (void *user_data)
+{
+  _MuxData *const md = user_data;
+  unsigned s;
+
+  /* the index and checkpoints stay for the next time around */
+  for (s = 0; s < md->streams; s++)
+    vcd_data_source_close (md->es[s].source);
+
+  return 0;
+}
+
+static void
+_mux_free (void *user_data)
+{
+  _MuxData *const md = user_data;
+  unsigned s;
+
+  for (s = 0; s < md->streams; s++)
+    {
+      vcd_data_source_destroy (md->es[s].source);
+      free (md->es[s].aus);
+    }
+
+  free (md);
+}
+
+VcdDataSource_t *
+vcd_mpeg_mux_new (vcd_type_t vcd_type, VcdDataSource_t *p_video,
+                  VcdDataSource_t *p_audio)
+{
+  vcd_mpeg_packer_funcs funcs = { 0, };
+  _MuxData *md;
+  unsigned s;
+
+  vcd_assert (p_video != NULL);
+
+  if (!(md = calloc (1, sizeof (_MuxData))))
+    {
+      vcd_error ("mux: can't allocate memory for the multiplexer");
+      vcd_data_source_destroy (p_video);
+      if (p_audio)
+        vcd_data_source_destroy (p_audio);
+      return NULL;
+    }
+
+  md->es[MUX_VIDEO].source = p_video;
+  md->es[MUX_VIDEO].stream_id = 0xe0;
+  md->es[MUX_VIDEO].buffer_scale = true;
+  md->streams = 1;
+
+  if (p_audio)
+    {
+      md->es[MUX_AUDIO].source = p_audio;
+      md->es[MUX_AUDIO].stream_id = 0xc0;
+      md->es[MUX_AUDIO].buffer_size = 4 * 1024;
+      md->streams = 2;
+    }
+
+  /* the mux rate is that of the whole sector, as (S)VCD streams are
+     read at a fixed number of sectors per second */
+  switch (vcd_type)
+    {
+    case VCD_TYPE_VCD:
+    case VCD_TYPE_VCD11:
+    case VCD_TYPE_VCD2:
+      md->scr_step = 90000 / 75;
+      md->mux_rate = 75 * 2352 / 50;
+      md->es[MUX_VIDEO].buffer_size = 46 * 1024;
+      md->header_packs = md->streams;
+      break;
+
+    case VCD_TYPE_SVCD:
+    case VCD_TYPE_HQVCD:
+      md->mpeg2 = true;
+      md->vbr = true;
+      md->scr_step = 90000 / 150;
+      md->mux_rate = 150 * 2352 / 50;
+      md->es[MUX_VIDEO].buffer_size = 230 * 1024;
+      md->header_packs = 1;
+      break;
+
+    default:
+      vcd_assert_not_reached ();
+      break;
+    }
+
+  /* time enough to fill the buffers before the first decoding */
+  md->delay = md->scr_step
+    * (md->header_packs + 1
+       + (md->es[MUX_VIDEO].buffer_size + md->es[MUX_AUDIO].buffer_size)
+       / (MUX_PACK_SIZE - 64));
+
+  for (s = 0; s < md->streams; s++)
+    md->es[s].group_start = MUX_NONE;
+
+  funcs.make = _make_pack;
+  funcs.close = _mux_close;
+  funcs.free = _mux_free;
+
+  return _vcd_mpeg_packer_source_new (&md->packer, md, &md->state,
+                                      sizeof (_mux_state_t), &funcs);
+}
+
+bool
+vcd_mpeg_mux_video_es_p (VcdDataSource_t *p_source)
+{
+  uint8_t buf[4] = { 0, };
+  bool _retval;
+
+  vcd_assert (p_source != NULL);
+
+  vcd_data_source_seek (p_source, 0);
+  _retval = vcd_data_source_read (p_source, buf, 1, sizeof (buf)) == 4
+    && !buf[0] && !buf[1] && buf[2] == 0x01 && buf[3] == 0xb3;
+  vcd_data_source_seek (p_source, 0);
+
+  return _retval;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
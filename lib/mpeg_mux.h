@@ -0,0 +1,62 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* multiplexing of elementary streams into the program streams
+   sequence items are made of, so that they need no separate mux pass
+   and no intermediate file */
+
+#ifndef __VCD_MPEG_MUX_H__
+#define __VCD_MPEG_MUX_H__
+
+#include <libvcd/types.h>
+
+/* Private includes */
+#include "stream.h"
+
+/* returns a source reading as the program stream for vcd_type that
+   p_video, a MPEG-1 or MPEG-2 video elementary stream, and p_audio, a
+   MPEG-1 audio elementary stream (layer II for all (S)VCD types),
+   multiplex to: 2324 byte packs with system headers, STD buffer
+   sizes, SCR, PTS and DTS as the type requires, every pack fitting
+   into a mode 2 form 2 sector. p_audio may be NULL for a stream
+   without audio.
+
+   Packs are made when read; the source can be seeked in anywhere and
+   gives the same bytes every time. As its length is known only at
+   the end, it's a stream source (see vcd_data_source_set_stream ()).
+   p_video and p_audio get destroyed along with it -- or right away,
+   if there's no memory for it, in which case NULL is returned. */
+VcdDataSource_t *
+vcd_mpeg_mux_new (vcd_type_t vcd_type, VcdDataSource_t *p_video,
+                  VcdDataSource_t *p_audio);
+
+/* whether p_source starts like a video elementary stream, i.e. with a
+   sequence header instead of a pack header */
+bool
+vcd_mpeg_mux_video_es_p (VcdDataSource_t *p_source);
+
+#endif /* __VCD_MPEG_MUX_H__ */
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,294 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cdio/cdio.h>
+
+/* Public headers */
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "vcd_assert.h"
+#include "mpeg_pack.h"
+#include "util.h"
+
+#define PACK_CHECKPOINT  256    /* packs */
+
+/* pack writing */
+
+void
+_vcd_mpeg_put_timecode (uint8_t *p, unsigned prefix, int64_t t)
+{
+  p[0] = (prefix << 4) | (((t >> 30) & 0x07) << 1) | 1;
+  p[1] = (t >> 22) & 0xff;
+  p[2] = (((t >> 15) & 0x7f) << 1) | 1;
+  p[3] = (t >> 7) & 0xff;
+  p[4] = ((t & 0x7f) << 1) | 1;
+}
+
+unsigned
+_vcd_mpeg_put_pack_header (uint8_t *p, bool mpeg2, unsigned mux_rate,
+                           int64_t scr)
+{
+  const unsigned rate = mux_rate;
+
+  p[0] = p[1] = 0x00;
+  p[2] = 0x01;
+  p[3] = 0xba;
+
+  if (!mpeg2)
+    {
+      _vcd_mpeg_put_timecode (p + 4, 0x2, scr);
+      p[9] = 0x80 | (rate >> 15);
+      p[10] = (rate >> 7) & 0xff;
+      p[11] = ((rate & 0x7f) << 1) | 1;
+
+      return 12;
+    }
+
+  /* SCR extension is 0, as the SCR is a multiple of 300 27MHz ticks */
+  p[4] = 0x40 | (((scr >> 30) & 0x07) << 3) | 0x04 | ((scr >> 28) & 0x03);
+  p[5] = (scr >> 20) & 0xff;
+  p[6] = (((scr >> 15) & 0x1f) << 3) | 0x04 | ((scr >> 13) & 0x03);
+  p[7] = (scr >> 5) & 0xff;
+  p[8] = ((scr & 0x1f) << 3) | 0x04;
+  p[9] = 0x01;
+  p[10] = rate >> 14;
+  p[11] = (rate >> 6) & 0xff;
+  p[12] = ((rate & 0x3f) << 2) | 0x03;
+  p[13] = 0xf8; /* no pack stuffing */
+
+  return 14;
+}
+
+void
+_vcd_mpeg_put_padding (uint8_t *p, unsigned len)
+{
+  vcd_assert (len >= 6);
+
+  p[0] = p[1] = 0x00;
+  p[2] = 0x01;
+  p[3] = 0xbe;
+  p[4] = (len - 6) >> 8;
+  p[5] = (len - 6) & 0xff;
+  memset (p + 6, 0xff, len - 6);
+}
+
+unsigned
+_vcd_mpeg_pes_header_len (bool mpeg2, unsigned stuff, bool std,
+                          unsigned stamps)
+{
+  const unsigned _ts = stamps ? 5 * stamps : 0;
+
+  if (!mpeg2)
+    return 6 + stuff + (std ? 2 : 0) + (stamps ? _ts : 1);
+
+  return 6 + 3 + _ts + (std ? 3 : 0) + stuff;
+}
+
+/* pack source */
+
+static uint32_t
+_next_pack (const VcdMpegPacker_t *pk)
+{
+  return *(const uint32_t *) pk->state;
+}
+
+static void *
+_checkpoint (const VcdMpegPacker_t *pk, unsigned n)
+{
+  return pk->checkpoints + n * pk->state_size;
+}
+
+/* makes pack_no the one in pk->pack, returns false if there's none */
+static bool
+_load_pack (VcdMpegPacker_t *pk, long pack_no)
+{
+  const unsigned _cp = pack_no / PACK_CHECKPOINT;
+
+  if (pk->pack_no == pack_no)
+    return true;
+
+  if (pk->packs >= 0 && pack_no >= pk->packs)
+    return false;
+
+  if (pack_no < _next_pack (pk)
+      || (_cp < pk->checkpoint_count
+          && *(const uint32_t *) _checkpoint (pk, _cp) > _next_pack (pk)))
+    {
+      memcpy (pk->state, _checkpoint (pk, _cp), pk->state_size);
+
+      if (pk->funcs.rewound)
+        pk->funcs.rewound (pk->user_data);
+    }
+
+  pk->pack_no = -1;
+
+  while (_next_pack (pk) <= pack_no)
+    {
+      if (!(_next_pack (pk) % PACK_CHECKPOINT)
+          && _next_pack (pk) / PACK_CHECKPOINT == pk->checkpoint_count)
+        {
+          uint8_t *p_new = realloc (pk->checkpoints,
+                                    (pk->checkpoint_count + 1)
+                                    * pk->state_size);
+
+          if (!p_new)
+            {
+              vcd_error ("can't allocate memory for pack %u's checkpoint",
+                         (unsigned) _next_pack (pk));
+              return false;
+            }
+
+          pk->checkpoints = p_new;
+          memcpy (_checkpoint (pk, pk->checkpoint_count++), pk->state,
+                  pk->state_size);
+        }
+
+      if (!pk->funcs.make (pk->user_data, pk->pack))
+        {
+          pk->packs = _next_pack (pk);
+          return false;
+        }
+    }
+
+  pk->pack_no = pack_no;
+
+  return true;
+}
+
+/* data source io functions */
+
+static int
+_packer_open (void *user_data)
+{
+  VcdMpegPacker_t *const pk = user_data;
+
+  pk->pos = 0;
+
+  return 0;
+}
+
+static int
+_packer_close (void *user_data)
+{
+  VcdMpegPacker_t *const pk = user_data;
+
+  /* the checkpoints stay for the next time around */
+  return pk->funcs.close ? pk->funcs.close (pk->user_data) : 0;
+}
+
+static long
+_packer_seek (void *user_data, long offset)
+{
+  VcdMpegPacker_t *const pk = user_data;
+
+  pk->pos = offset;
+
+  return offset;
+}
+
+static long
+_packer_stat (void *user_data)
+{
+  VcdMpegPacker_t *const pk = user_data;
+
+  if (pk->packs < 0)
+    {
+      long n = _next_pack (pk);
+
+      while (_load_pack (pk, n))
+        n++;
+    }
+
+  return pk->packs * VCD_MPEG_PACK_SIZE;
+}
+
+static long
+_packer_read (void *user_data, void *buf, long count)
+{
+  VcdMpegPacker_t *const pk = user_data;
+  long done = 0;
+
+  while (done < count)
+    {
+      const unsigned offset = pk->pos % VCD_MPEG_PACK_SIZE;
+      const long n = MIN (VCD_MPEG_PACK_SIZE - offset, count - done);
+
+      if (!_load_pack (pk, pk->pos / VCD_MPEG_PACK_SIZE))
+        break;
+
+      memcpy ((uint8_t *) buf + done, pk->pack + offset, n);
+      pk->pos += n;
+      done += n;
+    }
+
+  return done;
+}
+
+static void
+_packer_free (void *user_data)
+{
+  VcdMpegPacker_t *const pk = user_data;
+
+  free (pk->checkpoints);
+
+  if (pk->funcs.free)
+    pk->funcs.free (pk->user_data);
+}
+
+VcdDataSource_t *
+_vcd_mpeg_packer_source_new (VcdMpegPacker_t *p_packer, void *p_user_data,
+                             void *p_state, size_t state_size,
+                             const vcd_mpeg_packer_funcs *funcs)
+{
+  vcd_data_source_io_functions io = { 0, };
+  VcdDataSource_t *p_new;
+
+  vcd_assert (p_packer != NULL);
+  vcd_assert (p_state != NULL);
+  vcd_assert (state_size >= sizeof (uint32_t));
+  vcd_assert (funcs != NULL && funcs->make != NULL);
+
+  memset (p_packer, 0, sizeof (VcdMpegPacker_t));
+
+  p_packer->user_data = p_user_data;
+  p_packer->funcs = *funcs;
+  p_packer->state = p_state;
+  p_packer->state_size = state_size;
+  p_packer->pack_no = -1;
+  p_packer->packs = -1;
+
+  io.open = _packer_open;
+  io.seek = _packer_seek;
+  io.stat = _packer_stat;
+  io.read = _packer_read;
+  io.close = _packer_close;
+  io.free = _packer_free;
+
+  p_new = vcd_data_source_new (p_packer, &io);
+  vcd_data_source_set_stream (p_new);
+
+  return p_new;
+}
@@ -0,0 +1,100 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* what mpeg_mux.c and mpeg_repack.c have in common: writing 2324
+   byte packs, and a stream source made of packs that are made when
+   read */
+
+#ifndef __VCD_MPEG_PACK_H__
+#define __VCD_MPEG_PACK_H__
+
+#include <libvcd/types.h>
+
+#include "stream.h"
+
+#define VCD_MPEG_PACK_SIZE  2324
+
+/* pack writing */
+
+/* a 33 bit PTS, DTS or MPEG-1 SCR, with prefix in the upper 4 bits */
+void
+_vcd_mpeg_put_timecode (uint8_t *p, unsigned prefix, int64_t t);
+
+/* pack header with the SCR scr and a mux rate of mux_rate units of
+   50 bytes/s, returns its length */
+unsigned
+_vcd_mpeg_put_pack_header (uint8_t *p, bool mpeg2, unsigned mux_rate,
+                           int64_t scr);
+
+/* padding packet, len bytes long with its header */
+void
+_vcd_mpeg_put_padding (uint8_t *p, unsigned len);
+
+/* length of a PES header with stuff stuffing bytes, the STD buffer
+   size if std, and stamps time stamps (0, 1 for PTS, 2 for PTS and
+   DTS) */
+unsigned
+_vcd_mpeg_pes_header_len (bool mpeg2, unsigned stuff, bool std,
+                          unsigned stamps);
+
+/* pack source */
+
+typedef struct {
+  /* makes the next pack into pack, returns false after the last
+     one */
+  bool (*make) (void *p_user_data, uint8_t *pack);
+
+  /* called after the state has been set back to a checkpoint; may be
+     NULL */
+  void (*rewound) (void *p_user_data);
+
+  vcd_data_close_t close;
+  vcd_data_free_t free;
+} vcd_mpeg_packer_funcs;
+
+/* the state of the packer between two packs is saved every 256 packs,
+   so that seeking backwards only has to redo the packs from the
+   checkpoint before */
+typedef struct {
+  void *user_data;
+  vcd_mpeg_packer_funcs funcs;
+
+  void *state;
+  size_t state_size;
+  uint8_t *checkpoints;
+  unsigned checkpoint_count;
+
+  uint8_t pack[VCD_MPEG_PACK_SIZE];
+  long pack_no;          /* the one in pack[], -1 if none */
+  long packs;            /* -1 until the end was reached */
+  long pos;
+} VcdMpegPacker_t;
+
+/* returns a stream source (see vcd_data_source_set_stream ()) of the
+   packs funcs->make () makes, which can be seeked in anywhere.
+   p_packer is usually part of p_user_data and has to stay until
+   funcs->free () is called, after which nothing of it is used.
+   p_state, state_size bytes long, is the state of the packer between
+   two packs; it has to start with the uint32_t number of the pack
+   made next, which funcs->make () increments. */
+VcdDataSource_t *
+_vcd_mpeg_packer_source_new (VcdMpegPacker_t *p_packer, void *p_user_data,
+                             void *p_state, size_t state_size,
+                             const vcd_mpeg_packer_funcs *funcs);
+
+#endif /* __VCD_MPEG_PACK_H__ */
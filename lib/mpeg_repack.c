@@ -0,0 +1,943 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cdio/cdio.h>
+
+/* Public headers */
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "vcd_assert.h"
+#include "mpeg_pack.h"
+#include "mpeg_repack.h"
+#include "util.h"
+
+/* how it works: every stream kept has a cursor into the input, at the
+   packet holding its next payload byte. From there on the payload for
+   its next output packet is gathered; of the streams, the one whose
+   packet is complete earliest in the input goes into the next pack,
+   so that no byte is sent before the input had it -- nor much later,
+   as a packet only takes input coming in soon after its first byte.
+   Time stamps move to the packet the access unit they're for starts
+   in, if it's the first one starting there -- else the packet is cut
+   short before it.
+
+   The state between two packs is just the SCR and the cursors, which
+   is saved every so many packs by the pack source of mpeg_pack.c, as
+   in mpeg_mux.c. */
+
+#define REPACK_PACK_SIZE   VCD_MPEG_PACK_SIZE
+#define REPACK_WINDOW      (1024*1024) /* of the input kept in memory */
+#define REPACK_PROBE       (1024*1024) /* input looked at for streams */
+#define REPACK_STREAMS     6
+#define REPACK_SEGMENTS    32          /* input packets per packet */
+#define REPACK_LATE        (90000/75)  /* a sector at single speed */
+
+#define REPACK_NONE        ((uint32_t) -1)
+
+typedef struct {
+  uint32_t pos;          /* of the input packet with the next byte, or
+                            where to look for it */
+  uint32_t skip;         /* payload bytes of that packet already sent */
+  uint32_t sent;         /* payload bytes of the stream sent */
+  int64_t scr;           /* of the input pack pos is in */
+} _repack_cursor_t;
+
+/* an input packet, or pack header */
+typedef struct {
+  uint8_t id;
+  uint32_t pos;          /* of its start code */
+  uint32_t payload;
+  unsigned length;       /* of the payload */
+  int64_t pts;           /* -1 if none */
+  int64_t dts;           /* -1 if none */
+  unsigned std_size;     /* 0 if none */
+  bool std_scale;
+
+  /* pack header */
+  bool mpeg2;
+  unsigned mux_rate;
+} _repack_packet_t;
+
+/* the next output packet of a stream */
+typedef struct {
+  bool valid;
+  unsigned length;       /* of the payload, 0 at the end of the stream */
+  bool std;
+  int64_t pts;           /* -1 if none */
+  int64_t dts;           /* -1 if none */
+  uint32_t last;         /* input offset of its last byte */
+  int64_t scr;           /* ...and of the pack that came in */
+  _repack_cursor_t next; /* cursor after it */
+  uint8_t payload[REPACK_PACK_SIZE];
+} _repack_out_t;
+
+typedef struct {
+  uint8_t stream_id;
+  unsigned std_size;     /* 0 if unknown */
+  bool std_scale;
+  _repack_out_t out;
+} _repack_es_t;
+
+typedef struct {
+  uint32_t pack;         /* the one made next, first for mpeg_pack.c */
+  int64_t scr;           /* of the one before, -1 if none */
+  _repack_cursor_t cursor[REPACK_STREAMS];
+} _repack_state_t;
+
+typedef struct {
+  VcdDataSource_t *source;
+
+  uint8_t *window;
+  uint32_t window_pos;
+  unsigned window_len;
+  bool window_valid;
+
+  bool mpeg2;
+  unsigned mux_rate;     /* in units of 50 bytes/s */
+  unsigned pack_time;    /* 90kHz ticks a pack takes at the mux rate */
+  int64_t first_scr;
+  uint8_t system_header[REPACK_PACK_SIZE];
+  unsigned system_header_len;
+  bool garbage_warned;
+
+  _repack_es_t es[REPACK_STREAMS];
+  unsigned streams;
+
+  _repack_state_t state;
+  VcdMpegPacker_t packer;
+} _RepackData;
+
+/* input */
+
+/* returns the input at pos, with *p_avail of the len bytes wanted
+   there, less only at the end of the input; len must be well below
+   REPACK_WINDOW */
+static const uint8_t *
+_peek (_RepackData *rd, uint32_t pos, unsigned len, unsigned *p_avail)
+{
+  if (!rd->window_valid || pos < rd->window_pos
+      || (pos + len > rd->window_pos + rd->window_len
+          && rd->window_len == REPACK_WINDOW))
+    {
+      /* the streams' cursors are close to each other, but not at the
+         same place */
+      const uint32_t start =
+        pos > REPACK_WINDOW / 4 ? pos - REPACK_WINDOW / 4 : 0;
+
+      vcd_data_source_seek (rd->source, start);
+      rd->window_len =
+        vcd_data_source_read (rd->source, rd->window, 1, REPACK_WINDOW);
+      rd->window_pos = start;
+      rd->window_valid = true;
+    }
+
+  if (pos - rd->window_pos >= rd->window_len)
+    *p_avail = 0;
+  else
+    *p_avail = MIN (len, rd->window_len - (pos - rd->window_pos));
+
+  return rd->window + (pos - rd->window_pos);
+}
+
+/* the offset of the next start code of the system layer at or after
+   pos, or REPACK_NONE */
+static uint32_t
+_resync (_RepackData *rd, uint32_t pos)
+{
+  bool _garbage = false;
+
+  while (true)
+    {
+      unsigned avail, n;
+      const uint8_t *p = _peek (rd, pos, 4096, &avail);
+
+      if (avail < 4)
+        return REPACK_NONE;
+
+      for (n = 0; n + 4 <= avail; n++)
+        {
+          if (!p[n] && !p[n + 1] && p[n + 2] == 0x01 && p[n + 3] >= 0xb9)
+            {
+              /* zero bytes between packs are fine */
+              if (_garbage && !rd->garbage_warned)
+                {
+                  vcd_warn ("repack: skipping garbage in mpeg stream"
+                            " before byte offset %u", pos + n);
+                  rd->garbage_warned = true;
+                }
+
+              return pos + n;
+            }
+
+          if (p[n])
+            _garbage = true;
+        }
+
+      pos += n;
+    }
+}
+
+static int64_t
+_get_timecode (const uint8_t *p)
+{
+  return ((int64_t) (p[0] >> 1) & 0x07) << 30 | p[1] << 22
+    | (p[2] >> 1) << 15 | p[3] << 7 | p[4] >> 1;
+}
+
+static bool
+_kept_p (uint8_t id)
+{
+  return (id >= 0xc0 && id <= 0xc2) || (id >= 0xe0 && id <= 0xe2);
+}
+
+/* the header of a video or audio packet p with avail bytes of it
+   there */
+static void
+_parse_pes (const uint8_t *p, unsigned avail, _repack_packet_t *pkt)
+{
+  const unsigned end = MIN (avail, 6 + (p[4] << 8 | p[5]));
+  unsigned pos = 6;
+
+  if (end > 9 && (p[6] >> 6) == 0x2)
+    {
+      /* ISO13818-1 */
+      const unsigned flags = p[7];
+      const unsigned hdr_end = 9 + p[8];
+
+      pos = 9;
+
+      if ((flags & 0x80) && pos + 5 <= end)
+        pkt->pts = _get_timecode (p + pos);
+      if ((flags & 0xc0) == 0xc0 && pos + 10 <= end)
+        pkt->dts = _get_timecode (p + pos + 5);
+
+      pos += (flags & 0x80 ? 5 : 0) + ((flags & 0xc0) == 0xc0 ? 5 : 0)
+        + (flags & 0x20 ? 6 : 0) + (flags & 0x10 ? 3 : 0)
+        + (flags & 0x08 ? 1 : 0) + (flags & 0x04 ? 1 : 0)
+        + (flags & 0x02 ? 2 : 0);
+
+      if ((flags & 0x01) && pos < hdr_end && pos < end)
+        {
+          const unsigned ext = p[pos++];
+
+          if (ext & 0x80)
+            pos += 16; /* private data */
+          if ((ext & 0x40) && pos < end)
+            pos += 1 + p[pos]; /* pack header field */
+          if (ext & 0x20)
+            pos += 2; /* sequence counter */
+          if ((ext & 0x10) && pos + 2 <= end)
+            {
+              pkt->std_scale = (p[pos] >> 5) & 1;
+              pkt->std_size = (p[pos] & 0x1f) << 8 | p[pos + 1];
+            }
+        }
+
+      pos = hdr_end;
+    }
+  else
+    {
+      /* ISO11172-1 */
+      while (pos < end && p[pos] == 0xff)
+        pos++;
+
+      if (pos + 2 <= end && (p[pos] >> 6) == 0x1)
+        {
+          pkt->std_scale = (p[pos] >> 5) & 1;
+          pkt->std_size = (p[pos] & 0x1f) << 8 | p[pos + 1];
+          pos += 2;
+        }
+
+      if (pos < end)
+        switch (p[pos] >> 4)
+          {
+          case 0x2:
+            if (pos + 5 <= end)
+              pkt->pts = _get_timecode (p + pos);
+            pos += 5;
+            break;
+          case 0x3:
+            if (pos + 10 <= end)
+              {
+                pkt->pts = _get_timecode (p + pos);
+                pkt->dts = _get_timecode (p + pos + 5);
+              }
+            pos += 10;
+            break;
+          default:
+            pos++;
+            break;
+          }
+    }
+
+  if (pos > end)
+    {
+      /* no payload to speak of, then */
+      pkt->pts = pkt->dts = -1;
+      pos = end;
+    }
+
+  pkt->payload = pkt->pos + pos;
+  pkt->length = 6 + (p[4] << 8 | p[5]) - pos;
+}
+
+/* reads what starts at the next start code from pos on into pkt, and
+   sets *p_scr if it's a pack header; returns the offset of what
+   follows, or REPACK_NONE at the end of the stream */
+static uint32_t
+_parse (_RepackData *rd, uint32_t pos, int64_t *p_scr,
+        _repack_packet_t *pkt)
+{
+  const uint8_t *p;
+  unsigned avail;
+
+  while ((pos = _resync (rd, pos)) != REPACK_NONE)
+    {
+      p = _peek (rd, pos, 6 + 3 + 255, &avail);
+
+      memset (pkt, 0, sizeof (_repack_packet_t));
+      pkt->id = p[3];
+      pkt->pos = pos;
+      pkt->pts = pkt->dts = -1;
+
+      switch (pkt->id)
+        {
+        case 0xb9:
+          return REPACK_NONE;
+
+        case 0xba:
+          if (avail >= 12 && (p[4] >> 4) == 0x2)
+            {
+              *p_scr = _get_timecode (p + 4);
+              pkt->mux_rate = (p[9] & 0x7f) << 15 | p[10] << 7 | p[11] >> 1;
+              return pos + 12;
+            }
+
+          if (avail >= 14 && (p[4] >> 6) == 0x1)
+            {
+              *p_scr = ((int64_t) (p[4] >> 3) & 0x07) << 30
+                | (p[4] & 0x03) << 28 | p[5] << 20
+                | (p[6] >> 3) << 15 | (p[6] & 0x03) << 13
+                | p[7] << 5 | p[8] >> 3;
+              pkt->mpeg2 = true;
+              pkt->mux_rate = p[10] << 14 | p[11] << 6 | p[12] >> 2;
+              return pos + 14 + (p[13] & 0x07);
+            }
+
+          /* not a pack header after all */
+          pos += 4;
+          break;
+
+        default:
+          if (avail < 6)
+            return REPACK_NONE;
+
+          if (_kept_p (pkt->id))
+            _parse_pes (p, avail, pkt);
+
+          return pos + 6 + (p[4] << 8 | p[5]);
+        }
+    }
+
+  return REPACK_NONE;
+}
+
+/* the offset of the first access unit starting in buf, or len; a
+   picture start code resp. an audio frame header */
+static unsigned
+_first_au (uint8_t stream_id, const uint8_t *buf, unsigned len)
+{
+  unsigned n;
+
+  for (n = 0; n + 4 <= len; n++)
+    if (stream_id >= 0xe0)
+      {
+        if (!buf[n] && !buf[n + 1] && buf[n + 2] == 0x01 && !buf[n + 3])
+          return n;
+      }
+    else if (buf[n] == 0xff && (buf[n + 1] & 0xf8) == 0xf8
+             && (buf[n + 1] & 0x06) && (buf[n + 2] >> 4) != 0xf
+             && (buf[n + 2] >> 4) && ((buf[n + 2] >> 2) & 0x03) != 0x03)
+      return n;
+
+  return len;
+}
+
+/* moves c to the packet of stream es with its next payload byte, read
+   into pkt; false at the end of the stream */
+static bool
+_cursor_packet (_RepackData *rd, const _repack_es_t *es,
+                _repack_cursor_t *c, _repack_packet_t *pkt)
+{
+  while (c->pos != REPACK_NONE)
+    {
+      const uint32_t next = _parse (rd, c->pos, &c->scr, pkt);
+
+      if (next != REPACK_NONE
+          && pkt->id == es->stream_id && c->skip < pkt->length)
+        {
+          c->pos = pkt->pos;
+          return true;
+        }
+
+      c->pos = next;
+      c->skip = 0;
+    }
+
+  return false;
+}
+
+/* pack writing */
+
+static unsigned
+_pack_header_len (const _RepackData *rd)
+{
+  return rd->mpeg2 ? 14 : 12;
+}
+
+static unsigned
+_stamps (const _repack_out_t *out)
+{
+  if (out->pts < 0)
+    return 0;
+
+  return out->dts >= 0 && out->dts != out->pts ? 2 : 1;
+}
+
+static unsigned
+_put_pes_header (const _RepackData *rd, uint8_t *p, const _repack_es_t *es,
+                 unsigned stuff)
+{
+  const _repack_out_t *out = &es->out;
+  const unsigned stamps = _stamps (out);
+  const unsigned len =
+    _vcd_mpeg_pes_header_len (rd->mpeg2, stuff, out->std, stamps);
+  const unsigned size = es->std_size;
+  const unsigned scale = es->std_scale ? 0x20 : 0;
+  unsigned pos = 6;
+
+  p[0] = p[1] = 0x00;
+  p[2] = 0x01;
+  p[3] = es->stream_id;
+  p[4] = (len - 6 + out->length) >> 8;
+  p[5] = (len - 6 + out->length) & 0xff;
+
+  if (!rd->mpeg2)
+    {
+      memset (p + pos, 0xff, stuff);
+      pos += stuff;
+
+      if (out->std)
+        {
+          p[pos++] = 0x40 | scale | (size >> 8);
+          p[pos++] = size & 0xff;
+        }
+    }
+  else
+    {
+      p[pos++] = 0x81; /* original */
+      p[pos++] = (stamps ? (stamps == 1 ? 0x80 : 0xc0) : 0)
+        | (out->std ? 1 : 0);
+      p[pos++] = len - 9;
+    }
+
+  switch (stamps)
+    {
+    case 0:
+      if (!rd->mpeg2)
+        p[pos++] = 0x0f;
+      break;
+    case 1:
+      _vcd_mpeg_put_timecode (p + pos, 0x2, out->pts);
+      pos += 5;
+      break;
+    case 2:
+      _vcd_mpeg_put_timecode (p + pos, 0x3, out->pts);
+      _vcd_mpeg_put_timecode (p + pos + 5, 0x1, out->dts);
+      pos += 10;
+      break;
+    }
+
+  if (rd->mpeg2)
+    {
+      if (out->std)
+        {
+          p[pos++] = 0x1e; /* just the P-STD buffer */
+          p[pos++] = 0x40 | scale | (size >> 8);
+          p[pos++] = size & 0xff;
+        }
+
+      memset (p + pos, 0xff, stuff);
+      pos += stuff;
+    }
+
+  vcd_assert (pos == len);
+
+  return len;
+}
+
+/* gathers the next output packet of stream s into its out */
+static void
+_make_out (_RepackData *rd, unsigned s)
+{
+  _repack_es_t *const es = &rd->es[s];
+  _repack_out_t *const out = &es->out;
+  _repack_cursor_t c = rd->state.cursor[s];
+  struct {
+    unsigned start;      /* in out->payload */
+    uint32_t payload;    /* of the input packet */
+    _repack_cursor_t c;  /* ...and the cursor to it */
+    int64_t pts, dts;
+  } seg[REPACK_SEGMENTS];
+  const unsigned room = REPACK_PACK_SIZE - _pack_header_len (rd);
+  unsigned segs = 0, n = 0, ahead = 0, max, fill, au, k;
+  _repack_packet_t pkt;
+
+  out->valid = true;
+  out->std = !c.sent && es->std_size;
+  out->pts = out->dts = -1;
+
+  max = room - _vcd_mpeg_pes_header_len (rd->mpeg2, 0, out->std, 0);
+
+  /* and a start code's worth more, to see an access unit starting at
+     the end */
+  fill = max + 3;
+
+  while (n < fill && segs < REPACK_SEGMENTS
+         && _cursor_packet (rd, es, &c, &pkt))
+    {
+      const unsigned want = MIN (pkt.length - c.skip, fill - n);
+      unsigned avail;
+      const uint8_t *p;
+
+      /* a sparse stream, like audio, isn't held back for long to fill
+         a packet -- what comes next only tells where an access unit
+         starts */
+      if (segs && c.scr > seg[0].c.scr + REPACK_LATE)
+        {
+          p = _peek (rd, pkt.payload + c.skip, MIN (want, 3), &avail);
+          memcpy (out->payload + n, p, avail);
+          ahead = avail;
+          break;
+        }
+
+      seg[segs].start = n;
+      seg[segs].payload = pkt.payload;
+      seg[segs].c = c;
+      seg[segs].pts = pkt.pts;
+      seg[segs].dts = pkt.dts;
+
+      /* the time stamps were for an access unit sent before */
+      if (c.skip && pkt.pts >= 0)
+        {
+          p = _peek (rd, pkt.payload, MIN (c.skip + 3, pkt.length), &avail);
+
+          if (_first_au (es->stream_id, p, avail) < c.skip)
+            seg[segs].pts = -1;
+        }
+
+      p = _peek (rd, pkt.payload + c.skip, want, &avail);
+      if (!avail)
+        break;
+
+      memcpy (out->payload + n, p, avail);
+      n += avail;
+      c.skip += avail;
+      segs++;
+    }
+
+  au = _first_au (es->stream_id, out->payload, n + ahead);
+
+  n = MIN (n, max);
+  out->length = n;
+
+  if (!n)
+    return;
+
+  /* the time stamps of the first access unit, if it's the first one
+     of its input packet too */
+  for (k = segs - 1; k > 0 && seg[k].start > au; k--);
+
+  if (au < n && seg[k].pts >= 0)
+    {
+      out->pts = seg[k].pts;
+      out->dts = seg[k].dts;
+
+      max = room
+        - _vcd_mpeg_pes_header_len (rd->mpeg2, 0, out->std, _stamps (out));
+
+      if (au < max)
+        out->length = MIN (n, max);
+      else
+        {
+          /* ...so that it starts the next packet */
+          out->pts = out->dts = -1;
+          out->length = au;
+        }
+    }
+
+  /* where it ends in the input */
+  for (k = segs - 1; k > 0 && seg[k].start >= out->length; k--);
+
+  out->next = seg[k].c;
+  out->next.skip += out->length - seg[k].start;
+  out->next.sent += out->length;
+  out->last = seg[k].payload + out->next.skip - 1;
+  out->scr = seg[k].c.scr;
+}
+
+/* makes the next pack into pack, returns false if there's none */
+static bool
+_make_pack (void *user_data, uint8_t *pack)
+{
+  _RepackData *const rd = user_data;
+  unsigned len, s;
+  int64_t scr;
+  int best = -1;
+
+  if (!rd->state.pack && rd->system_header_len)
+    {
+      /* (S)VCD players want the system header in a pack of its own */
+      scr = rd->first_scr;
+      len = _vcd_mpeg_put_pack_header (pack, rd->mpeg2, rd->mux_rate, scr);
+      memcpy (pack + len, rd->system_header, rd->system_header_len);
+      len += rd->system_header_len;
+      _vcd_mpeg_put_padding (pack + len, REPACK_PACK_SIZE - len);
+    }
+  else
+    {
+      _repack_es_t *es;
+      _repack_out_t *out;
+      unsigned room, stuff = 0;
+
+      for (s = 0; s < rd->streams; s++)
+        {
+          if (!rd->es[s].out.valid)
+            _make_out (rd, s);
+
+          if (rd->es[s].out.length
+              && (best < 0 || rd->es[s].out.last < rd->es[best].out.last))
+            best = s;
+        }
+
+      if (best < 0)
+        return false;
+
+      es = &rd->es[best];
+      out = &es->out;
+
+      scr = out->scr;
+      if (rd->state.scr >= 0 && scr < rd->state.scr + rd->pack_time)
+        scr = rd->state.scr + rd->pack_time;
+
+      len = _vcd_mpeg_put_pack_header (pack, rd->mpeg2, rd->mux_rate, scr);
+
+      /* what's left over is padding -- or header stuffing, if too
+         little for a padding packet */
+      room = REPACK_PACK_SIZE - len
+        - _vcd_mpeg_pes_header_len (rd->mpeg2, 0, out->std, _stamps (out))
+        - out->length;
+      if (room < 6)
+        stuff = room;
+
+      len += _put_pes_header (rd, pack + len, es, stuff);
+      memcpy (pack + len, out->payload, out->length);
+      len += out->length;
+
+      if (len < REPACK_PACK_SIZE)
+        _vcd_mpeg_put_padding (pack + len, REPACK_PACK_SIZE - len);
+
+      rd->state.cursor[best] = out->next;
+      out->valid = false;
+    }
+
+  rd->state.pack++;
+  rd->state.scr = scr;
+
+  return true;
+}
+
+/* adds the streams of the system header at pos, len bytes long, to
+   rd->system_header -- VCD has one per stream */
+static void
+_merge_system_header (_RepackData *rd, uint32_t pos, unsigned len)
+{
+  unsigned avail, n, k;
+  const uint8_t *p = _peek (rd, pos, len, &avail);
+
+  if (avail != len || len < 12)
+    return;
+
+  if (!rd->system_header_len)
+    {
+      memcpy (rd->system_header, p, 12);
+      rd->system_header_len = 12;
+    }
+
+  for (n = 12; n + 3 <= len; n += 3)
+    {
+      for (k = 12; k < rd->system_header_len; k += 3)
+        if (rd->system_header[k] == p[n])
+          break;
+
+      if (k == rd->system_header_len && k + 3 <= REPACK_PACK_SIZE / 2)
+        {
+          memcpy (rd->system_header + k, p + n, 3);
+          rd->system_header_len += 3;
+        }
+    }
+}
+
+/* finds the streams in the first REPACK_PROBE bytes of the input,
+   along with the system header and the stream parameters */
+static void
+_probe (_RepackData *rd)
+{
+  uint8_t left_out[256] = { 0, };
+  _repack_packet_t pkt;
+  uint32_t pos = 0;
+  int64_t scr = -1;
+  unsigned s, n, len, audio = 0, video = 0;
+
+  while (pos < REPACK_PROBE
+         && (pos = _parse (rd, pos, &scr, &pkt)) != REPACK_NONE)
+    {
+      _repack_es_t *es = NULL;
+
+      switch (pkt.id)
+        {
+        case 0xba:
+          if (rd->first_scr < 0)
+            {
+              rd->first_scr = scr;
+              rd->mpeg2 = pkt.mpeg2;
+              rd->mux_rate = pkt.mux_rate;
+            }
+          break;
+
+        case 0xbb:
+          _merge_system_header (rd, pkt.pos, pos - pkt.pos);
+          break;
+
+        case 0xbe: /* padding */
+        case 0xbf: /* private stream 2, DVD navigation */
+          break;
+
+        default:
+          for (s = 0; s < rd->streams; s++)
+            if (rd->es[s].stream_id == pkt.id)
+              es = &rd->es[s];
+
+          if (!es && _kept_p (pkt.id) && rd->streams < REPACK_STREAMS)
+            {
+              es = &rd->es[rd->streams++];
+              es->stream_id = pkt.id;
+            }
+
+          if (es && !es->std_size && pkt.std_size)
+            {
+              es->std_size = pkt.std_size;
+              es->std_scale = pkt.std_scale;
+            }
+
+          if (!es && !left_out[pkt.id])
+            {
+              vcd_warn ("repack: leaving out stream 0x%2.2x, which has"
+                        " no place on a (S)VCD", pkt.id);
+              left_out[pkt.id] = true;
+            }
+          break;
+        }
+    }
+
+  if (!rd->streams)
+    vcd_warn ("repack: no video or audio stream found");
+
+  if (!rd->system_header_len)
+    return;
+
+  /* a buffer size given for a stream here is for it, if its packets
+     don't give one */
+  for (n = 12; n + 3 <= rd->system_header_len; n += 3)
+    {
+      const uint8_t *p = rd->system_header + n;
+
+      for (s = 0; s < rd->streams; s++)
+        if (rd->es[s].stream_id == p[0] && !rd->es[s].std_size)
+          {
+            rd->es[s].std_size = (p[1] & 0x1f) << 8 | p[2];
+            rd->es[s].std_scale = (p[1] >> 5) & 1;
+          }
+    }
+
+  /* the streams left out aren't in it either */
+  for (n = len = 12; n + 3 <= rd->system_header_len; n += 3)
+    {
+      const uint8_t id = rd->system_header[n];
+
+      for (s = 0; s < rd->streams; s++)
+        if (rd->es[s].stream_id == id)
+          break;
+
+      if (s < rd->streams)
+        {
+          memmove (rd->system_header + len, rd->system_header + n, 3);
+          len += 3;
+          audio += id < 0xe0;
+          video += id >= 0xe0;
+        }
+    }
+
+  rd->system_header_len = len;
+  rd->system_header[4] = (len - 6) >> 8;
+  rd->system_header[5] = (len - 6) & 0xff;
+  rd->system_header[9] = (rd->system_header[9] & 0x03) | (audio << 2);
+  rd->system_header[10] = (rd->system_header[10] & 0xe0) | video;
+}
+
+/* pack source functions */
+
+static void
+_repack_rewound (void *user_data)
+{
+  _RepackData *const rd = user_data;
+  unsigned s;
+
+  /* the packets gathered were for the state left */
+  for (s = 0; s < rd->streams; s++)
+    rd->es[s].out.valid = false;
+}
+
+static int
+_repack_close (void *user_data)
+{
+  _RepackData *const rd = user_data;
+
+  /* the window and checkpoints stay for the next time around */
+  vcd_data_source_close (rd->source);
+
+  return 0;
+}
+
+static void
+_repack_free (void *user_data)
+{
+  _RepackData *const rd = user_data;
+
+  free (rd->window);
+  free (rd);
+}
+
+VcdDataSource_t *
+vcd_mpeg_repack_new (VcdDataSource_t *p_ps)
+{
+  vcd_mpeg_packer_funcs funcs = { 0, };
+  _RepackData *rd;
+  unsigned s;
+
+  vcd_assert (p_ps != NULL);
+
+  if (!(rd = calloc (1, sizeof (_RepackData)))
+      || !(rd->window = malloc (REPACK_WINDOW)))
+    {
+      vcd_error ("repack: can't allocate memory for the repacketizer");
+      free (rd);
+      return NULL;
+    }
+
+  rd->source = p_ps;
+  rd->first_scr = -1;
+
+  _probe (rd);
+
+  if (rd->first_scr < 0)
+    rd->first_scr = 0;
+
+  /* bigger packs take longer at the same rate */
+  if (rd->mux_rate)
+    rd->pack_time = (REPACK_PACK_SIZE * 90000 + rd->mux_rate * 50 - 1)
+      / (rd->mux_rate * 50);
+
+  rd->state.scr = -1;
+
+  for (s = 0; s < rd->streams; s++)
+    rd->state.cursor[s].scr = rd->first_scr;
+
+  funcs.make = _make_pack;
+  funcs.rewound = _repack_rewound;
+  funcs.close = _repack_close;
+  funcs.free = _repack_free;
+
+  return _vcd_mpeg_packer_source_new (&rd->packer, rd, &rd->state,
+                                      sizeof (_repack_state_t), &funcs);
+}
+
+bool
+vcd_mpeg_repack_needed_p (VcdDataSource_t *p_source)
+{
+  uint8_t buf[REPACK_PACK_SIZE + 4];
+  unsigned len, pos;
+
+  vcd_assert (p_source != NULL);
+
+  vcd_data_source_seek (p_source, 0);
+  len = vcd_data_source_read (p_source, buf, 1, sizeof (buf));
+  vcd_data_source_seek (p_source, 0);
+
+  if (len < 14 || buf[0] || buf[1] || buf[2] != 0x01 || buf[3] != 0xba)
+    return false; /* the scanner will complain */
+
+  pos = (buf[4] >> 6) == 0x1 ? 14 + (buf[13] & 0x07) : 12;
+
+  /* on to the next pack header */
+  while (pos + 4 <= len)
+    if (!buf[pos] && !buf[pos + 1] && buf[pos + 2] == 0x01)
+      {
+        if (buf[pos + 3] == 0xba)
+          return pos != REPACK_PACK_SIZE;
+
+        if (buf[pos + 3] == 0xb9 || pos + 6 > len)
+          return false;
+
+        pos += 6 + (buf[pos + 4] << 8 | buf[pos + 5]);
+      }
+    else if (!buf[pos])
+      pos++;
+    else
+      return false;
+
+  /* a pack longer than a sector, unless the stream ends with it */
+  return len == sizeof (buf);
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
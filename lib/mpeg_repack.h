@@ -0,0 +1,58 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* repacketizing of program streams whose packs don't fill a sector,
+   such as the 2048 byte packs of DVD, into 2324 byte packs */
+
+#ifndef __VCD_MPEG_REPACK_H__
+#define __VCD_MPEG_REPACK_H__
+
+#include <libvcd/types.h>
+
+/* Private includes */
+#include "stream.h"
+
+/* returns a source reading as p_ps, a MPEG-1 or MPEG-2 program
+   stream, with the payload of its video (0xe0 to 0xe2) and audio (0xc0
+   to 0xc2) packets put into 2324 byte packs, one packet each. PTS and
+   DTS stay with the access units they belong to; the SCR of a pack is
+   that of the input pack its last byte came in, or later as the mux
+   rate requires. The first system header gets a pack of its own, all
+   other streams are left out.
+
+   Like vcd_mpeg_mux_new () it's a stream source which can be seeked
+   in anywhere. p_ps isn't destroyed along with it. NULL is returned
+   if there's no memory for it. */
+VcdDataSource_t *
+vcd_mpeg_repack_new (VcdDataSource_t *p_ps);
+
+/* whether p_source is a program stream whose first pack isn't 2324
+   bytes long */
+bool
+vcd_mpeg_repack_needed_p (VcdDataSource_t *p_source);
+
+#endif /* __VCD_MPEG_REPACK_H__ */
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -33,15 +33,28 @@
 
 /* Private headers */
 #include "vcd_assert.h"
+#include "arena.h"
 #include "mpeg_stream.h"
+#include "mpeg_repack.h"
 #include "data_structures.h"
 #include "mpeg.h"
 #include "util.h"
 
+/* progress granularity when scanning a stream of unknown length */
+#define VCD_MPEG_STREAM_PROGRESS (1024*1024)
+
+/* how far back and forward the scan information of a packet points,
+   in seconds */
+#define SCAN_WINDOW 10
+
 struct _VcdMpegSource
 {
   VcdDataSource_t *data_source;
 
+  /* what's read instead of data_source, if its packs needed
+     repacketizing */
+  VcdDataSource_t *repacked;
+
   bool scanned;
 
   /* _get_packet cache */
@@ -49,8 +62,32 @@ struct _VcdMpegSource
   unsigned _read_pkt_no;
 
   struct vcd_mpeg_stream_info info;
+
+  /* backs the aps lists in info and aps_index */
+  VcdArena_t *arena;
+
+  /* the aps lists of info, for looking up the access points around a
+     packet when fixing up its scan information */
+  struct aps_index aps_index[3];
+
+  /* see vcd_mpeg_source_get_scan_stats () */
+  double scan_seconds;
+  unsigned long scan_bytes;
+  unsigned long scan_seeks;
+
+  /* see vcd_mpeg_source_get_fingerprint (); only computed if
+     fingerprint_wanted was set before scanning */
+  bool fingerprint_wanted;
+  uint64_t fingerprint;
 };
 
+/* the stream as packets are taken from it */
+static VcdDataSource_t *
+_source (const VcdMpegSource_t *obj)
+{
+  return obj->repacked ? obj->repacked : obj->data_source;
+}
+
 /*
  * access functions
  */
@@ -66,6 +103,7 @@ vcd_mpeg_source_new (VcdDataSource_t *mpeg_file)
 
   new_obj->data_source = mpeg_file;
   new_obj->scanned = false;
+  new_obj->arena = _vcd_arena_new ();
 
   return new_obj;
 }
@@ -76,12 +114,17 @@ vcd_mpeg_source_destroy (VcdMpegSource_t *obj, bool destroy_file_obj)
   int i;
   vcd_assert (obj != NULL);
 
+  if (obj->repacked)
+    vcd_data_source_destroy (obj->repacked);
+
   if (destroy_file_obj)
     vcd_data_source_destroy (obj->data_source);
 
   for (i = 0; i < 3; i++)
     if (obj->info.shdr[i].aps_list)
-      _cdio_list_free (obj->info.shdr[i].aps_list, true, NULL);
+      _cdio_list_free (obj->info.shdr[i].aps_list, false, NULL);
+
+  _vcd_arena_destroy (obj->arena);
 
   free (obj);
 }
@@ -96,6 +139,44 @@ vcd_mpeg_source_get_info (VcdMpegSource_t *obj)
   return &(obj->info);
 }
 
+void
+vcd_mpeg_source_get_scan_stats (const VcdMpegSource_t *obj,
+                                double *p_seconds, unsigned long *p_bytes,
+                                unsigned long *p_seeks)
+{
+  vcd_assert (obj != NULL);
+
+  if (p_seconds)
+    *p_seconds = obj->scan_seconds;
+  if (p_bytes)
+    *p_bytes = obj->scan_bytes;
+  if (p_seeks)
+    *p_seeks = obj->scan_seeks;
+}
+
+bool
+vcd_mpeg_source_want_fingerprint (VcdMpegSource_t *obj)
+{
+  vcd_assert (obj != NULL);
+
+  if (obj->scanned)
+    return obj->fingerprint_wanted;
+
+  obj->fingerprint_wanted = true;
+
+  return true;
+}
+
+uint64_t
+vcd_mpeg_source_get_fingerprint (const VcdMpegSource_t *obj)
+{
+  vcd_assert (obj != NULL);
+  vcd_assert (obj->scanned);
+  vcd_assert (obj->fingerprint_wanted);
+
+  return obj->fingerprint;
+}
+
 long
 vcd_mpeg_source_stat (VcdMpegSource_t *obj)
 {
@@ -105,6 +186,40 @@ vcd_mpeg_source_stat (VcdMpegSource_t *obj)
   return obj->info.packets * 2324;
 }
 
+/* fills in obj->aps_index from the aps lists of obj->info */
+static void
+_index_aps (VcdMpegSource_t *obj)
+{
+  int i;
+
+  for (i = 0; i < 3; i++)
+    {
+      struct aps_index *idx = &obj->aps_index[i];
+      CdioList_t *aps_list = obj->info.shdr[i].aps_list;
+      CdioListNode_t *n;
+
+      memset (idx, 0, sizeof (struct aps_index));
+      idx->ordered = true;
+
+      if (!aps_list || !_cdio_list_length (aps_list))
+        continue;
+
+      idx->aps = _vcd_arena_alloc (obj->arena, _cdio_list_length (aps_list)
+                                   * sizeof (struct aps_data));
+
+      _CDIO_LIST_FOREACH (n, aps_list)
+        {
+          struct aps_data *_data = _cdio_list_node_data (n);
+
+          if (idx->count
+              && _data->timestamp < idx->aps[idx->count - 1].timestamp)
+            idx->ordered = false;
+
+          idx->aps[idx->count++] = *_data;
+        }
+    }
+}
+
 void
 vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
                       vcd_mpeg_prog_cb_t callback, void *user_data)
@@ -117,6 +232,9 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
   VcdMpegStreamCtx state;
   CdioListNode_t *n;
   vcd_mpeg_prog_info_t _progress = { 0, };
+  unsigned long *p_prev_seeks;
+  double t_start;
+  bool _stream;
 
   vcd_assert (obj != NULL);
 
@@ -128,13 +246,31 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
 
   vcd_assert (!obj->scanned);
 
+  /* padding each pack to a sector would waste what's missing of it */
+  if (!obj->repacked && vcd_mpeg_repack_needed_p (obj->data_source))
+    {
+      vcd_info ("mpeg stream isn't made of %d byte packs"
+                " -- repacketizing it on the fly", MPEG_PACKET_SIZE);
+      obj->repacked = vcd_mpeg_repack_new (obj->data_source);
+    }
+
+  _stream = vcd_data_source_is_stream (_source (obj));
+
+  t_start = _vcd_clock ();
+  p_prev_seeks = _vcd_stream_count_seeks (&obj->scan_seeks);
+
   memset (&state, 0, sizeof (state));
+  obj->fingerprint = VCD_HASH64_INIT;
 
   if (fix_scan_info)
     state.stream.scan_data_warnings = VCD_MPEG_SCAN_DATA_WARNS + 1;
 
-  vcd_data_source_seek (obj->data_source, 0);
-  length = vcd_data_source_stat (obj->data_source);
+  vcd_data_source_seek (_source (obj), 0);
+
+  /* for a pipe the length is only known when we're through; scanning
+     is what pulls it into the spool then */
+  if (!_stream)
+    length = vcd_data_source_stat (_source (obj));
 
   if (callback)
     {
@@ -143,13 +279,16 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
     }
 
 
-  while (pos < length)
+  while (_stream || pos < length)
     {
       char buf[2324] = { 0, };
-      int read_len = MIN (sizeof (buf), (length - pos));
+      int read_len = _stream ? sizeof (buf) : MIN (sizeof (buf), (length - pos));
       int pkt_len;
 
-      read_len = vcd_data_source_read (obj->data_source, buf, read_len, 1);
+      read_len = vcd_data_source_read (_source (obj), buf, read_len, 1);
+
+      if (_stream && !read_len)
+        break;
 
       pkt_len = vcd_mpeg_parse_packet (buf, read_len, true, &state);
 
@@ -158,15 +297,21 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
           if (!pno)
             vcd_error ("input mpeg stream has been deemed invalid -- aborting");
 
-          vcd_warn ("bad packet at packet #%d (stream byte offset %d)"
-                    " -- remaining %d bytes of stream will be ignored",
-                    pno, pos, length - pos);
+          if (_stream)
+            vcd_warn ("bad packet at packet #%d (stream byte offset %d)"
+                      " -- remainder of stream will be ignored", pno, pos);
+          else
+            vcd_warn ("bad packet at packet #%d (stream byte offset %d)"
+                      " -- remaining %d bytes of stream will be ignored",
+                      pno, pos, length - pos);
 
-          pos = length; /* don't fall into assert... */
+          if (!_stream)
+            pos = length; /* don't fall into assert... */
           break;
         }
 
-      if (callback && (pos - _progress.current_pos) > (length / 100))
+      if (callback && (pos - _progress.current_pos)
+          > (_stream ? VCD_MPEG_STREAM_PROGRESS : length / 100))
         {
           _progress.current_pos = pos;
           _progress.current_pack = pno;
@@ -186,7 +331,8 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
         case APS_SGI:
         case APS_ASGI:
           {
-            struct aps_data *_data = calloc(1, sizeof (struct aps_data));
+            struct aps_data *_data =
+              _vcd_arena_alloc (obj->arena, sizeof (struct aps_data));
 
             _data->packet_no = pno;
             _data->timestamp = state.packet.aps_pts;
@@ -204,6 +350,9 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
           break;
         }
 
+      if (obj->fingerprint_wanted)
+        obj->fingerprint = _vcd_hash64 (obj->fingerprint, buf, pkt_len);
+
       pos += pkt_len;
       pno++;
 
@@ -216,14 +365,22 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
 
           padpackets++;
 
-          vcd_data_source_seek (obj->data_source, pos);
+          vcd_data_source_seek (_source (obj), pos);
         }
     }
 
-  vcd_data_source_close (obj->data_source);
+  vcd_data_source_close (_source (obj));
+
+  if (_stream)
+    length = pos;
+
+  _vcd_stream_count_seeks (p_prev_seeks);
+  obj->scan_seconds = _vcd_clock () - t_start;
+  obj->scan_bytes = pos;
 
   if (callback)
     {
+      _progress.length = length;
       _progress.current_pos = pos;
       _progress.current_pack = pno;
       callback (&_progress, user_data);
@@ -258,6 +415,8 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
         }
   }
 
+  _index_aps (obj);
+
   if (padpackets)
     vcd_warn ("autopadding requires to insert additional %d zero bytes"
               " into MPEG stream (due to %d unaligned packets of %d total)",
@@ -266,40 +425,149 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps, bool fix_scan_info,
   obj->info.version = state.stream.version;
 }
 
-static double
-_approx_pts (CdioList_t *aps_list, uint32_t packet_no)
+void
+vcd_mpeg_source_copy_scan (VcdMpegSource_t *obj,
+                           const VcdMpegSource_t *p_scanned)
 {
-  double retval = 0;
-  CdioListNode_t *node;
+  int i;
 
-  struct aps_data *_laps = NULL;
+  vcd_assert (obj != NULL);
+  vcd_assert (p_scanned != NULL);
+  vcd_assert (p_scanned->scanned);
+  vcd_assert (!obj->scanned);
+
+  obj->info = p_scanned->info;
 
-  double last_pts_ratio = 0;
+  if (p_scanned->repacked)
+    obj->repacked = vcd_mpeg_repack_new (obj->data_source);
 
-  _CDIO_LIST_FOREACH (node, aps_list)
+  /* the aps lists point into p_scanned's arena */
+  for (i = 0; i < 3; i++)
     {
-      struct aps_data *_aps = _cdio_list_node_data (node);
+      CdioListNode_t *n;
 
-      if (_laps)
-        {
-          long p = _aps->packet_no;
-          double t = _aps->timestamp;
+      if (!p_scanned->info.shdr[i].aps_list)
+        continue;
+
+      obj->info.shdr[i].aps_list = _cdio_list_new ();
 
-          p -= _laps->packet_no;
-          t -= _laps->timestamp;
+      _CDIO_LIST_FOREACH (n, p_scanned->info.shdr[i].aps_list)
+        {
+          struct aps_data *_data =
+            _vcd_arena_alloc (obj->arena, sizeof (struct aps_data));
 
-          last_pts_ratio = t / p;
+          *_data = *(struct aps_data *) _cdio_list_node_data (n);
+          _cdio_list_append (obj->info.shdr[i].aps_list, _data);
         }
+    }
 
-      if (_aps->packet_no >= packet_no)
-        break;
+  _index_aps (obj);
+
+  obj->fingerprint_wanted = p_scanned->fingerprint_wanted;
+  obj->fingerprint = p_scanned->fingerprint;
+  obj->scanned = true;
+}
+
+/* the index of the first access point of idx at or after packet_no */
+static unsigned
+_aps_lower_bound (const struct aps_index *idx, uint32_t packet_no)
+{
+  unsigned lo = 0, hi = idx->count;
+
+  while (lo < hi)
+    {
+      const unsigned mid = lo + (hi - lo) / 2;
+
+      if (idx->aps[mid].packet_no < packet_no)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+/* the index of the first access point in [from, to) less than
+   SCAN_WINDOW seconds before pts, or to if there's none */
+static unsigned
+_aps_first_within (const struct aps_index *idx, unsigned from, unsigned to,
+                   double pts)
+{
+  if (!idx->ordered)
+    {
+      while (from < to && !(pts - idx->aps[from].timestamp < SCAN_WINDOW))
+        from++;
+
+      return from;
+    }
+
+  while (from < to)
+    {
+      const unsigned mid = from + (to - from) / 2;
+
+      if (pts - idx->aps[mid].timestamp < SCAN_WINDOW)
+        to = mid;
+      else
+        from = mid + 1;
+    }
+
+  return from;
+}
+
+/* the index of the last access point in [from, to) less than
+   SCAN_WINDOW seconds after pts, or to if there's none */
+static unsigned
+_aps_last_within (const struct aps_index *idx, unsigned from, unsigned to,
+                  double pts)
+{
+  unsigned lo = from, hi = to;
 
-      _laps = _aps;
+  if (!idx->ordered)
+    {
+      while (hi > from)
+        if (idx->aps[--hi].timestamp - pts < SCAN_WINDOW)
+          return hi;
+
+      return to;
     }
 
+  while (lo < hi)
+    {
+      const unsigned mid = lo + (hi - lo) / 2;
+
+      if (idx->aps[mid].timestamp - pts < SCAN_WINDOW)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo > from ? lo - 1 : to;
+}
+
+double
+_vcd_mpeg_aps_approx_pts (const struct aps_index *idx, uint32_t packet_no)
+{
+  const struct aps_data *_laps, *_a, *_b;
+  unsigned i;
+  double retval;
+
+  if (!idx->count)
+    return 0;
+
+  if (idx->count == 1)
+    return idx->aps[0].timestamp;
+
+  i = _aps_lower_bound (idx, packet_no);
+
+  /* extrapolate at the ends */
+  _laps = &idx->aps[i ? i - 1 : 0];
+  _b = &idx->aps[MIN (MAX (i, 1), idx->count - 1)];
+  _a = _b - 1;
+
   retval = packet_no;
   retval -= _laps->packet_no;
-  retval *= last_pts_ratio;
+  retval *= (_b->timestamp - _a->timestamp)
+    / (double) ((long) _b->packet_no - (long) _a->packet_no);
   retval += _laps->timestamp;
 
   return retval;
@@ -319,34 +587,37 @@ _set_scan_msf (msf_t *_msf, long lsn)
   _msf->f |= 0x80;
 }
 
-static void
-_fix_scan_info (struct vcd_mpeg_scan_data_t *scan_data_ptr,
-                unsigned packet_no, double pts, CdioList_t *aps_list)
+void
+_vcd_mpeg_aps_scan_offsets (const struct aps_index *idx, unsigned packet_no,
+                            double pts, long *p_prev, long *p_next,
+                            long *p_back, long *p_forw)
 {
-  CdioListNode_t *node;
   long _next = -1, _prev = -1, _forw = -1, _back = -1;
+  unsigned i, j;
 
-  _CDIO_LIST_FOREACH (node, aps_list)
+  /* [0, i) comes before packet_no, [j, count) after it */
+  i = j = _aps_lower_bound (idx, packet_no);
+  if (j < idx->count && idx->aps[j].packet_no == packet_no)
+    j++;
+
+  if (i > 0)
     {
-      struct aps_data *_aps = _cdio_list_node_data (node);
+      unsigned k = _aps_first_within (idx, 0, i, pts);
 
-      if (_aps->packet_no == packet_no)
-        continue;
-      else if (_aps->packet_no < packet_no)
-        {
-          _prev = _aps->packet_no;
+      _prev = idx->aps[i - 1].packet_no;
 
-          if (pts - _aps->timestamp < 10 && _back == -1)
-            _back = _aps->packet_no;
-        }
-      else if (_aps->packet_no > packet_no)
-        {
-          if (_next == -1)
-            _next = _aps->packet_no;
+      if (k < i)
+        _back = idx->aps[k].packet_no;
+    }
 
-          if (_aps->timestamp - pts < 10)
-            _forw = _aps->packet_no;
-        }
+  if (j < idx->count)
+    {
+      unsigned k = _aps_last_within (idx, j, idx->count, pts);
+
+      _next = idx->aps[j].packet_no;
+
+      if (k < idx->count)
+        _forw = idx->aps[k].packet_no;
     }
 
   if (_back == -1)
@@ -355,6 +626,21 @@ _fix_scan_info (struct vcd_mpeg_scan_data_t *scan_data_ptr,
   if (_forw == -1)
     _forw = packet_no;
 
+  *p_prev = _prev;
+  *p_next = _next;
+  *p_back = _back;
+  *p_forw = _forw;
+}
+
+static void
+_fix_scan_info (struct vcd_mpeg_scan_data_t *scan_data_ptr,
+                unsigned packet_no, double pts, const struct aps_index *idx)
+{
+  long _next, _prev, _forw, _back;
+
+  _vcd_mpeg_aps_scan_offsets (idx, packet_no, pts,
+                              &_prev, &_next, &_back, &_forw);
+
   _set_scan_msf (&scan_data_ptr->prev_ofs, _prev);
   _set_scan_msf (&scan_data_ptr->next_ofs, _next);
   _set_scan_msf (&scan_data_ptr->back_ofs, _back);
@@ -396,9 +682,9 @@ vcd_mpeg_source_get_packet (VcdMpegSource_t *obj, unsigned long packet_no,
 
   pos = obj->_read_pkt_pos;
   pno = obj->_read_pkt_no;
-  length = vcd_data_source_stat (obj->data_source);
+  length = vcd_data_source_stat (_source (obj));
 
-  vcd_data_source_seek (obj->data_source, pos);
+  vcd_data_source_seek (_source (obj), pos);
 
   while (pos < length)
     {
@@ -406,7 +692,7 @@ vcd_mpeg_source_get_packet (VcdMpegSource_t *obj, unsigned long packet_no,
       int read_len = MIN (sizeof (buf), (length - pos));
       int pkt_len;
 
-      vcd_data_source_read (obj->data_source, buf, read_len, 1);
+      vcd_data_source_read (_source (obj), buf, read_len, 1);
 
       pkt_len = vcd_mpeg_parse_packet (buf, read_len,
                                        fix_scan_info, &state);
@@ -437,11 +723,11 @@ vcd_mpeg_source_get_packet (VcdMpegSource_t *obj, unsigned long packet_no,
               if (state.packet.has_pts)
                 _pts = state.packet.pts - obj->info.min_pts;
               else
-                _pts = _approx_pts (obj->info.shdr[vid_idx].aps_list,
-                                    packet_no);
+                _pts = _vcd_mpeg_aps_approx_pts (&obj->aps_index[vid_idx],
+                                                 packet_no);
 
               _fix_scan_info (state.packet.scan_data_ptr, packet_no,
-                              _pts, obj->info.shdr[vid_idx].aps_list);
+                              _pts, &obj->aps_index[vid_idx]);
             }
 
 	  memset (packet_buf, 0, 2324);
@@ -460,7 +746,7 @@ vcd_mpeg_source_get_packet (VcdMpegSource_t *obj, unsigned long packet_no,
       pno++;
 
       if (pkt_len != read_len)
-	vcd_data_source_seek (obj->data_source, pos);
+	vcd_data_source_seek (_source (obj), pos);
     }
 
   vcd_assert (pos == length);
@@ -475,7 +761,7 @@ vcd_mpeg_source_close (VcdMpegSource_t *p_vcdmpegsource)
 {
   vcd_assert (p_vcdmpegsource != NULL);
 
-  vcd_data_source_close (p_vcdmpegsource->data_source);
+  vcd_data_source_close (_source (p_vcdmpegsource));
 }
 
 
@@ -40,6 +40,14 @@ struct aps_data
   double timestamp;
 };
 
+/* an aps list as an array, in packet order */
+struct aps_index
+{
+  struct aps_data *aps;
+  unsigned count;
+  bool ordered; /* timestamps don't decrease along the array */
+};
+
 /* enums */
 
 typedef enum {
@@ -88,6 +96,12 @@ vcd_mpeg_source_scan (VcdMpegSource_t *obj, bool strict_aps,
                       bool fix_scan_info, vcd_mpeg_prog_cb_t callback, 
                       void *user_data);
 
+/* takes over the result of vcd_mpeg_source_scan () on p_scanned, a
+   source for the same stream data, instead of scanning obj again */
+void
+vcd_mpeg_source_copy_scan (VcdMpegSource_t *obj,
+                           const VcdMpegSource_t *p_scanned);
+
 /* gets the packet at given position */
 int
 vcd_mpeg_source_get_packet (VcdMpegSource_t *obj, unsigned long packet_no,
@@ -101,9 +115,40 @@ vcd_mpeg_source_close (VcdMpegSource_t *obj);
 const struct vcd_mpeg_stream_info *
 vcd_mpeg_source_get_info (VcdMpegSource_t *obj);
 
+/* time spent in vcd_mpeg_source_scan (), and the bytes read and
+   seeks done by it */
+void
+vcd_mpeg_source_get_scan_stats (const VcdMpegSource_t *obj,
+                                double *p_seconds, unsigned long *p_bytes,
+                                unsigned long *p_seeks);
+
+/* makes vcd_mpeg_source_scan () compute the fingerprint; returns
+   false if obj has already been scanned without it */
+bool
+vcd_mpeg_source_want_fingerprint (VcdMpegSource_t *obj);
+
+/* hash over the stream data seen by vcd_mpeg_source_scan (); if it
+   didn't change, neither did the packets written for the stream */
+uint64_t
+vcd_mpeg_source_get_fingerprint (const VcdMpegSource_t *obj);
+
 long
 vcd_mpeg_source_stat (VcdMpegSource_t *obj);
 
+/* interpolates the timestamp of packet_no from the access points
+   around it, extrapolating before the first and after the last one */
+double
+_vcd_mpeg_aps_approx_pts (const struct aps_index *idx, uint32_t packet_no);
+
+/* the access points the scan information of packet_no, with
+   timestamp pts, points to: the ones just before and after it (-1 if
+   none), and the first before and the last after it less than 10
+   seconds away (packet_no if none) */
+void
+_vcd_mpeg_aps_scan_offsets (const struct aps_index *idx, unsigned packet_no,
+                            double pts, long *p_prev, long *p_next,
+                            long *p_back, long *p_forw);
+
 void
 vcd_mpeg_source_destroy (VcdMpegSource_t *obj, bool destroy_file_obj);
 
@@ -25,9 +25,11 @@
 #include <libvcd/files.h>
 
 /* Private headers */
+#include "arena.h"
 #include "data_structures.h"
 #include "directory.h"
 #include "image_sink.h"
+#include "manifest.h"
 #include "mpeg_stream.h"
 #include "salloc.h"
 #include "vcd.h"
@@ -58,6 +60,11 @@ typedef struct {
 
   /* computed on sector allocation */
   unsigned relative_start_extent; /* relative to iso data end */
+
+  /* computed when written, for the manifest */
+  uint32_t manifest_extent;
+  uint32_t manifest_sectors;
+  uint64_t manifest_key;
 } mpeg_sequence_t;
 
 /* work in progress -- fixme rename all occurences */
@@ -112,6 +119,15 @@ struct _VcdObj {
   /* output */
   VcdImageSink_t *image_sink;
 
+  /* see VCD_PARM_MANIFEST and VCD_PARM_REUSE_IMAGE */
+  char *manifest_fname;
+  char *reuse_image_fname;
+
+  /* while writing, the previous manifest and image, if usable */
+  VcdManifest_t *reuse_manifest;
+  VcdDataSource_t *reuse_source;
+  unsigned reuse_sector_size;
+
   /* ... */
   unsigned iso_size;
   char *iso_volume_label;
@@ -148,6 +164,10 @@ struct _VcdObj {
   /* dictionary */
   CdioList_t *buffer_dict_list;
 
+  /* memory allocated per output session; released by
+     vcd_obj_end_output () */
+  VcdArena_t *output_arena;
+
   /* aggregates */
   VcdSalloc *iso_bitmap;
 
@@ -160,9 +180,21 @@ struct _VcdObj {
   unsigned in_track;
 
   long last_cb_call;
+  double last_cb_time;
+
+  /* see VCD_PARM_PROGRESS_SECTORS and VCD_PARM_PROGRESS_INTERVAL */
+  unsigned progress_sectors;
+  unsigned progress_interval;
 
   progress_callback_t progress_callback;
   void *callback_user_data;
+
+  /* see vcd_obj_set_log_handler () */
+  vcd_log_handler2_t log_handler;
+  void *log_user_data;
+
+  /* see vcd_obj_get_stats () */
+  vcd_obj_stats_t stats;
 };
 
 /* private functions */
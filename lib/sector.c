@@ -186,23 +186,6 @@ do_encode_L2 (void *buf, sectortype_t sectortype, uint32_t address)
     break;
   case MODE_2:
     break;
-  case MODE_2_FORM_1:
-    {
-      mode2_form1_sector_t *sector = buf;
-
-      sector->edc = uint32_to_le(build_edc(buf, 16, 16+8+2048-1));
-
-      encode_L2_P((uint8_t*)buf+SYNC_LEN);
-      encode_L2_Q((uint8_t*)buf+SYNC_LEN);
-    }
-    break;
-  case MODE_2_FORM_2:
-    {
-      mode2_form2_sector_t *sector = buf;
-
-      sector->edc = uint32_to_le(build_edc(buf, 16, 16+8+2324-1));
-    }
-    break;
   default:
     vcd_assert_not_reached ();
   }
@@ -211,9 +194,10 @@ do_encode_L2 (void *buf, sectortype_t sectortype, uint32_t address)
 }
 
 void
-_vcd_make_mode2 (void *raw_sector, const void *data, uint32_t extent,
-                 uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci)
+_vcd_make_mode2_header (void *raw_sector, const void *data, uint32_t extent,
+                        uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci)
 {
+  raw_cd_sector_t *sector = raw_sector;
   uint8_t *subhdr = (uint8_t*)raw_sector+16;
 
   vcd_assert (raw_sector != NULL);
@@ -221,26 +205,74 @@ _vcd_make_mode2 (void *raw_sector, const void *data, uint32_t extent,
   vcd_assert (extent != SECTOR_NIL);
 
   memset (raw_sector, 0, CDIO_CD_FRAMESIZE_RAW);
+  memcpy (sector->sync, sync_pattern, sizeof (sync_pattern));
 
   subhdr[0] = subhdr[4] = fnum;
   subhdr[1] = subhdr[5] = cnum;
   subhdr[2] = subhdr[6] = sm;
   subhdr[3] = subhdr[7] = ci;
 
+  memcpy ((char*)raw_sector+CDIO_CD_XA_SYNC_HEADER, data,
+          (sm & SM_FORM2) ? M2F2_SECTOR_SIZE : CDIO_CD_FRAMESIZE);
+
+  build_address (raw_sector, (sm & SM_FORM2) ? MODE_2_FORM_2 : MODE_2_FORM_1,
+                 extent+CDIO_PREGAP_SECTORS);
+}
+
+void
+_vcd_make_mode2_edc (void *raw_sector)
+{
+  uint8_t sm;
+
+  vcd_assert (raw_sector != NULL);
+
+  sm = ((uint8_t*)raw_sector)[16+2];
+
   if (sm & SM_FORM2)
     {
-      memcpy ((char*)raw_sector+CDIO_CD_XA_SYNC_HEADER, data,
-              M2F2_SECTOR_SIZE);
-      do_encode_L2 (raw_sector, MODE_2_FORM_2, extent+CDIO_PREGAP_SECTORS);
+      mode2_form2_sector_t *sector = raw_sector;
+
+      sector->edc = uint32_to_le(build_edc(raw_sector, 16, 16+8+2324-1));
     }
   else
     {
-      memcpy ((char*)raw_sector+CDIO_CD_XA_SYNC_HEADER, data,
-              CDIO_CD_FRAMESIZE);
-      do_encode_L2 (raw_sector, MODE_2_FORM_1, extent+CDIO_PREGAP_SECTORS);
+      mode2_form1_sector_t *sector = raw_sector;
+
+      sector->edc = uint32_to_le(build_edc(raw_sector, 16, 16+8+2048-1));
     }
 }
 
+void
+_vcd_make_mode2_ecc (void *raw_sector)
+{
+  uint8_t *p_header = (uint8_t*)raw_sector+SYNC_LEN;
+  uint8_t header[HEADER_LEN];
+
+  vcd_assert (raw_sector != NULL);
+
+  if (((uint8_t*)raw_sector)[16+2] & SM_FORM2)
+    return;
+
+  /* for mode 2 the header is taken as all zero by the P and Q
+     parities */
+  memcpy (header, p_header, HEADER_LEN);
+  memset (p_header, 0, HEADER_LEN);
+
+  encode_L2_P(p_header);
+  encode_L2_Q(p_header);
+
+  memcpy (p_header, header, HEADER_LEN);
+}
+
+void
+_vcd_make_mode2 (void *raw_sector, const void *data, uint32_t extent,
+                 uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci)
+{
+  _vcd_make_mode2_header (raw_sector, data, extent, fnum, cnum, sm, ci);
+  _vcd_make_mode2_edc (raw_sector);
+  _vcd_make_mode2_ecc (raw_sector);
+}
+
 void
 _vcd_make_raw_mode2 (void *raw_sector, const void *data, uint32_t extent)
 {
@@ -254,6 +286,90 @@ _vcd_make_raw_mode2 (void *raw_sector, const void *data, uint32_t extent)
   do_encode_L2 (raw_sector, MODE_2, extent+CDIO_PREGAP_SECTORS);
 }
 
+int
+_vcd_check_mode2 (const void *raw_sector, uint32_t extent)
+{
+  const uint8_t *p_sector = raw_sector;
+  const uint8_t *subhdr = p_sector + SYNC_LEN + HEADER_LEN;
+  int problems = 0;
+
+  vcd_assert (raw_sector != NULL);
+
+  if (memcmp (p_sector, sync_pattern, sizeof (sync_pattern)))
+    problems |= VCD_SECTOR_BAD_SYNC;
+
+  if (extent != SECTOR_NIL)
+    {
+      msf_t msf;
+
+      cdio_lba_to_msf (extent + CDIO_PREGAP_SECTORS, &msf);
+
+      if (memcmp (&msf, p_sector + SYNC_LEN, sizeof (msf_t)))
+        problems |= VCD_SECTOR_BAD_ADDRESS;
+    }
+
+  if (p_sector[SYNC_LEN + 3] != 2)
+    problems |= VCD_SECTOR_BAD_MODE;
+
+  if (memcmp (subhdr, subhdr + 4, 4))
+    problems |= VCD_SECTOR_BAD_SUBHEADER;
+
+  if (subhdr[2] & SM_FORM2)
+    {
+      const mode2_form2_sector_t *sector = raw_sector;
+
+      /* the form 2 EDC is optional, zero if left out */
+      if (sector->edc
+          && uint32_from_le (sector->edc)
+          != build_edc (raw_sector, 16, 16+8+2324-1))
+        problems |= VCD_SECTOR_BAD_EDC;
+    }
+  else
+    {
+      const mode2_form1_sector_t *sector = raw_sector;
+      uint8_t buf[CDIO_CD_FRAMESIZE_RAW];
+
+      if (uint32_from_le (sector->edc)
+          != build_edc (raw_sector, 16, 16+8+2048-1))
+        problems |= VCD_SECTOR_BAD_EDC;
+
+      /* as in _vcd_make_mode2_ecc (), with the header taken as zero */
+      memcpy (buf, raw_sector, sizeof (buf));
+      memset (buf + SYNC_LEN, 0, HEADER_LEN);
+
+      encode_L2_P (buf + SYNC_LEN);
+      encode_L2_Q (buf + SYNC_LEN);
+
+      if (memcmp (buf + CDIO_CD_FRAMESIZE_RAW - L2_P - L2_Q,
+                  sector->l2_p, L2_P + L2_Q))
+        problems |= VCD_SECTOR_BAD_ECC;
+    }
+
+  return problems;
+}
+
+const char *
+_vcd_check_mode2_name (int problem)
+{
+  switch (problem)
+    {
+    case VCD_SECTOR_BAD_SYNC:
+      return "sync";
+    case VCD_SECTOR_BAD_ADDRESS:
+      return "address";
+    case VCD_SECTOR_BAD_MODE:
+      return "mode";
+    case VCD_SECTOR_BAD_SUBHEADER:
+      return "subheader";
+    case VCD_SECTOR_BAD_EDC:
+      return "EDC";
+    case VCD_SECTOR_BAD_ECC:
+      return "ECC";
+    }
+
+  return "unknown";
+}
+
 
 /*
  * Local variables:
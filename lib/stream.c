@@ -39,6 +39,19 @@
 #include "stream.h"
 #include "util.h"
 
+/* see _vcd_stream_count_seeks () */
+static VCD_THREAD_LOCAL unsigned long *_seek_counter = NULL;
+
+unsigned long *
+_vcd_stream_count_seeks (unsigned long *p_counter)
+{
+  unsigned long *p_prev = _seek_counter;
+
+  _seek_counter = p_counter;
+
+  return p_prev;
+}
+
 /*
  * DataSource implementations
  */
@@ -88,6 +101,8 @@ vcd_data_sink_seek(VcdDataSink* obj, long offset)
   if (obj->position != offset) {
     vcd_warn("had to reposition DataSink from %ld to %ld!", obj->position, offset);
     obj->position = offset;
+    if (_seek_counter)
+      (*_seek_counter)++;
     return obj->op.seek(obj->user_data, offset);
   }
 
@@ -162,6 +177,7 @@ struct _VcdDataSource {
   vcd_data_source_io_functions op;
   int is_open;
   long position;
+  bool is_stream;
 };
 
 static void
@@ -195,6 +211,8 @@ vcd_data_source_seek(VcdDataSource_t* p_obj, long offset)
              offset);
 #endif
     p_obj->position = offset;
+    if (_seek_counter)
+      (*_seek_counter)++;
     return p_obj->op.seek(p_obj->user_data, offset);
   }
 
@@ -233,6 +251,22 @@ vcd_data_source_read(VcdDataSource_t* obj, void *ptr, long size, long nmemb)
   return read_bytes;
 }
 
+void
+vcd_data_source_set_stream(VcdDataSource_t *p_obj)
+{
+  vcd_assert (p_obj != NULL);
+
+  p_obj->is_stream = true;
+}
+
+bool
+vcd_data_source_is_stream(const VcdDataSource_t *p_obj)
+{
+  vcd_assert (p_obj != NULL);
+
+  return p_obj->is_stream;
+}
+
 long
 vcd_data_source_stat(VcdDataSource_t *p_obj)
 {
@@ -107,12 +107,28 @@ vcd_data_source_seek(VcdDataSource_t *p_obj, long int offset);
 long
 vcd_data_source_stat(VcdDataSource_t *p_obj);
 
+/* marks p_obj as coming from a pipe or the like, whose length isn't
+   known before it has been read to the end; for such sources
+   vcd_data_source_stat () has to read all of it first, so readers
+   which can do with less should rather read until EOF */
+void
+vcd_data_source_set_stream(VcdDataSource_t *p_obj);
+
+bool
+vcd_data_source_is_stream(const VcdDataSource_t *p_obj);
+
 void
 vcd_data_source_destroy(VcdDataSource_t *p_obj);
 
 void
 vcd_data_source_close(VcdDataSource_t *p_obj);
 
+/* from now on, count the repositionings of data sources and sinks
+   done by the calling thread in *p_counter (none if NULL); returns
+   the counter used so far, to be put back when done */
+unsigned long *
+_vcd_stream_count_seeks (unsigned long *p_counter);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -32,6 +32,7 @@
 #include <libvcd/logging.h>
 
 /* Private headers */
+#include "vcd_assert.h"
 #include "stream_stdio.h"
 #include "util.h"
 
@@ -42,6 +43,8 @@ typedef struct {
   FILE *fd;
   char *fd_buf;
   off_t st_size; /* used only for source */
+  int out_fd;   /* used only for sinks; if >= 0, written instead of
+                   pathname and left open */
 } _UserData;
 
 static int
@@ -49,6 +52,12 @@ _stdio_open_source (void *user_data)
 {
   _UserData *const ud = user_data;
 
+  if (!strcmp (ud->pathname, "-"))
+    {
+      ud->fd = stdin;
+      return 0;
+    }
+
   if ((ud->fd = fopen (ud->pathname, "rb")))
     {
       ud->fd_buf = calloc(1, VCD_STREAM_STDIO_BUFSIZE);
@@ -63,7 +72,12 @@ _stdio_open_sink (void *user_data)
 {
   _UserData *const ud = user_data;
 
-  if ((ud->fd = fopen (ud->pathname, "wb")))
+  if (ud->out_fd >= 0)
+    ud->fd = fdopen (dup (ud->out_fd), "wb");
+  else
+    ud->fd = fopen (ud->pathname, "wb");
+
+  if (ud->fd)
     {
       ud->fd_buf = calloc(1, VCD_STREAM_STDIO_BUFSIZE);
       setvbuf (ud->fd, ud->fd_buf, _IOFBF, VCD_STREAM_STDIO_BUFSIZE);
@@ -77,7 +91,7 @@ _stdio_close(void *user_data)
 {
   _UserData *const ud = user_data;
 
-  if (fclose (ud->fd))
+  if (ud->fd != stdin && fclose (ud->fd))
     vcd_error ("fclose (): %s", strerror (errno));
 
   ud->fd = NULL;
@@ -169,8 +183,11 @@ vcd_data_source_new_stdio(const char pathname[])
   vcd_data_source_io_functions funcs = { 0, };
   _UserData *ud = NULL;
   struct stat statbuf;
+  const bool _stdin_p = !strcmp (pathname, "-");
 
-  if (stat (pathname, &statbuf) == -1)
+  if (_stdin_p)
+    memset (&statbuf, 0, sizeof (statbuf));
+  else if (stat (pathname, &statbuf) == -1)
     {
       vcd_error ("could not stat() file `%s': %s", pathname, strerror (errno));
       return NULL;
@@ -190,26 +207,239 @@ vcd_data_source_new_stdio(const char pathname[])
 
   new_obj = vcd_data_source_new(ud, &funcs);
 
+  if (_stdin_p || !(S_ISREG (statbuf.st_mode) || S_ISBLK (statbuf.st_mode)))
+    {
+      vcd_debug ("`%s' can't be seeked in, spooling it", pathname);
+      new_obj = vcd_data_source_new_spool (new_obj, VCD_STREAM_SPOOL_MEM);
+    }
+
   return new_obj;
 }
 
+/*
+ * spooling source
+ */
 
-VcdDataSink*
-vcd_data_sink_new_stdio(const char pathname[])
+#define VCD_STREAM_SPOOL_CHUNK (64*1024)
+
+typedef struct {
+  VcdDataSource_t *stream;
+  bool eof;
+
+  unsigned long mem_limit;
+  uint8_t *mem;         /* spooled data while size <= mem_limit... */
+  unsigned long mem_alloced;
+  FILE *spool;          /* ...and after that */
+
+  unsigned long size;   /* bytes read from stream so far */
+  unsigned long pos;
+} _SpoolData;
+
+/* returns false if the data could not be kept */
+static bool
+_spool_append (_SpoolData *sd, const void *buf, unsigned long count)
+{
+  if (!sd->spool && sd->size + count > sd->mem_limit)
+    {
+      vcd_debug ("spooled stream exceeds %lu bytes, moving it to a"
+                 " temporary file", sd->mem_limit);
+
+      if (!(sd->spool = tmpfile ()))
+        {
+          vcd_error ("tmpfile (): %s", strerror (errno));
+          return false;
+        }
+
+      if (sd->size && fwrite (sd->mem, 1, sd->size, sd->spool) != sd->size)
+        {
+          vcd_error ("fwrite (): %s", strerror (errno));
+          fclose (sd->spool);
+          sd->spool = NULL;
+          return false;
+        }
+
+      free (sd->mem);
+      sd->mem = NULL;
+      sd->mem_alloced = 0;
+    }
+
+  if (sd->spool)
+    {
+      if (fseek (sd->spool, 0, SEEK_END)
+          || fwrite (buf, 1, count, sd->spool) != count)
+        {
+          vcd_error ("spooling stream: %s", strerror (errno));
+          return false;
+        }
+    }
+  else
+    {
+      if (sd->size + count > sd->mem_alloced)
+        {
+          unsigned long n = sd->mem_alloced ? sd->mem_alloced
+            : VCD_STREAM_SPOOL_CHUNK;
+          uint8_t *p_mem;
+
+          while (n < sd->size + count)
+            n *= 2;
+
+          if (!(p_mem = realloc (sd->mem, n)))
+            {
+              vcd_error ("spooling stream: can't allocate %lu bytes", n);
+              return false;
+            }
+
+          sd->mem = p_mem;
+          sd->mem_alloced = n;
+        }
+
+      memcpy (sd->mem + sd->size, buf, count);
+    }
+
+  sd->size += count;
+
+  return true;
+}
+
+/* reads from the stream until at least upto bytes are spooled */
+static void
+_spool_fill (_SpoolData *sd, unsigned long upto)
+{
+  while (!sd->eof && sd->size < upto)
+    {
+      uint8_t buf[VCD_STREAM_SPOOL_CHUNK];
+      long n = vcd_data_source_read (sd->stream, buf, 1, sizeof (buf));
+
+      /* a spooling error ends the stream where it happened */
+      if (n <= 0 || !_spool_append (sd, buf, n))
+        {
+          sd->eof = true;
+          vcd_data_source_close (sd->stream);
+          break;
+        }
+    }
+}
+
+static int
+_spool_open (void *user_data)
+{
+  _SpoolData *const sd = user_data;
+
+  sd->pos = 0;
+
+  return 0;
+}
+
+static int
+_spool_close (void *user_data)
+{
+  /* the spooled data has to stay for the next time around */
+  return 0;
+}
+
+static long
+_spool_seek (void *user_data, long offset)
+{
+  _SpoolData *const sd = user_data;
+
+  sd->pos = offset;
+
+  return offset;
+}
+
+static long
+_spool_stat (void *user_data)
+{
+  _SpoolData *const sd = user_data;
+
+  _spool_fill (sd, (unsigned long) -1);
+
+  return sd->size;
+}
+
+static long
+_spool_read (void *user_data, void *buf, long count)
+{
+  _SpoolData *const sd = user_data;
+  unsigned long n;
+
+  _spool_fill (sd, sd->pos + count);
+
+  if (sd->pos >= sd->size)
+    return 0;
+
+  n = MIN ((unsigned long) count, sd->size - sd->pos);
+
+  if (sd->spool)
+    {
+      if (fseek (sd->spool, sd->pos, SEEK_SET)
+          || fread (buf, 1, n, sd->spool) != n)
+        vcd_error ("reading spooled stream: %s", strerror (errno));
+    }
+  else
+    memcpy (buf, sd->mem + sd->pos, n);
+
+  sd->pos += n;
+
+  return n;
+}
+
+static void
+_spool_free (void *user_data)
+{
+  _SpoolData *const sd = user_data;
+
+  vcd_data_source_destroy (sd->stream);
+
+  if (sd->spool)
+    fclose (sd->spool);
+
+  free (sd->mem);
+  free (sd);
+}
+
+VcdDataSource_t *
+vcd_data_source_new_spool(VcdDataSource_t *p_stream, unsigned long mem_limit)
+{
+  VcdDataSource_t *new_obj = NULL;
+  vcd_data_source_io_functions funcs = { 0, };
+  _SpoolData *sd = NULL;
+
+  if (!p_stream)
+    return NULL;
+
+  sd = calloc(1, sizeof (_SpoolData));
+
+  sd->stream = p_stream;
+  sd->mem_limit = mem_limit;
+
+  funcs.open = _spool_open;
+  funcs.seek = _spool_seek;
+  funcs.stat = _spool_stat;
+  funcs.read = _spool_read;
+  funcs.close = _spool_close;
+  funcs.free = _spool_free;
+
+  new_obj = vcd_data_source_new(sd, &funcs);
+  vcd_data_source_set_stream (new_obj);
+
+  return new_obj;
+}
+
+
+static VcdDataSink*
+_data_sink_new_stdio (const char pathname[], int fd)
 {
   VcdDataSink *new_obj = NULL;
   vcd_data_sink_io_functions funcs;
   _UserData *ud = NULL;
-  struct stat statbuf;
-
-  if (stat (pathname, &statbuf) != -1)
-    vcd_warn ("file `%s' exist already, will get overwritten!", pathname);
 
   ud = calloc(1, sizeof (_UserData));
 
   memset (&funcs, 0, sizeof (funcs));
 
   ud->pathname = strdup (pathname);
+  ud->out_fd = fd;
 
   funcs.open = _stdio_open_sink;
   funcs.seek = _stdio_seek;
@@ -222,6 +452,29 @@ vcd_data_sink_new_stdio(const char pathname[])
   return new_obj;
 }
 
+VcdDataSink*
+vcd_data_sink_new_stdio(const char pathname[])
+{
+  struct stat statbuf;
+
+  if (stat (pathname, &statbuf) != -1)
+    vcd_warn ("file `%s' exist already, will get overwritten!", pathname);
+
+  return _data_sink_new_stdio (pathname, -1);
+}
+
+VcdDataSink*
+vcd_data_sink_new_stdio_fd (int fd)
+{
+  char pathname[32];
+
+  vcd_assert (fd >= 0);
+
+  snprintf (pathname, sizeof (pathname), "<fd %d>", fd);
+
+  return _data_sink_new_stdio (pathname, fd);
+}
+
 
 /*
  * Local variables:
@@ -28,9 +28,27 @@
 VcdDataSink*
 vcd_data_sink_new_stdio(const char pathname[]);
 
+/* writes to the open file descriptor fd, e.g. stdout; fd is left open
+   and may only be written to sequentially */
+VcdDataSink*
+vcd_data_sink_new_stdio_fd (int fd);
+
+/* pathname "-" stands for stdin; pipes and other files that can't be
+   seeked in are read through vcd_data_source_new_spool () */
 VcdDataSource_t *
 vcd_data_source_new_stdio(const char pathname[]);
 
+/* default for mem_limit of vcd_data_source_new_spool () */
+#define VCD_STREAM_SPOOL_MEM (64*1024*1024)
+
+/* makes a seekable source out of p_stream, which is read only once
+   and front to back; what has been read is kept in memory up to
+   mem_limit bytes, beyond that in a temporary file. p_stream gets
+   destroyed along with the returned source */
+VcdDataSource_t *
+vcd_data_source_new_spool(VcdDataSource_t *p_stream,
+                          unsigned long mem_limit);
+
 #endif /* __VCD_STREAM_STDIO_H__ */
 
 
@@ -26,6 +26,13 @@
 #include <string.h>
 #include <cdio/bytesex.h>
 
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
 /* Private includes */
 #include "vcd_assert.h"
 #include "util.h"
@@ -132,6 +139,23 @@ _vcd_memdup (const void *mem, size_t count)
   return new_mem;
 }
 
+/* true if all count bytes at mem are zero; once the head is known to be
+   zero the rest is compared against itself shifted by the head length,
+   which lets memcmp () use its wide word/vector compare loop */
+bool
+_vcd_mem_is_zero (const void *mem, size_t count)
+{
+  const uint8_t *buf = mem;
+  const size_t head = count < 16 ? count : 16;
+  size_t i;
+
+  for (i = 0; i < head; i++)
+    if (buf[i])
+      return false;
+
+  return !memcmp (buf, buf + head, count - head);
+}
+
 char *
 _vcd_strdup_upper (const char str[])
 {
@@ -153,6 +177,43 @@ _vcd_strdup_upper (const char str[])
   return new_str;
 }
 
+double
+_vcd_clock (void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+  struct timespec ts;
+
+  if (!clock_gettime (CLOCK_MONOTONIC, &ts))
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+
+#ifdef HAVE_GETTIMEOFDAY
+  {
+    struct timeval tv;
+
+    gettimeofday (&tv, NULL);
+
+    return tv.tv_sec + tv.tv_usec / 1e6;
+  }
+#else
+  return (double) time (NULL);
+#endif
+}
+
+uint64_t
+_vcd_hash64 (uint64_t hash, const void *data, size_t len)
+{
+  const uint8_t *p = data;
+
+  while (len--)
+    {
+      hash ^= *p++;
+      hash *= 0x100000001b3ULL;
+    }
+
+  return hash;
+}
+
 
 /*
  * Local variables:
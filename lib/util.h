@@ -23,6 +23,41 @@
 
 #include <stdlib.h>
 #include <libvcd/types.h>
+#include <libvcd/logging.h>
+
+/* storage class for state that must not be shared between threads */
+#ifdef HAVE_TLS
+# define VCD_THREAD_LOCAL __thread
+#else
+# define VCD_THREAD_LOCAL
+#endif
+
+/* per-object log handlers: public entry points bracket their work
+   with these so that messages go to the object's handler */
+typedef struct
+{
+  vcd_log_handler2_t handler;
+  void *p_user_data;
+} _vcd_log_scope_t;
+
+void
+_vcd_log_scope_enter (_vcd_log_scope_t *p_saved,
+                      vcd_log_handler2_t handler, void *p_user_data);
+
+void
+_vcd_log_scope_leave (const _vcd_log_scope_t *p_saved);
+
+/* seconds since some fixed point in the past; only differences
+   between two calls mean something */
+double
+_vcd_clock (void);
+
+/* FNV-1a; start with VCD_HASH64_INIT and feed the result of one call
+   into the next to hash several pieces of data */
+#define VCD_HASH64_INIT 0xcbf29ce484222325ULL
+
+uint64_t
+_vcd_hash64 (uint64_t hash, const void *data, size_t len);
 
 static inline unsigned
 _vcd_len2blocks (unsigned len, int blocksize)
@@ -69,6 +104,9 @@ _vcd_strfreev(char **strv);
 void *
 _vcd_memdup (const void *mem, size_t count);
 
+bool
+_vcd_mem_is_zero (const void *mem, size_t count);
+
 char *
 _vcd_strdup_upper (const char str[]);
 
@@ -26,6 +26,12 @@
 #include <string.h>
 #include <ctype.h>
 #include <math.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_RESOURCE_H
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
 
 #define _VCD_INFO_PRIVATE_H
 /* We don't want to pull in cdio's config */
@@ -49,6 +55,7 @@
 #include "obj.h"
 #include "pbc.h"
 #include "salloc.h"
+#include "stream_stdio.h"
 #include "util.h"
 #include "vcd.h"
 
@@ -61,15 +68,12 @@ static void sequence_free(mpeg_sequence_t *data)
   if (data != NULL) free(data);
 }
 
-static void dict_free(struct _dict_t *data)
-{
-  if (data != NULL) free(data);
-}
+static void
+_vcd_obj_end_output (VcdObj_t *p_obj);
+
+static void
+_close_reuse_image (VcdObj_t *p_obj);
 
-static void cue_data_free(vcd_cue_t *data)
-{
-  if (data != NULL) free(data);
-}
 
 
 /* exported private functions
@@ -262,7 +266,7 @@ VcdObj_t *
 vcd_obj_new (vcd_type_t vcd_type)
 {
   VcdObj_t *p_new_obj = NULL;
-  static bool _first = true;
+  static VCD_THREAD_LOCAL bool _first = true;
 
   if (_first)
     {
@@ -317,6 +321,8 @@ vcd_obj_new (vcd_type_t vcd_type)
   /* post-gap after last track */
   p_new_obj->leadout_pregap = CDIO_POSTGAP_SECTORS;
 
+  p_new_obj->progress_sectors = 75;
+
   if (_vcd_obj_has_cap_p (p_new_obj, _CAP_TRACK_MARGINS))
     {
       p_new_obj->track_front_margin = 30;
@@ -374,10 +380,26 @@ _vcd_obj_remove_mpeg_track (VcdObj_t *p_vcdobj, int track_id)
   _cdio_list_node_free (node, true, NULL);
 }
 
-int
-vcd_obj_append_segment_play_item (VcdObj_t *p_vcdobj,
-                                  VcdMpegSource_t *p_mpeg_source,
-                                  const char item_id[])
+static void
+_count_scan (VcdObj_t *p_obj, const VcdMpegSource_t *p_mpeg_source)
+{
+  vcd_stage_stats_t *p_stage = &p_obj->stats.stage[VCD_STAGE_SCAN];
+  double seconds;
+  unsigned long bytes, seeks;
+
+  vcd_mpeg_source_get_scan_stats (p_mpeg_source, &seconds, &bytes, &seeks);
+
+  p_stage->seconds += seconds;
+  p_stage->bytes += bytes;
+  p_stage->count++;
+
+  p_obj->stats.seeks += seeks;
+}
+
+static int
+_vcd_obj_append_segment_play_item (VcdObj_t *p_vcdobj,
+                                   VcdMpegSource_t *p_mpeg_source,
+                                   const char item_id[])
 {
   mpeg_segment_t *segment = NULL;
 
@@ -414,6 +436,8 @@ vcd_obj_append_segment_play_item (VcdObj_t *p_vcdobj,
       return -1;
     }
 
+  _count_scan (p_vcdobj, p_mpeg_source);
+
   /* create list node */
 
   segment = calloc(1, sizeof (mpeg_sequence_t));
@@ -437,10 +461,28 @@ vcd_obj_append_segment_play_item (VcdObj_t *p_vcdobj,
 }
 
 int
-vcd_obj_append_sequence_play_item (VcdObj_t *p_vcdobj,
-                                   VcdMpegSource_t *p_mpeg_source,
-                                   const char item_id[],
-                                   const char default_entry_id[])
+vcd_obj_append_segment_play_item (VcdObj_t *p_vcdobj,
+                                  VcdMpegSource_t *p_mpeg_source,
+                                  const char item_id[])
+{
+  _vcd_log_scope_t scope;
+  int rc;
+
+  vcd_assert (p_vcdobj != NULL);
+
+  _vcd_log_scope_enter (&scope, p_vcdobj->log_handler,
+                        p_vcdobj->log_user_data);
+  rc = _vcd_obj_append_segment_play_item (p_vcdobj, p_mpeg_source, item_id);
+  _vcd_log_scope_leave (&scope);
+
+  return rc;
+}
+
+static int
+_vcd_obj_append_sequence_play_item (VcdObj_t *p_vcdobj,
+                                    VcdMpegSource_t *p_mpeg_source,
+                                    const char item_id[],
+                                    const char default_entry_id[])
 {
   unsigned length;
   mpeg_sequence_t *sequence = NULL;
@@ -467,9 +509,19 @@ vcd_obj_append_sequence_play_item (VcdObj_t *p_vcdobj,
       return -1;
     }
 
+  /* the manifest keys need it */
+  if ((p_vcdobj->manifest_fname || p_vcdobj->reuse_image_fname)
+      && !vcd_mpeg_source_want_fingerprint (p_mpeg_source))
+    {
+      vcd_error ("mpeg sequence item #%d was scanned without a fingerprint",
+                 track_no);
+      return -1;
+    }
+
   vcd_info ("scanning mpeg sequence item #%d for scanpoints...", track_no);
   vcd_mpeg_source_scan (p_mpeg_source, !p_vcdobj->relaxed_aps,
                         p_vcdobj->update_scan_offsets, NULL, NULL);
+  _count_scan (p_vcdobj, p_mpeg_source);
 
   sequence = calloc(1, sizeof (mpeg_sequence_t));
 
@@ -553,6 +605,26 @@ vcd_obj_append_sequence_play_item (VcdObj_t *p_vcdobj,
   return track_no;
 }
 
+int
+vcd_obj_append_sequence_play_item (VcdObj_t *p_vcdobj,
+                                   VcdMpegSource_t *p_mpeg_source,
+                                   const char item_id[],
+                                   const char default_entry_id[])
+{
+  _vcd_log_scope_t scope;
+  int rc;
+
+  vcd_assert (p_vcdobj != NULL);
+
+  _vcd_log_scope_enter (&scope, p_vcdobj->log_handler,
+                        p_vcdobj->log_user_data);
+  rc = _vcd_obj_append_sequence_play_item (p_vcdobj, p_mpeg_source,
+                                           item_id, default_entry_id);
+  _vcd_log_scope_leave (&scope);
+
+  return rc;
+}
+
 static int
 _pause_cmp (pause_t *ent1, pause_t *ent2)
 {
@@ -712,10 +784,17 @@ vcd_obj_destroy (VcdObj_t *p_obj)
   CdioListNode_t *p_node;
 
   vcd_assert (p_obj != NULL);
-  vcd_assert (!p_obj->in_output);
+
+  /* an error handler which didn't return may have cut the output short
+     (see vcd_log_handler_t) */
+  if (p_obj->in_output)
+    _vcd_obj_end_output (p_obj);
+  _close_reuse_image (p_obj);
 
   free (p_obj->iso_volume_label);
   free (p_obj->iso_application_id);
+  free (p_obj->manifest_fname);
+  free (p_obj->reuse_image_fname);
 
   _CDIO_LIST_FOREACH (p_node, p_obj->custom_file_list)
     {
@@ -834,6 +913,18 @@ vcd_obj_set_param_uint (VcdObj_t *p_obj, vcd_parm_t param, unsigned arg)
       vcd_debug ("changed rear margin to %u", p_obj->track_rear_margin);
       break;
 
+    case VCD_PARM_PROGRESS_SECTORS:
+      p_obj->progress_sectors = arg ? arg : 1;
+      vcd_debug ("changed progress quantum to %u sectors",
+                 p_obj->progress_sectors);
+      break;
+
+    case VCD_PARM_PROGRESS_INTERVAL:
+      p_obj->progress_interval = arg;
+      vcd_debug ("changed progress interval to %u ms",
+                 p_obj->progress_interval);
+      break;
+
     default:
       vcd_assert_not_reached ();
       break;
@@ -848,6 +939,16 @@ vcd_obj_set_param_str (VcdObj_t *p_obj, vcd_parm_t param, const char *arg)
   vcd_assert (p_obj != NULL);
   vcd_assert (arg != NULL);
 
+  /* tracks are only fingerprinted for the manifest while they're
+     scanned */
+  if ((param == VCD_PARM_MANIFEST || param == VCD_PARM_REUSE_IMAGE)
+      && _cdio_list_length (p_obj->mpeg_sequence_list))
+    {
+      vcd_error ("manifest and image to reuse have to be set before"
+                 " sequence items are added");
+      return -1;
+    }
+
   switch (param)
     {
     case VCD_PARM_VOLUME_ID:
@@ -905,6 +1006,18 @@ vcd_obj_set_param_str (VcdObj_t *p_obj, vcd_parm_t param, const char *arg)
       vcd_debug ("changed album id to `%s'", p_obj->info_album_id);
       break;
 
+    case VCD_PARM_MANIFEST:
+      free (p_obj->manifest_fname);
+      p_obj->manifest_fname = strdup (arg);
+      vcd_debug ("changed manifest file to `%s'", p_obj->manifest_fname);
+      break;
+
+    case VCD_PARM_REUSE_IMAGE:
+      free (p_obj->reuse_image_fname);
+      p_obj->reuse_image_fname = strdup (arg);
+      vcd_debug ("changed image to reuse to `%s'", p_obj->reuse_image_fname);
+      break;
+
     default:
       vcd_assert_not_reached ();
       break;
@@ -913,6 +1026,16 @@ vcd_obj_set_param_str (VcdObj_t *p_obj, vcd_parm_t param, const char *arg)
   return 0;
 }
 
+void
+vcd_obj_set_log_handler (VcdObj_t *p_obj, vcd_log_handler2_t handler,
+                         void *p_user_data)
+{
+  vcd_assert (p_obj != NULL);
+
+  p_obj->log_handler = handler;
+  p_obj->log_user_data = handler ? p_user_data : NULL;
+}
+
 int
 vcd_obj_set_param_bool (VcdObj_t *p_obj, vcd_parm_t param, bool arg)
 {
@@ -1492,17 +1615,36 @@ _finalize_vcd_iso_track (VcdObj_t *p_obj)
   _finalize_vcd_iso_track_filesystem (p_obj);
 }
 
+/* calls the progress callback, every progress_sectors sectors but not
+   more often than every progress_interval milliseconds, unless forced */
 static int
 _callback_wrapper (VcdObj_t *p_obj, int force)
 {
-  const int cb_frequency = 75;
-
-  if (p_obj->last_cb_call + cb_frequency > p_obj->sectors_written && !force)
+  if (!p_obj->progress_callback)
     return 0;
 
+  if (!force)
+    {
+      if (p_obj->last_cb_call + p_obj->progress_sectors
+          > p_obj->sectors_written)
+        return 0;
+
+      if (p_obj->progress_interval)
+        {
+          const double t_now = _vcd_clock ();
+
+          if ((t_now - p_obj->last_cb_time) * 1000 < p_obj->progress_interval)
+            return 0;
+
+          p_obj->last_cb_time = t_now;
+        }
+    }
+  else if (p_obj->progress_interval)
+    p_obj->last_cb_time = _vcd_clock ();
+
   p_obj->last_cb_call = p_obj->sectors_written;
 
-  if (p_obj->progress_callback) {
+  {
     progress_info_t _pi;
 
     _pi.sectors_written = p_obj->sectors_written;
@@ -1512,21 +1654,73 @@ _callback_wrapper (VcdObj_t *p_obj, int force)
 
     return p_obj->progress_callback (&_pi, p_obj->callback_user_data);
   }
-  else
-    return 0;
+}
+
+/* charges the time since t_start and bytes to p_stage; returns the
+   current time, so that the next stage can start from there */
+static double
+_stage_add (vcd_stage_stats_t *p_stage, double t_start, unsigned bytes)
+{
+  const double t_now = _vcd_clock ();
+
+  p_stage->seconds += t_now - t_start;
+  p_stage->bytes += bytes;
+  p_stage->count++;
+
+  return t_now;
+}
+
+static void
+_count_packet (VcdObj_t *p_obj, enum vcd_mpeg_packet_type type)
+{
+  switch (type)
+    {
+    case PKT_TYPE_VIDEO:
+      p_obj->stats.packets.video++;
+      break;
+    case PKT_TYPE_AUDIO:
+      p_obj->stats.packets.audio++;
+      break;
+    case PKT_TYPE_OGT:
+      p_obj->stats.packets.ogt++;
+      break;
+    case PKT_TYPE_ZERO:
+      p_obj->stats.packets.zero++;
+      break;
+    case PKT_TYPE_EMPTY:
+      p_obj->stats.packets.empty++;
+      break;
+    default:
+      break;
+    }
 }
 
 static int
 _write_m2_image_sector (VcdObj_t *obj, const void *data, uint32_t extent,
                         uint8_t fnum, uint8_t cnum, uint8_t sm, uint8_t ci)
 {
+  vcd_stage_stats_t *p_stage = obj->stats.stage;
   char buf[CDIO_CD_FRAMESIZE_RAW] = { 0, };
+  double t;
 
   vcd_assert (extent == obj->sectors_written);
 
-  _vcd_make_mode2(buf, data, extent, fnum, cnum, sm, ci);
+  t = _vcd_clock ();
+
+  _vcd_make_mode2_header (buf, data, extent, fnum, cnum, sm, ci);
+  t = _stage_add (&p_stage[VCD_STAGE_SUBHEADER], t, CDIO_CD_FRAMESIZE_RAW);
+
+  _vcd_make_mode2_edc (buf);
+  t = _stage_add (&p_stage[VCD_STAGE_EDC], t, CDIO_CD_FRAMESIZE_RAW);
+
+  if (!(sm & SM_FORM2))
+    {
+      _vcd_make_mode2_ecc (buf);
+      t = _stage_add (&p_stage[VCD_STAGE_ECC], t, CDIO_CD_FRAMESIZE_RAW);
+    }
 
   vcd_image_sink_write (obj->image_sink, buf, extent);
+  _stage_add (&p_stage[VCD_STAGE_SINK], t, CDIO_CD_FRAMESIZE_RAW);
 
   obj->sectors_written++;
 
@@ -1536,38 +1730,55 @@ _write_m2_image_sector (VcdObj_t *obj, const void *data, uint32_t extent,
 static int
 _write_m2_raw_image_sector (VcdObj_t *obj, const void *data, uint32_t extent)
 {
+  vcd_stage_stats_t *p_stage = obj->stats.stage;
   char buf[CDIO_CD_FRAMESIZE_RAW] = { 0, };
+  double t;
 
   vcd_assert (extent == obj->sectors_written);
 
+  t = _vcd_clock ();
+
   _vcd_make_raw_mode2(buf, data, extent);
+  t = _stage_add (&p_stage[VCD_STAGE_SUBHEADER], t, CDIO_CD_FRAMESIZE_RAW);
 
   vcd_image_sink_write (obj->image_sink, buf, extent);
+  _stage_add (&p_stage[VCD_STAGE_SINK], t, CDIO_CD_FRAMESIZE_RAW);
 
   obj->sectors_written++;
 
   return _callback_wrapper (obj, false);
 }
 
+/* number of sectors custom files are read in per data source access */
+#define CUSTOM_FILE_BLOCK_SECTORS 64
+
 static void
 _write_source_mode2_raw (VcdObj_t *obj, VcdDataSource_t *source,
                          uint32_t extent)
 {
   int n;
   uint32_t sectors;
+  char *block = calloc (CUSTOM_FILE_BLOCK_SECTORS, M2RAW_SECTOR_SIZE);
 
   sectors = vcd_data_source_stat (source) / M2RAW_SECTOR_SIZE;
 
   vcd_data_source_seek (source, 0);
 
-  for (n = 0;n < sectors;n++) {
-    char buf[M2RAW_SECTOR_SIZE] = { 0, };
+  for (n = 0;n < sectors;)
+    {
+      const int count = MIN (CUSTOM_FILE_BLOCK_SECTORS, sectors - n);
+      int i;
 
-    vcd_data_source_read (source, buf, M2RAW_SECTOR_SIZE, 1);
+      vcd_data_source_read (source, block, M2RAW_SECTOR_SIZE, count);
 
-    if (_write_m2_raw_image_sector (obj, buf, extent+n))
-      break;
-  }
+      for (i = 0; i < count; i++, n++)
+        if (_write_m2_raw_image_sector (obj, block + i * M2RAW_SECTOR_SIZE,
+                                        extent+n))
+          goto out;
+    }
+
+ out:
+  free (block);
 
   vcd_data_source_close (source);
 }
@@ -1577,37 +1788,131 @@ _write_source_mode2_form1 (VcdObj_t *obj, VcdDataSource_t *source,
                            uint32_t extent)
 {
   int n;
-  uint32_t sectors, size, last_block_size;
+  uint32_t sectors, size;
+  char *block = malloc (CUSTOM_FILE_BLOCK_SECTORS * CDIO_CD_FRAMESIZE);
 
   size = vcd_data_source_stat (source);
 
   sectors = _vcd_len2blocks (size, CDIO_CD_FRAMESIZE);
 
-  last_block_size = size % CDIO_CD_FRAMESIZE;
-  if (!last_block_size)
-    last_block_size = CDIO_CD_FRAMESIZE;
-
   vcd_data_source_seek (source, 0);
 
-  for (n = 0;n < sectors;n++) {
-    char buf[CDIO_CD_FRAMESIZE] = { 0, };
+  for (n = 0;n < sectors;)
+    {
+      const int count = MIN (CUSTOM_FILE_BLOCK_SECTORS, sectors - n);
+      const uint32_t offset = n * CDIO_CD_FRAMESIZE;
+      const uint32_t len = MIN (size - offset, count * CDIO_CD_FRAMESIZE);
+      int i;
 
-    vcd_data_source_read (source, buf,
-                          ((n + 1 == sectors)
-                           ? last_block_size
-                           : CDIO_CD_FRAMESIZE), 1);
+      vcd_data_source_read (source, block, len, 1);
 
-    if (_write_m2_image_sector (obj, buf, extent+n, 1, 0,
-                                ((n+1 < sectors)
-                                 ? SM_DATA
-                                 : SM_DATA |SM_EOF),
-                                0))
-      break;
-  }
+      /* zero-pad the tail of the last sector */
+      memset (block + len, 0, count * CDIO_CD_FRAMESIZE - len);
+
+      for (i = 0; i < count; i++, n++)
+        if (_write_m2_image_sector (obj, block + i * CDIO_CD_FRAMESIZE,
+                                    extent+n, 1, 0,
+                                    ((n+1 < sectors)
+                                     ? SM_DATA
+                                     : SM_DATA |SM_EOF),
+                                    0))
+          goto out;
+    }
+
+ out:
+  free (block);
 
   vcd_data_source_close (source);
 }
 
+/* hash over everything the sectors of a sequence track are made of,
+   except for their address */
+static uint64_t
+_sequence_key (const VcdObj_t *p_obj, const mpeg_sequence_t *track,
+               int track_idx)
+{
+  CdioListNode_t *node;
+  uint32_t params[9];
+  uint64_t key;
+
+  params[0] = track->info->packets;
+  params[1] = p_obj->track_pregap;
+  params[2] = p_obj->track_front_margin;
+  params[3] = p_obj->track_rear_margin;
+  params[4] = track_idx + 1; /* fnum */
+  params[5] = p_obj->type;
+  params[6] = p_obj->svcd_vcd3_mpegav;
+  params[7] = p_obj->update_scan_offsets;
+  params[8] = p_obj->relaxed_aps;
+
+  key = vcd_mpeg_source_get_fingerprint (track->source);
+  key = _vcd_hash64 (key, params, sizeof (params));
+
+  _CDIO_LIST_FOREACH (node, track->pause_list)
+    {
+      const pause_t *_pause = _cdio_list_node_data (node);
+
+      key = _vcd_hash64 (key, &_pause->time, sizeof (_pause->time));
+    }
+
+  return key;
+}
+
+/* copies a sequence track which didn't change from the image given by
+   VCD_PARM_REUSE_IMAGE; only the sync and header, which hold the
+   address and aren't covered by the form 2 EDC, are made anew.
+   returns -1 if the track isn't in there */
+static int
+_reuse_sequence (VcdObj_t *p_obj, const mpeg_sequence_t *track,
+                 uint32_t extent)
+{
+  const vcd_manifest_entry_t *_entry;
+  const unsigned size = p_obj->reuse_sector_size;
+  char *block;
+  uint32_t n;
+  int rc = 0;
+
+  if (!p_obj->reuse_manifest)
+    return -1;
+
+  _entry = _vcd_manifest_find (p_obj->reuse_manifest, track->manifest_key);
+
+  if (!_entry || _entry->sectors != track->manifest_sectors
+      || _entry->extent + _entry->sectors > p_obj->reuse_manifest->sectors)
+    return -1;
+
+  vcd_info ("unchanged, copying %u sectors from `%s'",
+            _entry->sectors, p_obj->reuse_image_fname);
+
+  block = calloc (CUSTOM_FILE_BLOCK_SECTORS, size);
+
+  vcd_data_source_seek (p_obj->reuse_source, (long) _entry->extent * size);
+
+  for (n = 0; n < _entry->sectors && !rc;)
+    {
+      const int count = MIN (CUSTOM_FILE_BLOCK_SECTORS, _entry->sectors - n);
+      int i;
+
+      if (vcd_data_source_read (p_obj->reuse_source, block, size, count)
+          != size * count)
+        {
+          vcd_error ("short read from `%s'", p_obj->reuse_image_fname);
+          rc = 1;
+          break;
+        }
+
+      /* skip sync and header of 2352 byte sectors */
+      for (i = 0; i < count && !rc; i++, n++)
+        rc = _write_m2_raw_image_sector (p_obj, block + i * size
+                                         + (size - M2RAW_SECTOR_SIZE),
+                                         extent + n);
+    }
+
+  free (block);
+
+  return rc;
+}
+
 static int
 _write_sequence (VcdObj_t *p_obj, int track_idx)
 {
@@ -1708,6 +2013,18 @@ _write_sequence (VcdObj_t *p_obj, int track_idx)
     free (norm_str);
   }
 
+  track->manifest_extent = lastsect;
+  track->manifest_sectors = p_obj->track_pregap + p_obj->track_front_margin
+    + track->info->packets + p_obj->track_rear_margin;
+  track->manifest_key = _sequence_key (p_obj, track, track_idx);
+
+  {
+    const int rc = _reuse_sequence (p_obj, track, lastsect);
+
+    if (rc >= 0)
+      return rc;
+  }
+
   for (n = 0; n < p_obj->track_pregap; n++)
     _write_m2_image_sector (p_obj, zero, lastsect++, 0, 0, SM_FORM2, 0);
 
@@ -1721,9 +2038,12 @@ _write_sequence (VcdObj_t *p_obj, int track_idx)
     int ci = 0, sm = 0, cnum = 0, fnum = 0;
     struct vcd_mpeg_packet_info pkt_flags;
     bool set_trigger = false;
+    double t = _vcd_clock ();
 
     vcd_mpeg_source_get_packet (track->source, n, buf, &pkt_flags,
                                 p_obj->update_scan_offsets);
+    _stage_add (&p_obj->stats.stage[VCD_STAGE_PACKET], t, sizeof (buf));
+    _count_packet (p_obj, vcd_mpeg_packet_get_type (&pkt_flags));
 
     while (pause_node)
       {
@@ -1862,10 +2182,14 @@ _write_segment (VcdObj_t *p_obj, mpeg_segment_t *p_segment)
           struct vcd_mpeg_packet_info pkt_flags;
           bool set_trigger = false;
           bool _need_eor = false;
+          double t = _vcd_clock ();
 
           vcd_mpeg_source_get_packet (p_segment->source, packet_no,
                                       buf, &pkt_flags,
                                       p_obj->update_scan_offsets);
+          _stage_add (&p_obj->stats.stage[VCD_STAGE_PACKET], t,
+                      sizeof (buf));
+          _count_packet (p_obj, vcd_mpeg_packet_get_type (&pkt_flags));
 
           fn = 1;
           cn = CN_EMPTY;
@@ -2203,8 +2527,8 @@ vcd_obj_get_image_size (VcdObj_t *p_obj)
   return size_sectors;
 }
 
-long
-vcd_obj_begin_output (VcdObj_t *p_obj)
+static long
+_vcd_obj_begin_output (VcdObj_t *p_obj)
 {
   uint32_t image_size;
 
@@ -2223,6 +2547,8 @@ vcd_obj_begin_output (VcdObj_t *p_obj)
 
   p_obj->buffer_dict_list = _cdio_list_new ();
 
+  p_obj->output_arena = _vcd_arena_new ();
+
   _finalize_vcd_iso_track (p_obj);
 
   _update_entry_points (p_obj);
@@ -2249,8 +2575,24 @@ vcd_obj_begin_output (VcdObj_t *p_obj)
   return image_size;
 }
 
-void
-vcd_obj_end_output (VcdObj_t *p_obj)
+long
+vcd_obj_begin_output (VcdObj_t *p_obj)
+{
+  _vcd_log_scope_t scope;
+  long rc;
+
+  vcd_assert (p_obj != NULL);
+
+  _vcd_log_scope_enter (&scope, p_obj->log_handler,
+                        p_obj->log_user_data);
+  rc = _vcd_obj_begin_output (p_obj);
+  _vcd_log_scope_leave (&scope);
+
+  return rc;
+}
+
+static void
+_vcd_obj_end_output (VcdObj_t *p_obj)
 {
   vcd_assert (p_obj != NULL);
 
@@ -2261,7 +2603,34 @@ vcd_obj_end_output (VcdObj_t *p_obj)
   _vcd_salloc_destroy (p_obj->iso_bitmap);
 
   _dict_clean (p_obj);
-  _cdio_list_free (p_obj->buffer_dict_list, true, (CdioDataFree_t) &dict_free);
+  _cdio_list_free (p_obj->buffer_dict_list, false, NULL);
+
+  {
+    vcd_arena_stats_t stats;
+
+    _vcd_arena_get_stats (p_obj->output_arena, &stats);
+    vcd_debug ("output arena: %u allocations (%lu bytes) in %u chunks",
+               stats.allocs, (unsigned long) stats.bytes, stats.chunks);
+
+    if (stats.bytes > p_obj->stats.arena_bytes)
+      p_obj->stats.arena_bytes = stats.bytes;
+  }
+
+  _vcd_arena_destroy (p_obj->output_arena);
+  p_obj->output_arena = NULL;
+}
+
+void
+vcd_obj_end_output (VcdObj_t *p_obj)
+{
+  _vcd_log_scope_t scope;
+
+  vcd_assert (p_obj != NULL);
+
+  _vcd_log_scope_enter (&scope, p_obj->log_handler,
+                        p_obj->log_user_data);
+  _vcd_obj_end_output (p_obj);
+  _vcd_log_scope_leave (&scope);
 }
 
 int
@@ -2287,10 +2656,20 @@ vcd_obj_append_pbc_node (VcdObj_t *p_obj, struct _pbc_t *p_pbc)
   return 0;
 }
 
-int
-vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
-                     progress_callback_t callback, void *user_data,
-                     const time_t *p_create_time)
+static vcd_cue_t *
+_cue_append (VcdObj_t *p_obj, CdioList_t *p_cue_list)
+{
+  vcd_cue_t *p_cue = _vcd_arena_alloc (p_obj->output_arena, sizeof (vcd_cue_t));
+
+  _cdio_list_append (p_cue_list, p_cue);
+
+  return p_cue;
+}
+
+static int
+_vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
+                      progress_callback_t callback, void *user_data,
+                      const time_t *p_create_time)
 {
   CdioListNode_t *node;
 
@@ -2308,7 +2687,7 @@ vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
 
     p_cue_list = _cdio_list_new ();
 
-    _cdio_list_append (p_cue_list, (p_cue = calloc(1, sizeof (vcd_cue_t))));
+    p_cue = _cue_append (p_obj, p_cue_list);
 
     p_cue->lsn = 0;
     p_cue->type = VCD_CUE_TRACK_START;
@@ -2318,15 +2697,13 @@ vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
         mpeg_sequence_t *p_track = _cdio_list_node_data (node);
         CdioListNode_t *p_entry_node;
 
-        _cdio_list_append (p_cue_list,
-                           (p_cue = calloc(1, sizeof (vcd_cue_t))));
+        p_cue = _cue_append (p_obj, p_cue_list);
 
         p_cue->lsn = p_track->relative_start_extent + p_obj->iso_size;
         p_cue->lsn -= p_obj->track_pregap;
         p_cue->type = VCD_CUE_PREGAP_START;
 
-        _cdio_list_append (p_cue_list,
-                           (p_cue = calloc(1, sizeof (vcd_cue_t))));
+        p_cue = _cue_append (p_obj, p_cue_list);
 
         p_cue->lsn = p_track->relative_start_extent + p_obj->iso_size;
         p_cue->type = VCD_CUE_TRACK_START;
@@ -2335,8 +2712,7 @@ vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
           {
             entry_t *_entry = _cdio_list_node_data (p_entry_node);
 
-            _cdio_list_append (p_cue_list,
-                               (p_cue = calloc(1, sizeof (vcd_cue_t))));
+            p_cue = _cue_append (p_obj, p_cue_list);
 
             p_cue->lsn = p_obj->iso_size;
             p_cue->lsn += p_track->relative_start_extent;
@@ -2349,7 +2725,7 @@ vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
 
     /* add last one... */
 
-    _cdio_list_append (p_cue_list, (p_cue = calloc(1, sizeof (vcd_cue_t))));
+    p_cue = _cue_append (p_obj, p_cue_list);
 
     p_cue->lsn = p_obj->relative_end_extent + p_obj->iso_size;
 
@@ -2361,7 +2737,7 @@ vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
 
     vcd_image_sink_set_cuesheet (p_image_sink, p_cue_list);
 
-    _cdio_list_free (p_cue_list, true, (CdioDataFree_t) &cue_data_free);
+    _cdio_list_free (p_cue_list, false, NULL);
   }
 
   /* and now for the pay load */
@@ -2422,6 +2798,168 @@ vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
   }
 }
 
+static void
+_open_reuse_image (VcdObj_t *p_obj)
+{
+  VcdManifest_t *p_manifest;
+  struct stat statbuf;
+  long size;
+
+  if (!p_obj->reuse_image_fname)
+    return;
+
+  if (!p_obj->manifest_fname)
+    {
+      vcd_warn ("no manifest for `%s' given, not reusing it",
+                p_obj->reuse_image_fname);
+      return;
+    }
+
+  if (!(p_manifest = _vcd_manifest_read (p_obj->manifest_fname)))
+    {
+      vcd_warn ("could not read manifest `%s', not reusing `%s'",
+                p_obj->manifest_fname, p_obj->reuse_image_fname);
+      return;
+    }
+
+  if (stat (p_obj->reuse_image_fname, &statbuf) == -1)
+    {
+      vcd_warn ("could not stat() `%s', not reusing it",
+                p_obj->reuse_image_fname);
+      _vcd_manifest_destroy (p_manifest);
+      return;
+    }
+
+  p_obj->reuse_source = vcd_data_source_new_stdio (p_obj->reuse_image_fname);
+  size = vcd_data_source_stat (p_obj->reuse_source);
+
+  if (p_manifest->sectors
+      && size == (long) p_manifest->sectors * CDIO_CD_FRAMESIZE_RAW)
+    p_obj->reuse_sector_size = CDIO_CD_FRAMESIZE_RAW;
+  else if (p_manifest->sectors
+           && size == (long) p_manifest->sectors * M2RAW_SECTOR_SIZE)
+    p_obj->reuse_sector_size = M2RAW_SECTOR_SIZE;
+  else
+    {
+      vcd_warn ("`%s' doesn't match manifest `%s', not reusing it",
+                p_obj->reuse_image_fname, p_obj->manifest_fname);
+      _vcd_manifest_destroy (p_manifest);
+      vcd_data_source_destroy (p_obj->reuse_source);
+      p_obj->reuse_source = NULL;
+      return;
+    }
+
+  p_obj->reuse_manifest = p_manifest;
+}
+
+static void
+_close_reuse_image (VcdObj_t *p_obj)
+{
+  _vcd_manifest_destroy (p_obj->reuse_manifest);
+  p_obj->reuse_manifest = NULL;
+
+  if (p_obj->reuse_source)
+    vcd_data_source_destroy (p_obj->reuse_source);
+  p_obj->reuse_source = NULL;
+}
+
+static void
+_write_manifest (const VcdObj_t *p_obj)
+{
+  VcdManifest_t _manifest = { 0, };
+  CdioListNode_t *node;
+
+  _manifest.sectors = p_obj->sectors_written;
+  _manifest.entries =
+    calloc (_cdio_list_length (p_obj->mpeg_sequence_list) + 1,
+            sizeof (vcd_manifest_entry_t));
+
+  _CDIO_LIST_FOREACH (node, p_obj->mpeg_sequence_list)
+    {
+      const mpeg_sequence_t *track = _cdio_list_node_data (node);
+      vcd_manifest_entry_t *_entry = &_manifest.entries[_manifest.count];
+
+      _entry->sequence = _manifest.count++;
+      _entry->extent = track->manifest_extent;
+      _entry->sectors = track->manifest_sectors;
+      _entry->key = track->manifest_key;
+    }
+
+  _vcd_manifest_write (&_manifest, p_obj->manifest_fname);
+
+  free (_manifest.entries);
+}
+
+int
+vcd_obj_write_image (VcdObj_t *p_obj, VcdImageSink_t *p_image_sink,
+                     progress_callback_t callback, void *user_data,
+                     const time_t *p_create_time)
+{
+  _vcd_log_scope_t scope;
+  unsigned long *p_prev_seeks;
+  double t_start;
+  int rc;
+
+  vcd_assert (p_obj != NULL);
+
+  _vcd_log_scope_enter (&scope, p_obj->log_handler,
+                        p_obj->log_user_data);
+  p_prev_seeks = _vcd_stream_count_seeks (&p_obj->stats.seeks);
+  t_start = _vcd_clock ();
+
+  _open_reuse_image (p_obj);
+
+  rc = _vcd_obj_write_image (p_obj, p_image_sink, callback, user_data,
+                             p_create_time);
+
+  _close_reuse_image (p_obj);
+
+  if (!rc && p_obj->manifest_fname)
+    _write_manifest (p_obj);
+
+  p_obj->stats.seconds += _vcd_clock () - t_start;
+  p_obj->stats.sectors += p_obj->sectors_written;
+  _vcd_stream_count_seeks (p_prev_seeks);
+  _vcd_log_scope_leave (&scope);
+
+  return rc;
+}
+
+void
+vcd_obj_get_stats (const VcdObj_t *p_obj, vcd_obj_stats_t *p_stats)
+{
+  vcd_assert (p_obj != NULL);
+  vcd_assert (p_stats != NULL);
+
+  *p_stats = p_obj->stats;
+
+  p_stats->peak_rss = 0;
+#if defined(HAVE_GETRUSAGE) && defined(HAVE_SYS_RESOURCE_H)
+  {
+    struct rusage usage;
+
+    if (!getrusage (RUSAGE_SELF, &usage))
+#ifdef __APPLE__
+      p_stats->peak_rss = usage.ru_maxrss / 1024; /* bytes there */
+#else
+      p_stats->peak_rss = usage.ru_maxrss;
+#endif
+  }
+#endif
+}
+
+const char *
+vcd_stage_name (vcd_stage_t stage)
+{
+  static const char *const names[VCD_STAGE_COUNT] = {
+    "scan", "packet", "subheader", "edc", "ecc", "sink"
+  };
+
+  vcd_assert (stage < VCD_STAGE_COUNT);
+
+  return names[stage];
+}
+
 const char *
 vcd_version_string (bool full_text)
 {
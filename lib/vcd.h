@@ -29,6 +29,7 @@
 #include "stream.h"
 
 #include <libvcd/types.h>
+#include <libvcd/logging.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -61,7 +62,19 @@ extern "C" {
     VCD_PARM_LEADOUT_PREGAP,      /**< unsigned        [0..300] */
     VCD_PARM_TRACK_PREGAP,        /**< unsigned        [1..300] */
     VCD_PARM_TRACK_FRONT_MARGIN,  /**< unsigned        [0..150] */
-    VCD_PARM_TRACK_REAR_MARGIN    /**< unsigned        [0..150] */
+    VCD_PARM_TRACK_REAR_MARGIN,   /**< unsigned        [0..150] */
+    VCD_PARM_PROGRESS_SECTORS,    /**< unsigned        [1..] sectors between
+                                       progress callbacks, default 75 */
+    VCD_PARM_PROGRESS_INTERVAL,   /**< unsigned        milliseconds at least
+                                       between progress callbacks, 0 (the
+                                       default) for no limit */
+    VCD_PARM_MANIFEST,            /**< char *          file to record the
+                                       layout of the written image in */
+    VCD_PARM_REUSE_IMAGE          /**< char *          bin file of an image
+                                       written before with the same
+                                       VCD_PARM_MANIFEST; sequence tracks
+                                       which didn't change are copied from
+                                       it instead of being encoded again */
   } vcd_parm_t;
   
   /** sets VideoCD parameter */
@@ -157,8 +170,67 @@ extern "C" {
   void 
   vcd_obj_end_output (VcdObj_t *p_vcdobj);
   
+  /** messages logged while p_vcdobj adds MPEG items or writes the
+      image go to handler instead of the thread or process handler;
+      NULL undoes this */
+  void
+  vcd_obj_set_log_handler (VcdObj_t *p_vcdobj, vcd_log_handler2_t handler,
+                           void *p_user_data);
+
+  /** stages of building an image which vcd_obj_get_stats () accounts
+      for separately */
+  typedef enum {
+    VCD_STAGE_SCAN = 0,   /**< scanning MPEG items for access points */
+    VCD_STAGE_PACKET,     /**< fetching and parsing MPEG packets */
+    VCD_STAGE_SUBHEADER,  /**< sync, address, subheader and payload */
+    VCD_STAGE_EDC,        /**< error detection codes */
+    VCD_STAGE_ECC,        /**< error correction codes (form 1 only) */
+    VCD_STAGE_SINK,       /**< handing sectors to the image sink */
+    VCD_STAGE_COUNT
+  } vcd_stage_t;
+
+  typedef struct
+  {
+    double seconds;       /**< cumulative time spent */
+    uint64_t bytes;       /**< bytes processed */
+    unsigned long count;  /**< packets, sectors or items processed */
+  } vcd_stage_stats_t;
+
+  typedef struct
+  {
+    vcd_stage_stats_t stage[VCD_STAGE_COUNT];
+
+    double seconds;       /**< time spent in vcd_obj_write_image () */
+    unsigned long sectors;  /**< sectors written */
+    unsigned long seeks;  /**< repositioned data sources and sinks */
+
+    /** MPEG packets written, by type */
+    struct {
+      unsigned long video;
+      unsigned long audio;
+      unsigned long ogt;
+      unsigned long zero;
+      unsigned long empty;
+    } packets;
+
+    uint64_t arena_bytes; /**< largest per-output allocation arena */
+    long peak_rss;        /**< peak resident set size of the process in
+                               KiB, 0 if unknown */
+  } vcd_obj_stats_t;
+
+  /** fills in p_stats with what p_vcdobj has done so far; the counters
+      add up over all items added and images written */
+  void
+  vcd_obj_get_stats (const VcdObj_t *p_vcdobj, vcd_obj_stats_t *p_stats);
+
+  /** short lower case name of stage, e.g. "scan" */
+  const char *
+  vcd_stage_name (vcd_stage_t stage);
+
   /** destructor for VideoCD objects; call this to destory a VideoCD
-      object created by vcd_obj_new () */
+      object created by vcd_obj_new ().  It may be called while an
+      output session is still open, after an error handler got out of
+      it by longjmp (); the image sink is left to the caller then */
   void 
   vcd_obj_destroy (VcdObj_t *p_vcdobj);
   
@@ -0,0 +1,360 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <cdio/cdio.h>
+
+/* Public headers */
+#include <libvcd/types.h>
+#include <libvcd/logging.h>
+#include <libvcd/sector.h>
+
+/* Private headers */
+#include "vcd_assert.h"
+#include "salloc.h"
+#include "stream_stdio.h"
+#include "util.h"
+#include "verify.h"
+
+/* sectors read at once; each worker reads whole chunks, taking them in
+   order, so the file is still read front to back in large blocks */
+#define VCD_VERIFY_CHUNK 512
+
+typedef struct {
+  const char *fname;
+  VcdDataSource_t *p_source; /* read by the one worker instead of
+                                fname, if not NULL */
+  const vcd_verify_opts_t *p_opts;
+  vcd_verify_result_t *p_result;
+  uint32_t chunks;
+  uint32_t next_chunk;
+  uint32_t checked;
+  bool failed;
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_t lock;
+#endif
+} _verify_t;
+
+/* returns false if there's no memory left for the error */
+static bool
+_add_error (vcd_verify_result_t *p_result, uint32_t sector, int problems,
+            unsigned *p_alloced)
+{
+  int n;
+
+  if (p_result->bad == *p_alloced)
+    {
+      const unsigned alloced = *p_alloced ? *p_alloced * 2 : 64;
+      vcd_verify_error_t *p_errors =
+        realloc (p_result->errors, alloced * sizeof (vcd_verify_error_t));
+
+      if (!p_errors)
+        return false;
+
+      p_result->errors = p_errors;
+      *p_alloced = alloced;
+    }
+
+  p_result->errors[p_result->bad].sector = sector;
+  p_result->errors[p_result->bad].problems = problems;
+  p_result->bad++;
+
+  for (n = 0; n < VCD_SECTOR_CHECKS; n++)
+    if (problems & (1 << n))
+      p_result->problems[n]++;
+
+  return true;
+}
+
+static void *
+_verify_worker (void *user_data)
+{
+  _verify_t *p_verify = user_data;
+  const vcd_verify_opts_t *p_opts = p_verify->p_opts;
+  const unsigned ss = p_opts->sector_size;
+  uint8_t *buf = malloc (VCD_VERIFY_CHUNK * ss);
+  vcd_verify_result_t _result;
+  unsigned alloced = 0;
+  VcdDataSource_t *p_source = NULL;
+  uint8_t raw[CDIO_CD_FRAMESIZE_RAW];
+  bool failed = false;
+
+  memset (&_result, 0, sizeof (_result));
+
+  /* sectors without sync and header are checked with a made up one */
+  memset (raw, 0, CDIO_CD_FRAMESIZE_RAW);
+  memset (raw + 1, 0xff, 10);
+  raw[15] = 2;
+
+  if (!buf)
+    {
+      vcd_warn ("can't allocate %u bytes for verifying `%s'",
+                VCD_VERIFY_CHUNK * ss, p_verify->fname);
+      failed = true;
+    }
+  else if (p_verify->p_source)
+    p_source = p_verify->p_source;
+  else if (!(p_source = vcd_data_source_new_stdio (p_verify->fname)))
+    failed = true;
+
+  while (p_source)
+    {
+      uint32_t chunk, first, count, n;
+      long len;
+
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_lock (&p_verify->lock);
+#endif
+      chunk = p_verify->next_chunk++;
+#ifdef HAVE_PTHREAD_H
+      pthread_mutex_unlock (&p_verify->lock);
+#endif
+
+      if (chunk >= p_verify->chunks)
+        break;
+
+      first = chunk * VCD_VERIFY_CHUNK;
+      count = p_verify->p_result->sectors - first;
+      if (count > VCD_VERIFY_CHUNK)
+        count = VCD_VERIFY_CHUNK;
+
+      vcd_data_source_seek (p_source, p_opts->offset + (long) first * ss);
+      len = vcd_data_source_read (p_source, buf, ss, count);
+
+      if (len != (long) count * ss)
+        {
+          vcd_warn ("short read at sector %u of `%s'", first, p_verify->fname);
+          failed = true;
+          break;
+        }
+
+      for (n = 0; n < count; n++)
+        {
+          const uint32_t sector = first + n;
+          const uint8_t *p_sector = buf + n * ss;
+          uint32_t extent = SECTOR_NIL;
+          int problems;
+
+          if (ss != CDIO_CD_FRAMESIZE_RAW)
+            {
+              memcpy (raw + 16, p_sector, M2RAW_SECTOR_SIZE);
+              p_sector = raw;
+            }
+          else if (p_opts->first_extent != SECTOR_NIL)
+            extent = p_opts->first_extent + sector;
+
+          if ((problems = _vcd_check_mode2 (p_sector, extent))
+              && !_add_error (&_result, sector, problems, &alloced))
+            {
+              vcd_warn ("can't allocate memory for the list of bad sectors");
+              failed = true;
+              break;
+            }
+        }
+
+      _result.sectors += n;
+
+      if (failed)
+        break;
+    }
+
+  if (p_source && p_source != p_verify->p_source)
+    vcd_data_source_destroy (p_source);
+
+  free (buf);
+
+  /* merged unordered; sorted once all workers are done */
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_lock (&p_verify->lock);
+#endif
+  {
+    vcd_verify_result_t *p_result = p_verify->p_result;
+    vcd_verify_error_t *p_errors = NULL;
+    int n;
+
+    if (_result.bad
+        && !(p_errors = realloc (p_result->errors,
+                                 (p_result->bad + _result.bad)
+                                 * sizeof (vcd_verify_error_t))))
+      {
+        vcd_warn ("can't allocate memory for the list of bad sectors");
+        failed = true;
+      }
+    else if (_result.bad)
+      {
+        p_result->errors = p_errors;
+        memcpy (p_result->errors + p_result->bad, _result.errors,
+                _result.bad * sizeof (vcd_verify_error_t));
+        p_result->bad += _result.bad;
+
+        for (n = 0; n < VCD_SECTOR_CHECKS; n++)
+          p_result->problems[n] += _result.problems[n];
+      }
+
+    p_verify->checked += _result.sectors;
+
+    if (failed)
+      p_verify->failed = true;
+  }
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_unlock (&p_verify->lock);
+#endif
+
+  free (_result.errors);
+
+  return NULL;
+}
+
+static int
+_error_cmp (const void *p1, const void *p2)
+{
+  const vcd_verify_error_t *e1 = p1, *e2 = p2;
+
+  return e1->sector < e2->sector ? -1 : e1->sector > e2->sector;
+}
+
+int
+_vcd_verify_image (const char fname[], const vcd_verify_opts_t *p_opts,
+                   vcd_verify_result_t *p_result)
+{
+  _verify_t _verify;
+  VcdDataSource_t *p_source;
+  unsigned jobs;
+  double t_start = _vcd_clock ();
+
+  vcd_assert (fname != NULL);
+  vcd_assert (p_opts != NULL);
+  vcd_assert (p_result != NULL);
+  vcd_assert (p_opts->sector_size == CDIO_CD_FRAMESIZE_RAW
+              || p_opts->sector_size == M2RAW_SECTOR_SIZE);
+
+  memset (p_result, 0, sizeof (vcd_verify_result_t));
+
+  p_result->sectors = p_opts->sectors;
+
+  if (!(p_source = vcd_data_source_new_stdio (fname)))
+    return -1;
+
+  if (!p_result->sectors)
+    {
+      long size = vcd_data_source_stat (p_source) - p_opts->offset;
+
+      if (size < 0)
+        size = 0;
+
+      if (size % p_opts->sector_size)
+        vcd_warn ("`%s' ends with a partial sector", fname);
+
+      p_result->sectors = size / p_opts->sector_size;
+    }
+
+  memset (&_verify, 0, sizeof (_verify));
+  _verify.fname = fname;
+
+  /* stdin or a pipe can be read only once; the source spools what it
+     reads, so that it can be seeked in, and is the only one there is */
+  if (vcd_data_source_is_stream (p_source))
+    _verify.p_source = p_source;
+  else
+    vcd_data_source_destroy (p_source);
+
+  _verify.p_opts = p_opts;
+  _verify.p_result = p_result;
+  _verify.chunks =
+    (p_result->sectors + VCD_VERIFY_CHUNK - 1) / VCD_VERIFY_CHUNK;
+
+  jobs = p_opts->jobs ? p_opts->jobs : 1;
+  if (jobs > _verify.chunks)
+    jobs = _verify.chunks ? _verify.chunks : 1;
+
+  if (_verify.p_source)
+    jobs = 1;
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_init (&_verify.lock, NULL);
+
+  if (jobs > 1)
+    {
+      /* the calling thread is the last of the jobs */
+      pthread_t *threads = calloc (jobs - 1, sizeof (pthread_t));
+      unsigned n, started = 0;
+
+      for (n = 0; threads && n < jobs - 1; n++)
+        if (!pthread_create (&threads[n], NULL, _verify_worker, &_verify))
+          started++;
+        else
+          break;
+
+      /* whatever is left is done here */
+      _verify_worker (&_verify);
+
+      for (n = 0; n < started; n++)
+        pthread_join (threads[n], NULL);
+
+      free (threads);
+    }
+  else
+#endif
+    _verify_worker (&_verify);
+
+#ifdef HAVE_PTHREAD_H
+  pthread_mutex_destroy (&_verify.lock);
+#endif
+
+  if (_verify.p_source)
+    vcd_data_source_destroy (_verify.p_source);
+
+  p_result->sectors = _verify.checked;
+  p_result->seconds = _vcd_clock () - t_start;
+
+  if (p_result->bad)
+    qsort (p_result->errors, p_result->bad, sizeof (vcd_verify_error_t),
+           _error_cmp);
+
+  return _verify.failed ? -1 : 0;
+}
+
+void
+_vcd_verify_result_free (vcd_verify_result_t *p_result)
+{
+  vcd_assert (p_result != NULL);
+
+  free (p_result->errors);
+  p_result->errors = NULL;
+  p_result->bad = 0;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
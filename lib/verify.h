@@ -0,0 +1,68 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* checking the sectors of a written image with _vcd_check_mode2 () */
+
+#ifndef __VCD_VERIFY_H__
+#define __VCD_VERIFY_H__
+
+#include <libvcd/types.h>
+#include <libvcd/sector.h>
+
+typedef struct {
+  unsigned sector_size;  /* CDIO_CD_FRAMESIZE_RAW, or M2RAW_SECTOR_SIZE
+                            for images without sync and header */
+  long offset;           /* of the first sector in the file */
+  uint32_t sectors;      /* 0 for all up to the end of the file */
+  uint32_t first_extent; /* of the first sector; SECTOR_NIL to not
+                            check the addresses */
+  unsigned jobs;         /* threads checking sectors */
+} vcd_verify_opts_t;
+
+typedef struct {
+  uint32_t sector;       /* index in the image */
+  int problems;          /* VCD_SECTOR_BAD_* */
+} vcd_verify_error_t;
+
+typedef struct {
+  uint32_t sectors;      /* checked */
+  uint32_t bad;          /* entries in errors */
+  vcd_verify_error_t *errors; /* in sector order */
+  unsigned long problems[VCD_SECTOR_CHECKS]; /* bad sectors by check */
+  double seconds;
+} vcd_verify_result_t;
+
+/* returns -1 if fname couldn't be read, else 0, whatever was found;
+   p_result has to be freed with _vcd_verify_result_free () */
+int
+_vcd_verify_image (const char fname[], const vcd_verify_opts_t *p_opts,
+                   vcd_verify_result_t *p_result);
+
+void
+_vcd_verify_result_free (vcd_verify_result_t *p_result);
+
+#endif /* __VCD_VERIFY_H__ */
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
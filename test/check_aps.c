@@ -0,0 +1,233 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Check the scan offsets and the interpolated PTS that
+   vcd_mpeg_source_get_packet () fills in from the access point index
+   against a linear walk over all access points, as it was done before
+   there was an index: for each packet of a few made up streams, for
+   PTS all around it. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+
+/* Private headers */
+#include "mpeg_stream.h"
+
+/* the linear walks */
+
+static double
+_approx_pts (const struct aps_index *idx, uint32_t packet_no)
+{
+  const struct aps_data *_laps = NULL;
+  double last_pts_ratio = 0;
+  double retval;
+  unsigned n;
+
+  if (!idx->count)
+    return 0;
+
+  /* which used to crash; extrapolate from the first two */
+  if (packet_no <= idx->aps[0].packet_no)
+    {
+      if (idx->count == 1)
+        return idx->aps[0].timestamp;
+
+      retval = (long) packet_no - (long) idx->aps[0].packet_no;
+      retval *= (idx->aps[1].timestamp - idx->aps[0].timestamp)
+        / (idx->aps[1].packet_no - idx->aps[0].packet_no);
+
+      return retval + idx->aps[0].timestamp;
+    }
+
+  for (n = 0; n < idx->count; n++)
+    {
+      const struct aps_data *_aps = &idx->aps[n];
+
+      if (_laps)
+        {
+          long p = _aps->packet_no;
+          double t = _aps->timestamp;
+
+          p -= _laps->packet_no;
+          t -= _laps->timestamp;
+
+          last_pts_ratio = t / p;
+        }
+
+      if (_aps->packet_no >= packet_no)
+        break;
+
+      _laps = _aps;
+    }
+
+  retval = packet_no;
+  retval -= _laps->packet_no;
+  retval *= last_pts_ratio;
+  retval += _laps->timestamp;
+
+  return retval;
+}
+
+static void
+_scan_offsets (const struct aps_index *idx, unsigned packet_no, double pts,
+               long offsets[4])
+{
+  long _next = -1, _prev = -1, _forw = -1, _back = -1;
+  unsigned n;
+
+  for (n = 0; n < idx->count; n++)
+    {
+      const struct aps_data *_aps = &idx->aps[n];
+
+      if (_aps->packet_no == packet_no)
+        continue;
+      else if (_aps->packet_no < packet_no)
+        {
+          _prev = _aps->packet_no;
+
+          if (pts - _aps->timestamp < 10 && _back == -1)
+            _back = _aps->packet_no;
+        }
+      else if (_aps->packet_no > packet_no)
+        {
+          if (_next == -1)
+            _next = _aps->packet_no;
+
+          if (_aps->timestamp - pts < 10)
+            _forw = _aps->packet_no;
+        }
+    }
+
+  offsets[0] = _prev;
+  offsets[1] = _next;
+  offsets[2] = _back == -1 ? packet_no : _back;
+  offsets[3] = _forw == -1 ? packet_no : _forw;
+}
+
+static int
+check_stream (const char name[], struct aps_data *aps, unsigned count)
+{
+  static const char *const names[] = { "prev", "next", "back", "forw" };
+  struct aps_index idx = { aps, count, true };
+  const unsigned last = aps[count - 1].packet_no;
+  unsigned packet_no, n;
+  int fail = 0;
+
+  for (n = 1; n < count; n++)
+    if (aps[n].timestamp < aps[n - 1].timestamp)
+      idx.ordered = false;
+
+  printf ("checking %s ...", name);
+
+  for (packet_no = 0; packet_no <= last + 10; packet_no++)
+    {
+      const double approx = _vcd_mpeg_aps_approx_pts (&idx, packet_no);
+      const double want = _approx_pts (&idx, packet_no);
+      double pts;
+
+      if (approx < want - 1e-9 || approx > want + 1e-9)
+        {
+          if (!fail++)
+            printf ("failed!\n");
+          printf ("==> packet %u: PTS %f, not %f\n", packet_no, approx, want);
+        }
+
+      for (pts = -15; pts <= aps[count - 1].timestamp + 15; pts += 0.25)
+        {
+          long got[4], expected[4];
+
+          _vcd_mpeg_aps_scan_offsets (&idx, packet_no, pts,
+                                      &got[0], &got[1], &got[2], &got[3]);
+          _scan_offsets (&idx, packet_no, pts, expected);
+
+          for (n = 0; n < 4; n++)
+            if (got[n] != expected[n])
+              {
+                if (!fail++)
+                  printf ("failed!\n");
+                printf ("==> packet %u, PTS %.2f: %s %ld, not %ld\n",
+                        packet_no, pts, names[n], got[n], expected[n]);
+              }
+        }
+    }
+
+  if (!fail)
+    printf ("ok!\n");
+
+  return fail ? 1 : 0;
+}
+
+int
+main (int argc, const char *argv[])
+{
+  /* an access point every 12 packets, half a second apart */
+  struct aps_data steady[40];
+
+  /* mostly every 15 packets, from 5 on, a few seconds apart */
+  struct aps_data uneven[] = {
+    { 5, 0.0 }, { 20, 0.5 }, { 35, 1.0 }, { 36, 4.0 }, { 50, 9.9 },
+    { 65, 10.0 }, { 90, 14.0 }, { 91, 14.5 }, { 120, 30.0 }, { 121, 30.0 },
+    { 150, 42.5 }
+  };
+
+  /* a PTS discontinuity, and one going back a bit */
+  struct aps_data jumping[] = {
+    { 3, 20.0 }, { 15, 20.5 }, { 27, 21.0 }, { 39, 21.5 }, { 51, 0.0 },
+    { 63, 0.5 }, { 75, 12.0 }, { 87, 11.5 }, { 99, 25.0 }, { 111, 2.0 }
+  };
+
+  struct aps_data single[] = { { 7, 3.0 } };
+
+  struct aps_data pair[] = { { 7, 3.0 }, { 19, 3.5 } };
+
+  unsigned n;
+  int fail = 0;
+
+  for (n = 0; n < 40; n++)
+    {
+      steady[n].packet_no = 12 * n;
+      steady[n].timestamp = 0.5 * n;
+    }
+
+  fail += check_stream ("steady access points", steady, 40);
+  fail += check_stream ("uneven access points", uneven,
+                        sizeof (uneven) / sizeof (uneven[0]));
+  fail += check_stream ("non-monotonic timestamps", jumping,
+                        sizeof (jumping) / sizeof (jumping[0]));
+  fail += check_stream ("one access point", single, 1);
+  fail += check_stream ("two access points", pair, 2);
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
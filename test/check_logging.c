@@ -0,0 +1,316 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Check that messages below the level set with vcd_log_set_level ()
+   don't reach the handler, and that messages queued by several threads
+   with vcd_log_async_start () all arrive, in order, in the background
+   thread. With a small queue and a handler held up, messages that don't
+   fit get counted and reported as dropped, while an error waits until
+   it has been handled. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#include <libvcd/logging.h>
+
+#define THREADS  4
+#define MESSAGES 1000
+
+#define SMALL_QUEUE 16
+#define FILLERS     100
+
+static unsigned handled = 0;
+
+#ifdef HAVE_PTHREAD_H
+static pthread_t main_thread;
+static pthread_t handler_thread;
+static bool handler_thread_seen = false;
+static unsigned next_seq[THREADS];
+static unsigned out_of_order = 0;
+static unsigned wrong_thread = 0;
+
+/* the handler waits at the message "held" while gate_closed */
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gate_cond = PTHREAD_COND_INITIALIZER;
+static bool gate_closed = false;
+static bool gate_reached = false;
+
+static unsigned fillers = 0;
+static unsigned long dropped = 0;
+static unsigned errors = 0;
+#endif
+
+static void
+_log_handler (vcd_log_level_t level, const char message[])
+{
+#ifdef HAVE_PTHREAD_H
+  int thread;
+  unsigned seq;
+
+  if (sscanf (message, "thread %d message %u", &thread, &seq) == 2)
+    {
+      /* all of them should come from the one background thread */
+      if (!handler_thread_seen)
+        {
+          handler_thread = pthread_self ();
+          handler_thread_seen = true;
+        }
+
+      if (pthread_equal (pthread_self (), main_thread)
+          || !pthread_equal (pthread_self (), handler_thread))
+        wrong_thread++;
+
+      if (thread < 0 || thread >= THREADS || seq != next_seq[thread]++)
+        out_of_order++;
+    }
+  else
+    {
+      unsigned long n;
+
+      if (!strncmp (message, "filler ", 7))
+        fillers++;
+      else if (sscanf (message, "%lu log messages dropped", &n) == 1)
+        dropped += n;
+      else if (level == VCD_LOG_ERROR)
+        __atomic_add_fetch (&errors, 1, __ATOMIC_RELEASE);
+      else if (!strcmp (message, "held"))
+        {
+          pthread_mutex_lock (&gate_lock);
+          gate_reached = true;
+          pthread_cond_broadcast (&gate_cond);
+          while (gate_closed)
+            pthread_cond_wait (&gate_cond, &gate_lock);
+          pthread_mutex_unlock (&gate_lock);
+        }
+    }
+#endif
+
+  handled++;
+}
+
+static int
+check_level (void)
+{
+  vcd_log_set_level (VCD_LOG_WARN);
+
+  if (vcd_log_enabled (VCD_LOG_INFO) || !vcd_log_enabled (VCD_LOG_WARN))
+    {
+      printf ("vcd_log_enabled () disagrees with vcd_log_set_level ()\n");
+      return 1;
+    }
+
+  vcd_log (VCD_LOG_INFO, "%s", "dropped");
+  vcd_warn ("%s", "kept");
+
+  vcd_log_set_level (VCD_LOG_DEBUG);
+
+  if (handled != 1)
+    {
+      printf ("%u messages handled instead of 1\n", handled);
+      return 1;
+    }
+
+  printf ("checking level gate ... ok!\n");
+
+  return 0;
+}
+
+#ifdef HAVE_PTHREAD_H
+static void *
+_worker (void *user_data)
+{
+  const int num = *(int *) user_data;
+  unsigned i;
+
+  for (i = 0; i < MESSAGES; i++)
+    vcd_info ("thread %d message %u", num, i);
+
+  return NULL;
+}
+
+static int
+check_async (void)
+{
+  pthread_t threads[THREADS];
+  int nums[THREADS];
+  int i;
+
+  handled = 0;
+  main_thread = pthread_self ();
+
+  if (vcd_log_async_start (THREADS * MESSAGES))
+    {
+      printf ("no asynchronous logging here; skipping\n");
+      return 0;
+    }
+
+  if (!vcd_log_async_start (0))
+    {
+      printf ("vcd_log_async_start () started twice\n");
+      return 1;
+    }
+
+  for (i = 0; i < THREADS; i++)
+    {
+      nums[i] = i;
+      if (pthread_create (&threads[i], NULL, _worker, &nums[i]))
+        {
+          printf ("can't start thread %d\n", i);
+          return 1;
+        }
+    }
+
+  for (i = 0; i < THREADS; i++)
+    pthread_join (threads[i], NULL);
+
+  vcd_log_async_stop ();
+
+  printf ("checking async logging ...");
+
+  if (handled != THREADS * MESSAGES)
+    printf ("failed!\n==> %u messages handled instead of %u\n",
+            handled, THREADS * MESSAGES);
+  else if (out_of_order)
+    printf ("failed!\n==> %u messages out of order\n", out_of_order);
+  else if (wrong_thread)
+    printf ("failed!\n==> %u messages not handled by the background thread\n",
+            wrong_thread);
+  else
+    {
+      printf ("ok!\n");
+      return 0;
+    }
+
+  return 1;
+}
+
+static void *
+_error_worker (void *user_data)
+{
+  unsigned *p_seen = user_data;
+
+  vcd_error ("%s", "this one must not get lost");
+
+  /* it has to be handled before vcd_error () returns */
+  *p_seen = __atomic_load_n (&errors, __ATOMIC_ACQUIRE);
+
+  return NULL;
+}
+
+static int
+check_overflow (void)
+{
+  const struct timespec wait = { 0, 50 * 1000 * 1000 };
+  pthread_t thread;
+  unsigned i, seen = 0, early;
+
+  if (vcd_log_async_start (SMALL_QUEUE))
+    return 0;
+
+  /* hold the background thread up in the handler... */
+  gate_closed = true;
+  vcd_info ("%s", "held");
+
+  pthread_mutex_lock (&gate_lock);
+  while (!gate_reached)
+    pthread_cond_wait (&gate_cond, &gate_lock);
+  pthread_mutex_unlock (&gate_lock);
+
+  /* ...so that most of these find the queue full */
+  for (i = 0; i < FILLERS; i++)
+    vcd_info ("filler %u", i);
+
+  if (pthread_create (&thread, NULL, _error_worker, &seen))
+    {
+      printf ("can't start thread\n");
+      return 1;
+    }
+
+  /* the error can't be handled while the gate is closed */
+  nanosleep (&wait, NULL);
+  early = __atomic_load_n (&errors, __ATOMIC_ACQUIRE);
+
+  pthread_mutex_lock (&gate_lock);
+  gate_closed = false;
+  pthread_cond_broadcast (&gate_cond);
+  pthread_mutex_unlock (&gate_lock);
+
+  pthread_join (thread, NULL);
+
+  vcd_log_async_stop ();
+
+  printf ("checking a full queue ...");
+
+  if (!dropped)
+    printf ("failed!\n==> no messages reported dropped\n");
+  else if (fillers + dropped != FILLERS)
+    printf ("failed!\n==> %u messages handled and %lu reported dropped"
+            " of %u\n", fillers, dropped, FILLERS);
+  else if (fillers > SMALL_QUEUE)
+    printf ("failed!\n==> %u messages handled with a queue of %u\n",
+            fillers, SMALL_QUEUE);
+  else if (errors != 1)
+    printf ("failed!\n==> error handled %u times\n", errors);
+  else if (early || seen != 1)
+    printf ("failed!\n==> vcd_error () didn't wait for the handler\n");
+  else
+    {
+      printf ("ok! (%u handled, %lu dropped)\n", fillers, dropped);
+      return 0;
+    }
+
+  return 1;
+}
+#endif
+
+int
+main (int argc, const char *argv[])
+{
+  vcd_log_handler_t default_handler = vcd_log_set_handler (_log_handler);
+  int fail = 0;
+
+  fail += check_level ();
+
+#ifdef HAVE_PTHREAD_H
+  fail += check_async ();
+  fail += check_overflow ();
+#endif
+
+  vcd_log_set_handler (default_handler);
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
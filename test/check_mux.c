@@ -0,0 +1,209 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Take avseq00.m1p apart into its video and audio elementary streams,
+   multiplex them again with vcd_mpeg_mux_new () for VCD 2.0 and SVCD,
+   and check the result against the scanner: it has to parse without
+   complaints, describe the same video and audio as the original, and
+   give back the elementary streams byte for byte, with sane SCR, PTS
+   and DTS. Seeking in it has to give the same packs as reading it
+   front to back, and vcd_obj_append_sequence_play_item () has to take
+   it. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+
+/* Private headers */
+#include "mpeg_mux.h"
+#include "stream_stdio.h"
+#include "vcd.h"
+
+#include "mpeg_test_common.h"
+
+#define VIDEO_ES "check_mux.m1v"
+#define AUDIO_ES "check_mux.mp2"
+
+static const char *
+_check_info (const struct vcd_mpeg_stream_info *p_info,
+             const struct vcd_mpeg_stream_info *p_orig,
+             mpeg_vers_t version, unsigned muxrate)
+{
+  if (p_info->version != version)
+    return "wrong MPEG system version";
+
+  if (p_info->muxrate != muxrate)
+    return "wrong mux rate";
+
+  if (!p_info->shdr[0].seen
+      || p_info->shdr[0].hsize != p_orig->shdr[0].hsize
+      || p_info->shdr[0].vsize != p_orig->shdr[0].vsize
+      || p_info->shdr[0].frate != p_orig->shdr[0].frate
+      || p_info->shdr[0].bitrate != p_orig->shdr[0].bitrate)
+    return "video differs";
+
+  if (!p_info->ahdr[0].seen
+      || p_info->ahdr[0].layer != p_orig->ahdr[0].layer
+      || p_info->ahdr[0].bitrate != p_orig->ahdr[0].bitrate
+      || p_info->ahdr[0].sampfreq != p_orig->ahdr[0].sampfreq)
+    return "audio differs";
+
+  if (p_info->playing_time < p_orig->playing_time - 0.1
+      || p_info->playing_time > p_orig->playing_time + 0.1)
+    return "playing time differs";
+
+  if (!p_info->shdr[0].aps_list
+      || !_cdio_list_length (p_info->shdr[0].aps_list))
+    return "no access points";
+
+  return NULL;
+}
+
+static int
+check_type (vcd_type_t type, const char name[],
+            const struct vcd_mpeg_stream_info *p_orig,
+            const demux_t *p_es)
+{
+  VcdDataSource_t *p_mux;
+  VcdMpegSource_t *p_source;
+  VcdObj_t *p_obj;
+  demux_t dmx;
+  uint8_t *p_all = NULL;
+  long size = 0;
+  const char *failure = NULL;
+
+  printf ("checking %s mux ...", name);
+
+  memset (&dmx, 0, sizeof (dmx));
+  mpeg_test_warnings = 0;
+
+  p_mux = vcd_mpeg_mux_new (type, vcd_data_source_new_stdio (VIDEO_ES),
+                            vcd_data_source_new_stdio (AUDIO_ES));
+  p_source = vcd_mpeg_source_new (p_mux);
+
+  vcd_mpeg_source_scan (p_source, true, false, NULL, NULL);
+
+  failure = _check_info (vcd_mpeg_source_get_info (p_source), p_orig,
+                         type == VCD_TYPE_SVCD
+                         ? MPEG_VERS_MPEG2 : MPEG_VERS_MPEG1,
+                         (type == VCD_TYPE_SVCD ? 150 : 75) * 2352 * 8);
+
+  /* front to back */
+  if (!failure)
+    failure = mpeg_test_read_packs (p_mux, &dmx, &p_all, &size);
+
+  if (!failure
+      && (dmx.len[0] != p_es->len[0] || dmx.len[1] != p_es->len[1]
+          || memcmp (dmx.data[0], p_es->data[0], p_es->len[0])
+          || memcmp (dmx.data[1], p_es->data[1], p_es->len[1])))
+    failure = "elementary streams don't come back";
+
+  /* back to front */
+  if (!failure)
+    failure = mpeg_test_seek_packs (p_mux, p_all, size);
+
+  if (!failure && mpeg_test_warnings)
+    failure = "warnings while multiplexing or scanning";
+
+  /* the first play item of a disc */
+  p_obj = vcd_obj_new (type);
+
+  if (!failure
+      && vcd_obj_append_sequence_play_item (p_obj, p_source, NULL, NULL))
+    failure = "vcd_obj_append_sequence_play_item () failed";
+
+  vcd_obj_destroy (p_obj);
+
+  free (p_all);
+  mpeg_test_demux_free (&dmx);
+
+  if (failure)
+    {
+      printf ("failed!\n==> %s\n", failure);
+      return 1;
+    }
+
+  printf ("ok! (%ld packs)\n", size / PACK_SIZE);
+
+  return 0;
+}
+
+int
+main (int argc, const char *argv[])
+{
+  VcdMpegSource_t *p_orig;
+  demux_t es;
+  uint8_t *p_all;
+  long size, n;
+  int fail = 0;
+
+  vcd_log_set_handler (mpeg_test_log_handler);
+
+  if (!(p_all = mpeg_test_read_avseq (&p_orig, &size)))
+    return EXIT_FAILURE;
+
+  /* take it apart */
+  memset (&es, 0, sizeof (es));
+
+  for (n = 0; n < size / PACK_SIZE; n++)
+    mpeg_test_demux_pack (&es, p_all + n * PACK_SIZE);
+
+  free (p_all);
+
+  if (es.failure || !es.len[0] || !es.len[1]
+      || !mpeg_test_write_file (VIDEO_ES, es.data[0], es.len[0])
+      || !mpeg_test_write_file (AUDIO_ES, es.data[1], es.len[1]))
+    {
+      printf ("can't take avseq00.m1p apart\n");
+      return EXIT_FAILURE;
+    }
+
+  /* ...and put it together again */
+  fail += check_type (VCD_TYPE_VCD2, "VCD 2.0",
+                      vcd_mpeg_source_get_info (p_orig), &es);
+  fail += check_type (VCD_TYPE_SVCD, "SVCD",
+                      vcd_mpeg_source_get_info (p_orig), &es);
+
+  vcd_mpeg_source_destroy (p_orig, true);
+  mpeg_test_demux_free (&es);
+
+  if (!fail)
+    {
+      remove (VIDEO_ES);
+      remove (AUDIO_ES);
+    }
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -11,6 +11,7 @@ fi
 . ${srcdir}/check_vcdimager_fn
 . ${srcdir}/check_vcdxbuild_fn
 . ${srcdir}/check_vcdxrip_fn
+. ${srcdir}/check_vcdverify_fn
 
 BASE=`basename $0 .sh`
 
@@ -122,6 +123,10 @@ test_vcdinfo '-B -i videocd.nrg --debug 3 -I' \
 RC=$?
 check_result $RC 'vcd-info test 3'
 
+test_vcdverify videocd.nrg
+RC=$?
+check_result $RC 'vcdverify'
+
 # if we got this far, everything should be ok
 test_vcdxbuild_cleanup videocd.nrg vcd20_nrg.xml $REMOVE_EXTRA
 exit $RC
@@ -0,0 +1,296 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Cut each packet of avseq00.m1p in two, each half in a pack of its
+   own, and check that vcd_mpeg_repack_new () puts it back into 2324
+   byte packs: the elementary streams and time stamps have to come back
+   as they were, in not many more packs than there were, and seeking
+   has to give the same packs as reading front to back. The scanner
+   has to repacketize the cut stream by itself, without complaints. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+
+/* Private headers */
+#include "mpeg_repack.h"
+#include "stream_stdio.h"
+
+#include "mpeg_test_common.h"
+
+#define CUT_STREAM "check_repack.mpg"
+
+static void
+_put_timecode (uint8_t *p, unsigned prefix, int64_t t)
+{
+  p[0] = (prefix << 4) | (((t >> 30) & 0x07) << 1) | 1;
+  p[1] = (t >> 22) & 0xff;
+  p[2] = (((t >> 15) & 0x7f) << 1) | 1;
+  p[3] = (t >> 7) & 0xff;
+  p[4] = ((t & 0x7f) << 1) | 1;
+}
+
+/* the offset of the first picture resp. audio frame starting in p */
+static int
+_first_au (int id, const uint8_t *p, int len)
+{
+  int n;
+
+  for (n = 0; n + 4 <= len; n++)
+    if (id == 0xe0 ? !p[n] && !p[n + 1] && p[n + 2] == 1 && !p[n + 3]
+        : p[n] == 0xff && (p[n + 1] & 0xf0) == 0xf0)
+      return n;
+
+  return len;
+}
+
+/* puts a pack with SCR scr and the packet id with the header fields
+   std (2 bytes, or NULL) and ts (the time stamps, or NULL) and the
+   payload p of len bytes into *pp */
+static void
+_put_half (uint8_t **pp, long *p_len, int64_t scr, const uint8_t *mux_rate,
+           int id, const uint8_t *std, const uint8_t *ts,
+           const uint8_t *p, int len)
+{
+  uint8_t hdr[12 + 6 + 2 + 10];
+  const int ts_len = !ts ? 1 : (ts[0] >> 4 == 0x3 ? 10 : 5);
+  int hlen = 12 + 6;
+
+  hdr[0] = hdr[1] = 0x00;
+  hdr[2] = 0x01;
+  hdr[3] = 0xba;
+  _put_timecode (hdr + 4, 0x2, scr);
+  memcpy (hdr + 9, mux_rate, 3);
+
+  if (std)
+    {
+      memcpy (hdr + hlen, std, 2);
+      hlen += 2;
+    }
+
+  if (ts)
+    memcpy (hdr + hlen, ts, ts_len);
+  else
+    hdr[hlen] = 0x0f;
+  hlen += ts_len;
+
+  hdr[12] = hdr[13] = 0x00;
+  hdr[14] = 0x01;
+  hdr[15] = id;
+  hdr[16] = (hlen - 18 + len) >> 8;
+  hdr[17] = (hlen - 18 + len) & 0xff;
+
+  mpeg_test_append (pp, p_len, hdr, hlen);
+  mpeg_test_append (pp, p_len, p, len);
+}
+
+/* cuts the pack p in two, or just drops its padding */
+static void
+_cut_pack (uint8_t **pp, long *p_len, const uint8_t *p)
+{
+  const int64_t scr = mpeg_test_timecode (p + 4);
+  int pos = 12;
+
+  while (pos + 6 <= PACK_SIZE && !p[pos] && !p[pos + 1] && p[pos + 2] == 1)
+    {
+      const int id = p[pos + 3];
+      const int plen = p[pos + 4] << 8 | p[pos + 5];
+      const uint8_t *h = p + pos;
+
+      pos += 6 + plen;
+
+      if (id == 0xbb)
+        {
+          mpeg_test_append (pp, p_len, p, 12);
+          mpeg_test_append (pp, p_len, h, 6 + plen);
+        }
+      else if (id == 0xe0 || id == 0xc0)
+        {
+          int std, ts;
+          const int hlen = mpeg_test_pes_header (h, &std, &ts);
+          const int len = plen + 6 - hlen;
+          const int half = len / 2;
+          const uint8_t *_ts = h[ts] >> 4 >= 0x2 ? h + ts : NULL;
+          const bool _second = _first_au (id, h + hlen, len) >= half;
+
+          /* the time stamps go with the half the access unit starts
+             in */
+          _put_half (pp, p_len, scr, p + 9, id, std < 0 ? NULL : h + std,
+                     _second ? NULL : _ts, h + hlen, half);
+          _put_half (pp, p_len, scr + 600, p + 9, id, NULL,
+                     _second ? _ts : NULL, h + hlen + half, len - half);
+        }
+    }
+}
+
+static bool
+_same_p (const demux_t *a, const demux_t *b)
+{
+  int i;
+
+  for (i = 0; i < 2; i++)
+    if (a->len[i] != b->len[i] || memcmp (a->data[i], b->data[i], a->len[i])
+        || a->stamps[i] != b->stamps[i]
+        || memcmp (a->pts[i], b->pts[i], a->stamps[i] * sizeof (int64_t)))
+      return false;
+
+  return true;
+}
+
+static const char *
+_check_repack (const demux_t *p_orig)
+{
+  VcdDataSource_t *p_cut = vcd_data_source_new_stdio (CUT_STREAM);
+  VcdDataSource_t *p_repack;
+  const char *failure = NULL;
+  demux_t dmx;
+  uint8_t *p_all = NULL;
+  long size = 0;
+
+  memset (&dmx, 0, sizeof (dmx));
+
+  if (!vcd_mpeg_repack_needed_p (p_cut))
+    failure = "cut stream deemed fine as it is";
+
+  p_repack = vcd_mpeg_repack_new (p_cut);
+
+  /* front to back */
+  if (!failure)
+    failure = mpeg_test_read_packs (p_repack, &dmx, &p_all, &size);
+
+  if (!failure && !_same_p (&dmx, p_orig))
+    failure = "elementary streams or time stamps don't come back";
+
+  if (!failure && dmx.packs > p_orig->packs)
+    failure = "more packs than before";
+
+  /* back to front */
+  if (!failure)
+    failure = mpeg_test_seek_packs (p_repack, p_all, size);
+
+  if (!failure)
+    printf ("%ld packs ", size / PACK_SIZE);
+
+  vcd_data_source_destroy (p_repack);
+  vcd_data_source_destroy (p_cut);
+  free (p_all);
+  mpeg_test_demux_free (&dmx);
+
+  return failure;
+}
+
+static const char *
+_check_scan (const struct vcd_mpeg_stream_info *p_orig)
+{
+  VcdMpegSource_t *p_source =
+    vcd_mpeg_source_new (vcd_data_source_new_stdio (CUT_STREAM));
+  const struct vcd_mpeg_stream_info *p_info;
+  const char *failure = NULL;
+
+  vcd_mpeg_source_scan (p_source, true, false, NULL, NULL);
+  p_info = vcd_mpeg_source_get_info (p_source);
+
+  if (p_info->packets > p_orig->packets)
+    failure = "more packs than before";
+  else if (!p_info->shdr[0].seen || !p_info->ahdr[0].seen
+           || p_info->shdr[0].hsize != p_orig->shdr[0].hsize
+           || p_info->ahdr[0].bitrate != p_orig->ahdr[0].bitrate)
+    failure = "video or audio differs";
+  else if (p_info->playing_time != p_orig->playing_time)
+    failure = "playing time differs";
+
+  vcd_mpeg_source_destroy (p_source, true);
+
+  return failure;
+}
+
+int
+main (int argc, const char *argv[])
+{
+  VcdMpegSource_t *p_orig;
+  demux_t orig;
+  uint8_t *p_all, *p_cut = NULL;
+  long size, cut_len = 0, n;
+  const char *failure;
+
+  vcd_log_set_handler (mpeg_test_log_handler);
+
+  if (!(p_all = mpeg_test_read_avseq (&p_orig, &size)))
+    return EXIT_FAILURE;
+
+  memset (&orig, 0, sizeof (orig));
+
+  /* cut it up */
+  for (n = 0; n < size / PACK_SIZE; n++)
+    {
+      mpeg_test_demux_pack (&orig, p_all + n * PACK_SIZE);
+      _cut_pack (&p_cut, &cut_len, p_all + n * PACK_SIZE);
+    }
+
+  free (p_all);
+
+  if (orig.failure || !orig.len[0] || !orig.len[1]
+      || !mpeg_test_write_file (CUT_STREAM, p_cut, cut_len))
+    {
+      printf ("can't cut avseq00.m1p up\n");
+      return EXIT_FAILURE;
+    }
+
+  free (p_cut);
+
+  printf ("checking repacketizing ...");
+  failure = _check_repack (&orig);
+
+  if (!failure)
+    failure = _check_scan (vcd_mpeg_source_get_info (p_orig));
+
+  if (!failure && mpeg_test_warnings)
+    failure = "warnings while repacketizing or scanning";
+
+  vcd_mpeg_source_destroy (p_orig, true);
+  mpeg_test_demux_free (&orig);
+
+  if (failure)
+    {
+      printf ("failed!\n==> %s\n", failure);
+      return EXIT_FAILURE;
+    }
+
+  printf ("ok!\n");
+
+  remove (CUT_STREAM);
+
+  return EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,102 @@
+#!/bin/sh
+# checks vcdxbuild --manifest/--reuse-image: rebuilding from an
+# unchanged control file has to copy every sequence track and give the
+# same image, changing an option the tracks depend on has to encode
+# them anew.
+
+if test -z $srcdir ; then
+  srcdir=`pwd`
+fi
+
+. ${srcdir}/check_common_fn
+. ${srcdir}/check_vcdxbuild_fn
+
+BASE=`basename $0 .sh`
+XML=${srcdir}/check_svcd1.xml
+
+reuse_cleanup() {
+  test_vcdxbuild_cleanup videocd.bin.old $BASE.manifest $BASE.log \
+    $BASE-*.xml $BASE-*.bin
+}
+
+# test_vcdxbuild takes the file prefix from the control file's
+# directory, which doesn't hold the MPEG files for the modified ones
+reuse_build() {
+  cmd="../frontends/xml/vcdxbuild $2 --create-time TESTING --check --file-prefix ${srcdir}/ $1"
+  if $cmd > $BASE.log 2>&1; then
+    :
+  else
+    cat $BASE.log
+    echo "$0 failed running:"
+    echo "$cmd"
+    reuse_cleanup
+    exit 1
+  fi
+}
+
+test_vcdxbuild $XML "--manifest=$BASE.manifest"
+RC=$?
+if test $RC -ne 0 ; then
+  if test $RC -eq 77 ; then
+    echo vcdxbuild skipped
+  else
+    echo vcdxbuild failed
+  fi
+  reuse_cleanup
+  exit $RC
+fi
+
+cp videocd.bin $BASE-first.bin
+
+reuse_build $XML "--manifest=$BASE.manifest --reuse-image=videocd.bin"
+
+if test `grep -c "unchanged, copying" $BASE.log` -ne 4 ; then
+  cat $BASE.log
+  echo "$0: unchanged sequence tracks weren't copied"
+  reuse_cleanup
+  exit 1
+fi
+
+if test -f videocd.bin.old ; then
+  echo "$0: videocd.bin.old left behind"
+  reuse_cleanup
+  exit 1
+fi
+
+cmp_files videocd.bin $BASE-first.bin vcdxbuild
+RC=$?
+check_result $RC 'vcdxbuild reusing unchanged image'
+
+for option in "relaxed aps" "update scan offsets" ; do
+  name=`echo $option | tr ' ' '-'`
+
+  sed -e "s|<info>|<option name=\"$option\" value=\"true\"/><info>|" \
+    $XML > $BASE-$name.xml
+
+  reuse_build $XML "--manifest=$BASE.manifest"
+  reuse_build $BASE-$name.xml \
+    "--manifest=$BASE.manifest --reuse-image=videocd.bin"
+
+  if grep "unchanged, copying" $BASE.log > /dev/null ; then
+    cat $BASE.log
+    echo "$0: tracks copied although \`$option' changed"
+    reuse_cleanup
+    exit 1
+  fi
+
+  cp videocd.bin $BASE-$name.bin
+  reuse_build $BASE-$name.xml ""
+
+  cmp_files videocd.bin $BASE-$name.bin vcdxbuild
+  RC=$?
+  check_result $RC "vcdxbuild with \`$option' changed"
+done
+
+# if we got this far, everything should be ok
+reuse_cleanup
+exit $RC
+
+#;;; Local Variables: ***
+#;;; mode:shell-script ***
+#;;; eval: (sh-set-shell "bash") ***
+#;;; End: ***
@@ -0,0 +1,275 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Build and read back several images at the same time, each in its
+   own thread, and check that neither the results nor the log messages
+   get mixed up between threads. Configure with --enable-tsan to run
+   it under ThreadSanitizer. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+
+#include <libvcd/info.h>
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "image_sink.h"
+#include "mpeg_stream.h"
+#include "stream_stdio.h"
+#include "vcd.h"
+
+#define SKIP_TEST_RC 77
+
+#define THREADS 4
+#define ROUNDS  200
+
+typedef struct
+{
+  int num;
+  char mpeg_fname[1024];
+  char bin_fname[32];
+  char cue_fname[32];
+#ifdef HAVE_PTHREAD_H
+  pthread_t thread;
+  pthread_t self;  /* as seen by the thread itself */
+#endif
+
+  unsigned obj_messages;     /* messages seen by the object handlers */
+  unsigned thread_messages;  /* messages seen by the thread handler */
+  unsigned foreign_messages; /* messages that came from another thread */
+  const char *failure;
+} thread_ctx_t;
+
+static void
+_log_handler (vcd_log_level_t level, const char message[], void *p_user_data)
+{
+  thread_ctx_t *p_ctx = p_user_data;
+
+#ifdef HAVE_PTHREAD_H
+  if (!pthread_equal (p_ctx->self, pthread_self ()))
+    p_ctx->foreign_messages++;
+#endif
+
+  p_ctx->thread_messages++;
+}
+
+static void
+_obj_log_handler (vcd_log_level_t level, const char message[],
+                  void *p_user_data)
+{
+  thread_ctx_t *p_ctx = p_user_data;
+
+#ifdef HAVE_PTHREAD_H
+  if (!pthread_equal (p_ctx->self, pthread_self ()))
+    p_ctx->foreign_messages++;
+#endif
+
+  p_ctx->obj_messages++;
+}
+
+static const char *
+_build (thread_ctx_t *p_ctx)
+{
+  VcdObj_t *p_vcdobj = vcd_obj_new (VCD_TYPE_VCD2);
+  VcdImageSink_t *p_sink = vcd_image_sink_new_bincue ();
+  char volume_id[16];
+  int rc;
+
+  vcd_obj_set_log_handler (p_vcdobj, _obj_log_handler, p_ctx);
+
+  snprintf (volume_id, sizeof (volume_id), "THREAD%d", p_ctx->num);
+  vcd_obj_set_param_str (p_vcdobj, VCD_PARM_VOLUME_ID, volume_id);
+
+  if (vcd_obj_append_sequence_play_item
+      (p_vcdobj,
+       vcd_mpeg_source_new (vcd_data_source_new_stdio (p_ctx->mpeg_fname)),
+       NULL, NULL) < 0)
+    {
+      vcd_image_sink_destroy (p_sink);
+      vcd_obj_destroy (p_vcdobj);
+      return "could not add MPEG track";
+    }
+
+  vcd_image_sink_set_arg (p_sink, "bin", p_ctx->bin_fname);
+  vcd_image_sink_set_arg (p_sink, "cue", p_ctx->cue_fname);
+
+  vcd_obj_begin_output (p_vcdobj);
+  rc = vcd_obj_write_image (p_vcdobj, p_sink, NULL, NULL, NULL);
+  vcd_obj_end_output (p_vcdobj);
+  vcd_obj_destroy (p_vcdobj);
+
+  return rc ? "writing image failed" : NULL;
+}
+
+static const char *
+_inspect (thread_ctx_t *p_ctx)
+{
+  vcdinfo_obj_t *p_vcdinfo = NULL;
+  char *psz_source = strdup (p_ctx->cue_fname);
+  char volume_id[16];
+  char pin[80];
+  const char *failure = NULL;
+  int i;
+
+  if (vcdinfo_open (&p_vcdinfo, &psz_source, DRIVER_BINCUE, NULL)
+      != VCDINFO_OPEN_VCD)
+    {
+      free (psz_source);
+      return "image is not recognized as a VCD";
+    }
+
+  vcdinfo_set_log_handler (p_vcdinfo, _obj_log_handler, p_ctx);
+
+  snprintf (volume_id, sizeof (volume_id), "THREAD%d", p_ctx->num);
+  snprintf (pin, sizeof (pin), "%s", vcdinfo_pin2str (2 + p_ctx->num));
+
+  /* the results of these live in per-thread buffers; while the other
+     threads are doing the same they must not change under us */
+  for (i = 0; i < ROUNDS && !failure; i++)
+    {
+      const char *psz_pin = vcdinfo_pin2str (2 + p_ctx->num);
+      const char *psz_vol = vcdinfo_get_volume_id (p_vcdinfo);
+
+      if (strcmp (psz_vol, volume_id))
+        failure = "wrong volume id";
+      else if (strcmp (psz_pin, pin))
+        failure = "wrong play item name";
+    }
+
+  vcdinfo_close (p_vcdinfo);
+  free (psz_source);
+
+  return failure;
+}
+
+static void *
+_worker (void *user_data)
+{
+  thread_ctx_t *p_ctx = user_data;
+
+#ifdef HAVE_PTHREAD_H
+  p_ctx->self = pthread_self ();
+#endif
+  vcd_log_set_thread_handler (_log_handler, p_ctx);
+
+  p_ctx->failure = _build (p_ctx);
+
+  if (!p_ctx->failure)
+    p_ctx->failure = _inspect (p_ctx);
+
+  /* something that is not about any object goes to the thread */
+  vcd_debug ("thread %d done", p_ctx->num);
+
+  vcd_log_set_thread_handler (NULL, NULL);
+
+  return NULL;
+}
+
+int
+main (int argc, const char *argv[])
+{
+/* without __thread the thread log handlers are shared by all threads */
+#if defined HAVE_PTHREAD_H && defined HAVE_TLS
+  thread_ctx_t ctx[THREADS];
+  const char *srcdir = getenv ("srcdir");
+  int i, fail = 0;
+
+  if (!srcdir)
+    srcdir = ".";
+
+  /* driver setup in libcdio isn't thread safe */
+  cdio_init ();
+  /* neither is libcdio's logging */
+  cdio_loglevel_default = CDIO_LOG_ASSERT;
+
+  memset (ctx, 0, sizeof (ctx));
+
+  for (i = 0; i < THREADS; i++)
+    {
+      ctx[i].num = i;
+      snprintf (ctx[i].mpeg_fname, sizeof (ctx[i].mpeg_fname),
+                "%s/avseq00.m1p", srcdir);
+      snprintf (ctx[i].bin_fname, sizeof (ctx[i].bin_fname),
+                "threads%d.bin", i);
+      snprintf (ctx[i].cue_fname, sizeof (ctx[i].cue_fname),
+                "threads%d.cue", i);
+
+      if (pthread_create (&ctx[i].thread, NULL, _worker, &ctx[i]))
+        {
+          printf ("can't start thread %d\n", i);
+          return EXIT_FAILURE;
+        }
+    }
+
+  for (i = 0; i < THREADS; i++)
+    {
+      pthread_join (ctx[i].thread, NULL);
+
+      printf ("checking thread %d ...", i);
+
+      if (ctx[i].failure)
+        printf ("failed!\n==> %s\n", ctx[i].failure);
+      else if (ctx[i].foreign_messages)
+        printf ("failed!\n==> %u messages from other threads\n",
+                ctx[i].foreign_messages);
+      else if (!ctx[i].obj_messages)
+        printf ("failed!\n==> object log handler not called\n");
+      else if (!ctx[i].thread_messages)
+        printf ("failed!\n==> thread log handler not called\n");
+      else
+        {
+          printf ("ok!\n");
+          remove (ctx[i].bin_fname);
+          remove (ctx[i].cue_fname);
+          continue;
+        }
+
+      fail++;
+    }
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+#elif defined HAVE_PTHREAD_H
+  printf ("no thread-local storage; skipping test\n");
+  return SKIP_TEST_RC;
+#else
+  printf ("no thread support; skipping test\n");
+  return SKIP_TEST_RC;
+#endif
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
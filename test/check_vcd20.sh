@@ -10,6 +10,7 @@ fi
 . ${srcdir}/check_vcdimager_fn
 . ${srcdir}/check_vcdxbuild_fn
 . ${srcdir}/check_vcdxrip_fn
+. ${srcdir}/check_vcdverify_fn
 
 BASE=`basename $0 .sh`
 RC=0
@@ -108,6 +109,35 @@ test_vcdinfo '-B --bin-file videocd.bin --debug 4 -f -L -S --show-pvd vol' \
 RC=$?
 check_result $RC 'vcd-info test 3'
 
+test_vcdverify '--jobs=2 videocd.cue'
+RC=$?
+check_result $RC 'vcdverify'
+
+test_vcdverify_stdin videocd.bin
+RC=$?
+check_result $RC 'vcdverify from stdin'
+
+# sector 16 holds the ISO-9660 primary volume descriptor (form 1), the
+# last one is an empty form 2 sector; each corruption has to be found
+LAST=`wc -c < videocd.bin`
+LAST=`expr $LAST / 2352 - 1`
+
+test_vcdverify_bad videocd.cue 16 1 sync
+RC=$?
+check_result $RC 'vcdverify bad sync'
+
+test_vcdverify_bad videocd.cue 16 12 address
+RC=$?
+check_result $RC 'vcdverify bad header address'
+
+test_vcdverify_bad videocd.cue $LAST 2348 EDC
+RC=$?
+check_result $RC 'vcdverify bad EDC'
+
+test_vcdverify_bad videocd.cue 16 2200 ECC
+RC=$?
+check_result $RC 'vcdverify bad ECC'
+
 # if we got this far, everything should be ok
 test_vcdxbuild_cleanup
 exit 0
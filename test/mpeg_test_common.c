@@ -0,0 +1,278 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+
+#include "stream_stdio.h"
+#include "mpeg_test_common.h"
+
+unsigned mpeg_test_warnings = 0;
+
+void
+mpeg_test_log_handler (vcd_log_level_t level, const char message[])
+{
+  /* MPEG-1 video has no SVCD scan information, which is fine here */
+  if (level == VCD_LOG_WARN && !strstr (message, "scan information"))
+    {
+      printf ("warning: %s\n", message);
+      mpeg_test_warnings++;
+    }
+  else if (level >= VCD_LOG_ERROR)
+    {
+      printf ("error: %s\n", message);
+      exit (EXIT_FAILURE);
+    }
+}
+
+int64_t
+mpeg_test_timecode (const uint8_t *p)
+{
+  return ((int64_t) (p[0] >> 1) & 0x07) << 30 | p[1] << 22
+    | (p[2] >> 1) << 15 | p[3] << 7 | p[4] >> 1;
+}
+
+static int64_t
+_mpeg2_scr (const uint8_t *p)
+{
+  return ((int64_t) (p[0] >> 3) & 0x07) << 30 | (p[0] & 0x03) << 28
+    | p[1] << 20 | (p[2] >> 3) << 15 | (p[2] & 0x03) << 13
+    | p[3] << 5 | p[4] >> 3;
+}
+
+void
+mpeg_test_append (uint8_t **pp, long *p_len, const uint8_t *p, long len)
+{
+  *pp = realloc (*pp, *p_len + len);
+  memcpy (*pp + *p_len, p, len);
+  *p_len += len;
+}
+
+int
+mpeg_test_pes_header (const uint8_t *p, int *p_std, int *p_ts)
+{
+  int hlen = 6;
+
+  while (p[hlen] == 0xff)
+    hlen++;
+
+  *p_std = -1;
+  if (p[hlen] >> 6 == 1)
+    {
+      *p_std = hlen;
+      hlen += 2;
+    }
+
+  *p_ts = hlen;
+  switch (p[hlen] >> 4)
+    {
+    case 0x2:
+      return hlen + 5;
+    case 0x3:
+      return hlen + 10;
+    default:
+      return hlen + 1;
+    }
+}
+
+void
+mpeg_test_demux_pack (demux_t *p_dmx, const uint8_t *p)
+{
+  const bool _mpeg2 = (p[4] >> 6) == 0x1;
+  int64_t scr;
+  int pos;
+
+  if (p[0] || p[1] || p[2] != 1 || p[3] != 0xba
+      || (!_mpeg2 && (p[4] >> 4) != 0x2))
+    {
+      p_dmx->failure = "pack header missing";
+      return;
+    }
+
+  scr = _mpeg2 ? _mpeg2_scr (p + 4) : mpeg_test_timecode (p + 4);
+  pos = _mpeg2 ? 14 + (p[13] & 0x07) : 12;
+
+  p_dmx->packs++;
+
+  while (pos + 6 <= PACK_SIZE && !p[pos] && !p[pos + 1] && p[pos + 2] == 1)
+    {
+      const int id = p[pos + 3];
+      const int plen = p[pos + 4] << 8 | p[pos + 5];
+      const int idx = id == 0xe0 ? 0 : 1;
+      const uint8_t *h = p + pos;
+      int64_t pts = -1, dts = -1;
+      int hlen;
+
+      if (pos + 6 + plen > PACK_SIZE)
+        {
+          p_dmx->failure = "packet beyond end of pack";
+          return;
+        }
+
+      pos += 6 + plen;
+
+      if (id != 0xe0 && id != 0xc0)
+        continue;
+
+      if (_mpeg2)
+        {
+          if (h[7] >> 6 >= 2)
+            pts = dts = mpeg_test_timecode (h + 9);
+          if (h[7] >> 6 == 3)
+            dts = mpeg_test_timecode (h + 14);
+          hlen = 9 + h[8];
+        }
+      else
+        {
+          int std, ts;
+
+          hlen = mpeg_test_pes_header (h, &std, &ts);
+          if (h[ts] >> 4 >= 0x2)
+            pts = dts = mpeg_test_timecode (h + ts);
+          if (h[ts] >> 4 == 0x3)
+            dts = mpeg_test_timecode (h + ts + 5);
+        }
+
+      if (dts > pts)
+        p_dmx->failure = "DTS after PTS";
+      else if (pts >= 0 && dts <= scr)
+        p_dmx->failure = "access unit sent after its DTS";
+
+      if (pts >= 0)
+        {
+          p_dmx->pts[idx] = realloc (p_dmx->pts[idx], (p_dmx->stamps[idx] + 1)
+                                     * sizeof (int64_t));
+          p_dmx->pts[idx][p_dmx->stamps[idx]++] = pts;
+        }
+
+      mpeg_test_append (&p_dmx->data[idx], &p_dmx->len[idx], h + hlen,
+                        plen + 6 - hlen);
+    }
+}
+
+void
+mpeg_test_demux_free (demux_t *p_dmx)
+{
+  free (p_dmx->data[0]);
+  free (p_dmx->data[1]);
+  free (p_dmx->pts[0]);
+  free (p_dmx->pts[1]);
+}
+
+bool
+mpeg_test_write_file (const char fname[], const uint8_t *p, long len)
+{
+  FILE *fd = fopen (fname, "wb");
+  bool _ok = fd && fwrite (p, 1, len, fd) == len;
+
+  if (fd && fclose (fd))
+    _ok = false;
+
+  return _ok;
+}
+
+uint8_t *
+mpeg_test_read_avseq (VcdMpegSource_t **pp_orig, long *p_size)
+{
+  const char *srcdir = getenv ("srcdir");
+  char fname[1024];
+  uint8_t *p_all;
+  FILE *fd;
+
+  if (!srcdir)
+    srcdir = ".";
+
+  snprintf (fname, sizeof (fname), "%s/avseq00.m1p", srcdir);
+
+  *pp_orig = vcd_mpeg_source_new (vcd_data_source_new_stdio (fname));
+  vcd_mpeg_source_scan (*pp_orig, true, false, NULL, NULL);
+
+  *p_size = vcd_mpeg_source_get_info (*pp_orig)->packets * PACK_SIZE;
+  p_all = malloc (*p_size);
+
+  fd = fopen (fname, "rb");
+
+  if (!fd || fread (p_all, 1, *p_size, fd) != *p_size)
+    {
+      printf ("can't read `%s'\n", fname);
+      free (p_all);
+      p_all = NULL;
+    }
+
+  if (fd)
+    fclose (fd);
+
+  return p_all;
+}
+
+const char *
+mpeg_test_read_packs (VcdDataSource_t *p_source, demux_t *p_dmx,
+                      uint8_t **pp_all, long *p_size)
+{
+  long n;
+
+  *p_size = vcd_data_source_stat (p_source);
+  *pp_all = malloc (*p_size);
+
+  vcd_data_source_seek (p_source, 0);
+  if (*p_size % PACK_SIZE
+      || vcd_data_source_read (p_source, *pp_all, 1, *p_size) != *p_size)
+    return "stream isn't made of whole packs";
+
+  for (n = 0; !p_dmx->failure && n < *p_size / PACK_SIZE; n++)
+    mpeg_test_demux_pack (p_dmx, *pp_all + n * PACK_SIZE);
+
+  return p_dmx->failure;
+}
+
+const char *
+mpeg_test_seek_packs (VcdDataSource_t *p_source, const uint8_t *p_all,
+                      long size)
+{
+  long n;
+
+  for (n = size / PACK_SIZE - 1; n >= 0; n--)
+    {
+      uint8_t pack[PACK_SIZE];
+
+      vcd_data_source_seek (p_source, n * PACK_SIZE);
+      if (vcd_data_source_read (p_source, pack, 1, PACK_SIZE) != PACK_SIZE
+          || memcmp (pack, p_all + n * PACK_SIZE, PACK_SIZE))
+        return "seeking gives other packs";
+    }
+
+  return NULL;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
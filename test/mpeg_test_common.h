@@ -0,0 +1,99 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* what check_mux.c and check_repack.c have in common: taking 2324
+   byte packs apart again, reading a stream front to back and seeking
+   in it back to front, and avseq00.m1p */
+
+#ifndef __MPEG_TEST_COMMON_H__
+#define __MPEG_TEST_COMMON_H__
+
+#include <libvcd/logging.h>
+
+/* Private headers */
+#include "mpeg_stream.h"
+#include "stream.h"
+
+#define PACK_SIZE 2324
+
+typedef struct {
+  uint8_t *data[2];   /* video, audio */
+  long len[2];
+  int64_t *pts[2];    /* the time stamps, in order */
+  unsigned stamps[2];
+  unsigned packs;
+  const char *failure;
+} demux_t;
+
+/* the warnings mpeg_test_log_handler () has seen */
+extern unsigned mpeg_test_warnings;
+
+/* counts and prints warnings, and exits on errors */
+void
+mpeg_test_log_handler (vcd_log_level_t level, const char message[]);
+
+/* a 33 bit PTS, DTS or MPEG-1 SCR */
+int64_t
+mpeg_test_timecode (const uint8_t *p);
+
+void
+mpeg_test_append (uint8_t **pp, long *p_len, const uint8_t *p, long len);
+
+/* the length of the MPEG-1 PES header at p, which has the STD buffer
+   field at *p_std, if any, and the time stamps at *p_ts */
+int
+mpeg_test_pes_header (const uint8_t *p, int *p_std, int *p_ts);
+
+/* collects the payload and PTS of the video and audio packets of the
+   MPEG-1 or MPEG-2 pack p, and sets p_dmx->failure if it isn't sane */
+void
+mpeg_test_demux_pack (demux_t *p_dmx, const uint8_t *p);
+
+void
+mpeg_test_demux_free (demux_t *p_dmx);
+
+bool
+mpeg_test_write_file (const char fname[], const uint8_t *p, long len);
+
+/* scans $srcdir/avseq00.m1p into *pp_orig and returns its packs,
+   *p_size bytes, or NULL if it can't be read */
+uint8_t *
+mpeg_test_read_avseq (VcdMpegSource_t **pp_orig, long *p_size);
+
+/* reads p_source front to back into *pp_all, *p_size bytes, and
+   demuxes it into p_dmx; returns what's wrong, or NULL */
+const char *
+mpeg_test_read_packs (VcdDataSource_t *p_source, demux_t *p_dmx,
+                      uint8_t **pp_all, long *p_size);
+
+/* seeks to each pack of p_source back to front; returns what's wrong
+   if they aren't the ones in p_all, or NULL */
+const char *
+mpeg_test_seek_packs (VcdDataSource_t *p_source, const uint8_t *p_all,
+                      long size);
+
+#endif /* __MPEG_TEST_COMMON_H__ */
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */
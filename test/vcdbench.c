@@ -0,0 +1,985 @@
+/*
+    Copyright (C) 2018 Rocky Bernstein <rocky@gnu.org>
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+*/
+
+/* Benchmarks for the parts of libvcd where the time goes; run with
+   'make bench'.
+
+   A synthetic MPEG program stream is generated first, so no large
+   sample files are needed and the input can be scaled as wanted. The
+   stream is not decodable, but its pack, system, PES, sequence, GOP,
+   picture and audio frame headers are what a VCD (MPEG-1) or SVCD
+   (MPEG-2) stream has, which is all libvcd looks at.
+
+   Each benchmark prints one line of space separated key=value pairs,
+   in a fixed order, e.g.
+
+     bench=scan type=vcd bytes=10458000 sectors=4500 seconds=0.041234
+     mb_per_s=241.88 sectors_per_s=109132.4
+
+   (on a single line), so results can be compared between runs with
+   simple text tools. When a benchmark is repeated, the fastest run is
+   reported. */
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+/* We don't want to pull in cdio's config */
+#define __CDIO_CONFIG_H__
+#include <cdio/cdio.h>
+
+/* Public headers */
+#include <libvcd/info.h>
+#include <libvcd/logging.h>
+#include <libvcd/sector.h>
+
+/* Private headers */
+#include "directory.h"
+#include "image_sink.h"
+#include "mpeg_stream.h"
+#include "stream_stdio.h"
+#include "vcd.h"
+
+#define BENCH_MPEG    "bench.mpg"
+#define BENCH_BIN     "bench.bin"
+#define BENCH_CUE     "bench.cue"
+#define BENCH_NRG     "bench.nrg"
+#define BENCH_TOC     "bench.toc"
+#define BENCH_IMG     "bench"
+#define BENCH_RIPPED  "bench_rip.mpg"
+
+#define PACK_SIZE     M2F2_SECTOR_SIZE
+
+/* sectors read at once when ripping */
+#define RIP_BLOCK     32
+
+static struct
+{
+  const char *type_name;
+  vcd_type_t vcd_type;
+  bool mpeg2;
+
+  double length;         /* seconds */
+  unsigned bitrate;      /* video, bits/s */
+  double aps;            /* access points per second */
+  unsigned audio;        /* audio streams */
+
+  unsigned repeat;
+  const char *only;
+  bool keep;
+  bool verbose;
+} gl = {
+  "vcd", VCD_TYPE_VCD2, false,
+  60.0, 1150000, 2.0, 1,
+  1, NULL, false, false
+};
+
+typedef struct
+{
+  unsigned long long bytes;
+  unsigned long long sectors;
+  double seconds;
+  bool skipped;
+} bench_result_t;
+
+static double
+_now (void)
+{
+  struct timeval tv;
+
+  gettimeofday (&tv, NULL);
+
+  return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+static void
+_log_handler (vcd_log_level_t level, const char message[])
+{
+  if (level < (gl.verbose ? VCD_LOG_WARN : VCD_LOG_ERROR))
+    return;
+
+  fprintf (stderr, "vcdbench: %s\n", message);
+
+  if (level >= VCD_LOG_ERROR)
+    exit (EXIT_FAILURE);
+}
+
+/*
+ * synthetic MPEG program stream
+ */
+
+/* used for SCR and PTS, with the 4 bit prefix in front */
+static uint8_t *
+_put_timecode (uint8_t *p, unsigned prefix, uint64_t ts)
+{
+  *p++ = (prefix << 4) | ((ts >> 29) & 0x0e) | 1;
+  *p++ = (ts >> 22) & 0xff;
+  *p++ = ((ts >> 14) & 0xfe) | 1;
+  *p++ = (ts >> 7) & 0xff;
+  *p++ = ((ts << 1) & 0xfe) | 1;
+
+  return p;
+}
+
+static uint8_t *
+_put_start_code (uint8_t *p, uint8_t code)
+{
+  *p++ = 0x00;
+  *p++ = 0x00;
+  *p++ = 0x01;
+  *p++ = code;
+
+  return p;
+}
+
+static uint8_t *
+_put_pack_header (uint8_t *p, uint64_t scr, unsigned muxrate)
+{
+  p = _put_start_code (p, 0xba);
+
+  if (gl.mpeg2)
+    {
+      const unsigned scr_ext = 0;
+
+      *p++ = 0x44 | ((scr >> 27) & 0x38) | ((scr >> 28) & 0x03);
+      *p++ = (scr >> 20) & 0xff;
+      *p++ = ((scr >> 12) & 0xf8) | 0x04 | ((scr >> 13) & 0x03);
+      *p++ = (scr >> 5) & 0xff;
+      *p++ = ((scr << 3) & 0xf8) | 0x04 | ((scr_ext >> 7) & 0x03);
+      *p++ = ((scr_ext << 1) & 0xfe) | 1;
+      *p++ = (muxrate >> 14) & 0xff;
+      *p++ = (muxrate >> 6) & 0xff;
+      *p++ = ((muxrate << 2) & 0xfc) | 0x03;
+      *p++ = 0xf8; /* no stuffing */
+    }
+  else
+    {
+      p = _put_timecode (p, 0x2, scr);
+      *p++ = 0x80 | ((muxrate >> 15) & 0x7f);
+      *p++ = (muxrate >> 7) & 0xff;
+      *p++ = ((muxrate << 1) & 0xfe) | 1;
+    }
+
+  return p;
+}
+
+static uint8_t *
+_put_system_header (uint8_t *p, unsigned muxrate)
+{
+  uint8_t *p_len;
+  unsigned i;
+
+  p = _put_start_code (p, 0xbb);
+  p_len = p;
+  p += 2;
+
+  *p++ = 0x80 | ((muxrate >> 15) & 0x7f);
+  *p++ = (muxrate >> 7) & 0xff;
+  *p++ = ((muxrate << 1) & 0xfe) | 1;
+  *p++ = (gl.audio << 2) | 0x02; /* CSPS */
+  *p++ = 0xe0 | 1;               /* locked, one video stream */
+  *p++ = 0x7f;
+
+  /* buffer sizes are in units of 1024 bytes for video and 128 bytes
+     for audio */
+  *p++ = 0xe0;
+  *p++ = 0xe0;
+  *p++ = gl.mpeg2 ? 230 : 46;
+
+  for (i = 0; i < gl.audio; i++)
+    {
+      *p++ = 0xc0 + i;
+      *p++ = 0xc0;
+      *p++ = 32;
+    }
+
+  p_len[0] = (p - p_len - 2) >> 8;
+  p_len[1] = (p - p_len - 2) & 0xff;
+
+  return p;
+}
+
+/* Start a packet of the given stream that fills up the pack up to
+   end, and return where its payload goes. */
+static uint8_t *
+_put_packet_header (uint8_t *p, const uint8_t *end, uint8_t stream_id,
+                    const uint64_t *p_pts)
+{
+  uint8_t *p_len;
+  unsigned size;
+
+  p = _put_start_code (p, stream_id);
+  p_len = p;
+  p += 2;
+
+  if (stream_id != 0xbe) /* padding packets have no PES header */
+    {
+      if (gl.mpeg2)
+        {
+          *p++ = 0x81;
+          *p++ = p_pts ? 0x80 : 0x00;
+          *p++ = p_pts ? 5 : 0;
+          if (p_pts)
+            p = _put_timecode (p, 0x2, *p_pts);
+        }
+      else if (p_pts)
+        p = _put_timecode (p, 0x2, *p_pts);
+      else
+        *p++ = 0x0f;
+    }
+
+  size = end - p_len - 2;
+  p_len[0] = size >> 8;
+  p_len[1] = size & 0xff;
+
+  /* filler which won't be taken for a start code */
+  memset (p, 0x55, end - p);
+
+  return p;
+}
+
+static uint8_t *
+_put_sequence_header (uint8_t *p)
+{
+  const unsigned hsize = gl.mpeg2 ? 480 : 352;
+  const unsigned vsize = gl.mpeg2 ? 480 : 240;
+  const unsigned aratio = gl.mpeg2 ? 2 : 12;
+  const unsigned frate = 4; /* 29.97 */
+  const unsigned brate = gl.bitrate / 400;
+  const unsigned vbv = gl.mpeg2 ? 112 : 20;
+
+  p = _put_start_code (p, 0xb3);
+
+  *p++ = hsize >> 4;
+  *p++ = ((hsize & 0x0f) << 4) | (vsize >> 8);
+  *p++ = vsize & 0xff;
+  *p++ = (aratio << 4) | frate;
+  *p++ = (brate >> 10) & 0xff;
+  *p++ = (brate >> 2) & 0xff;
+  *p++ = ((brate & 0x03) << 6) | 0x20 | ((vbv >> 5) & 0x1f);
+  *p++ = ((vbv & 0x1f) << 3) | (gl.mpeg2 ? 0 : 0x04);
+
+  return p;
+}
+
+static uint8_t *
+_put_gop_header (uint8_t *p, double t)
+{
+  const unsigned secs = t;
+  const unsigned h = secs / 3600, m = (secs / 60) % 60, s = secs % 60;
+  const unsigned f = (unsigned) ((t - secs) * 30) % 30;
+
+  p = _put_start_code (p, 0xb8);
+
+  *p++ = (h << 2) | (m >> 4);
+  *p++ = ((m & 0x0f) << 4) | 0x08 | (s >> 3);
+  *p++ = ((s & 0x07) << 5) | (f >> 1);
+  *p++ = ((f & 0x01) << 7) | 0x40; /* closed GOP */
+
+  return p;
+}
+
+static uint8_t *
+_put_picture_header (uint8_t *p, unsigned temporal_ref, unsigned type)
+{
+  p = _put_start_code (p, 0x00);
+
+  *p++ = (temporal_ref >> 2) & 0xff;
+  *p++ = ((temporal_ref & 0x03) << 6) | (type << 3) | 0x07;
+  *p++ = 0xff;
+  *p++ = 0xf8;
+
+  return p;
+}
+
+/* empty scan information, as SVCD wants it after each I-picture */
+static uint8_t *
+_put_scan_data (uint8_t *p)
+{
+  p = _put_start_code (p, 0xb2);
+
+  *p++ = 0x10;
+  *p++ = 14;
+  memset (p, 0xff, 12);
+
+  return p + 12;
+}
+
+/* Write the stream described by gl to fd and return the number of
+   packs written. */
+static unsigned long
+_generate_mpeg (FILE *fd)
+{
+  const unsigned packs_per_sec = gl.mpeg2 ? 150 : 75;
+  const unsigned long packs = gl.length * packs_per_sec;
+  const unsigned muxrate = CDIO_CD_FRAMESIZE_RAW * packs_per_sec / 50;
+  const double audio_rate = 224000;
+  double video_credit = 0, audio_credit[3] = { 0, };
+  double next_aps = 0;
+  unsigned frame = 0;
+  unsigned long n;
+
+  for (n = 0; n < packs; n++)
+    {
+      uint8_t buf[PACK_SIZE];
+      uint8_t *p = buf;
+      const uint8_t *end = buf + sizeof (buf);
+      const double t = (double) n / packs_per_sec;
+      const uint64_t scr = (uint64_t) n * 90000 / packs_per_sec;
+      const uint64_t pts = scr + 90000 / 4; /* decoder delay */
+      double best = 0;
+      int stream = -1; /* padding */
+      unsigned i;
+
+      p = _put_pack_header (p, scr, muxrate);
+
+      video_credit += gl.bitrate / 8.0 / packs_per_sec;
+      for (i = 0; i < gl.audio; i++)
+        audio_credit[i] += audio_rate / 8.0 / packs_per_sec;
+
+      if (!n)
+        p = _put_system_header (p, muxrate);
+      else
+        {
+          if (video_credit > best)
+            best = video_credit, stream = 0;
+
+          for (i = 0; i < gl.audio; i++)
+            if (audio_credit[i] > best)
+              best = audio_credit[i], stream = 1 + i;
+        }
+
+      switch (stream)
+        {
+        case -1:
+          _put_packet_header (p, end, 0xbe, NULL);
+          break;
+
+        case 0:
+          p = _put_packet_header (p, end, 0xe0, &pts);
+          video_credit -= end - p;
+
+          if (t >= next_aps)
+            {
+              p = _put_sequence_header (p);
+              p = _put_gop_header (p, t);
+              p = _put_picture_header (p, 0, 1);
+              if (gl.mpeg2)
+                p = _put_scan_data (p);
+              p = _put_start_code (p, 0x01); /* first slice */
+
+              next_aps += 1.0 / gl.aps;
+              frame = 0;
+            }
+          else
+            {
+              p = _put_picture_header (p, ++frame, 2);
+              p = _put_start_code (p, 0x01);
+            }
+          break;
+
+        default:
+          p = _put_packet_header (p, end, 0xc0 + stream - 1, &pts);
+          audio_credit[stream - 1] -= end - p;
+
+          /* layer II, 224 kbit/s, 44.1 kHz, stereo */
+          *p++ = 0xff;
+          *p++ = 0xfd;
+          *p++ = 0xb0;
+          *p++ = 0x04;
+          break;
+        }
+
+      if (fwrite (buf, sizeof (buf), 1, fd) != 1)
+        return 0;
+    }
+
+  return packs;
+}
+
+/*
+ * benchmarks
+ */
+
+static bool
+_bench_generate (bench_result_t *p_res)
+{
+  FILE *fd = fopen (BENCH_MPEG, "wb");
+  unsigned long packs;
+
+  if (!fd)
+    return false;
+
+  packs = _generate_mpeg (fd);
+  if (fclose (fd) || !packs)
+    return false;
+
+  p_res->sectors = packs;
+  p_res->bytes = (unsigned long long) packs * PACK_SIZE;
+
+  return true;
+}
+
+static bool
+_bench_scan (bench_result_t *p_res)
+{
+  VcdMpegSource_t *p_src =
+    vcd_mpeg_source_new (vcd_data_source_new_stdio (BENCH_MPEG));
+
+  vcd_mpeg_source_scan (p_src, true, gl.mpeg2, NULL, NULL);
+
+  p_res->sectors = vcd_mpeg_source_get_info (p_src)->packets;
+  p_res->bytes = p_res->sectors * PACK_SIZE;
+
+  vcd_mpeg_source_destroy (p_src, true);
+
+  return p_res->sectors != 0;
+}
+
+static bool
+_bench_packet_fetch (bench_result_t *p_res)
+{
+  VcdMpegSource_t *p_src =
+    vcd_mpeg_source_new (vcd_data_source_new_stdio (BENCH_MPEG));
+  unsigned long i, packets;
+  double t0;
+
+  vcd_mpeg_source_scan (p_src, true, gl.mpeg2, NULL, NULL);
+  packets = vcd_mpeg_source_get_info (p_src)->packets;
+
+  t0 = _now ();
+
+  for (i = 0; i < packets; i++)
+    {
+      uint8_t buf[PACK_SIZE];
+      struct vcd_mpeg_packet_info info;
+
+      vcd_mpeg_source_get_packet (p_src, i, buf, &info, gl.mpeg2);
+    }
+
+  vcd_mpeg_source_close (p_src);
+
+  p_res->seconds = _now () - t0;
+  p_res->sectors = packets;
+  p_res->bytes = packets * PACK_SIZE;
+
+  vcd_mpeg_source_destroy (p_src, true);
+
+  return packets != 0;
+}
+
+static bool
+_bench_edc_ecc (bench_result_t *p_res, bool form2)
+{
+  const unsigned long sectors =
+    gl.length * (gl.mpeg2 ? 150 : 75);
+  uint8_t data[M2F2_SECTOR_SIZE];
+  uint8_t raw[CDIO_CD_FRAMESIZE_RAW];
+  unsigned long i;
+
+  memset (data, 0x55, sizeof (data));
+
+  for (i = 0; i < sectors; i++)
+    {
+      data[0] = i & 0xff;
+      if (form2)
+        _vcd_make_mode2 (raw, data, i, 1, 1, SM_FORM2 | SM_REALT | SM_VIDEO,
+                         CI_MPEG2);
+      else
+        _vcd_make_mode2 (raw, data, i, 0, 0, SM_DATA, 0);
+    }
+
+  p_res->sectors = sectors;
+  p_res->bytes = sectors * (form2 ? M2F2_SECTOR_SIZE : ISO_BLOCKSIZE);
+
+  return true;
+}
+
+static bool
+_bench_edc_ecc_form1 (bench_result_t *p_res)
+{
+  return _bench_edc_ecc (p_res, false);
+}
+
+static bool
+_bench_edc_ecc_form2 (bench_result_t *p_res)
+{
+  return _bench_edc_ecc (p_res, true);
+}
+
+/* an ISO 9660 tree about as big as a well filled disc can get */
+static bool
+_bench_directory (bench_result_t *p_res)
+{
+  VcdDirectory_t *p_dir = _vcd_directory_new ();
+  uint32_t extent = 18, sectors;
+  void *p_buf;
+  unsigned d, f;
+
+  for (d = 0; d < 64; d++)
+    {
+      char path[64];
+
+      snprintf (path, sizeof (path), "DIR%.2u", d);
+      _vcd_directory_mkdir (p_dir, path);
+
+      for (f = 0; f < 64; f++)
+        {
+          snprintf (path, sizeof (path), "DIR%.2u/FILE%.3u.DAT;1", d, f);
+          _vcd_directory_mkfile (p_dir, path, 1000 + d * 64 + f, 2048,
+                                 false, 0);
+        }
+    }
+
+  sectors = _vcd_directory_get_size (p_dir);
+  p_buf = calloc (sectors, ISO_BLOCKSIZE);
+  _vcd_directory_dump_entries (p_dir, p_buf, extent);
+  free (p_buf);
+
+  _vcd_directory_destroy (p_dir);
+
+  p_res->sectors = sectors;
+  p_res->bytes = (unsigned long long) sectors * ISO_BLOCKSIZE;
+
+  return true;
+}
+
+static void
+_remove_image (void)
+{
+  unsigned i;
+
+  remove (BENCH_BIN);
+  remove (BENCH_CUE);
+  remove (BENCH_NRG);
+  remove (BENCH_TOC);
+
+  for (i = 1; i < 100; i++)
+    {
+      char buf[64];
+
+      snprintf (buf, sizeof (buf), "%s_%.2u.img", BENCH_IMG, i);
+      remove (buf);
+      snprintf (buf, sizeof (buf), "%s_%.2u_pregap.img", BENCH_IMG, i);
+      remove (buf);
+    }
+}
+
+/* Only the writing of the image is timed, the MPEG stream is scanned
+   before. */
+static bool
+_bench_image (bench_result_t *p_res, VcdImageSink_t *p_sink)
+{
+  VcdObj_t *p_vcdobj = vcd_obj_new (gl.vcd_type);
+  long sectors;
+  double t0;
+  int rc;
+
+  vcd_obj_set_param_str (p_vcdobj, VCD_PARM_VOLUME_ID, "VCDBENCH");
+  if (gl.mpeg2)
+    vcd_obj_set_param_bool (p_vcdobj, VCD_PARM_UPDATE_SCAN_OFFSETS, true);
+
+  if (vcd_obj_append_sequence_play_item
+      (p_vcdobj, vcd_mpeg_source_new (vcd_data_source_new_stdio (BENCH_MPEG)),
+       NULL, NULL) < 0)
+    {
+      vcd_image_sink_destroy (p_sink);
+      vcd_obj_destroy (p_vcdobj);
+      return false;
+    }
+
+  t0 = _now ();
+
+  sectors = vcd_obj_begin_output (p_vcdobj);
+  rc = vcd_obj_write_image (p_vcdobj, p_sink, NULL, NULL, NULL);
+  vcd_obj_end_output (p_vcdobj);
+
+  p_res->seconds = _now () - t0;
+  p_res->sectors = sectors;
+  p_res->bytes = (unsigned long long) sectors * CDIO_CD_FRAMESIZE_RAW;
+
+  vcd_obj_destroy (p_vcdobj);
+
+  return !rc;
+}
+
+static bool
+_bench_image_bincue (bench_result_t *p_res)
+{
+  VcdImageSink_t *p_sink = vcd_image_sink_new_bincue ();
+
+  vcd_image_sink_set_arg (p_sink, "bin", BENCH_BIN);
+  vcd_image_sink_set_arg (p_sink, "cue", BENCH_CUE);
+
+  return _bench_image (p_res, p_sink);
+}
+
+static bool
+_bench_image_nrg (bench_result_t *p_res)
+{
+  VcdImageSink_t *p_sink = vcd_image_sink_new_nrg ();
+
+  vcd_image_sink_set_arg (p_sink, "nrg", BENCH_NRG);
+
+  return _bench_image (p_res, p_sink);
+}
+
+static bool
+_bench_image_cdrdao (bench_result_t *p_res)
+{
+  VcdImageSink_t *p_sink = vcd_image_sink_new_cdrdao ();
+
+  vcd_image_sink_set_arg (p_sink, "toc", BENCH_TOC);
+  vcd_image_sink_set_arg (p_sink, "img_base", BENCH_IMG);
+
+  return _bench_image (p_res, p_sink);
+}
+
+/* Copy the MPEG tracks of the BIN/CUE image written by the
+   image-bincue benchmark to a file, the way vcdxrip does it. */
+static bool
+_bench_rip (bench_result_t *p_res, bool mapped)
+{
+  vcdinfo_obj_t *p_vcdinfo = NULL;
+  vcdinfo_image_map_t *p_map = NULL;
+  char *psz_source = strdup (BENCH_CUE);
+  CdIo_t *p_cdio;
+  track_t i_track, i_last;
+  FILE *fd;
+  double t0;
+
+  if (vcdinfo_open (&p_vcdinfo, &psz_source, DRIVER_BINCUE, NULL)
+      != VCDINFO_OPEN_VCD)
+    {
+      free (psz_source);
+      return false;
+    }
+
+  p_cdio = vcdinfo_get_cd_image (p_vcdinfo);
+
+  if (mapped && !(p_map = vcdinfo_image_map_new (p_cdio)))
+    {
+      vcdinfo_close (p_vcdinfo);
+      free (psz_source);
+      p_res->skipped = true;
+      return true;
+    }
+
+  fd = fopen (BENCH_RIPPED, "wb");
+
+  t0 = _now ();
+
+  /* the first track holds the ISO 9660 filesystem */
+  i_track = cdio_get_first_track_num (p_cdio) + 1;
+  i_last = cdio_get_first_track_num (p_cdio) + cdio_get_num_tracks (p_cdio);
+
+  for (; i_track < i_last && fd; i_track++)
+    {
+      lsn_t lsn = cdio_get_track_lsn (p_cdio, i_track);
+      const lsn_t end_lsn = cdio_get_track_last_lsn (p_cdio, i_track) + 1;
+
+      while (lsn < end_lsn)
+        {
+          uint8_t buf[RIP_BLOCK * M2RAW_SECTOR_SIZE];
+          const unsigned n = MIN (RIP_BLOCK, end_lsn - lsn);
+          unsigned i;
+
+          for (i = 0; i < n; i++)
+            {
+              const uint8_t *p_sect;
+
+              if (p_map)
+                p_sect = vcdinfo_image_map_sector (p_map, lsn + i);
+              else
+                {
+                  if (!i && cdio_read_mode2_sectors (p_cdio, buf, lsn,
+                                                     true, n))
+                    break;
+                  p_sect = buf + i * M2RAW_SECTOR_SIZE;
+                }
+
+              if (!p_sect)
+                break;
+
+              fwrite (p_sect + CDIO_CD_SUBHEADER_SIZE, M2F2_SECTOR_SIZE, 1,
+                      fd);
+            }
+
+          p_res->sectors += i;
+
+          if (i < n)
+            break;
+
+          lsn += n;
+        }
+    }
+
+  if (fd)
+    fclose (fd);
+
+  p_res->seconds = _now () - t0;
+  p_res->bytes = p_res->sectors * M2F2_SECTOR_SIZE;
+
+  vcdinfo_image_map_destroy (p_map);
+  vcdinfo_close (p_vcdinfo);
+  free (psz_source);
+
+  remove (BENCH_RIPPED);
+
+  return fd && p_res->sectors;
+}
+
+static bool
+_bench_rip_read (bench_result_t *p_res)
+{
+  return _bench_rip (p_res, false);
+}
+
+static bool
+_bench_rip_mapped (bench_result_t *p_res)
+{
+  return _bench_rip (p_res, true);
+}
+
+/* in the order they are run; later ones use the files left behind by
+   earlier ones */
+static const struct {
+  const char *name;
+  bool (*func) (bench_result_t *p_res);
+  bool needed_for_rip;
+} _benchmarks[] = {
+  { "generate",      _bench_generate },
+  { "scan",          _bench_scan },
+  { "packet-fetch",  _bench_packet_fetch },
+  { "edc-ecc-form1", _bench_edc_ecc_form1 },
+  { "edc-ecc-form2", _bench_edc_ecc_form2 },
+  { "directory",     _bench_directory },
+  { "image-nrg",     _bench_image_nrg },
+  { "image-cdrdao",  _bench_image_cdrdao },
+  { "image-bincue",  _bench_image_bincue, true },
+  { "rip",           _bench_rip_read, true },
+  { "rip-mapped",    _bench_rip_mapped },
+};
+
+#define BENCHMARKS (sizeof (_benchmarks) / sizeof (_benchmarks[0]))
+
+static bool
+_selected (const char name[])
+{
+  const char *p;
+  const size_t len = strlen (name);
+
+  if (!gl.only)
+    return true;
+
+  for (p = gl.only; (p = strstr (p, name)); p += len)
+    if ((p == gl.only || p[-1] == ',') && (p[len] == ',' || !p[len]))
+      return true;
+
+  return false;
+}
+
+static bool
+_run (unsigned idx)
+{
+  bench_result_t best = { 0, };
+  unsigned i;
+
+  for (i = 0; i < gl.repeat; i++)
+    {
+      bench_result_t res = { 0, };
+      double t0 = _now ();
+
+      res.seconds = -1;
+
+      if (!_benchmarks[idx].func (&res))
+        {
+          printf ("bench=%s type=%s failed\n", _benchmarks[idx].name,
+                  gl.type_name);
+          return false;
+        }
+
+      /* benchmarks with setup time their work themselves */
+      if (res.seconds < 0)
+        res.seconds = _now () - t0;
+
+      if (res.skipped)
+        {
+          printf ("bench=%s type=%s skipped\n", _benchmarks[idx].name,
+                  gl.type_name);
+          return true;
+        }
+
+      if (!i || res.seconds < best.seconds)
+        best = res;
+    }
+
+  if (best.seconds <= 0)
+    best.seconds = 1e-6;
+
+  printf ("bench=%s type=%s bytes=%llu sectors=%llu seconds=%.6f"
+          " mb_per_s=%.2f sectors_per_s=%.1f\n",
+          _benchmarks[idx].name, gl.type_name, best.bytes, best.sectors,
+          best.seconds, best.bytes / best.seconds / (1024 * 1024),
+          best.sectors / best.seconds);
+  fflush (stdout);
+
+  return true;
+}
+
+static void
+_usage (void)
+{
+  unsigned i;
+
+  printf ("usage: vcdbench [OPTION]...\n"
+          "\n"
+          "  --type=vcd|svcd     kind of MPEG stream and disc (default vcd)\n"
+          "  --length=SECONDS    length of the MPEG stream (default 60)\n"
+          "  --bitrate=KBIT      video bitrate (default 1150, 2000 for svcd)\n"
+          "  --aps=N             access points per second (default 2)\n"
+          "  --audio=N           number of audio streams, 0-3 (default 1)\n"
+          "  --repeat=N          run each benchmark N times, report fastest\n"
+          "  --only=NAME[,NAME]  run these benchmarks only\n"
+          "  --generate=FILE     only write the MPEG stream to FILE\n"
+          "  --keep              keep the generated files\n"
+          "  --verbose           show libvcd warnings\n"
+          "\n"
+          "benchmarks:");
+
+  for (i = 0; i < BENCHMARKS; i++)
+    printf (" %s", _benchmarks[i].name);
+
+  printf ("\n");
+}
+
+int
+main (int argc, const char *argv[])
+{
+  const char *psz_generate = NULL;
+  bool bitrate_set = false;
+  unsigned n;
+  int i, fail = 0;
+
+  for (i = 1; i < argc; i++)
+    {
+      const char *arg = argv[i];
+      const char *val = strchr (arg, '=');
+
+      val = val ? val + 1 : "";
+
+      if (!strncmp (arg, "--type=", 7))
+        {
+          if (!strcmp (val, "vcd"))
+            gl.type_name = "vcd", gl.vcd_type = VCD_TYPE_VCD2, gl.mpeg2 = false;
+          else if (!strcmp (val, "svcd"))
+            gl.type_name = "svcd", gl.vcd_type = VCD_TYPE_SVCD, gl.mpeg2 = true;
+          else
+            {
+              fprintf (stderr, "vcdbench: unknown type `%s'\n", val);
+              return EXIT_FAILURE;
+            }
+        }
+      else if (!strncmp (arg, "--length=", 9))
+        gl.length = atof (val);
+      else if (!strncmp (arg, "--bitrate=", 10))
+        gl.bitrate = atoi (val) * 1000, bitrate_set = true;
+      else if (!strncmp (arg, "--aps=", 6))
+        gl.aps = atof (val);
+      else if (!strncmp (arg, "--audio=", 8))
+        gl.audio = atoi (val);
+      else if (!strncmp (arg, "--repeat=", 9))
+        gl.repeat = atoi (val);
+      else if (!strncmp (arg, "--only=", 7))
+        gl.only = val;
+      else if (!strncmp (arg, "--generate=", 11))
+        psz_generate = val;
+      else if (!strcmp (arg, "--keep"))
+        gl.keep = true;
+      else if (!strcmp (arg, "--verbose"))
+        gl.verbose = true;
+      else
+        {
+          _usage ();
+          return strcmp (arg, "--help") ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+    }
+
+  if (gl.mpeg2 && !bitrate_set)
+    gl.bitrate = 2000000;
+
+  if (gl.length <= 0 || gl.aps <= 0 || gl.audio > 3 || !gl.repeat
+      || gl.bitrate / 400 >= 1 << 18)
+    {
+      fprintf (stderr, "vcdbench: parameter out of range\n");
+      return EXIT_FAILURE;
+    }
+
+  vcd_log_set_handler (_log_handler);
+  cdio_loglevel_default = CDIO_LOG_ERROR;
+
+  if (psz_generate)
+    {
+      FILE *fd = fopen (psz_generate, "wb");
+
+      if (!fd || !_generate_mpeg (fd) || fclose (fd))
+        {
+          perror (psz_generate);
+          return EXIT_FAILURE;
+        }
+
+      return EXIT_SUCCESS;
+    }
+
+  printf ("# vcdbench version=%s type=%s length=%g bitrate=%u aps=%g"
+          " audio=%u repeat=%u\n", VERSION, gl.type_name, gl.length,
+          gl.bitrate, gl.aps, gl.audio, gl.repeat);
+
+  for (n = 0; n < BENCHMARKS; n++)
+    {
+      const bool rip = _selected ("rip") || _selected ("rip-mapped");
+
+      /* the stream everything else works on is always written */
+      if (!n || _selected (_benchmarks[n].name)
+          || (_benchmarks[n].needed_for_rip && rip))
+        if (!_run (n))
+          fail++;
+    }
+
+  if (!gl.keep)
+    {
+      _remove_image ();
+      remove (BENCH_MPEG);
+    }
+
+  return fail ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+
+/*
+ * Local variables:
+ *  c-file-style: "gnu"
+ *  tab-width: 8
+ *  indent-tabs-mode: nil
+ * End:
+ */